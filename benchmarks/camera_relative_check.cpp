@@ -0,0 +1,79 @@
+// Shows the camera-space error of a 10 m mesh placed far from the world origin, as with georeferenced coordinates,
+// with the float model-view of the sample apps and with TriMesh recentering and CameraRelativeModelView. The mesh
+// is written to an OBJ file with world coordinates and loaded with and without recentering, and the camera looks at
+// it from 10 m away. The errors are against the same transformation in double precision. Returns nonzero if the
+// camera-relative error reaches 0.1 mm at any distance.
+//
+// Usage: camera_relative_check
+#include "cyTriMesh.h"
+#include "cyMatrix.h"
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <random>
+#include <string>
+#include <vector>
+
+static const int grid = 21;  // vertices per side, 0.5 m apart
+
+// Writes a terrain patch centered at the given point and returns its vertices as they are read back in double precision
+static std::vector<cy::Vec3d> write_patch(const std::string& filename, const cy::Vec3d& center, std::mt19937& rng) {
+    std::uniform_real_distribution<double> height(-0.5, 0.5);
+    std::vector<cy::Vec3d> vertices;
+    FILE* file = fopen(filename.c_str(), "w");
+    if (!file) return vertices;
+    for (int i = 0; i < grid; i++) {
+        for (int j = 0; j < grid; j++) {
+            cy::Vec3d p = center + cy::Vec3d((i - grid / 2) * 0.5, height(rng), (j - grid / 2) * 0.5);
+            char line[128];
+            snprintf(line, sizeof(line), "v %.6f %.6f %.6f\n", p.x, p.y, p.z);
+            fputs(line, file);
+            sscanf(line + 2, "%lf %lf %lf", &p.x, &p.y, &p.z);
+            vertices.push_back(p);
+        }
+    }
+    for (int i = 0; i + 1 < grid; i++) {
+        for (int j = 0; j + 1 < grid; j++) {
+            int v = i * grid + j + 1;
+            fprintf(file, "f %d %d %d\nf %d %d %d\n", v, v + grid, v + 1, v + 1, v + grid, v + grid + 1);
+        }
+    }
+    fclose(file);
+    return vertices;
+}
+
+int main() {
+    std::string filename = (std::filesystem::temp_directory_path() / "camera_relative_check.obj").string();
+    std::mt19937 rng(1);
+    int failures = 0;
+
+    printf("%-14s %18s %18s\n", "distance (m)", "float mv (mm)", "camera-rel. (mm)");
+    for (double distance : {0.0, 1e3, 1e4, 1e5, 1e6, 6.4e6}) {
+        // A direction that does not line up with an axis, and a center that is not a multiple of the vertex spacing
+        cy::Vec3d center = cy::Vec3d(0.6, 0.08, 0.795).GetNormalized() * distance + cy::Vec3d(0.123, 0.456, 0.789);
+        std::vector<cy::Vec3d> world = write_patch(filename, center, rng);
+        cy::TriMesh plain, recentered;
+        if (world.empty() || !plain.LoadFromFileObj(filename.c_str(), false, nullptr) ||
+            !recentered.LoadFromFileObj(filename.c_str(), false, nullptr, true)) {
+            printf("cannot write or read %s\n", filename.c_str());
+            return 1;
+        }
+
+        cy::Matrix34d view = cy::Matrix34d::View(center + cy::Vec3d(3, 4, 8.66), center, cy::Vec3d(0, 1, 0));
+        cy::Matrix34f float_mv(view);
+        cy::Matrix34f relative_mv =
+            cy::CameraRelativeModelView(view, recentered.GetOrigin(), cy::Matrix34f::Identity());
+        double float_error = 0, relative_error = 0;
+        for (size_t i = 0; i < world.size(); i++) {
+            cy::Vec3d reference = view * world[i];
+            float_error = std::max(float_error, (cy::Vec3d(float_mv * plain.V((int)i)) - reference).Length());
+            relative_error =
+                std::max(relative_error, (cy::Vec3d(relative_mv * recentered.V((int)i)) - reference).Length());
+        }
+        printf("%-14.0f %18.4f %18.4f\n", distance, float_error * 1e3, relative_error * 1e3);
+        if (relative_error >= 1e-4) failures++;
+    }
+    std::filesystem::remove(filename);
+    return failures != 0;
+}
@@ -0,0 +1,70 @@
+// Compares the PCLMUL CRC32 and the SSSE3/AVX2 Adler-32 of lodepng with the scalar code on random buffers, at each
+// CPU feature level the machine supports, with random lengths and alignments and running Adler-32 values.
+// Returns nonzero on a mismatch.
+//
+// Usage: checksum_fuzz [iterations] [seed]
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace simd {
+#include "lodepng.cpp"
+}
+
+unsigned scalar_crc32(const unsigned char* data, size_t length);
+unsigned scalar_update_adler32(unsigned adler, const unsigned char* data, unsigned length);
+
+#ifndef LODEPNG_SIMD_X86
+int main() {
+    printf("lodepng has no SIMD checksums in this build (x86-64 with optimization needed), nothing to compare\n");
+    return 0;
+}
+#else
+int main(int argc, char** argv) {
+    long iterations = argc > 1 ? atol(argv[1]) : 100000;
+    std::mt19937_64 rng(argc > 2 ? strtoull(argv[2], nullptr, 10) : 12345);
+    int detected = simd::lodepng_get_simd_features();
+    const int levels[4] = {0, LODEPNG_SIMD_PCLMUL, LODEPNG_SIMD_SSSE3, LODEPNG_SIMD_SSSE3 | LODEPNG_SIMD_AVX2};
+    printf("CPU features: pclmul %d, ssse3 %d, avx2 %d\n", (detected & LODEPNG_SIMD_PCLMUL) != 0,
+           (detected & LODEPNG_SIMD_SSSE3) != 0, (detected & LODEPNG_SIMD_AVX2) != 0);
+
+    long tested = 0, mismatches = 0;
+    std::vector<unsigned char> buffer(1 << 20);
+    for (long it = 0; it < iterations; it++) {
+        // The fuzzer is single threaded, so it may switch the feature level the checksums are picked with
+        int features = levels[it % 4] & detected;
+        simd::lodepng_simd_features = features;
+        size_t length = rng() % 32 == 0 ? rng() % buffer.size() : rng() % 1000;
+        size_t offset = rng() % 64;
+        if (offset + length > buffer.size()) length = buffer.size() - offset;
+        // All-255 runs push the Adler-32 sums to their largest values before the modulo
+        bool saturated = rng() % 8 == 0;
+        for (size_t i = 0; i < offset + length; i++) buffer[i] = saturated ? 255 : (unsigned char)rng();
+        const unsigned char* data = buffer.data() + offset;
+        unsigned adler = rng() % 4 == 0 ? 1u : (unsigned)(rng() % 65521u) | (unsigned)(rng() % 65521u) << 16;
+
+        unsigned crc_expected = scalar_crc32(data, length), crc_actual = simd::lodepng_crc32(data, length);
+        unsigned adler_expected = scalar_update_adler32(adler, data, (unsigned)length);
+        unsigned adler_actual = simd::update_adler32(adler, data, (unsigned)length);
+        tested++;
+        if (crc_expected != crc_actual || adler_expected != adler_actual) {
+            if (mismatches++ < 10) {
+                printf("mismatch: length %zu, offset %zu, features %d: crc %08x vs %08x, adler %08x vs %08x\n", length,
+                       offset, features, crc_expected, crc_actual, adler_expected, adler_actual);
+            }
+        }
+    }
+    simd::lodepng_simd_features = detected;
+
+    printf("%ld cases, %ld mismatches\n", tested, mismatches);
+    return mismatches != 0;
+}
+#endif
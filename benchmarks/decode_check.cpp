@@ -0,0 +1,245 @@
+// Decodes PNG files, and corrupted versions of them, with the sequential and the threaded (pipelined) decoder of
+// lodepng, through lodepng::decode and lodepng_decode_into, and checks that they all give the same error code and,
+// without an error, the same pixels, for several output color types, including one lodepng can't convert to. The
+// corrupted versions have flipped bits in the compressed data, a wrong Adler-32, truncated data, an invalid filter
+// type, and more or fewer scanline bytes than the image needs. Files above 1 MiB of scanlines take the pipelined path.
+// Returns nonzero on a difference.
+//
+// Usage: decode_check [-m mutations per file] file...
+#include "lodepng.h"
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <random>
+#include <string>
+#include <vector>
+
+typedef std::vector<unsigned char> Bytes;
+
+struct OutputMode {
+    const char* name;
+    LodePNGColorType colortype;
+    unsigned bitdepth;
+    bool convert;
+};
+
+static const OutputMode output_modes[] = {
+    {"rgba8", LCT_RGBA, 8, true},
+    {"rgb8", LCT_RGB, 8, true},
+    {"grey8", LCT_GREY, 8, true},
+    {"rgba16", LCT_RGBA, 16, true},
+    {"grey16", LCT_GREY, 16, true},
+    {"png", LCT_RGBA, 8, false},
+};
+
+struct Result {
+    unsigned error;
+    Bytes pixels;
+};
+
+static void setup(lodepng::State& state, const OutputMode& mode, unsigned threads) {
+    state.info_raw.colortype = mode.colortype;
+    state.info_raw.bitdepth = mode.bitdepth;
+    state.decoder.color_convert = mode.convert;
+    state.decoder.num_threads = threads;
+}
+
+static Result decode(const Bytes& png, const OutputMode& mode, unsigned threads) {
+    lodepng::State state;
+    setup(state, mode, threads);
+    Result result;
+    unsigned w, h;
+    result.error = lodepng::decode(result.pixels, w, h, state, png);
+    if (result.error) result.pixels.clear();
+    return result;
+}
+
+static Result decode_into(const Bytes& png, const OutputMode& mode, unsigned threads, lodepng::Arena* arena) {
+    lodepng::State state;
+    setup(state, mode, threads);
+    Result result;
+    unsigned w, h;
+    // A PNG that can't be inspected gets its error before the output buffer is looked at
+    if (lodepng_inspect(&w, &h, &state, png.data(), png.size()) == 0) {
+        result.pixels.resize(lodepng_get_raw_size(w, h, mode.convert ? &state.info_raw : &state.info_png.color));
+    }
+    result.pixels.push_back(0);
+    lodepng::State fresh;
+    setup(fresh, mode, threads);
+    result.error = lodepng_decode_into(result.pixels.data(), result.pixels.size() - 1, 0, &w, &h, &fresh,
+                                       png.data(), png.size(), arena);
+    result.pixels.pop_back();
+    if (result.error) result.pixels.clear();
+    return result;
+}
+
+// The data of all IDAT chunks
+static Bytes read_idat(const Bytes& png) {
+    Bytes idat;
+    const unsigned char* end = png.data() + png.size();
+    for (const unsigned char* chunk = png.data() + 8; chunk + 12 <= end; chunk = lodepng_chunk_next_const(chunk, end)) {
+        if (lodepng_chunk_type_equals(chunk, "IDAT")) {
+            const unsigned char* data = lodepng_chunk_data_const(chunk);
+            idat.insert(idat.end(), data, data + lodepng_chunk_length(chunk));
+        }
+        if (lodepng_chunk_type_equals(chunk, "IEND")) break;
+    }
+    return idat;
+}
+
+// The PNG with its IDAT chunks replaced by one with the given data
+static Bytes replace_idat(const Bytes& png, const Bytes& idat) {
+    Bytes result(png.begin(), png.begin() + 8);
+    bool written = false;
+    const unsigned char* end = png.data() + png.size();
+    for (const unsigned char* chunk = png.data() + 8; chunk + 12 <= end; chunk = lodepng_chunk_next_const(chunk, end)) {
+        bool is_end = lodepng_chunk_type_equals(chunk, "IEND");
+        if (!lodepng_chunk_type_equals(chunk, "IDAT")) {
+            result.insert(result.end(), chunk, chunk + lodepng_chunk_length(chunk) + 12);
+        } else if (!written) {
+            size_t start = result.size();
+            unsigned length = (unsigned)idat.size();
+            const unsigned char header[8] = {(unsigned char)(length >> 24), (unsigned char)(length >> 16),
+                                             (unsigned char)(length >> 8), (unsigned char)length, 'I', 'D', 'A', 'T'};
+            result.insert(result.end(), header, header + 8);
+            result.insert(result.end(), idat.begin(), idat.end());
+            result.resize(result.size() + 4);
+            lodepng_chunk_generate_crc(&result[start]);
+            written = true;
+        }
+        if (is_end) break;
+    }
+    return result;
+}
+
+static Bytes inflate(const Bytes& zdata) {
+    unsigned char* data = nullptr;
+    size_t size = 0;
+    LodePNGDecompressSettings settings;
+    lodepng_decompress_settings_init(&settings);
+    lodepng_zlib_decompress(&data, &size, zdata.data(), zdata.size(), &settings);
+    Bytes result(data, data + size);
+    free(data);
+    return result;
+}
+
+// Stored blocks: fast, and the data decides the errors rather than the Huffman codes
+static Bytes deflate_stored(const Bytes& data) {
+    unsigned char* zdata = nullptr;
+    size_t size = 0;
+    LodePNGCompressSettings settings;
+    lodepng_compress_settings_init(&settings);
+    settings.btype = 0;
+    lodepng_zlib_compress(&zdata, &size, data.data(), data.size(), &settings);
+    Bytes result(zdata, zdata + size);
+    free(zdata);
+    return result;
+}
+
+static Bytes mutate(const Bytes& png, const Bytes& idat, const Bytes& scanlines, size_t linebytes, int kind,
+                    std::mt19937& rng, std::string& name) {
+    Bytes z = idat;
+    Bytes s = scanlines;
+    size_t row = scanlines.size() / linebytes;
+    switch (kind) {
+        case 0: {
+            int flips = 1 + rng() % 3;
+            for (int i = 0; i < flips; i++) z[2 + rng() % (z.size() - 6)] ^= (unsigned char)(1u << (rng() % 8));
+            name = "flipped bits";
+            return replace_idat(png, z);
+        }
+        case 1:
+            z[z.size() - 1 - rng() % 4] ^= 1;
+            name = "wrong Adler-32";
+            return replace_idat(png, z);
+        case 2:
+            z.resize(2 + rng() % (z.size() - 2));
+            name = "truncated data";
+            return replace_idat(png, z);
+        case 3:
+            s[linebytes * (rng() % row)] = (unsigned char)(5 + rng() % 251);
+            name = "invalid filter type";
+            return replace_idat(png, deflate_stored(s));
+        case 4: {
+            s[linebytes * (rng() % row)] = (unsigned char)(5 + rng() % 251);
+            z = deflate_stored(s);
+            z[z.size() - 1] ^= 1;
+            name = "invalid filter type and wrong Adler-32";
+            return replace_idat(png, z);
+        }
+        case 5:
+            s.resize(s.size() + 1 + rng() % (2 * linebytes));
+            name = "extra scanline bytes";
+            return replace_idat(png, deflate_stored(s));
+        default:
+            s.resize(s.size() - 1 - rng() % (s.size() - 1));
+            name = "missing scanline bytes";
+            return replace_idat(png, deflate_stored(s));
+    }
+}
+
+static int check(const std::string& name, const Bytes& png, long& cases) {
+    // One arena for all images, as an application that reuses it
+    static lodepng::Arena arena;
+    int differences = 0;
+    for (const OutputMode& mode : output_modes) {
+        Result sequential = decode(png, mode, 1);
+        struct {
+            const char* name;
+            Result result;
+        } others[] = {
+            {"threaded", decode(png, mode, 4)},
+            {"decode_into", decode_into(png, mode, 1, &arena)},
+            {"threaded decode_into", decode_into(png, mode, 4, nullptr)},
+        };
+        for (const auto& other : others) {
+            cases++;
+            if (sequential.error != other.result.error || sequential.pixels != other.result.pixels) {
+                printf("%s, %s: sequential error %u, %s error %u%s\n", name.c_str(), mode.name, sequential.error,
+                       other.name, other.result.error, sequential.error == other.result.error ? ", different pixels" : "");
+                differences++;
+            }
+        }
+    }
+    return differences;
+}
+
+int main(int argc, char** argv) {
+    int mutations = 14;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-m") == 0 && i + 1 < argc) mutations = atoi(argv[++i]);
+        else files.push_back(argv[i]);
+    }
+    if (files.empty()) {
+        printf("usage: decode_check [-m mutations per file] file...\n");
+        return 1;
+    }
+
+    std::mt19937 rng(12345);
+    long cases = 0, differences = 0;
+    for (const std::string& file : files) {
+        Bytes png;
+        if (lodepng::load_file(png, file) || png.size() < 33) {
+            printf("cannot read %s\n", file.c_str());
+            return 1;
+        }
+        differences += check(file, png, cases);
+
+        // The corrupted versions need the PNG to be readable up to its scanlines
+        lodepng::State state;
+        unsigned w, h;
+        Bytes idat = read_idat(png);
+        if (lodepng_inspect(&w, &h, &state, png.data(), png.size()) || state.info_png.interlace_method || idat.size() < 8) continue;
+        Bytes scanlines = inflate(idat);
+        size_t linebytes = (w * lodepng_get_bpp(&state.info_png.color) + 7) / 8 + 1;
+        if (scanlines.size() != linebytes * h) continue;
+        for (int i = 0; i < mutations; i++) {
+            std::string kind;
+            Bytes corrupt = mutate(png, idat, scanlines, linebytes, i % 7, rng, kind);
+            differences += check(file + " (" + kind + ")", corrupt, cases);
+        }
+    }
+    printf("%ld cases, %ld differences\n", cases, differences);
+    return differences != 0;
+}
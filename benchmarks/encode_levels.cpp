@@ -0,0 +1,97 @@
+// Encodes PNG files with each compression level of lodepng_encoder_settings_level, and with the defaults of
+// lodepng_encoder_settings_init with and without lazy matching, and prints the total size and encoding time of each.
+// Every encoded file is decoded again and compared with the input. Encodes on one thread, the time is the fastest of
+// the given amount of runs, 1 by default.
+//
+// Usage: encode_levels [-r runs] file...
+#include "lodepng.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+typedef std::vector<unsigned char> Bytes;
+
+struct Image {
+    std::string name;
+    Bytes pixels;
+    unsigned width, height;
+};
+
+struct Config {
+    std::string name;
+    int level; // -1 for the defaults
+    unsigned lazymatching;
+};
+
+static void setup(lodepng::State& state, const Config& config) {
+    if (config.level >= 0) lodepng_encoder_settings_level(&state.encoder, (unsigned)config.level);
+    else state.encoder.zlibsettings.lazymatching = config.lazymatching;
+    state.encoder.zlibsettings.num_threads = 1;
+}
+
+int main(int argc, char** argv) {
+    int runs = 1;
+    std::vector<Image> images;
+    size_t raw = 0;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) {
+            runs = atoi(argv[++i]);
+            continue;
+        }
+        Image image;
+        image.name = argv[i];
+        if (lodepng::decode(image.pixels, image.width, image.height, image.name)) {
+            printf("cannot read %s\n", argv[i]);
+            return 1;
+        }
+        raw += image.pixels.size();
+        images.push_back(image);
+    }
+    if (images.empty() || runs < 1) {
+        printf("usage: encode_levels [-r runs] file...\n");
+        return 1;
+    }
+
+    std::vector<Config> configs = {{"default", -1, 1}, {"default, lazymatching 0", -1, 0}};
+    for (int level = 0; level <= 9; level++) configs.push_back({"level " + std::to_string(level), level, 0});
+
+    printf("%zu images, %.1f MB of RGBA pixels\n\n", images.size(), raw / 1e6);
+    printf("%-24s %12s %8s %10s %10s\n", "settings", "bytes", "ratio", "ms", "MB/s");
+    int errors = 0;
+    for (const Config& config : configs) {
+        size_t size = 0;
+        double seconds = 0;
+        for (const Image& image : images) {
+            Bytes png;
+            double best = 1e30;
+            for (int run = 0; run < runs; run++) {
+                lodepng::State state;
+                setup(state, config);
+                png.clear();
+                auto start = std::chrono::steady_clock::now();
+                unsigned error = lodepng::encode(png, image.pixels, image.width, image.height, state);
+                double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+                if (error) {
+                    printf("%s, %s: error %u: %s\n", image.name.c_str(), config.name.c_str(), error,
+                           lodepng_error_text(error));
+                    return 1;
+                }
+                if (elapsed < best) best = elapsed;
+            }
+            Bytes decoded;
+            unsigned w, h;
+            if (lodepng::decode(decoded, w, h, png) || decoded != image.pixels) {
+                printf("%s, %s: decoded image differs\n", image.name.c_str(), config.name.c_str());
+                errors++;
+            }
+            size += png.size();
+            seconds += best;
+        }
+        printf("%-24s %12zu %7.2f%% %10.1f %10.1f\n", config.name.c_str(), size, 100.0 * size / raw, seconds * 1e3,
+               raw / seconds / 1e6);
+    }
+    return errors != 0;
+}
@@ -0,0 +1,77 @@
+// Compares the batch sphere and box tests of Frustum with the single-object IsVisible on random objects around a
+// view frustum, for every size up to 70 and a few larger ones that are not multiples of 8: each bit of the mask, the
+// bits past the end of the array, and the returned count. Frustum<float> uses the AVX tests when built with -mavx,
+// Frustum<double> always uses the generic ones. Returns nonzero on a mismatch.
+//
+// Usage: frustum_check [seed]
+#include "cyFrustum.h"
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+template <typename T> static int check(const char* name, std::mt19937& rng, size_t n) {
+    cy::Matrix4<T> view = cy::Matrix4<T>::View(cy::Vec3<T>(1, 2, 8), cy::Vec3<T>(0, 0, 0), cy::Vec3<T>(0, 1, 0));
+    cy::Frustum<T> frustum(cy::Matrix4<T>::Perspective(T(1), T(1.5), T(0.1), T(20)) * view);
+
+    std::uniform_real_distribution<T> position(-12, 12), extent(0, 3);
+    cy::Vec3Array<T> centers(n), bound_min(n), bound_max(n);
+    std::vector<T> radius(n);
+    for (size_t i = 0; i < n; i++) {
+        cy::Vec3<T> c(position(rng), position(rng), position(rng));
+        cy::Vec3<T> e(extent(rng), extent(rng), extent(rng));
+        centers.Set(i, c);
+        radius[i] = extent(rng);
+        bound_min.Set(i, c - e);
+        bound_max.Set(i, c + e);
+    }
+
+    // The words start filled, so that the bits past the end of the array must be cleared by the tests
+    size_t words = (n + 31) / 32;
+    std::vector<uint32_t> spheres(words, ~0u), boxes(words, ~0u);
+    size_t sphere_count = frustum.TestSpheres(centers, radius.data(), spheres.data());
+    size_t box_count = frustum.TestBoxes(bound_min, bound_max, boxes.data());
+
+    int mismatches = 0;
+    size_t visible_spheres = 0, visible_boxes = 0;
+    for (size_t i = 0; i < words * 32; i++) {
+        bool sphere = i < n && frustum.IsVisible(centers.Get(i), radius[i]);
+        bool box = i < n && frustum.IsVisible(bound_min.Get(i), bound_max.Get(i));
+        visible_spheres += sphere;
+        visible_boxes += box;
+        if (cy::Frustum<T>::IsVisible(spheres.data(), i) != sphere) {
+            if (mismatches++ < 10) printf("%s: sphere %zu of %zu is %d, expected %d\n", name, i, n, !sphere, sphere);
+        }
+        if (cy::Frustum<T>::IsVisible(boxes.data(), i) != box) {
+            if (mismatches++ < 10) printf("%s: box %zu of %zu is %d, expected %d\n", name, i, n, !box, box);
+        }
+    }
+    if (sphere_count != visible_spheres || box_count != visible_boxes) {
+        if (mismatches++ < 10) {
+            printf("%s: %zu objects, counts %zu and %zu, expected %zu and %zu\n", name, n, sphere_count, box_count,
+                   visible_spheres, visible_boxes);
+        }
+    }
+    return mismatches;
+}
+
+int main(int argc, char** argv) {
+    std::mt19937 rng(argc > 1 ? atoi(argv[1]) : 1);
+    std::vector<size_t> sizes;
+    for (size_t n = 0; n <= 70; n++) sizes.push_back(n);
+    for (size_t n : {255, 1001, 4099, 100003}) sizes.push_back(n);
+
+#ifdef __AVX__
+    const char* name = "Frustum<float> AVX";
+#else
+    const char* name = "Frustum<float>";
+#endif
+    int mismatches = 0;
+    for (size_t n : sizes) {
+        mismatches += check<float>(name, rng, n);
+        mismatches += check<double>("Frustum<double>", rng, n);
+    }
+    printf("%s and Frustum<double>, %zu sizes up to %zu: %d mismatches\n", name, sizes.size(), sizes.back(),
+           mismatches);
+    return mismatches != 0;
+}
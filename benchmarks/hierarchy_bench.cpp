@@ -0,0 +1,112 @@
+// Computes the world transformations of a random rigid hierarchy, parent world times child local, with Matrix34,
+// Matrix4 and DualQuat, and prints the arithmetic and memory per node and the time per node. DualQuat is timed
+// with and without converting every world transformation to a Matrix34, as needed before sending it to the GPU.
+// The results are compared with a double precision Matrix34 reference.
+//
+// Usage: hierarchy_bench [nodes] [runs]
+#include "cyQuat.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+// Multiplications and additions of one product, counted from the scalar code of the operators
+struct Cost {
+    int mul, add;
+};
+static const Cost matrix34_cost = {36, 27};
+static const Cost matrix4_cost = {64, 48};
+static const Cost dualquat_cost = {48, 40};
+
+static std::vector<int> parents;
+static volatile float sink;
+
+template <typename F> static double seconds_per_node(int runs, F f) {
+    double best = 1e30;
+    for (int run = 0; run < runs; run++) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        best = std::min(best, elapsed);
+    }
+    return best / parents.size();
+}
+
+// Node 0 is the root, every other node has an earlier node as its parent
+template <typename M> static void compose(std::vector<M>& world, const std::vector<M>& local) {
+    world[0] = local[0];
+    for (size_t i = 1; i < local.size(); i++) world[i] = world[parents[i]] * local[i];
+}
+
+static float max_difference(const cy::Matrix34f& m, const cy::Matrix34d& reference) {
+    float difference = 0;
+    for (int i = 0; i < 12; i++) difference = std::max(difference, (float)std::fabs(m.cell[i] - reference.cell[i]));
+    return difference;
+}
+
+static void print(const char* name, Cost cost, size_t bytes, double seconds, float error) {
+    printf("%-24s %4d %4d %6d %7zu %9.2f %10.2e\n", name, cost.mul, cost.add, cost.mul + cost.add, bytes, seconds * 1e9,
+           error);
+}
+
+int main(int argc, char** argv) {
+    size_t nodes = argc > 1 ? (size_t)atol(argv[1]) : 100000;
+    int runs = argc > 2 ? atoi(argv[2]) : 20;
+    if (nodes < 1 || runs < 1) {
+        printf("usage: hierarchy_bench [nodes] [runs]\n");
+        return 1;
+    }
+
+    // Each parent is one of the 16 nodes before, which makes long chains that drift in single precision
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<double> uniform(-1, 1);
+    parents.resize(nodes);
+    std::vector<cy::Matrix34d> local_d(nodes), world_d(nodes);
+    std::vector<cy::Matrix34f> local34(nodes), world34(nodes), converted(nodes);
+    std::vector<cy::Matrix4f> local4(nodes), world4(nodes);
+    std::vector<cy::DualQuatf> localdq(nodes), worlddq(nodes);
+    for (size_t i = 0; i < nodes; i++) {
+        parents[i] = i == 0 ? 0 : (int)(i - 1 - rng() % std::min<size_t>(i, 16));
+        cy::Vec3d axis(uniform(rng), uniform(rng), uniform(rng));
+        if (axis.LengthSquared() < 1e-6) axis.Set(0, 0, 1);
+        cy::Quatd rotation = cy::Quatd::Rotation(axis.GetNormalized(), uniform(rng) * 3.14159);
+        cy::Vec3d translation(uniform(rng), uniform(rng), uniform(rng));
+        local_d[i] = rotation.GetMatrix34(translation);
+        local34[i] = cy::Matrix34f(local_d[i]);
+        local4[i] = cy::Matrix4f(local34[i]);
+        localdq[i] = cy::DualQuatf(cy::Quatf(rotation), cy::Vec3f(translation));
+    }
+    compose(world_d, local_d);
+
+    printf("%zu nodes, best of %d runs\n\n", nodes, runs);
+    printf("%-24s %4s %4s %6s %7s %9s %10s\n", "", "mul", "add", "flops", "bytes", "ns/node", "max error");
+
+    double t = seconds_per_node(runs, [&] { compose(world34, local34); sink = world34.back().cell[9]; });
+    float error = 0;
+    for (size_t i = 0; i < nodes; i++) error = std::max(error, max_difference(world34[i], world_d[i]));
+    print("Matrix34", matrix34_cost, sizeof(cy::Matrix34f), t, error);
+
+    t = seconds_per_node(runs, [&] { compose(world4, local4); sink = world4.back().cell[12]; });
+    error = 0;
+    for (size_t i = 0; i < nodes; i++) {
+        error = std::max(error, max_difference(cy::Matrix34f(world4[i]), world_d[i]));
+    }
+    print("Matrix4", matrix4_cost, sizeof(cy::Matrix4f), t, error);
+
+    t = seconds_per_node(runs, [&] { compose(worlddq, localdq); sink = worlddq.back().dual.w; });
+    error = 0;
+    for (size_t i = 0; i < nodes; i++) error = std::max(error, max_difference(worlddq[i].GetMatrix34(), world_d[i]));
+    print("DualQuat", dualquat_cost, sizeof(cy::DualQuatf), t, error);
+    t = seconds_per_node(runs, [&] {
+        compose(worlddq, localdq);
+        for (size_t i = 0; i < nodes; i++) converted[i] = worlddq[i].GetMatrix34();
+        sink = converted.back().cell[9];
+    });
+    error = 0;
+    for (size_t i = 0; i < nodes; i++) error = std::max(error, max_difference(converted[i], world_d[i]));
+    print("DualQuat + GetMatrix34", dualquat_cost, sizeof(cy::DualQuatf), t, error);
+    return 0;
+}
@@ -0,0 +1,98 @@
+// Measures the inflate throughput of lodepng on the image data of PNG files: the zlib stream of the IDAT chunks with
+// and without the Adler-32 check, and the whole lodepng::decode to RGBA8. Throughput is in MB of inflated data per
+// second, the time is the fastest of the given amount of runs.
+//
+// Usage: inflate_bench [-r runs] file...
+#include "lodepng.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+typedef std::vector<unsigned char> Bytes;
+
+// The data of all IDAT chunks
+static Bytes read_idat(const Bytes& png) {
+    Bytes idat;
+    const unsigned char* end = png.data() + png.size();
+    for (const unsigned char* chunk = png.data() + 8; chunk + 12 <= end; chunk = lodepng_chunk_next_const(chunk, end)) {
+        if (lodepng_chunk_type_equals(chunk, "IDAT")) {
+            const unsigned char* data = lodepng_chunk_data_const(chunk);
+            idat.insert(idat.end(), data, data + lodepng_chunk_length(chunk));
+        }
+        if (lodepng_chunk_type_equals(chunk, "IEND")) break;
+    }
+    return idat;
+}
+
+template <typename F> static double best_seconds(int runs, F f) {
+    double best = 1e30;
+    for (int run = 0; run < runs; run++) {
+        auto start = std::chrono::steady_clock::now();
+        if (f()) return -1;
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best;
+}
+
+static unsigned inflate(const Bytes& idat, bool adler32, size_t& size) {
+    unsigned char* data = nullptr;
+    LodePNGDecompressSettings settings;
+    lodepng_decompress_settings_init(&settings);
+    settings.ignore_adler32 = !adler32;
+    size = 0;
+    unsigned error = lodepng_zlib_decompress(&data, &size, idat.data(), idat.size(), &settings);
+    free(data);
+    return error;
+}
+
+int main(int argc, char** argv) {
+    int runs = 5;
+    std::vector<std::string> files;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-r") == 0 && i + 1 < argc) runs = atoi(argv[++i]);
+        else files.push_back(argv[i]);
+    }
+    if (files.empty() || runs < 1) {
+        printf("usage: inflate_bench [-r runs] file...\n");
+        return 1;
+    }
+
+    printf("%-44s %9s %9s %9s %9s %9s\n", "", "zlib MB", "data MB", "MB/s", "+adler32", "decode");
+    size_t total_compressed = 0, total_inflated = 0;
+    double total_inflate = 0, total_adler32 = 0, total_decode = 0;
+    for (const std::string& file : files) {
+        Bytes png;
+        if (lodepng::load_file(png, file) || png.size() < 33) {
+            printf("cannot read %s\n", file.c_str());
+            return 1;
+        }
+        Bytes idat = read_idat(png);
+        size_t inflated = 0;
+        double inflate_time = best_seconds(runs, [&] { return inflate(idat, false, inflated); });
+        double adler32_time = best_seconds(runs, [&] { return inflate(idat, true, inflated); });
+        double decode_time = best_seconds(runs, [&] {
+            Bytes image;
+            unsigned w, h;
+            return lodepng::decode(image, w, h, png);
+        });
+        if (inflate_time < 0 || adler32_time < 0 || decode_time < 0) {
+            printf("cannot decode %s\n", file.c_str());
+            return 1;
+        }
+        printf("%-44s %9.2f %9.2f %9.0f %9.0f %9.0f\n", file.c_str(), idat.size() / 1e6, inflated / 1e6,
+               inflated / inflate_time / 1e6, inflated / adler32_time / 1e6, inflated / decode_time / 1e6);
+        total_compressed += idat.size();
+        total_inflated += inflated;
+        total_inflate += inflate_time;
+        total_adler32 += adler32_time;
+        total_decode += decode_time;
+    }
+    printf("%-44s %9.2f %9.2f %9.0f %9.0f %9.0f\n", "total", total_compressed / 1e6, total_inflated / 1e6,
+           total_inflated / total_inflate / 1e6, total_inflated / total_adler32 / 1e6, total_inflated / total_decode / 1e6);
+    printf("\ndecode of all files: %.1f ms\n", total_decode * 1e3);
+    return 0;
+}
@@ -0,0 +1,35 @@
+// The scalar code of lodepng, built without LODEPNG_COMPILE_SIMD as the reference for unfilter_fuzz and
+// checksum_fuzz.
+// lodepng.cpp is included in a namespace, so that its static functions are reachable and its exported ones do not
+// collide with the SIMD build of the fuzzer.
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+#define LODEPNG_NO_COMPILE_SIMD
+namespace scalar {
+#include "lodepng.cpp"
+}
+
+unsigned scalar_unfilter_scanline(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                                  size_t bytewidth, unsigned char filter_type, size_t length) {
+    return scalar::unfilterScanline(recon, scanline, precon, bytewidth, filter_type, length);
+}
+
+unsigned scalar_unfilter(unsigned char* out, size_t outstride, const unsigned char* in, unsigned w, unsigned h, unsigned bpp) {
+    return scalar::unfilter(out, outstride, in, w, h, bpp);
+}
+
+unsigned scalar_crc32(const unsigned char* data, size_t length) {
+    return scalar::lodepng_crc32(data, length);
+}
+
+unsigned scalar_update_adler32(unsigned adler, const unsigned char* data, unsigned length) {
+    return scalar::update_adler32(adler, data, length);
+}
@@ -0,0 +1,79 @@
+// Times Matrix34*Matrix34 against Matrix4*Matrix4 in single precision, as independent products over arrays and as a
+// chain where each product uses the previous result, and checks the Matrix34 product against double precision.
+// Returns nonzero if the check fails.
+//
+// Usage: matrix_bench [products] [runs]
+#include "cyMatrix.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+static volatile float sink;
+
+template <typename F> static double nanoseconds_per_product(size_t products, int runs, F f) {
+    double best = 1e30;
+    for (int run = 0; run < runs; run++) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        best = std::min(best, elapsed);
+    }
+    return best / products * 1e9;
+}
+
+template <typename M> static void independent(std::vector<M>& out, const std::vector<M>& a, const std::vector<M>& b) {
+    for (size_t i = 0; i < a.size(); i++) out[i] = a[i] * b[i];
+}
+
+// Each product needs the result of the one before, like the transformations along a path in a hierarchy
+template <typename M> static void chain(std::vector<M>& out, const std::vector<M>& a) {
+    out[0] = a[0];
+    for (size_t i = 1; i < a.size(); i++) out[i] = out[i - 1] * a[i];
+}
+
+int main(int argc, char** argv) {
+    size_t products = argc > 1 ? (size_t)atol(argv[1]) : 10000;
+    int runs = argc > 2 ? atoi(argv[2]) : 200;
+    if (products < 2 || runs < 1) {
+        printf("usage: matrix_bench [products] [runs]\n");
+        return 1;
+    }
+
+    // Rotations with translations, so that long chains stay bounded
+    std::mt19937 rng(1);
+    std::uniform_real_distribution<float> uniform(-1, 1);
+    std::vector<cy::Matrix34f> a34(products), b34(products), out34(products);
+    std::vector<cy::Matrix4f> a4(products), b4(products), out4(products);
+    for (size_t i = 0; i < products; i++) {
+        cy::Vec3f axis(uniform(rng), uniform(rng), uniform(rng) + 2);
+        a34[i].SetRotation(axis.GetNormalized(), uniform(rng) * 3.14159f);
+        a34[i].SetTranslation(cy::Vec3f(uniform(rng), uniform(rng), uniform(rng)));
+        for (int j = 0; j < 12; j++) b34[i].cell[j] = uniform(rng);
+        a4[i] = cy::Matrix4f(a34[i]);
+        b4[i] = cy::Matrix4f(b34[i]);
+    }
+
+    int failures = 0;
+    independent(out34, a34, b34);
+    for (size_t i = 0; i < products; i++) {
+        cy::Matrix34d reference = cy::Matrix34d(a34[i]) * cy::Matrix34d(b34[i]);
+        for (int j = 0; j < 12; j++) {
+            if (std::fabs(out34[i].cell[j] - reference.cell[j]) > 1e-5) failures++;
+        }
+    }
+    if (failures) printf("Matrix34 product: %d values differ from double precision\n", failures);
+
+    printf("%zu products, best of %d runs, ns per product\n\n", products, runs);
+    printf("%-10s %12s %8s\n", "", "independent", "chain");
+    double t34 = nanoseconds_per_product(products, runs, [&] { independent(out34, a34, b34); sink = out34.back().cell[0]; });
+    double c34 = nanoseconds_per_product(products, runs, [&] { chain(out34, a34); sink = out34.back().cell[0]; });
+    printf("%-10s %12.2f %8.2f\n", "Matrix34", t34, c34);
+    double t4 = nanoseconds_per_product(products, runs, [&] { independent(out4, a4, b4); sink = out4.back().cell[0]; });
+    double c4 = nanoseconds_per_product(products, runs, [&] { chain(out4, a4); sink = out4.back().cell[0]; });
+    printf("%-10s %12.2f %8.2f\n", "Matrix4", t4, c4);
+    return failures != 0;
+}
@@ -0,0 +1,108 @@
+// Measures the throughput of streaming per-frame data to the GPU in MB/s: writing into a GLStreamBuffer with memcpy,
+// and glNamedBufferSubData into a buffer that the previous frame read. The GPU reads the data of each frame by copying
+// it to another buffer, so that the writes must wait for or work around the GPU. The time includes the GPU, glFinish
+// is called after the last frame.
+// Runs in a hidden window.
+//
+// Usage: stream_buffer_bench [MB per frame] [frames]
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include "cyGL.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+template <typename F> static double seconds(int frames, F frame) {
+    glFinish();
+    auto start = std::chrono::steady_clock::now();
+    for (int i = 0; i < frames; i++) frame(i);
+    glFinish();
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+int main(int argc, char** argv) {
+    double mb = argc > 1 ? atof(argv[1]) : 4;
+    int frames = argc > 2 ? atoi(argv[2]) : 300;
+    GLsizeiptr size = (GLsizeiptr)(mb * 1e6) / 16 * 16;
+    if (size < 16 || frames < 1) {
+        printf("usage: stream_buffer_bench [MB per frame] [frames]\n");
+        return 1;
+    }
+    if (!glfwInit()) {
+        printf("cannot initialize GLFW\n");
+        return 1;
+    }
+    glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(64, 64, "stream_buffer_bench", nullptr, nullptr);
+    if (!window) {
+        printf("cannot create an OpenGL 4.6 context\n");
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    glewInit();
+
+    // Different data for every frame, like instance transforms of moving objects
+    std::vector<float> data(size / sizeof(float) + frames);
+    for (size_t i = 0; i < data.size(); i++) data[i] = (float)i;
+    auto frame_data = [&](int i) { return (const char*)(data.data() + i); };
+
+    GLuint target, buffer;
+    glCreateBuffers(1, &target);
+    glNamedBufferStorage(target, size, nullptr, 0);
+    glCreateBuffers(1, &buffer);
+    glNamedBufferStorage(buffer, size, nullptr, GL_DYNAMIC_STORAGE_BIT);
+
+    cy::GLStreamBuffer stream;
+    stream.Initialize(size);
+    int failures = 0;
+    double stream_time = seconds(frames, [&](int i) {
+        stream.BeginFrame();
+        GLintptr offset;
+        void* p = stream.Allocate(size, 16, offset);
+        if (!p) {
+            failures++;
+            return;
+        }
+        memcpy(p, frame_data(i), size);
+        glCopyNamedBufferSubData(stream.GetID(), target, offset, 0, size);
+        stream.EndFrame();
+    });
+    size_t stalls = stream.GetStallCount();
+
+    // Check the data of the last frame as the GPU read it
+    std::vector<char> result(size);
+    glGetNamedBufferSubData(target, 0, size, result.data());
+    if (memcmp(result.data(), frame_data(frames - 1), size) != 0) failures++;
+
+    double subdata_time = seconds(frames, [&](int i) {
+        glNamedBufferSubData(buffer, 0, size, frame_data(i));
+        glCopyNamedBufferSubData(buffer, target, 0, 0, size);
+    });
+
+    double total = (double)size * frames / 1e6;
+    printf("%.2f MB per frame, %d frames, %d regions\n\n", size / 1e6, frames, stream.NumRegions());
+    printf("%-24s %9s %9s %7s\n", "", "MB/s", "ms/frame", "stalls");
+    printf("%-24s %9.0f %9.3f %7zu\n", "GLStreamBuffer", total / stream_time, stream_time * 1e3 / frames, stalls);
+    printf("%-24s %9.0f %9.3f %7s\n", "glNamedBufferSubData", total / subdata_time, subdata_time * 1e3 / frames, "");
+    if (failures) printf("\nthe data of the last frame is not correct\n");
+    if (glGetError() != GL_NO_ERROR) {
+        printf("OpenGL error\n");
+        failures++;
+    }
+
+    stream.Delete();
+    glDeleteBuffers(1, &buffer);
+    glDeleteBuffers(1, &target);
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return failures != 0;
+}
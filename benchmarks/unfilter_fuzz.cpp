@@ -0,0 +1,111 @@
+// Compares the SIMD unfilter kernels of lodepng with the scalar code on random scanlines, at each CPU feature level
+// the machine supports: separate, in-place and overlapping buffers, all filter types and the bytewidths the kernels
+// specialize for, plus whole images through unfilter(). Returns nonzero on a mismatch.
+//
+// Usage: unfilter_fuzz [iterations] [seed]
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cstdint>
+#include <random>
+#include <string>
+#include <vector>
+
+namespace simd {
+#include "lodepng.cpp"
+}
+
+unsigned scalar_unfilter_scanline(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                                  size_t bytewidth, unsigned char filter_type, size_t length);
+unsigned scalar_unfilter(unsigned char* out, size_t outstride, const unsigned char* in, unsigned w, unsigned h, unsigned bpp);
+
+#ifndef LODEPNG_SIMD_X86
+int main() {
+    printf("lodepng has no SIMD kernels in this build (x86-64 with optimization needed), nothing to compare\n");
+    return 0;
+}
+#else
+int main(int argc, char** argv) {
+    long iterations = argc > 1 ? atol(argv[1]) : 200000;
+    std::mt19937_64 rng(argc > 2 ? strtoull(argv[2], nullptr, 10) : 12345);
+    int detected = simd::lodepng_get_simd_features();
+    const int levels[3] = {0, LODEPNG_SIMD_SSSE3, LODEPNG_SIMD_SSSE3 | LODEPNG_SIMD_AVX2};
+    printf("CPU features: ssse3 %d, avx2 %d\n", (detected & LODEPNG_SIMD_SSSE3) != 0, (detected & LODEPNG_SIMD_AVX2) != 0);
+
+    long tested = 0, mismatches = 0;
+    const size_t bytewidths[6] = {1, 2, 3, 4, 6, 8};
+    for (long it = 0; it < iterations; it++) {
+        // The fuzzer is single threaded, so it may switch the feature level the kernels are picked with
+        int features = levels[it % 3] & detected;
+        simd::lodepng_simd_features = features;
+        size_t bytewidth = bytewidths[rng() % 6];
+        size_t pixels = rng() % 16 == 0 ? 1 + rng() % 3000 : 1 + rng() % 80;
+        size_t length = pixels * bytewidth;
+        unsigned char filter = (unsigned char)(rng() % 5);
+        bool has_prev = rng() % 8 != 0;
+        // 0: separate buffers, 1: in place, 2: recon a few bytes before the scanline, as the decoder does
+        int mode = rng() % 3;
+        size_t shift = mode == 0 ? 0 : mode == 1 ? 0 : 1 + rng() % 20;
+        // Few distinct values make ties in the Paeth predictor likely
+        int spread = rng() % 3;
+        auto random_byte = [&]() {
+            return (unsigned char)(spread == 0 ? rng() : spread == 1 ? (rng() % 4) * 64 : rng() % 3);
+        };
+        std::vector<unsigned char> prev(length + 64), line(length + 128);
+        for (unsigned char& x : prev) x = random_byte();
+        for (unsigned char& x : line) x = random_byte();
+        const unsigned char* precon = has_prev ? prev.data() + 32 : nullptr;
+
+        std::vector<unsigned char> expected, actual;
+        if (mode == 0) {
+            expected.assign(length + 64, 0xAA);
+            actual = expected;
+            scalar_unfilter_scanline(expected.data() + 32, line.data() + 64, precon, bytewidth, filter, length);
+            simd::unfilterScanline(actual.data() + 32, line.data() + 64, precon, bytewidth, filter, length);
+        } else {
+            expected = line;
+            actual = line;
+            scalar_unfilter_scanline(expected.data() + 64 - shift, expected.data() + 64, precon, bytewidth, filter, length);
+            simd::unfilterScanline(actual.data() + 64 - shift, actual.data() + 64, precon, bytewidth, filter, length);
+        }
+        tested++;
+        if (expected != actual) {
+            if (mismatches++ < 10) {
+                printf("scanline mismatch: bytewidth %zu, length %zu, filter %d, mode %d, shift %zu, precon %d, features %d\n",
+                       bytewidth, length, filter, mode, shift, has_prev, features);
+            }
+        }
+    }
+
+    // Whole images through unfilter(), into rows with padding, and in place as the decoder does for images with
+    // padding bits
+    const unsigned bpps[6] = {8, 16, 24, 32, 48, 64};
+    for (long it = 0; it < iterations / 100 + 1; it++) {
+        simd::lodepng_simd_features = levels[it % 3] & detected;
+        unsigned bpp = bpps[rng() % 6];
+        unsigned w = 1 + rng() % 300, h = 1 + rng() % 20;
+        size_t line_size = (w * bpp + 7) / 8;
+        std::vector<unsigned char> in(h * (line_size + 1));
+        for (unsigned char& x : in) x = (unsigned char)rng();
+        for (unsigned y = 0; y < h; y++) in[y * (line_size + 1)] = (unsigned char)(rng() % 5);
+        size_t stride = line_size + rng() % 3 * 16;
+        std::vector<unsigned char> expected(h * stride), actual(h * stride), expected_in_place = in, actual_in_place = in;
+        scalar_unfilter(expected.data(), stride, in.data(), w, h, bpp);
+        simd::unfilter(actual.data(), stride, in.data(), w, h, bpp);
+        scalar_unfilter(expected_in_place.data(), line_size, expected_in_place.data(), w, h, bpp);
+        simd::unfilter(actual_in_place.data(), line_size, actual_in_place.data(), w, h, bpp);
+        tested++;
+        if (expected != actual || memcmp(expected_in_place.data(), actual_in_place.data(), h * line_size) != 0) {
+            if (mismatches++ < 10) printf("image mismatch: bpp %u, %ux%u\n", bpp, w, h);
+        }
+    }
+    simd::lodepng_simd_features = detected;
+
+    printf("%ld cases, %ld mismatches\n", tested, mismatches);
+    return mismatches != 0;
+}
+#endif
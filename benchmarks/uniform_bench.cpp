@@ -0,0 +1,159 @@
+// Measures the CPU time of submitting 10k uniform sets with GLSLProgram, using project4's shaders and 8 of the active
+// uniforms it sets per draw: by name, by registered index, by name with values that did not change (which GLSLProgram
+// skips), and with the glUseProgram and glGetUniformLocation calls that a name-based set made before the location
+// table.
+// Runs in a hidden window. glFinish is called before each run, so the times are of the calls only, not of the GPU.
+//
+// Usage: uniform_bench [runs]
+#include <GL/glew.h>
+#include <GLFW/glfw3.h>
+#include "cyMatrix.h"
+#include "cyGL.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+static const int sets = 10000;
+static const int sets_per_draw = 8;
+static const int draws = sets / sets_per_draw;
+
+struct DrawValues {
+    cy::Matrix4f mvp, mv_inv_transpose, mv;
+    cy::Vec3f kd, ks, ka;
+    float shininess;
+    int has_texture_kd;
+};
+
+template <typename F> static double microseconds(int runs, F f) {
+    double best = 1e30;
+    for (int run = 0; run < runs; run++) {
+        glFinish();
+        auto start = std::chrono::steady_clock::now();
+        f();
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best * 1e6;
+}
+
+int main(int argc, char** argv) {
+    int runs = argc > 1 ? atoi(argv[1]) : 20;
+    if (runs < 1) {
+        printf("usage: uniform_bench [runs]\n");
+        return 1;
+    }
+    if (!glfwInit()) {
+        printf("cannot initialize GLFW\n");
+        return 1;
+    }
+    glfwWindowHint(GLFW_CONTEXT_CREATION_API, GLFW_EGL_CONTEXT_API);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MAJOR, 4);
+    glfwWindowHint(GLFW_CONTEXT_VERSION_MINOR, 6);
+    glfwWindowHint(GLFW_OPENGL_PROFILE, GLFW_OPENGL_CORE_PROFILE);
+    glfwWindowHint(GLFW_OPENGL_FORWARD_COMPAT, GL_TRUE);
+    glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+    GLFWwindow* window = glfwCreateWindow(64, 64, "uniform_bench", nullptr, nullptr);
+    if (!window) {
+        printf("cannot create an OpenGL 4.6 context\n");
+        glfwTerminate();
+        return 1;
+    }
+    glfwMakeContextCurrent(window);
+    glewInit();
+
+    int result = 0;
+    {
+        cy::GLSLProgram program;
+        if (!program.BuildFiles("../project4/shaders/shader.vs", "../project4/shaders/shader.fs")) {
+            glfwDestroyWindow(window);
+            glfwTerminate();
+            return 1;
+        }
+        program.RegisterUniforms("mvp mv_inv_transpose mv material.kd material.ks material.ka material.shininess "
+                                 "has_texture_kd");
+
+        // Different values for every draw, so that no set is skipped as unchanged
+        std::vector<DrawValues> values(draws);
+        for (int i = 0; i < draws; i++) {
+            DrawValues& v = values[i];
+            v.mv = cy::Matrix4f::RotationY(i * 0.001f);
+            v.mv.SetTranslationComponent(cy::Vec3f(0, 0, -5 - i * 0.001f));
+            v.mvp = cy::Matrix4f::Perspective(1, 1, 0.1f, 100) * v.mv;
+            v.mv_inv_transpose = v.mv.GetInverse().GetTranspose();
+            v.kd = cy::Vec3f(0.8f, 0.5f, i * 0.0005f);
+            v.ks = cy::Vec3f(0.5f, 0.5f, i * 0.0005f);
+            v.ka = cy::Vec3f(0.1f, 0.1f, i * 0.0005f);
+            v.shininess = 10 + i * 0.01f;
+            v.has_texture_kd = i & 1;
+        }
+
+        auto by_name = [&](const DrawValues& v) {
+            program["mvp"] = v.mvp;
+            program["mv_inv_transpose"] = v.mv_inv_transpose;
+            program["mv"] = v.mv;
+            program["material.kd"] = v.kd;
+            program["material.ks"] = v.ks;
+            program["material.ka"] = v.ka;
+            program["material.shininess"] = v.shininess;
+            program["has_texture_kd"] = v.has_texture_kd;
+        };
+
+        double name = microseconds(runs, [&] {
+            for (const DrawValues& v : values) by_name(v);
+        });
+        double index = microseconds(runs, [&] {
+            program.Bind();
+            for (const DrawValues& v : values) {
+                program.SetUniform(0, v.mvp);
+                program.SetUniform(1, v.mv_inv_transpose);
+                program.SetUniform(2, v.mv);
+                program.SetUniform(3, v.kd);
+                program.SetUniform(4, v.ks);
+                program.SetUniform(5, v.ka);
+                program.SetUniform(6, v.shininess);
+                program.SetUniform(7, v.has_texture_kd);
+            }
+        });
+        double unchanged = microseconds(runs, [&] {
+            for (int i = 0; i < draws; i++) by_name(values[0]);
+        });
+        GLuint id = program.GetID();
+        double query = microseconds(runs, [&] {
+            for (const DrawValues& v : values) {
+                glUseProgram(id);
+                glUniformMatrix4fv(glGetUniformLocation(id, "mvp"), 1, GL_FALSE, v.mvp.cell);
+                glUseProgram(id);
+                glUniformMatrix4fv(glGetUniformLocation(id, "mv_inv_transpose"), 1, GL_FALSE, v.mv_inv_transpose.cell);
+                glUseProgram(id);
+                glUniformMatrix4fv(glGetUniformLocation(id, "mv"), 1, GL_FALSE, v.mv.cell);
+                glUseProgram(id);
+                glUniform3fv(glGetUniformLocation(id, "material.kd"), 1, &v.kd.x);
+                glUseProgram(id);
+                glUniform3fv(glGetUniformLocation(id, "material.ks"), 1, &v.ks.x);
+                glUseProgram(id);
+                glUniform3fv(glGetUniformLocation(id, "material.ka"), 1, &v.ka.x);
+                glUseProgram(id);
+                glUniform1f(glGetUniformLocation(id, "material.shininess"), v.shininess);
+                glUseProgram(id);
+                glUniform1i(glGetUniformLocation(id, "has_texture_kd"), v.has_texture_kd);
+            }
+        });
+        cy::GLSLProgram::InvalidateBinding();
+        program.InvalidateUniformValues();
+
+        printf("%d uniform sets, %d per draw, best of %d runs, CPU time\n\n", sets, sets_per_draw, runs);
+        printf("%-44s %10s %8s\n", "", "us", "ns/set");
+        printf("%-44s %10.1f %8.1f\n", "by name", name, name * 1e3 / sets);
+        printf("%-44s %10.1f %8.1f\n", "by registered index", index, index * 1e3 / sets);
+        printf("%-44s %10.1f %8.1f\n", "by name, unchanged values", unchanged, unchanged * 1e3 / sets);
+        printf("%-44s %10.1f %8.1f\n", "glUseProgram + glGetUniformLocation per set", query, query * 1e3 / sets);
+        if (glGetError() != GL_NO_ERROR) {
+            printf("OpenGL error\n");
+            result = 1;
+        }
+    }
+    glfwDestroyWindow(window);
+    glfwTerminate();
+    return result;
+}
@@ -0,0 +1,184 @@
+// Compares the AVX reductions of Vec3Array<float> with the generic ones on random vectors: GetBounds, Sum, Dot of two
+// arrays, Dot with a vector and Normalize. Both are checked against a double precision reference for every size up to
+// 40, which covers the partial last block of 8, and for the given size, which is also timed. Returns nonzero if a
+// result is not within the tolerance.
+//
+// Usage: vec3array_bench [size] [runs]
+#include "cyVec3Array.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+void generic_set(int array, const float* xyz, size_t n);
+void generic_get(int array, float* xyz);
+bool generic_bounds(float* bound_min, float* bound_max);
+void generic_sum(float* sum);
+float generic_dot();
+void generic_dot(const float* p, float* result);
+void generic_normalize();
+
+#ifndef __AVX__
+int main() {
+    printf("Vec3Array has no AVX reductions in this build (-mavx needed), nothing to compare\n");
+    return 0;
+}
+#else
+struct Results {
+    bool bounds;
+    float bound_min[3], bound_max[3], sum[3], dot;
+    std::vector<float> dots, normalized;
+};
+
+static const float direction[3] = {0.3f, -0.7f, 0.2f};
+
+static Results avx(const std::vector<float>& a, const std::vector<float>& b, size_t n) {
+    Results r;
+    cy::Vec3fArray va((const cy::Vec3f*)a.data(), n), vb((const cy::Vec3f*)b.data(), n);
+    cy::Vec3f bmin, bmax;
+    r.bounds = va.GetBounds(bmin, bmax);
+    bmin.Get(r.bound_min);
+    bmax.Get(r.bound_max);
+    va.Sum().Get(r.sum);
+    r.dot = va.Dot(vb);
+    r.dots.resize(n);
+    va.Dot(cy::Vec3f(direction), r.dots.data());
+    va.Normalize();
+    r.normalized.resize(3 * n);
+    va.GetAoS((cy::Vec3f*)r.normalized.data());
+    return r;
+}
+
+static Results generic(const std::vector<float>& a, const std::vector<float>& b, size_t n) {
+    Results r;
+    generic_set(0, a.data(), n);
+    generic_set(1, b.data(), n);
+    r.bounds = generic_bounds(r.bound_min, r.bound_max);
+    generic_sum(r.sum);
+    r.dot = generic_dot();
+    r.dots.resize(n);
+    generic_dot(direction, r.dots.data());
+    generic_normalize();
+    r.normalized.resize(3 * n);
+    generic_get(0, r.normalized.data());
+    return r;
+}
+
+// Values are compared relative to the sum of the magnitudes of their terms
+static bool near(float value, double reference, double magnitude, double tolerance) {
+    return std::fabs(value - reference) <= tolerance * std::max(magnitude, 1.0);
+}
+
+static int check(const char* name, const Results& r, const std::vector<float>& a, const std::vector<float>& b,
+                 size_t n) {
+    int failures = 0;
+    auto fail = [&](const char* what) {
+        if (failures++ < 5) printf("%s: %s differs for %zu vectors\n", name, what, n);
+    };
+    if (r.bounds != (n > 0)) fail("GetBounds result");
+    for (int c = 0; c < 3; c++) {
+        double mn = n ? a[c] : 0, mx = mn, sum = 0, magnitude = 0;
+        for (size_t i = 0; i < n; i++) {
+            mn = std::min(mn, (double)a[3 * i + c]);
+            mx = std::max(mx, (double)a[3 * i + c]);
+            sum += a[3 * i + c];
+            magnitude += std::fabs(a[3 * i + c]);
+        }
+        if (n && (r.bound_min[c] != mn || r.bound_max[c] != mx)) fail("GetBounds");
+        if (!near(r.sum[c], sum, magnitude, 1e-5)) fail("Sum");
+    }
+    double dot = 0, magnitude = 0;
+    for (size_t i = 0; i < 3 * n; i++) {
+        dot += (double)a[i] * b[i];
+        magnitude += std::fabs((double)a[i] * b[i]);
+    }
+    if (!near(r.dot, dot, magnitude, 1e-5)) fail("Dot of two arrays");
+    for (size_t i = 0; i < n; i++) {
+        const float* p = &a[3 * i];
+        double d = (double)p[0] * direction[0] + (double)p[1] * direction[1] + (double)p[2] * direction[2];
+        double m = std::fabs(p[0] * direction[0]) + std::fabs(p[1] * direction[1]) + std::fabs(p[2] * direction[2]);
+        if (!near(r.dots[i], d, m, 1e-6)) fail("Dot with a vector");
+        double length = std::sqrt((double)p[0] * p[0] + (double)p[1] * p[1] + (double)p[2] * p[2]);
+        for (int c = 0; c < 3; c++) {
+            if (!near(r.normalized[3 * i + c], length > 0 ? p[c] / length : 0, 1, 1e-6)) fail("Normalize");
+        }
+    }
+    return failures;
+}
+
+// Random vectors with a zero vector every 16, to check that Normalize keeps them at zero
+static std::vector<float> random_vectors(std::mt19937& rng, size_t n) {
+    std::uniform_real_distribution<float> uniform(-100, 100);
+    std::vector<float> v(3 * n);
+    for (size_t i = 0; i < n; i++) {
+        for (int c = 0; c < 3; c++) v[3 * i + c] = i % 16 == 5 ? 0 : uniform(rng);
+    }
+    return v;
+}
+
+template <typename F> static double microseconds(int runs, F f) {
+    double best = 1e30;
+    for (int run = 0; run < runs; run++) {
+        auto start = std::chrono::steady_clock::now();
+        f();
+        best = std::min(best, std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count());
+    }
+    return best * 1e6;
+}
+
+static volatile float sink;
+
+int main(int argc, char** argv) {
+    size_t size = argc > 1 ? (size_t)atol(argv[1]) : 100003;
+    int runs = argc > 2 ? atoi(argv[2]) : 200;
+    if (runs < 1) {
+        printf("usage: vec3array_bench [size] [runs]\n");
+        return 1;
+    }
+    if (!__builtin_cpu_supports("avx")) {
+        printf("the CPU does not support AVX, nothing to compare\n");
+        return 0;
+    }
+
+    std::mt19937 rng(1);
+    int failures = 0;
+    std::vector<size_t> sizes;
+    for (size_t n = 0; n <= 40; n++) sizes.push_back(n);
+    sizes.push_back(size);
+    for (size_t n : sizes) {
+        std::vector<float> a = random_vectors(rng, n), b = random_vectors(rng, n);
+        failures += check("AVX", avx(a, b, n), a, b, n);
+        failures += check("generic", generic(a, b, n), a, b, n);
+    }
+    printf("sizes 0 to 40 and %zu: %d results out of tolerance\n\n", size, failures);
+
+    std::vector<float> a = random_vectors(rng, size), b = random_vectors(rng, size);
+    std::vector<float> dots(size);
+    cy::Vec3fArray va((const cy::Vec3f*)a.data(), size), vb((const cy::Vec3f*)b.data(), size);
+    generic_set(0, a.data(), size);
+    generic_set(1, b.data(), size);
+    cy::Vec3f bmin, bmax;
+    float result[3];
+    double t[5][2];
+    t[0][0] = microseconds(runs, [&] { va.GetBounds(bmin, bmax); sink = bmin.x; });
+    t[0][1] = microseconds(runs, [&] { generic_bounds(result, result); sink = result[0]; });
+    t[1][0] = microseconds(runs, [&] { sink = va.Sum().x; });
+    t[1][1] = microseconds(runs, [&] { generic_sum(result); sink = result[0]; });
+    t[2][0] = microseconds(runs, [&] { sink = va.Dot(vb); });
+    t[2][1] = microseconds(runs, [&] { sink = generic_dot(); });
+    t[3][0] = microseconds(runs, [&] { va.Dot(cy::Vec3f(direction), dots.data()); sink = dots[0]; });
+    t[3][1] = microseconds(runs, [&] { generic_dot(direction, dots.data()); sink = dots[0]; });
+    // Normalizing normalized vectors takes the same time, so the runs can repeat it in place
+    t[4][0] = microseconds(runs, [&] { va.Normalize(); sink = va.X()[0]; });
+    t[4][1] = microseconds(runs, [&] { generic_normalize(); sink = result[0]; });
+
+    static const char* names[5] = {"GetBounds", "Sum", "Dot of two arrays", "Dot with a vector", "Normalize"};
+    printf("%zu vectors, best of %d runs\n\n", size, runs);
+    printf("%-20s %10s %10s %8s\n", "", "AVX us", "generic us", "speedup");
+    for (int i = 0; i < 5; i++) printf("%-20s %10.2f %10.2f %8.2f\n", names[i], t[i][0], t[i][1], t[i][1] / t[i][0]);
+    return failures != 0;
+}
+#endif
@@ -0,0 +1,39 @@
+// The generic reductions of Vec3Array<float>, built without -mavx as the reference for vec3array_bench.
+// cyVec3Array.h is included in a namespace, so that its classes do not collide with the AVX build of the benchmark.
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <limits>
+#include <new>
+#include <type_traits>
+#include <immintrin.h>
+
+namespace generic {
+#include "cyVec3Array.h"
+}
+
+static generic::cy::Vec3fArray arrays[2];
+
+void generic_set(int array, const float* xyz, size_t n) {
+    arrays[array].SetAoS(reinterpret_cast<const generic::cy::Vec3f*>(xyz), n);
+}
+
+void generic_get(int array, float* xyz) { arrays[array].GetAoS(reinterpret_cast<generic::cy::Vec3f*>(xyz)); }
+
+bool generic_bounds(float* bound_min, float* bound_max) {
+    generic::cy::Vec3f bmin, bmax;
+    bool result = arrays[0].GetBounds(bmin, bmax);
+    bmin.Get(bound_min);
+    bmax.Get(bound_max);
+    return result;
+}
+
+void generic_sum(float* sum) { arrays[0].Sum().Get(sum); }
+
+float generic_dot() { return arrays[0].Dot(arrays[1]); }
+
+void generic_dot(const float* p, float* result) { arrays[0].Dot(generic::cy::Vec3f(p), result); }
+
+void generic_normalize() { arrays[0].Normalize(); }
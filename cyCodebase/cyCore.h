@@ -56,6 +56,11 @@
 # include <immintrin.h>
 #endif
 
+// SSE code paths are compiled only when the intrinsics header above is included (MSVC or GCC/clang guard)
+#if defined(_INCLUDED_IMM) || defined(_IMMINTRIN_H_INCLUDED)
+# define _CY_SSE
+#endif
+
 //-------------------------------------------------------------------------------
 namespace cy {
 //-------------------------------------------------------------------------------
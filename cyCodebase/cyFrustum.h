@@ -0,0 +1,296 @@
+// cyCodeBase by Cem Yuksel
+// [www.cemyuksel.com]
+//-------------------------------------------------------------------------------
+//! \file   cyFrustum.h
+//!
+//! \brief  View frustum planes and visibility tests for culling.
+//!
+//! Frustum extracts the six clipping planes from a projection matrix using
+//! the Gribb/Hartmann method. When the matrix includes the model-view
+//! transformation, the planes are in the object space of the model, so the
+//! bounding boxes and spheres of a mesh can be tested without transforming them.
+//! The batch tests process Vec3Array streams 8 elements at a time and return
+//! bit masks of the visible elements.
+//!
+//-------------------------------------------------------------------------------
+//
+// Copyright (c) 2016, Cem Yuksel <cem@cemyuksel.com>
+// All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+//-------------------------------------------------------------------------------
+
+#ifndef _CY_FRUSTUM_H_INCLUDED_
+#define _CY_FRUSTUM_H_INCLUDED_
+
+//-------------------------------------------------------------------------------
+
+#include "cyMatrix.h"
+#include "cyVec3Array.h"
+#include <cstdint>
+
+//-------------------------------------------------------------------------------
+namespace cy {
+//-------------------------------------------------------------------------------
+
+//! View frustum defined by six planes.
+//!
+//! Each plane is stored as a 4D vector (a,b,c,d) with a normal (a,b,c) that points
+//! into the frustum, so a point p is on the inside of the plane when a*p.x+b*p.y+c*p.z+d >= 0.
+
+template <typename T>
+class Frustum
+{
+public:
+	//! Plane indices
+	enum PlaneID { LEFT=0, RIGHT, BOTTOM, TOP, NEAR_PLANE, FAR_PLANE, NUM_PLANES };
+
+	//////////////////////////////////////////////////////////////////////////
+	//!@name Constructors
+
+	Frustum() {}
+	explicit Frustum( Matrix4<T> const &m ) { Set(m); }	//!< Initialize using a projection matrix
+
+	//////////////////////////////////////////////////////////////////////////
+	//!@name Set and Get Methods
+
+	//! Extracts the planes from the given projection matrix, which can also include the view and model transformations.
+	//! The planes are normalized, so that the sphere tests use the correct distances.
+	void Set( Matrix4<T> const &m )
+	{
+		Vec4<T> r0 = m.GetRow(0), r1 = m.GetRow(1), r2 = m.GetRow(2), r3 = m.GetRow(3);
+		plane[LEFT      ] = r3 + r0;
+		plane[RIGHT     ] = r3 - r0;
+		plane[BOTTOM    ] = r3 + r1;
+		plane[TOP       ] = r3 - r1;
+		plane[NEAR_PLANE] = r3 + r2;
+		plane[FAR_PLANE ] = r3 - r2;
+		for ( int i=0; i<NUM_PLANES; ++i ) {
+			T len = Vec3<T>(plane[i]).Length();
+			if ( len > T(0) ) plane[i] /= len;
+		}
+	}
+
+	CY_NODISCARD Vec4<T> const & GetPlane( int i ) const { assert(i>=0 && i<NUM_PLANES); return plane[i]; }	//!< Returns the i^th plane
+
+	//////////////////////////////////////////////////////////////////////////
+	//!@name Visibility Tests
+
+	//! Returns true if the point is inside the frustum
+	CY_NODISCARD bool IsVisible( Vec3<T> const &p ) const
+	{
+		for ( int i=0; i<NUM_PLANES; ++i ) if ( Distance(i,p) < T(0) ) return false;
+		return true;
+	}
+
+	//! Returns true if the sphere intersects the frustum
+	CY_NODISCARD bool IsVisible( Vec3<T> const &center, T radius ) const
+	{
+		for ( int i=0; i<NUM_PLANES; ++i ) if ( Distance(i,center) < -radius ) return false;
+		return true;
+	}
+
+	//! Returns true if the axis-aligned box intersects the frustum.
+	//! For each plane only the box corner farthest along the plane normal is tested,
+	//! so the test is conservative: a box near a frustum corner can be reported visible.
+	CY_NODISCARD bool IsVisible( Vec3<T> const &boundMin, Vec3<T> const &boundMax ) const
+	{
+		for ( int i=0; i<NUM_PLANES; ++i ) {
+			Vec4<T> const &p = plane[i];
+			Vec3<T> c( p.x >= T(0) ? boundMax.x : boundMin.x, p.y >= T(0) ? boundMax.y : boundMin.y, p.z >= T(0) ? boundMax.z : boundMin.z );
+			if ( Distance(i,c) < T(0) ) return false;
+		}
+		return true;
+	}
+
+	//! Tests a batch of spheres with the given centers and radii.
+	//! Bit i of the mask is set if sphere i is visible. The mask must hold (centers.Size()+31)/32 words.
+	//! Returns the number of visible spheres.
+	size_t TestSpheres( Vec3Array<T> const &centers, T const *radius, uint32_t *mask ) const;
+
+	//! Tests a batch of axis-aligned boxes with the given minimum and maximum bounds.
+	//! Bit i of the mask is set if box i is visible. The mask must hold (boundMin.Size()+31)/32 words.
+	//! Returns the number of visible boxes.
+	size_t TestBoxes( Vec3Array<T> const &boundMin, Vec3Array<T> const &boundMax, uint32_t *mask ) const;
+
+	//! Returns true if bit i of a mask generated by one of the batch tests is set
+	CY_NODISCARD static bool IsVisible( uint32_t const *mask, size_t i ) { return ( mask[i>>5] >> (i&31) ) & 1u; }
+
+	//////////////////////////////////////////////////////////////////////////
+
+private:
+	Vec4<T> plane[NUM_PLANES];
+
+	T Distance( int i, Vec3<T> const &p ) const { return plane[i].x*p.x + plane[i].y*p.y + plane[i].z*p.z + plane[i].w; }
+
+	// Stores the visibility bits of 8 elements starting at index i, dropping the bits past the array size
+	static size_t StoreMask( uint32_t *mask, size_t i, size_t n, uint32_t bits )
+	{
+		if ( n - i < 8 ) bits &= (1u << (n-i)) - 1;
+		if ( (i & 31) == 0 ) mask[i>>5] = 0;
+		mask[i>>5] |= bits << (i&31);
+		size_t count = 0;
+		for ( ; bits; bits &= bits-1 ) ++count;
+		return count;
+	}
+};
+
+//-------------------------------------------------------------------------------
+
+template <typename T>
+inline size_t Frustum<T>::TestSpheres( Vec3Array<T> const &centers, T const *radius, uint32_t *mask ) const
+{
+	size_t const n = centers.Size();
+	T const *x=centers.X(), *y=centers.Y(), *z=centers.Z();
+	size_t count = 0;
+	for ( size_t i=0; i<n; i+=8 ) {
+		// the streams are padded to 8 values, but the radii are not
+		T r[8] = {};
+		for ( int j=0; j<8 && i+j<n; ++j ) r[j] = radius[i+j];
+		bool inside[8];
+		_CY_IVDEP_FOR ( int j=0; j<8; ++j ) inside[j] = true;
+		for ( int k=0; k<NUM_PLANES; ++k ) {
+			Vec4<T> const &p = plane[k];
+			_CY_IVDEP_FOR ( int j=0; j<8; ++j ) inside[j] &= x[i+j]*p.x + y[i+j]*p.y + z[i+j]*p.z + p.w >= -r[j];
+		}
+		uint32_t bits = 0;
+		for ( int j=0; j<8; ++j ) bits |= uint32_t(inside[j]) << j;
+		count += StoreMask(mask,i,n,bits);
+	}
+	return count;
+}
+
+template <typename T>
+inline size_t Frustum<T>::TestBoxes( Vec3Array<T> const &boundMin, Vec3Array<T> const &boundMax, uint32_t *mask ) const
+{
+	assert( boundMin.Size() == boundMax.Size() );
+	size_t const n = boundMin.Size();
+	size_t count = 0;
+	for ( size_t i=0; i<n; i+=8 ) {
+		bool inside[8];
+		_CY_IVDEP_FOR ( int j=0; j<8; ++j ) inside[j] = true;
+		for ( int k=0; k<NUM_PLANES; ++k ) {
+			Vec4<T> const &p = plane[k];
+			// the sign of the plane normal selects the farthest corner, so there is no per-element branch
+			T const *x = ( p.x >= T(0) ? boundMax.X() : boundMin.X() ) + i;
+			T const *y = ( p.y >= T(0) ? boundMax.Y() : boundMin.Y() ) + i;
+			T const *z = ( p.z >= T(0) ? boundMax.Z() : boundMin.Z() ) + i;
+			_CY_IVDEP_FOR ( int j=0; j<8; ++j ) inside[j] &= x[j]*p.x + y[j]*p.y + z[j]*p.z + p.w >= T(0);
+		}
+		uint32_t bits = 0;
+		for ( int j=0; j<8; ++j ) bits |= uint32_t(inside[j]) << j;
+		count += StoreMask(mask,i,n,bits);
+	}
+	return count;
+}
+
+//-------------------------------------------------------------------------------
+// AVX implementations for single precision
+//-------------------------------------------------------------------------------
+
+#if defined(_CY_SSE) && defined(__AVX__)
+
+template <> inline size_t Frustum<float>::TestSpheres( Vec3Array<float> const &centers, float const *radius, uint32_t *mask ) const
+{
+	size_t const n = centers.Size();
+	float const *x=centers.X(), *y=centers.Y(), *z=centers.Z();
+	__m256 const zero = _mm256_setzero_ps();
+	size_t count = 0;
+	for ( size_t i=0; i<n; i+=8 ) {
+		__m256 r;
+		if ( n-i >= 8 ) r = _mm256_loadu_ps(radius+i);
+		else {
+			alignas(32) float rt[8] = {};
+			for ( size_t j=0; j<n-i; ++j ) rt[j] = radius[i+j];
+			r = _mm256_load_ps(rt);
+		}
+		r = _mm256_sub_ps( zero, r );
+		__m256 vx = _mm256_load_ps(x+i), vy = _mm256_load_ps(y+i), vz = _mm256_load_ps(z+i);
+		__m256 inside = _mm256_castsi256_ps( _mm256_set1_epi32(-1) );
+		for ( int k=0; k<NUM_PLANES; ++k ) {
+			Vec4<float> const &p = plane[k];
+			__m256 d = _mm256_add_ps( _mm256_mul_ps(vx,_mm256_set1_ps(p.x)), _mm256_mul_ps(vy,_mm256_set1_ps(p.y)) );
+			d = _mm256_add_ps( d, _mm256_mul_ps(vz,_mm256_set1_ps(p.z)) );
+			d = _mm256_add_ps( d, _mm256_set1_ps(p.w) );
+			inside = _mm256_and_ps( inside, _mm256_cmp_ps(d,r,_CMP_GE_OQ) );	// same operations as IsVisible, so the results match exactly
+		}
+		count += StoreMask( mask, i, n, (uint32_t) _mm256_movemask_ps(inside) );
+	}
+	return count;
+}
+
+template <> inline size_t Frustum<float>::TestBoxes( Vec3Array<float> const &boundMin, Vec3Array<float> const &boundMax, uint32_t *mask ) const
+{
+	assert( boundMin.Size() == boundMax.Size() );
+	size_t const n = boundMin.Size();
+	__m256 const zero = _mm256_setzero_ps();
+	size_t count = 0;
+	for ( size_t i=0; i<n; i+=8 ) {
+		__m256 inside = _mm256_castsi256_ps( _mm256_set1_epi32(-1) );
+		for ( int k=0; k<NUM_PLANES; ++k ) {
+			Vec4<float> const &p = plane[k];
+			__m256 vx = _mm256_load_ps( ( p.x >= 0 ? boundMax.X() : boundMin.X() ) + i );
+			__m256 vy = _mm256_load_ps( ( p.y >= 0 ? boundMax.Y() : boundMin.Y() ) + i );
+			__m256 vz = _mm256_load_ps( ( p.z >= 0 ? boundMax.Z() : boundMin.Z() ) + i );
+			__m256 d = _mm256_add_ps( _mm256_mul_ps(vx,_mm256_set1_ps(p.x)), _mm256_mul_ps(vy,_mm256_set1_ps(p.y)) );
+			d = _mm256_add_ps( d, _mm256_mul_ps(vz,_mm256_set1_ps(p.z)) );
+			d = _mm256_add_ps( d, _mm256_set1_ps(p.w) );
+			inside = _mm256_and_ps( inside, _mm256_cmp_ps(d,zero,_CMP_GE_OQ) );
+		}
+		count += StoreMask( mask, i, n, (uint32_t) _mm256_movemask_ps(inside) );
+	}
+	return count;
+}
+
+#endif
+
+//-------------------------------------------------------------------------------
+
+//! Counts the objects tested against a frustum and the ones that passed, typically reset every frame.
+class CullStats
+{
+public:
+	CullStats() : tested(0), visible(0) {}
+
+	void Reset() { tested=0; visible=0; }																	//!< Clears the counters
+	void Add( bool isVisible ) { tested++; if ( isVisible ) visible++; }									//!< Records the result of a single test
+	void Add( size_t numTested, size_t numVisible ) { tested+=numTested; visible+=numVisible; }				//!< Records the results of a batch test
+
+	CY_NODISCARD size_t NumTested () const { return tested; }			//!< Returns the number of tested objects
+	CY_NODISCARD size_t NumVisible() const { return visible; }			//!< Returns the number of objects that passed the test
+	CY_NODISCARD size_t NumCulled () const { return tested-visible; }	//!< Returns the number of culled objects
+
+private:
+	size_t tested, visible;
+};
+
+typedef Frustum<float>  Frustumf;	//!< Single precision (float) view frustum
+typedef Frustum<double> Frustumd;	//!< Double precision (double) view frustum
+
+//-------------------------------------------------------------------------------
+} // namespace cy
+//-------------------------------------------------------------------------------
+
+typedef cy::Frustumf cyFrustumf;	//!< Single precision (float) view frustum
+typedef cy::Frustumd cyFrustumd;	//!< Double precision (double) view frustum
+
+//-------------------------------------------------------------------------------
+
+#endif
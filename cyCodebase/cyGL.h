@@ -81,6 +81,15 @@
 #include <fstream>
 #include <sstream>
 #include <cassert>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+#include <cstdint>
+#include <tuple>
+#include <deque>
+#include <functional>
+#include <mutex>
+#include <condition_variable>
 #include <regex>
 #include <filesystem>
 
@@ -164,6 +173,11 @@ public:
 	//! Checks if an OpenGL context exists. Returns false if a valid OpenGL context cannot be retrieved.
 	//! This is mostly useful for safely deleting previously allocated OpenGL objects.
 	static bool CheckContext() { return _CY_GL_GET_CONTEXT ? true : false; }
+
+#ifdef GL_VERSION_3_0
+	//! Returns true if the current OpenGL context supports the extension with the given name, such as "GL_KHR_debug".
+	static bool IsExtensionSupported( char const *name );
+#endif
 };
 
 //-------------------------------------------------------------------------------
@@ -250,6 +264,108 @@ protected:
 
 //-------------------------------------------------------------------------------
 
+//! OpenGL state cache.
+//!
+//! This class keeps shadow copies of the OpenGL bindings and states that render loops
+//! change most often and skips the calls that would set them to their current values.
+//! It covers the bound program, vertex array object, textures per texture unit,
+//! framebuffers, viewport, and the depth, face culling, blending, stencil, and scissor states.
+//! GLSLProgram, GLTexture, and GLRenderBuffer bind through this class, so mixing them with
+//! the methods here keeps the cache consistent. All values are unknown initially, so the first
+//! call of each kind always reaches OpenGL. The class has no local storage and all methods are static.
+//! The cache belongs to a single OpenGL context and must be used from the thread of that context.
+//! Invalidate() must be called after these states are changed without this class
+//! and after making a different OpenGL context current.
+class GLState
+{
+public:
+	//!@name Bindings
+
+	static void UseProgram   ( GLuint program );						//!< Binds the given program. The call is skipped if it is already bound.
+	static void ActiveTexture( int textureUnit );						//!< Sets the active texture unit. The call is skipped if it is already active.
+	static void BindTexture  ( GLenum target, GLuint texture );		//!< Binds the texture to the active texture unit.
+	static void BindTexture  ( int textureUnit, GLenum target, GLuint texture );	//!< Binds the texture to the given texture unit and makes that unit active.
+#ifdef GL_VERSION_3_0
+	static void BindVertexArray( GLuint vertexArray );					//!< Binds the given vertex array object. The call is skipped if it is already bound.
+	static void BindFramebuffer( GLenum target, GLuint framebuffer );	//!< Binds the framebuffer to GL_DRAW_FRAMEBUFFER, GL_READ_FRAMEBUFFER, or both with GL_FRAMEBUFFER.
+#endif
+
+	//!@name Fixed-Function States
+
+	static void Viewport  ( GLint x, GLint y, GLsizei width, GLsizei height );	//!< Sets the viewport. The call is skipped if the viewport is unchanged.
+	static void Enable    ( GLenum capability ) { SetEnabled( capability, true  ); }	//!< Enables the given capability.
+	static void Disable   ( GLenum capability ) { SetEnabled( capability, false ); }	//!< Disables the given capability.
+	static void DepthMask ( bool   write );		//!< Enables or disables writing into the depth buffer.
+	static void DepthFunc ( GLenum func  );		//!< Sets the depth comparison function.
+	static void CullFace  ( GLenum mode  );		//!< Sets the culled faces: GL_FRONT, GL_BACK, or GL_FRONT_AND_BACK.
+	static void FrontFace ( GLenum mode  );		//!< Sets the winding of the front faces: GL_CW or GL_CCW.
+
+	//! Enables or disables the given capability.
+	//! GL_DEPTH_TEST, GL_CULL_FACE, GL_BLEND, GL_STENCIL_TEST, and GL_SCISSOR_TEST are cached.
+	//! Other capabilities are always passed to OpenGL.
+	static void SetEnabled( GLenum capability, bool enable );
+
+	//!@name Cache Control
+
+	static GLuint GetProgram() { return Current().program; }	//!< Returns the program bound through this class or CY_GL_INVALID_ID if it is unknown.
+
+	//! Forgets all cached values, so that the next call of each method reaches OpenGL.
+	//! This must be called after these states are changed without this class.
+	static void Invalidate();
+
+	static void InvalidateProgram() { Current().program = CY_GL_INVALID_ID; }	//!< Forgets the program binding only.
+
+	//! Removes the given texture from the cache. This is called when the texture is deleted,
+	//! since OpenGL unbinds deleted textures and may reuse their IDs.
+	static void DeleteTexture( GLuint texture );
+#ifdef GL_VERSION_3_0
+	//! Removes the given framebuffer from the cached draw and read framebuffer bindings.
+	//! This is called when the framebuffer is deleted, for the same reason.
+	static void DeleteFramebuffer( GLuint framebuffer );
+#endif
+
+	static size_t GetElidedCount() { return Current().elided; }	//!< Returns the number of calls that were skipped because they would not change the state.
+	static size_t GetIssuedCount() { return Current().issued; }	//!< Returns the number of calls that were passed to OpenGL.
+	static void   ResetCounts   () { Current().elided = Current().issued = 0; }	//!< Resets the call counts, typically at the beginning of a frame.
+
+private:
+	static int const NUM_TEXTURE_UNITS = 32;	//!< The number of texture units that are cached. Bindings to higher units are always passed to OpenGL.
+	static int const NUM_CAPABILITIES  = 5;		//!< The number of cached capabilities.
+
+	//! A cached texture binding. A unit can hold one texture per target, but only the last target bound is cached.
+	struct TextureBinding
+	{
+		GLenum target;
+		GLuint texture;
+	};
+
+	//! The cached states. Unknown values are CY_GL_INVALID_ID or -1.
+	struct State
+	{
+		GLuint         program;
+		GLuint         vertexArray;
+		GLuint         drawFramebuffer;
+		GLuint         readFramebuffer;
+		int            activeUnit;
+		TextureBinding textures[NUM_TEXTURE_UNITS];
+		GLint          viewport[4];
+		signed char    capabilities[NUM_CAPABILITIES];
+		signed char    depthMask;
+		GLenum         depthFunc;
+		GLenum         cullFace;
+		GLenum         frontFace;
+		size_t         elided;
+		size_t         issued;
+		State();
+	};
+
+	static State& Current() { static State state; return state; }
+	static int  CapabilityIndex( GLenum capability );
+	static bool Skip( bool unchanged ) { if ( unchanged ) Current().elided++; else Current().issued++; return unchanged; }	//!< Counts the call and returns true if it should be skipped
+};
+
+//-------------------------------------------------------------------------------
+
 //! OpenGL texture base class.
 //!
 //! This class provides a convenient interface for handling basic texture
@@ -273,11 +389,11 @@ public:
 
 	//!@name General Methods
 
-	void   Delete() { if ( textureID != CY_GL_INVALID_ID ) glDeleteTextures(1,&textureID); textureID = CY_GL_INVALID_ID; }	//!< Deletes the texture.
+	void   Delete() { if ( textureID != CY_GL_INVALID_ID ) { GLState::DeleteTexture(textureID); glDeleteTextures(1,&textureID); } textureID = CY_GL_INVALID_ID; }	//!< Deletes the texture.
 	GLuint GetID () const { return textureID; }													//!< Returns the texture ID.
 	bool   IsNull() const { return textureID == CY_GL_INVALID_ID; }								//!< Returns true if the OpenGL texture object is not generated, i.e. the texture id is invalid.
-	void   Bind  () const { glBindTexture(TEXTURE_TYPE, textureID); }							//!< Binds the texture to the current texture unit.
-	void   Bind  (int textureUnit) const { glActiveTexture(GL_TEXTURE0+textureUnit); Bind(); }	//!< Binds the texture to the given texture unit.
+	void   Bind  () const { GLState::BindTexture(TEXTURE_TYPE, textureID); }					//!< Binds the texture to the current texture unit.
+	void   Bind  (int textureUnit) const { GLState::BindTexture(textureUnit, TEXTURE_TYPE, textureID); }	//!< Binds the texture to the given texture unit.
 	GLenum Type  () const { return TEXTURE_TYPE; }
 
 	//!@name Texture Creation and Initialization
@@ -291,6 +407,9 @@ public:
 	void BuildMipmaps() { Bind(); glGenerateMipmap(TEXTURE_TYPE); }
 #endif
 
+	//! Returns the number of levels in the full mipmap chain of an image with the given size.
+	static GLsizei NumMipmapLevels( GLsizei width, GLsizei height=1, GLsizei depth=1 ) { GLsizei levels = 1; for ( GLsizei size = (std::max)(width,(std::max)(height,depth)); size > 1; size >>= 1 ) levels++; return levels; }
+
 	//! Sets the texture filtering mode.
 	//! The acceptable values are GL_NEAREST and GL_LINEAR.
 	//! The minification filter values can also be GL_NEAREST_MIPMAP_NEAREST, GL_LINEAR_MIPMAP_NEAREST, GL_NEAREST_MIPMAP_LINEAR, or GL_LINEAR_MIPMAP_LINEAR.
@@ -429,6 +548,21 @@ public:
 	template <typename T> void SetSubImageRG  ( T const *data, GLint xOffset, GLint yOffset, GLsizei width, GLsizei height, int level=0 ) { SetSubImage(data,2,xOffset,yOffset,width,height,level); }	//!< Sets the part of the texture image with 2 channels.
 	template <typename T> void SetSubImageR   ( T const *data, GLint xOffset, GLint yOffset, GLsizei width, GLsizei height, int level=0 ) { SetSubImage(data,1,xOffset,yOffset,width,height,level); }	//!< Sets the part of the texture image with 1 channel.
 
+#ifdef GL_VERSION_4_2
+	//! Allocates immutable storage for the texture using the given texture format.
+	//! If numLevels is zero, the storage includes the full mipmap chain (a single level for rectangle textures).
+	//! The storage cannot be reallocated, so the texture image must be set using SetSubImage instead of SetImage.
+	void SetStorage( GLenum textureFormat, GLsizei width, GLsizei height, GLsizei numLevels=0 )
+	{
+		if ( numLevels <= 0 ) numLevels = TEXTURE_TYPE == GL_TEXTURE_RECTANGLE ? 1 : GLTexture<TEXTURE_TYPE>::NumMipmapLevels( width, TEXTURE_TYPE == GL_TEXTURE_1D_ARRAY ? 1 : height );
+		GLTexture<TEXTURE_TYPE>::Bind();
+		glTexStorage2D(TEXTURE_TYPE,numLevels,textureFormat,width,height);
+	}
+
+	//! Allocates immutable storage for the texture. The texture format is determined by the texture type and the number of channels.
+	void SetStorage( GL::Type textureType, int numChannels, GLsizei width, GLsizei height, GLsizei numLevels=0 ) { SetStorage(GL::TextureFormat(textureType,numChannels),width,height,numLevels); }
+#endif
+
 	//! Sets the texture wrapping parameter.
 	//! The acceptable values are GL_REPEAT, GL_MIRRORED_REPEAT, GL_CLAMP, and GL_CLAMP_TO_BORDER.
 	//! If the wrap argument is zero, the corresponding wrapping parameter is not changed.
@@ -563,6 +697,22 @@ public:
 	template <typename T> void SetImageRG  ( Side side, T const *data, GLsizei width, GLsizei height, int level=0 ) { SetImage(side,data,2,width,height,level); }	//!< Sets the texture image with 2 channels.
 	template <typename T> void SetImageR   ( Side side, T const *data, GLsizei width, GLsizei height, int level=0 ) { SetImage(side,data,1,width,height,level); }	//!< Sets the texture image with 1 channel.
 
+	//! Sets the part of the texture image of a side using the given data format and data type.
+	void SetSubImage( Side side, GLenum dataFormat, GLenum dataType, void const *data, GLint xOffset, GLint yOffset, GLsizei width, GLsizei height, int level=0 ) { GLTexture<GL_TEXTURE_CUBE_MAP>::Bind(); glTexSubImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X+side,level,xOffset,yOffset,width,height,dataFormat,dataType,data); }
+
+	//! Sets the part of the texture image of a side using the given data format. The data type is determined by the data pointer type.
+	template <typename T> void SetSubImage( Side side, GLenum dataFormat, T const *data, GLint xOffset, GLint yOffset, GLsizei width, GLsizei height, int level=0 ) { SetSubImage(side,dataFormat,GL::GetGLType(data),data,xOffset,yOffset,width,height,level); }
+
+#ifdef GL_VERSION_4_2
+	//! Allocates immutable storage for all sides of the cube map using the given texture format and side size.
+	//! If numLevels is zero, the storage includes the full mipmap chain.
+	//! The storage cannot be reallocated, so the side images must be set using SetSubImage instead of SetImage.
+	void SetStorage( GLenum textureFormat, GLsizei size, GLsizei numLevels=0 ) { GLTexture<GL_TEXTURE_CUBE_MAP>::Bind(); glTexStorage2D(GL_TEXTURE_CUBE_MAP,numLevels>0?numLevels:NumMipmapLevels(size),textureFormat,size,size); }
+
+	//! Allocates immutable storage for all sides of the cube map. The texture format is determined by the texture type and the number of channels.
+	void SetStorage( GL::Type textureType, int numChannels, GLsizei size, GLsizei numLevels=0 ) { SetStorage(GL::TextureFormat(textureType,numChannels),size,numLevels); }
+#endif
+
 #ifdef GL_TEXTURE_CUBE_MAP_SEAMLESS
 	//! Sets the global seamless cube mapping flag, if supported by the hardware.
 	static void SetSeamless(bool enable=true) { if (enable) glEnable(GL_TEXTURE_CUBE_MAP_SEAMLESS); else glDisable(GL_TEXTURE_CUBE_MAP_SEAMLESS); }
@@ -804,6 +954,10 @@ public:
 	template <bool file, bool parse>
 	bool Compile( char const *shaderSource, GLenum shaderType, int prependSourceCount, char const **prependSources, std::ostream *outStream=&std::cout );
 
+	//! Returns the compile status of the given shader and writes its info log (if any) to the given output stream.
+	//! This call waits until the compilation of the shader is completed.
+	static bool CheckCompileStatus( GLuint shaderID, std::ostream *outStream=&std::cout );
+
 	//!@name Source File Management
 
 	//! GLSL Shader Source class.
@@ -833,6 +987,12 @@ public:
 	//! Loads the given source file into a source string and returns it.
 	//! If load fails, an error message is printed to the given out stream and an empty string is returned.
 	static Source LoadSourceFile( char const *filename, std::ostream *outStream=&std::cout ) { Source s; s.LoadFile(filename,outStream); return s; }
+
+	//! Returns the complete shader source code that Compile would use, excluding the prepend sources.
+	//! If file is true, the source is treated as a file name, otherwise it is treated as the source code.
+	//! If parse is true, the include statements are recursively replaced with the contents of the included files.
+	template <bool file, bool parse>
+	static bool LoadSource( std::string &sourceCode, char const *shaderSource, std::ostream *outStream=&std::cout );
 };
 
 //-------------------------------------------------------------------------------
@@ -850,16 +1010,160 @@ private:
 	GLuint programID;			//!< The program ID
 	std::vector<GLint> params;	//!< A list of registered uniform parameter IDs
 
+	//! An entry of the uniform location table. Empty slots have an empty name.
+	struct UniformEntry
+	{
+		std::string name;
+		GLuint      hash;
+		GLint       location;
+	};
+	std::vector<UniformEntry> uniforms;		//!< Open addressing hash table of uniform locations. Its size is zero or a power of two.
+	unsigned int              numUniforms;	//!< The number of used entries in the uniform table
+
+	static GLuint  HashName( char const *name ) { GLuint h = 2166136261u; for ( ; *name; ++name ) h = ( h ^ GLuint(*name) ) * 16777619u; return h; }	//!< FNV-1a hash of a uniform name
+	void BuildUniformTable();
+	void AddUniformEntry( char const *name, GLuint hash, GLint location );
+
+	std::vector< std::vector<char> > values;	//!< Shadow copies of the last values set for each uniform location
+	static size_t& ElidedCount() { static size_t count = 0; return count; }	//!< The number of uniform calls skipped by all programs
+
+	bool fromBinaryCache;	//!< True if the program was loaded from the program binary cache
+	static std::string& BinaryCacheDirectory() { static std::string dir; return dir; }	//!< The directory of the program binary cache. Empty if the cache is disabled.
+#ifdef GL_VERSION_4_1
+	bool LoadBinary( std::string const &filename );			//!< Creates the program from the given program binary file. Returns false if the file is missing or rejected.
+	void SaveBinary( std::string const &filename ) const;	//!< Writes the binary of the linked program to the given file.
+#endif
+
+	//! Returns the program binary cache file for the given shader sources, or an empty string if the cache is disabled or not supported.
+	static std::string BinaryCacheFile( std::string const *sources, int prependSourceCount, char const **prependSource );
+
+	//! A shader whose compilation has been submitted, but whose status has not been checked yet
+	struct PendingShader
+	{
+		GLuint      shaderID;
+		int         stage;	//!< Index of the shader stage: vertex, fragment, geometry, tessellation control, or tessellation evaluation
+		std::string name;	//!< The file name of the shader, used in error messages
+	};
+	std::vector<PendingShader> pendingShaders;	//!< The shaders of the program being built. Empty if the program is not being built.
+	std::string pendingBinaryFile;				//!< The program binary cache file to write when the pending build is finished
+
+	static std::vector<GLSLProgram*>& PendingPrograms() { static std::vector<GLSLProgram*> programs; return programs; }	//!< The programs whose builds are not finished
+	void DeletePending() { for ( PendingShader const &s : pendingShaders ) glDeleteShader( s.shaderID ); pendingShaders.clear(); pendingBinaryFile.clear(); RemovePending(); }
+	void RemovePending() { auto &p = PendingPrograms(); p.erase( std::remove( p.begin(), p.end(), this ), p.end() ); }
+#ifdef GL_KHR_parallel_shader_compile
+	static bool ParallelCompileSupported() { static bool supported = GL::IsExtensionSupported("GL_KHR_parallel_shader_compile"); return supported; }
+#endif
+	static GLenum ShaderStageType( int stage ) { GLenum const t[] = { GL_VERTEX_SHADER, GL_FRAGMENT_SHADER, GL_GEOMETRY_SHADER, GL_TESS_CONTROL_SHADER, GL_TESS_EVALUATION_SHADER }; return t[stage]; }
+	static char const * ShaderStageName( int stage ) { char const *n[] = { "vertex shader", "fragment shader", "geometry shader", "tessellation control shader", "tessellation evaluation shader" }; return n[stage]; }
+
+	//! Loads the given shaders (vertex, fragment, geometry, tessellation control, and tessellation evaluation) and
+	//! submits their compilation and the link of the program without waiting for them. Shaders that are nullptr are skipped.
+	//! If the program binary cache has the program, it is loaded instead and no build is left pending.
+	template <bool files, bool parse>
+	bool Submit( char const * const *shaders, int prependSourceCount, char const **prependSource, std::ostream *outStream );
+
+	bool CheckLinkStatus( std::ostream *outStream );	//!< Returns the link status, writes the info log to the given stream, and builds the uniform table if the link is successful.
+
+	//! Returns true if the given value differs from the shadow copy at the given location and updates the shadow copy.
+	//! Array and transposed matrix values are not shadowed; they clear the shadow copies of the locations they cover.
+	bool IsNewValue( GLint location, void const *data, size_t size, GLsizei count=1, GLboolean transpose=GL_FALSE );
+
+	//!@{
+	//! Calls the OpenGL uniform function only if the value differs from the shadow copy of the last value set.
+	void Uniform1f   ( GLint id, float x ) { float const v[] = {x}; if ( IsNewValue(id,v,sizeof(v)) ) glUniform1f(id,x); }
+	void Uniform2f   ( GLint id, float x, float y ) { float const v[] = {x,y}; if ( IsNewValue(id,v,sizeof(v)) ) glUniform2f(id,x,y); }
+	void Uniform3f   ( GLint id, float x, float y, float z ) { float const v[] = {x,y,z}; if ( IsNewValue(id,v,sizeof(v)) ) glUniform3f(id,x,y,z); }
+	void Uniform4f   ( GLint id, float x, float y, float z, float w ) { float const v[] = {x,y,z,w}; if ( IsNewValue(id,v,sizeof(v)) ) glUniform4f(id,x,y,z,w); }
+	void Uniform1fv  ( GLint id, GLsizei count, float const *v ) { if ( IsNewValue(id,v,sizeof(float)*count,count) ) glUniform1fv(id,count,v); }
+	void Uniform2fv  ( GLint id, GLsizei count, float const *v ) { if ( IsNewValue(id,v,sizeof(float)*2*count,count) ) glUniform2fv(id,count,v); }
+	void Uniform3fv  ( GLint id, GLsizei count, float const *v ) { if ( IsNewValue(id,v,sizeof(float)*3*count,count) ) glUniform3fv(id,count,v); }
+	void Uniform4fv  ( GLint id, GLsizei count, float const *v ) { if ( IsNewValue(id,v,sizeof(float)*4*count,count) ) glUniform4fv(id,count,v); }
+	void Uniform1i   ( GLint id, int x ) { int const v[] = {x}; if ( IsNewValue(id,v,sizeof(v)) ) glUniform1i(id,x); }
+	void Uniform2i   ( GLint id, int x, int y ) { int const v[] = {x,y}; if ( IsNewValue(id,v,sizeof(v)) ) glUniform2i(id,x,y); }
+	void Uniform3i   ( GLint id, int x, int y, int z ) { int const v[] = {x,y,z}; if ( IsNewValue(id,v,sizeof(v)) ) glUniform3i(id,x,y,z); }
+	void Uniform4i   ( GLint id, int x, int y, int z, int w ) { int const v[] = {x,y,z,w}; if ( IsNewValue(id,v,sizeof(v)) ) glUniform4i(id,x,y,z,w); }
+	void Uniform1iv  ( GLint id, GLsizei count, int const *v ) { if ( IsNewValue(id,v,sizeof(int)*count,count) ) glUniform1iv(id,count,v); }
+	void Uniform2iv  ( GLint id, GLsizei count, int const *v ) { if ( IsNewValue(id,v,sizeof(int)*2*count,count) ) glUniform2iv(id,count,v); }
+	void Uniform3iv  ( GLint id, GLsizei count, int const *v ) { if ( IsNewValue(id,v,sizeof(int)*3*count,count) ) glUniform3iv(id,count,v); }
+	void Uniform4iv  ( GLint id, GLsizei count, int const *v ) { if ( IsNewValue(id,v,sizeof(int)*4*count,count) ) glUniform4iv(id,count,v); }
+#ifdef GL_VERSION_3_0
+	void Uniform1ui  ( GLint id, GLuint x ) { GLuint const v[] = {x}; if ( IsNewValue(id,v,sizeof(v)) ) glUniform1ui(id,x); }
+	void Uniform2ui  ( GLint id, GLuint x, GLuint y ) { GLuint const v[] = {x,y}; if ( IsNewValue(id,v,sizeof(v)) ) glUniform2ui(id,x,y); }
+	void Uniform3ui  ( GLint id, GLuint x, GLuint y, GLuint z ) { GLuint const v[] = {x,y,z}; if ( IsNewValue(id,v,sizeof(v)) ) glUniform3ui(id,x,y,z); }
+	void Uniform4ui  ( GLint id, GLuint x, GLuint y, GLuint z, GLuint w ) { GLuint const v[] = {x,y,z,w}; if ( IsNewValue(id,v,sizeof(v)) ) glUniform4ui(id,x,y,z,w); }
+	void Uniform1uiv ( GLint id, GLsizei count, GLuint const *v ) { if ( IsNewValue(id,v,sizeof(GLuint)*count,count) ) glUniform1uiv(id,count,v); }
+	void Uniform2uiv ( GLint id, GLsizei count, GLuint const *v ) { if ( IsNewValue(id,v,sizeof(GLuint)*2*count,count) ) glUniform2uiv(id,count,v); }
+	void Uniform3uiv ( GLint id, GLsizei count, GLuint const *v ) { if ( IsNewValue(id,v,sizeof(GLuint)*3*count,count) ) glUniform3uiv(id,count,v); }
+	void Uniform4uiv ( GLint id, GLsizei count, GLuint const *v ) { if ( IsNewValue(id,v,sizeof(GLuint)*4*count,count) ) glUniform4uiv(id,count,v); }
+#endif
+#ifdef GL_VERSION_4_0
+	void Uniform1d   ( GLint id, double x ) { double const v[] = {x}; if ( IsNewValue(id,v,sizeof(v)) ) glUniform1d(id,x); }
+	void Uniform2d   ( GLint id, double x, double y ) { double const v[] = {x,y}; if ( IsNewValue(id,v,sizeof(v)) ) glUniform2d(id,x,y); }
+	void Uniform3d   ( GLint id, double x, double y, double z ) { double const v[] = {x,y,z}; if ( IsNewValue(id,v,sizeof(v)) ) glUniform3d(id,x,y,z); }
+	void Uniform4d   ( GLint id, double x, double y, double z, double w ) { double const v[] = {x,y,z,w}; if ( IsNewValue(id,v,sizeof(v)) ) glUniform4d(id,x,y,z,w); }
+	void Uniform1dv  ( GLint id, GLsizei count, double const *v ) { if ( IsNewValue(id,v,sizeof(double)*count,count) ) glUniform1dv(id,count,v); }
+	void Uniform2dv  ( GLint id, GLsizei count, double const *v ) { if ( IsNewValue(id,v,sizeof(double)*2*count,count) ) glUniform2dv(id,count,v); }
+	void Uniform3dv  ( GLint id, GLsizei count, double const *v ) { if ( IsNewValue(id,v,sizeof(double)*3*count,count) ) glUniform3dv(id,count,v); }
+	void Uniform4dv  ( GLint id, GLsizei count, double const *v ) { if ( IsNewValue(id,v,sizeof(double)*4*count,count) ) glUniform4dv(id,count,v); }
+#endif
+	void UniformMatrix2fv    ( GLint id, GLsizei count, GLboolean transpose, float const *m ) { if ( IsNewValue(id,m,sizeof(float)*4*count,count,transpose) ) glUniformMatrix2fv(id,count,transpose,m); }
+	void UniformMatrix3fv    ( GLint id, GLsizei count, GLboolean transpose, float const *m ) { if ( IsNewValue(id,m,sizeof(float)*9*count,count,transpose) ) glUniformMatrix3fv(id,count,transpose,m); }
+	void UniformMatrix4fv    ( GLint id, GLsizei count, GLboolean transpose, float const *m ) { if ( IsNewValue(id,m,sizeof(float)*16*count,count,transpose) ) glUniformMatrix4fv(id,count,transpose,m); }
+#ifdef GL_VERSION_2_1
+	void UniformMatrix2x3fv  ( GLint id, GLsizei count, GLboolean transpose, float const *m ) { if ( IsNewValue(id,m,sizeof(float)*6*count,count,transpose) ) glUniformMatrix2x3fv(id,count,transpose,m); }
+	void UniformMatrix2x4fv  ( GLint id, GLsizei count, GLboolean transpose, float const *m ) { if ( IsNewValue(id,m,sizeof(float)*8*count,count,transpose) ) glUniformMatrix2x4fv(id,count,transpose,m); }
+	void UniformMatrix3x2fv  ( GLint id, GLsizei count, GLboolean transpose, float const *m ) { if ( IsNewValue(id,m,sizeof(float)*6*count,count,transpose) ) glUniformMatrix3x2fv(id,count,transpose,m); }
+	void UniformMatrix3x4fv  ( GLint id, GLsizei count, GLboolean transpose, float const *m ) { if ( IsNewValue(id,m,sizeof(float)*12*count,count,transpose) ) glUniformMatrix3x4fv(id,count,transpose,m); }
+	void UniformMatrix4x2fv  ( GLint id, GLsizei count, GLboolean transpose, float const *m ) { if ( IsNewValue(id,m,sizeof(float)*8*count,count,transpose) ) glUniformMatrix4x2fv(id,count,transpose,m); }
+	void UniformMatrix4x3fv  ( GLint id, GLsizei count, GLboolean transpose, float const *m ) { if ( IsNewValue(id,m,sizeof(float)*12*count,count,transpose) ) glUniformMatrix4x3fv(id,count,transpose,m); }
+#endif
+#ifdef GL_VERSION_4_0
+	void UniformMatrix2dv    ( GLint id, GLsizei count, GLboolean transpose, double const *m ) { if ( IsNewValue(id,m,sizeof(double)*4*count,count,transpose) ) glUniformMatrix2dv(id,count,transpose,m); }
+	void UniformMatrix3dv    ( GLint id, GLsizei count, GLboolean transpose, double const *m ) { if ( IsNewValue(id,m,sizeof(double)*9*count,count,transpose) ) glUniformMatrix3dv(id,count,transpose,m); }
+	void UniformMatrix4dv    ( GLint id, GLsizei count, GLboolean transpose, double const *m ) { if ( IsNewValue(id,m,sizeof(double)*16*count,count,transpose) ) glUniformMatrix4dv(id,count,transpose,m); }
+	void UniformMatrix2x3dv  ( GLint id, GLsizei count, GLboolean transpose, double const *m ) { if ( IsNewValue(id,m,sizeof(double)*6*count,count,transpose) ) glUniformMatrix2x3dv(id,count,transpose,m); }
+	void UniformMatrix2x4dv  ( GLint id, GLsizei count, GLboolean transpose, double const *m ) { if ( IsNewValue(id,m,sizeof(double)*8*count,count,transpose) ) glUniformMatrix2x4dv(id,count,transpose,m); }
+	void UniformMatrix3x2dv  ( GLint id, GLsizei count, GLboolean transpose, double const *m ) { if ( IsNewValue(id,m,sizeof(double)*6*count,count,transpose) ) glUniformMatrix3x2dv(id,count,transpose,m); }
+	void UniformMatrix3x4dv  ( GLint id, GLsizei count, GLboolean transpose, double const *m ) { if ( IsNewValue(id,m,sizeof(double)*12*count,count,transpose) ) glUniformMatrix3x4dv(id,count,transpose,m); }
+	void UniformMatrix4x2dv  ( GLint id, GLsizei count, GLboolean transpose, double const *m ) { if ( IsNewValue(id,m,sizeof(double)*8*count,count,transpose) ) glUniformMatrix4x2dv(id,count,transpose,m); }
+	void UniformMatrix4x3dv  ( GLint id, GLsizei count, GLboolean transpose, double const *m ) { if ( IsNewValue(id,m,sizeof(double)*12*count,count,transpose) ) glUniformMatrix4x3dv(id,count,transpose,m); }
+#endif
+	//!@}
+
 public:
-	GLSLProgram() : programID(CY_GL_INVALID_ID) {}					//!< Constructor
-	virtual ~GLSLProgram() { if ( GL::CheckContext() ) Delete(); }	//!< Destructor that deletes the program
+	GLSLProgram() : programID(CY_GL_INVALID_ID), numUniforms(0), fromBinaryCache(false) {}	//!< Constructor
+	virtual ~GLSLProgram() { RemovePending(); if ( GL::CheckContext() ) Delete(); }	//!< Destructor that deletes the program
 
 	//!@name General Methods
 
-	void   Delete() { if (programID!=CY_GL_INVALID_ID) { glDeleteProgram(programID); programID=CY_GL_INVALID_ID; } }	//!< Deletes the program.
+	void   Delete() { DeletePending(); if (programID!=CY_GL_INVALID_ID) { if (GLState::GetProgram()==programID) GLState::InvalidateProgram(); glDeleteProgram(programID); programID=CY_GL_INVALID_ID; } uniforms.clear(); numUniforms=0; values.clear(); fromBinaryCache=false; }	//!< Deletes the program.
 	GLuint GetID () const { return programID; }						//!< Returns the program ID
 	bool   IsNull() const { return programID == CY_GL_INVALID_ID; }	//!< Returns true if the OpenGL program object is not generated, i.e. the program id is invalid.
-	void   Bind  () const { glUseProgram(programID); }				//!< Binds the program for rendering
+	void   Bind  () const { GLState::UseProgram(programID); }		//!< Binds the program for rendering. The call is skipped if this program is already bound.
+
+	//! Forgets the last uniform values, so that the next uniform calls are sent to OpenGL even if their values have not changed.
+	//! This must be called after uniforms of this program are set without using GLSLProgram.
+	void InvalidateUniformValues() { values.clear(); }
+
+	static size_t GetElidedUniformCount() { return ElidedCount(); }	//!< Returns the number of uniform calls that were skipped because the values had not changed
+	static void   ResetElidedUniformCount() { ElidedCount() = 0; }		//!< Resets the number of skipped uniform calls, typically at the beginning of a frame
+
+	//! Forgets the program binding, so that the next Bind() call binds its program.
+	//! This must be called after a program is bound (or unbound) without using GLSLProgram or GLState.
+	static void InvalidateBinding() { GLState::InvalidateProgram(); }
+
+	//!@name Program Binary Cache
+
+	//! Sets the directory for caching the binaries of the programs built from source strings or files.
+	//! When the cache is enabled, the Build methods hash the shader sources, the prepend sources, and the
+	//! OpenGL vendor, renderer, and version strings. If a program binary with this hash exists in the cache,
+	//! the program is created from it without compiling the shaders. Otherwise, the program is built from
+	//! the sources and its binary is saved to the cache. Binaries that the driver rejects are rebuilt.
+	//! An empty string or nullptr (the default) disables the cache.
+	//! The cache requires OpenGL 4.1 and a driver that supports at least one program binary format.
+	static void SetBinaryCacheDirectory( char const *path ) { BinaryCacheDirectory() = path ? path : ""; }
+
+	bool IsFromBinaryCache() const { return fromBinaryCache; }	//!< Returns true if the program was loaded from the program binary cache.
 
 	//! Attaches the given shader to the program.
 	//! This function must be called before calling Link.
@@ -897,6 +1201,7 @@ public:
 	//! The prependSources strings are added to the beginning of each shader code, so the first string must begin with "#version" statement.
 	//! if files is true, it reads the source code from the given file names.
 	//! If parse is true, it parses the source files for include directives and recursively includes them to the source.
+	//! If the program binary cache is enabled, the program is loaded from the cache when possible (see SetBinaryCacheDirectory).
 	template <bool files, bool parse>
 	bool Build( char const *vertexShader, 
                 char const *fragmentShader,
@@ -1024,8 +1329,81 @@ public:
 	                   std::ostream *outStream=&std::cout )
 	{ return Build<false,false>(vertexShaderSourceCode,fragmentShaderSourceCode,geometryShaderSourceCode,tessControlShaderSourceCode,tessEvaluationShaderSourceCode,prependSourceCount,prependSource,outStream); }
 
+	//!@name Asynchronous Build Methods
+
+	//! Creates a program and submits the compilation of the given shaders and the link of the program without waiting for them,
+	//! so that the application can continue loading other data while the driver compiles the shaders.
+	//! The build must be completed by calling Finish (or FinishAll) before the program is used.
+	//! Returns false if a shader source cannot be loaded. Compilation and link errors are reported by Finish.
+	//! With GL_KHR_parallel_shader_compile, the driver compiles the shaders of all submitted programs in parallel and IsReady can be
+	//! used for polling. Without it, the driver can still compile them in the background, since all status queries are deferred to Finish.
+	//! The arguments are the same as the Build method. If the program binary cache is enabled, cached programs are loaded immediately.
+	template <bool files, bool parse>
+	bool BuildAsync( char const *vertexShader, 
+	                 char const *fragmentShader,
+	                 char const *geometryShader=nullptr,
+	                 char const *tessControlShader=nullptr,
+	                 char const *tessEvaluationShader=nullptr,
+	                 int         prependSourceCount=0,
+	                 char const **prependSource=nullptr,
+	                 std::ostream *outStream=&std::cout )
+	{
+		char const *shaders[] = { vertexShader, fragmentShader, geometryShader, tessControlShader, tessEvaluationShader };
+		return Submit<files,parse>( shaders, prependSourceCount, prependSource, outStream );
+	}
+
+	//! Submits the build of a program using the given shader files without waiting for it (see BuildAsync).
+	bool BuildFilesAsync( char const *vertexShaderFile, 
+	                      char const *fragmentShaderFile,
+	                      char const *geometryShaderFile=nullptr,
+	                      char const *tessControlShaderFile=nullptr,
+	                      char const *tessEvaluationShaderFile=nullptr,
+	                      std::ostream *outStream=&std::cout )
+	{ return BuildAsync<true,false>(vertexShaderFile,fragmentShaderFile,geometryShaderFile,tessControlShaderFile,tessEvaluationShaderFile,0,nullptr,outStream); }
+
+	//! Submits the build of a program using the given shader source codes without waiting for it (see BuildAsync).
+	bool BuildSourcesAsync( char const *vertexShaderSourceCode, 
+	                        char const *fragmentShaderSourceCode,
+	                        char const *geometryShaderSourceCode=nullptr,
+	                        char const *tessControlShaderSourceCode=nullptr,
+	                        char const *tessEvaluationShaderSourceCode=nullptr,
+	                        std::ostream *outStream=&std::cout )
+	{ return BuildAsync<false,false>(vertexShaderSourceCode,fragmentShaderSourceCode,geometryShaderSourceCode,tessControlShaderSourceCode,tessEvaluationShaderSourceCode,0,nullptr,outStream); }
+
+	//! Returns true if the program has a submitted build that is not finished yet.
+	bool IsPending() const { return ! pendingShaders.empty(); }
+
+	//! Returns true if Finish can complete the build without waiting for the driver.
+	//! Without GL_KHR_parallel_shader_compile, the completion cannot be queried, so this method always returns true.
+	bool IsReady() const;
+
+	//! Completes the submitted build by checking the compile and link status, waiting for the driver if necessary.
+	//! Returns true if the program is successfully built. Writes any error messages to the given output stream.
+	//! If the program has no pending build, returns true if the program exists.
+	bool Finish( std::ostream *outStream=&std::cout );
+
+	//! Returns true if none of the pending programs would wait for the driver in Finish.
+	static bool AreAllReady() { for ( GLSLProgram *p : PendingPrograms() ) if ( ! p->IsReady() ) return false; return true; }
+
+	//! Completes all pending builds. Returns true if all programs are successfully built.
+	static bool FinishAll( std::ostream *outStream=&std::cout ) { bool result = true; while ( ! PendingPrograms().empty() ) result &= PendingPrograms().front()->Finish(outStream); return result; }
+
+	//! Sets the maximum number of threads that the driver uses for compiling shaders in parallel.
+	//! Zero disables parallel compilation. This has no effect without GL_KHR_parallel_shader_compile.
+	static void SetMaxCompilerThreads( GLuint count )
+	{
+#ifdef GL_KHR_parallel_shader_compile
+		if ( ParallelCompileSupported() ) glMaxShaderCompilerThreadsKHR( count );
+#endif
+	}
+
 	//!@name Uniform Parameter Methods
 
+	//! Returns the location of the uniform parameter with the given name, or -1 if there is no such active uniform.
+	//! The active uniforms are placed in a hash table when the program is linked.
+	//! Other names, such as array elements, are queried from OpenGL once and then cached in the same table.
+	GLint GetUniformLocation( char const *name );
+
 	//! Registers a single uniform parameter.
 	//! The index must be unique and the name should match a uniform parameter name in one of the shaders.
 	//! The index values for different parameters don't have to be consecutive, but unused index values waste memory.
@@ -1039,271 +1417,271 @@ public:
 	//! Sets the value of the uniform parameter with the given index. 
 	//! The uniform parameter must be registered before using RegisterUniform() or RegisterUniforms().
 	//! The program must be bind by calling Bind() before calling this method.
-	void SetUniform (int index, float x)                                { glUniform1f  (params[index],x); }
-	void SetUniform (int index, float x, float y)                       { glUniform2f  (params[index],x,y); }
-	void SetUniform (int index, float x, float y, float z)              { glUniform3f  (params[index],x,y,z); }
-	void SetUniform (int index, float x, float y, float z, float w)     { glUniform4f  (params[index],x,y,z,w); }
-	void SetUniform1(int index, float  const *data, int count=1)        { glUniform1fv (params[index],count,data); }
-	void SetUniform2(int index, float  const *data, int count=1)        { glUniform2fv (params[index],count,data); }
-	void SetUniform3(int index, float  const *data, int count=1)        { glUniform3fv (params[index],count,data); }
-	void SetUniform4(int index, float  const *data, int count=1)        { glUniform4fv (params[index],count,data); }
-	void SetUniform (int index, int x)                                  { glUniform1i  (params[index],x); }
-	void SetUniform (int index, int x, int y)                           { glUniform2i  (params[index],x,y); }
-	void SetUniform (int index, int x, int y, int z)                    { glUniform3i  (params[index],x,y,z); }
-	void SetUniform (int index, int x, int y, int z, int w)             { glUniform4i  (params[index],x,y,z,w); }
-	void SetUniform1(int index, int    const *data, int count=1)        { glUniform1iv (params[index],count,data); }
-	void SetUniform2(int index, int    const *data, int count=1)        { glUniform2iv (params[index],count,data); }
-	void SetUniform3(int index, int    const *data, int count=1)        { glUniform3iv (params[index],count,data); }
-	void SetUniform4(int index, int    const *data, int count=1)        { glUniform4iv (params[index],count,data); }
+	void SetUniform (int index, float x)                                { Uniform1f  (params[index],x); }
+	void SetUniform (int index, float x, float y)                       { Uniform2f  (params[index],x,y); }
+	void SetUniform (int index, float x, float y, float z)              { Uniform3f  (params[index],x,y,z); }
+	void SetUniform (int index, float x, float y, float z, float w)     { Uniform4f  (params[index],x,y,z,w); }
+	void SetUniform1(int index, float  const *data, int count=1)        { Uniform1fv (params[index],count,data); }
+	void SetUniform2(int index, float  const *data, int count=1)        { Uniform2fv (params[index],count,data); }
+	void SetUniform3(int index, float  const *data, int count=1)        { Uniform3fv (params[index],count,data); }
+	void SetUniform4(int index, float  const *data, int count=1)        { Uniform4fv (params[index],count,data); }
+	void SetUniform (int index, int x)                                  { Uniform1i  (params[index],x); }
+	void SetUniform (int index, int x, int y)                           { Uniform2i  (params[index],x,y); }
+	void SetUniform (int index, int x, int y, int z)                    { Uniform3i  (params[index],x,y,z); }
+	void SetUniform (int index, int x, int y, int z, int w)             { Uniform4i  (params[index],x,y,z,w); }
+	void SetUniform1(int index, int    const *data, int count=1)        { Uniform1iv (params[index],count,data); }
+	void SetUniform2(int index, int    const *data, int count=1)        { Uniform2iv (params[index],count,data); }
+	void SetUniform3(int index, int    const *data, int count=1)        { Uniform3iv (params[index],count,data); }
+	void SetUniform4(int index, int    const *data, int count=1)        { Uniform4iv (params[index],count,data); }
 #ifdef GL_VERSION_3_0
-	void SetUniform (int index, GLuint x)                               { glUniform1ui (params[index],x); }
-	void SetUniform (int index, GLuint x, GLuint y)                     { glUniform2ui (params[index],x,y); }
-	void SetUniform (int index, GLuint x, GLuint y, GLuint z)           { glUniform3ui (params[index],x,y,z); }
-	void SetUniform (int index, GLuint x, GLuint y, GLuint z, GLuint w) { glUniform4ui (params[index],x,y,z,w); }
-	void SetUniform1(int index, GLuint const *data, int count=1)        { glUniform1uiv(params[index],count,data); }
-	void SetUniform2(int index, GLuint const *data, int count=1)        { glUniform2uiv(params[index],count,data); }
-	void SetUniform3(int index, GLuint const *data, int count=1)        { glUniform3uiv(params[index],count,data); }
-	void SetUniform4(int index, GLuint const *data, int count=1)        { glUniform4uiv(params[index],count,data); }
+	void SetUniform (int index, GLuint x)                               { Uniform1ui (params[index],x); }
+	void SetUniform (int index, GLuint x, GLuint y)                     { Uniform2ui (params[index],x,y); }
+	void SetUniform (int index, GLuint x, GLuint y, GLuint z)           { Uniform3ui (params[index],x,y,z); }
+	void SetUniform (int index, GLuint x, GLuint y, GLuint z, GLuint w) { Uniform4ui (params[index],x,y,z,w); }
+	void SetUniform1(int index, GLuint const *data, int count=1)        { Uniform1uiv(params[index],count,data); }
+	void SetUniform2(int index, GLuint const *data, int count=1)        { Uniform2uiv(params[index],count,data); }
+	void SetUniform3(int index, GLuint const *data, int count=1)        { Uniform3uiv(params[index],count,data); }
+	void SetUniform4(int index, GLuint const *data, int count=1)        { Uniform4uiv(params[index],count,data); }
 #endif
 #ifdef GL_VERSION_4_0
-	void SetUniform (int index, double x)                               { glUniform1d  (params[index],x); }
-	void SetUniform (int index, double x, double y)                     { glUniform2d  (params[index],x,y); }
-	void SetUniform (int index, double x, double y, double z)           { glUniform3d  (params[index],x,y,z); }
-	void SetUniform (int index, double x, double y, double z, double w) { glUniform4d  (params[index],x,y,z,w); }
-	void SetUniform1(int index, double const *data, int count=1)        { glUniform1dv (params[index],count,data); }
-	void SetUniform2(int index, double const *data, int count=1)        { glUniform2dv (params[index],count,data); }
-	void SetUniform3(int index, double const *data, int count=1)        { glUniform3dv (params[index],count,data); }
-	void SetUniform4(int index, double const *data, int count=1)        { glUniform4dv (params[index],count,data); }
-#endif
-
-	void SetUniformMatrix2  (int index, float  const *m, int count=1, bool transpose=false) { glUniformMatrix2fv  (params[index],count,transpose,m); }
-	void SetUniformMatrix3  (int index, float  const *m, int count=1, bool transpose=false) { glUniformMatrix3fv  (params[index],count,transpose,m); }
-	void SetUniformMatrix4  (int index, float  const *m, int count=1, bool transpose=false) { glUniformMatrix4fv  (params[index],count,transpose,m); }
+	void SetUniform (int index, double x)                               { Uniform1d  (params[index],x); }
+	void SetUniform (int index, double x, double y)                     { Uniform2d  (params[index],x,y); }
+	void SetUniform (int index, double x, double y, double z)           { Uniform3d  (params[index],x,y,z); }
+	void SetUniform (int index, double x, double y, double z, double w) { Uniform4d  (params[index],x,y,z,w); }
+	void SetUniform1(int index, double const *data, int count=1)        { Uniform1dv (params[index],count,data); }
+	void SetUniform2(int index, double const *data, int count=1)        { Uniform2dv (params[index],count,data); }
+	void SetUniform3(int index, double const *data, int count=1)        { Uniform3dv (params[index],count,data); }
+	void SetUniform4(int index, double const *data, int count=1)        { Uniform4dv (params[index],count,data); }
+#endif
+
+	void SetUniformMatrix2  (int index, float  const *m, int count=1, bool transpose=false) { UniformMatrix2fv  (params[index],count,transpose,m); }
+	void SetUniformMatrix3  (int index, float  const *m, int count=1, bool transpose=false) { UniformMatrix3fv  (params[index],count,transpose,m); }
+	void SetUniformMatrix4  (int index, float  const *m, int count=1, bool transpose=false) { UniformMatrix4fv  (params[index],count,transpose,m); }
 #ifdef GL_VERSION_2_1
-	void SetUniformMatrix2x3(int index, float  const *m, int count=1, bool transpose=false) { glUniformMatrix2x3fv(params[index],count,transpose,m); }
-	void SetUniformMatrix2x4(int index, float  const *m, int count=1, bool transpose=false) { glUniformMatrix2x4fv(params[index],count,transpose,m); }
-	void SetUniformMatrix3x2(int index, float  const *m, int count=1, bool transpose=false) { glUniformMatrix3x2fv(params[index],count,transpose,m); }
-	void SetUniformMatrix3x4(int index, float  const *m, int count=1, bool transpose=false) { glUniformMatrix3x4fv(params[index],count,transpose,m); }
-	void SetUniformMatrix4x2(int index, float  const *m, int count=1, bool transpose=false) { glUniformMatrix4x2fv(params[index],count,transpose,m); }
-	void SetUniformMatrix4x3(int index, float  const *m, int count=1, bool transpose=false) { glUniformMatrix4x3fv(params[index],count,transpose,m); }
+	void SetUniformMatrix2x3(int index, float  const *m, int count=1, bool transpose=false) { UniformMatrix2x3fv(params[index],count,transpose,m); }
+	void SetUniformMatrix2x4(int index, float  const *m, int count=1, bool transpose=false) { UniformMatrix2x4fv(params[index],count,transpose,m); }
+	void SetUniformMatrix3x2(int index, float  const *m, int count=1, bool transpose=false) { UniformMatrix3x2fv(params[index],count,transpose,m); }
+	void SetUniformMatrix3x4(int index, float  const *m, int count=1, bool transpose=false) { UniformMatrix3x4fv(params[index],count,transpose,m); }
+	void SetUniformMatrix4x2(int index, float  const *m, int count=1, bool transpose=false) { UniformMatrix4x2fv(params[index],count,transpose,m); }
+	void SetUniformMatrix4x3(int index, float  const *m, int count=1, bool transpose=false) { UniformMatrix4x3fv(params[index],count,transpose,m); }
 #endif
 #ifdef GL_VERSION_4_0
-	void SetUniformMatrix2  (int index, double const *m, int count=1, bool transpose=false) { glUniformMatrix2dv  (params[index],count,transpose,m); }
-	void SetUniformMatrix3  (int index, double const *m, int count=1, bool transpose=false) { glUniformMatrix3dv  (params[index],count,transpose,m); }
-	void SetUniformMatrix4  (int index, double const *m, int count=1, bool transpose=false) { glUniformMatrix4dv  (params[index],count,transpose,m); }
-	void SetUniformMatrix2x3(int index, double const *m, int count=1, bool transpose=false) { glUniformMatrix2x3dv(params[index],count,transpose,m); }
-	void SetUniformMatrix2x4(int index, double const *m, int count=1, bool transpose=false) { glUniformMatrix2x4dv(params[index],count,transpose,m); }
-	void SetUniformMatrix3x2(int index, double const *m, int count=1, bool transpose=false) { glUniformMatrix3x2dv(params[index],count,transpose,m); }	
-	void SetUniformMatrix3x4(int index, double const *m, int count=1, bool transpose=false) { glUniformMatrix3x4dv(params[index],count,transpose,m); }	
-	void SetUniformMatrix4x2(int index, double const *m, int count=1, bool transpose=false) { glUniformMatrix4x2dv(params[index],count,transpose,m); }	
-	void SetUniformMatrix4x3(int index, double const *m, int count=1, bool transpose=false) { glUniformMatrix4x3dv(params[index],count,transpose,m); }	
+	void SetUniformMatrix2  (int index, double const *m, int count=1, bool transpose=false) { UniformMatrix2dv  (params[index],count,transpose,m); }
+	void SetUniformMatrix3  (int index, double const *m, int count=1, bool transpose=false) { UniformMatrix3dv  (params[index],count,transpose,m); }
+	void SetUniformMatrix4  (int index, double const *m, int count=1, bool transpose=false) { UniformMatrix4dv  (params[index],count,transpose,m); }
+	void SetUniformMatrix2x3(int index, double const *m, int count=1, bool transpose=false) { UniformMatrix2x3dv(params[index],count,transpose,m); }
+	void SetUniformMatrix2x4(int index, double const *m, int count=1, bool transpose=false) { UniformMatrix2x4dv(params[index],count,transpose,m); }
+	void SetUniformMatrix3x2(int index, double const *m, int count=1, bool transpose=false) { UniformMatrix3x2dv(params[index],count,transpose,m); }	
+	void SetUniformMatrix3x4(int index, double const *m, int count=1, bool transpose=false) { UniformMatrix3x4dv(params[index],count,transpose,m); }	
+	void SetUniformMatrix4x2(int index, double const *m, int count=1, bool transpose=false) { UniformMatrix4x2dv(params[index],count,transpose,m); }	
+	void SetUniformMatrix4x3(int index, double const *m, int count=1, bool transpose=false) { UniformMatrix4x3dv(params[index],count,transpose,m); }	
 #endif
 
 #ifdef _CY_VECTOR_H_INCLUDED_
-	void SetUniform(int index, Vec2<float>  const &p)              { glUniform2fv (params[index],1,    &p.x ); }
-	void SetUniform(int index, Vec3<float>  const &p)              { glUniform3fv (params[index],1,    &p.x ); }
-	void SetUniform(int index, Vec4<float>  const &p)              { glUniform4fv (params[index],1,    &p.x ); }
-	void SetUniform(int index, Vec2<int>    const &p)              { glUniform2iv (params[index],1,    &p.x ); }
-	void SetUniform(int index, Vec3<int>    const &p)              { glUniform3iv (params[index],1,    &p.x ); }
-	void SetUniform(int index, Vec4<int>    const &p)              { glUniform4iv (params[index],1,    &p.x ); }
-	void SetUniform(int index, Vec2<float>  const *p, int count=1) { glUniform2fv (params[index],count,&p->x); }
-	void SetUniform(int index, Vec3<float>  const *p, int count=1) { glUniform3fv (params[index],count,&p->x); }
-	void SetUniform(int index, Vec4<float>  const *p, int count=1) { glUniform4fv (params[index],count,&p->x); }
-	void SetUniform(int index, Vec2<int>    const *p, int count=1) { glUniform2iv (params[index],count,&p->x); }
-	void SetUniform(int index, Vec3<int>    const *p, int count=1) { glUniform3iv (params[index],count,&p->x); }
-	void SetUniform(int index, Vec4<int>    const *p, int count=1) { glUniform4iv (params[index],count,&p->x); }
+	void SetUniform(int index, Vec2<float>  const &p)              { Uniform2fv (params[index],1,    &p.x ); }
+	void SetUniform(int index, Vec3<float>  const &p)              { Uniform3fv (params[index],1,    &p.x ); }
+	void SetUniform(int index, Vec4<float>  const &p)              { Uniform4fv (params[index],1,    &p.x ); }
+	void SetUniform(int index, Vec2<int>    const &p)              { Uniform2iv (params[index],1,    &p.x ); }
+	void SetUniform(int index, Vec3<int>    const &p)              { Uniform3iv (params[index],1,    &p.x ); }
+	void SetUniform(int index, Vec4<int>    const &p)              { Uniform4iv (params[index],1,    &p.x ); }
+	void SetUniform(int index, Vec2<float>  const *p, int count=1) { Uniform2fv (params[index],count,&p->x); }
+	void SetUniform(int index, Vec3<float>  const *p, int count=1) { Uniform3fv (params[index],count,&p->x); }
+	void SetUniform(int index, Vec4<float>  const *p, int count=1) { Uniform4fv (params[index],count,&p->x); }
+	void SetUniform(int index, Vec2<int>    const *p, int count=1) { Uniform2iv (params[index],count,&p->x); }
+	void SetUniform(int index, Vec3<int>    const *p, int count=1) { Uniform3iv (params[index],count,&p->x); }
+	void SetUniform(int index, Vec4<int>    const *p, int count=1) { Uniform4iv (params[index],count,&p->x); }
 # ifdef GL_VERSION_3_0
-	void SetUniform(int index, Vec2<GLuint> const &p)              { glUniform2uiv(params[index],1,    &p.x ); }
-	void SetUniform(int index, Vec3<GLuint> const &p)              { glUniform3uiv(params[index],1,    &p.x ); }
-	void SetUniform(int index, Vec4<GLuint> const &p)              { glUniform4uiv(params[index],1,    &p.x ); }
-	void SetUniform(int index, Vec2<GLuint> const *p, int count=1) { glUniform2uiv(params[index],count,&p->x); }
-	void SetUniform(int index, Vec3<GLuint> const *p, int count=1) { glUniform3uiv(params[index],count,&p->x); }
-	void SetUniform(int index, Vec4<GLuint> const *p, int count=1) { glUniform4uiv(params[index],count,&p->x); }
+	void SetUniform(int index, Vec2<GLuint> const &p)              { Uniform2uiv(params[index],1,    &p.x ); }
+	void SetUniform(int index, Vec3<GLuint> const &p)              { Uniform3uiv(params[index],1,    &p.x ); }
+	void SetUniform(int index, Vec4<GLuint> const &p)              { Uniform4uiv(params[index],1,    &p.x ); }
+	void SetUniform(int index, Vec2<GLuint> const *p, int count=1) { Uniform2uiv(params[index],count,&p->x); }
+	void SetUniform(int index, Vec3<GLuint> const *p, int count=1) { Uniform3uiv(params[index],count,&p->x); }
+	void SetUniform(int index, Vec4<GLuint> const *p, int count=1) { Uniform4uiv(params[index],count,&p->x); }
 # endif
 # ifdef GL_VERSION_4_0
-	void SetUniform(int index, Vec2<double> const &p)              { glUniform2dv (params[index],1,    &p.x ); }
-	void SetUniform(int index, Vec3<double> const &p)              { glUniform3dv (params[index],1,    &p.x ); }
-	void SetUniform(int index, Vec4<double> const &p)              { glUniform4dv (params[index],1,    &p.x ); }
-	void SetUniform(int index, Vec2<double> const *p, int count=1) { glUniform2dv (params[index],count,&p->x); }
-	void SetUniform(int index, Vec3<double> const *p, int count=1) { glUniform3dv (params[index],count,&p->x); }
-	void SetUniform(int index, Vec4<double> const *p, int count=1) { glUniform4dv (params[index],count,&p->x); }
+	void SetUniform(int index, Vec2<double> const &p)              { Uniform2dv (params[index],1,    &p.x ); }
+	void SetUniform(int index, Vec3<double> const &p)              { Uniform3dv (params[index],1,    &p.x ); }
+	void SetUniform(int index, Vec4<double> const &p)              { Uniform4dv (params[index],1,    &p.x ); }
+	void SetUniform(int index, Vec2<double> const *p, int count=1) { Uniform2dv (params[index],count,&p->x); }
+	void SetUniform(int index, Vec3<double> const *p, int count=1) { Uniform3dv (params[index],count,&p->x); }
+	void SetUniform(int index, Vec4<double> const *p, int count=1) { Uniform4dv (params[index],count,&p->x); }
 # endif
 #endif
 
 #ifdef _CY_IVECTOR_H_INCLUDED_
-	void SetUniform(int index, IVec2<int>    const &p)              { glUniform2iv (params[index],1,    &p.x ); }
-	void SetUniform(int index, IVec3<int>    const &p)              { glUniform3iv (params[index],1,    &p.x ); }
-	void SetUniform(int index, IVec4<int>    const &p)              { glUniform4iv (params[index],1,    &p.x ); }
-	void SetUniform(int index, IVec2<int>    const *p, int count=1) { glUniform2iv (params[index],count,&p->x); }
-	void SetUniform(int index, IVec3<int>    const *p, int count=1) { glUniform3iv (params[index],count,&p->x); }
-	void SetUniform(int index, IVec4<int>    const *p, int count=1) { glUniform4iv (params[index],count,&p->x); }
+	void SetUniform(int index, IVec2<int>    const &p)              { Uniform2iv (params[index],1,    &p.x ); }
+	void SetUniform(int index, IVec3<int>    const &p)              { Uniform3iv (params[index],1,    &p.x ); }
+	void SetUniform(int index, IVec4<int>    const &p)              { Uniform4iv (params[index],1,    &p.x ); }
+	void SetUniform(int index, IVec2<int>    const *p, int count=1) { Uniform2iv (params[index],count,&p->x); }
+	void SetUniform(int index, IVec3<int>    const *p, int count=1) { Uniform3iv (params[index],count,&p->x); }
+	void SetUniform(int index, IVec4<int>    const *p, int count=1) { Uniform4iv (params[index],count,&p->x); }
 # ifdef GL_VERSION_3_0
-	void SetUniform(int index, IVec2<GLuint> const &p)              { glUniform2uiv(params[index],1,    &p.x ); }
-	void SetUniform(int index, IVec3<GLuint> const &p)              { glUniform3uiv(params[index],1,    &p.x ); }
-	void SetUniform(int index, IVec4<GLuint> const &p)              { glUniform4uiv(params[index],1,    &p.x ); }
-	void SetUniform(int index, IVec2<GLuint> const *p, int count=1) { glUniform2uiv(params[index],count,&p->x); }
-	void SetUniform(int index, IVec3<GLuint> const *p, int count=1) { glUniform3uiv(params[index],count,&p->x); }
-	void SetUniform(int index, IVec4<GLuint> const *p, int count=1) { glUniform4uiv(params[index],count,&p->x); }
+	void SetUniform(int index, IVec2<GLuint> const &p)              { Uniform2uiv(params[index],1,    &p.x ); }
+	void SetUniform(int index, IVec3<GLuint> const &p)              { Uniform3uiv(params[index],1,    &p.x ); }
+	void SetUniform(int index, IVec4<GLuint> const &p)              { Uniform4uiv(params[index],1,    &p.x ); }
+	void SetUniform(int index, IVec2<GLuint> const *p, int count=1) { Uniform2uiv(params[index],count,&p->x); }
+	void SetUniform(int index, IVec3<GLuint> const *p, int count=1) { Uniform3uiv(params[index],count,&p->x); }
+	void SetUniform(int index, IVec4<GLuint> const *p, int count=1) { Uniform4uiv(params[index],count,&p->x); }
 # endif
 #endif
 
 #ifdef _CY_MATRIX_H_INCLUDED_
-	void SetUniform(int index, Matrix2 <float>  const &m)              { glUniformMatrix2fv  (params[index],1,    GL_FALSE,m.cell ); }
-	void SetUniform(int index, Matrix3 <float>  const &m)              { glUniformMatrix3fv  (params[index],1,    GL_FALSE,m.cell ); }
-	void SetUniform(int index, Matrix4 <float>  const &m)              { glUniformMatrix4fv  (params[index],1,    GL_FALSE,m.cell ); }
-	void SetUniform(int index, Matrix2 <float>  const *m, int count=1) { glUniformMatrix2fv  (params[index],count,GL_FALSE,m->cell); }
-	void SetUniform(int index, Matrix3 <float>  const *m, int count=1) { glUniformMatrix3fv  (params[index],count,GL_FALSE,m->cell); }
-	void SetUniform(int index, Matrix4 <float>  const *m, int count=1) { glUniformMatrix4fv  (params[index],count,GL_FALSE,m->cell); }
+	void SetUniform(int index, Matrix2 <float>  const &m)              { UniformMatrix2fv  (params[index],1,    GL_FALSE,m.cell ); }
+	void SetUniform(int index, Matrix3 <float>  const &m)              { UniformMatrix3fv  (params[index],1,    GL_FALSE,m.cell ); }
+	void SetUniform(int index, Matrix4 <float>  const &m)              { UniformMatrix4fv  (params[index],1,    GL_FALSE,m.cell ); }
+	void SetUniform(int index, Matrix2 <float>  const *m, int count=1) { UniformMatrix2fv  (params[index],count,GL_FALSE,m->cell); }
+	void SetUniform(int index, Matrix3 <float>  const *m, int count=1) { UniformMatrix3fv  (params[index],count,GL_FALSE,m->cell); }
+	void SetUniform(int index, Matrix4 <float>  const *m, int count=1) { UniformMatrix4fv  (params[index],count,GL_FALSE,m->cell); }
 # ifdef GL_VERSION_2_1
-	void SetUniform(int index, Matrix34<float>  const &m)              { glUniformMatrix3x4fv(params[index],1,    GL_FALSE,m.cell ); }
-	void SetUniform(int index, Matrix34<float>  const *m, int count=1) { glUniformMatrix3x4fv(params[index],count,GL_FALSE,m->cell); }
+	void SetUniform(int index, Matrix34<float>  const &m)              { UniformMatrix4x3fv(params[index],1,    GL_FALSE,m.cell ); }
+	void SetUniform(int index, Matrix34<float>  const *m, int count=1) { UniformMatrix4x3fv(params[index],count,GL_FALSE,m->cell); }
 # endif
 # ifdef GL_VERSION_4_0
-	void SetUniform(int index, Matrix2 <double> const &m)              { glUniformMatrix2dv  (params[index],1,    GL_FALSE,m.cell ); }
-	void SetUniform(int index, Matrix3 <double> const &m)              { glUniformMatrix3dv  (params[index],1,    GL_FALSE,m.cell ); }
-	void SetUniform(int index, Matrix4 <double> const &m)              { glUniformMatrix4dv  (params[index],1,    GL_FALSE,m.cell ); }
-	void SetUniform(int index, Matrix34<double> const &m)              { glUniformMatrix3x4dv(params[index],1,    GL_FALSE,m.cell ); }
-	void SetUniform(int index, Matrix2 <double> const *m, int count=1) { glUniformMatrix2dv  (params[index],count,GL_FALSE,m->cell); }
-	void SetUniform(int index, Matrix3 <double> const *m, int count=1) { glUniformMatrix3dv  (params[index],count,GL_FALSE,m->cell); }
-	void SetUniform(int index, Matrix4 <double> const *m, int count=1) { glUniformMatrix4dv  (params[index],count,GL_FALSE,m->cell); }
-	void SetUniform(int index, Matrix34<double> const *m, int count=1) { glUniformMatrix3x4dv(params[index],count,GL_FALSE,m->cell); }
+	void SetUniform(int index, Matrix2 <double> const &m)              { UniformMatrix2dv  (params[index],1,    GL_FALSE,m.cell ); }
+	void SetUniform(int index, Matrix3 <double> const &m)              { UniformMatrix3dv  (params[index],1,    GL_FALSE,m.cell ); }
+	void SetUniform(int index, Matrix4 <double> const &m)              { UniformMatrix4dv  (params[index],1,    GL_FALSE,m.cell ); }
+	void SetUniform(int index, Matrix34<double> const &m)              { UniformMatrix4x3dv(params[index],1,    GL_FALSE,m.cell ); }
+	void SetUniform(int index, Matrix2 <double> const *m, int count=1) { UniformMatrix2dv  (params[index],count,GL_FALSE,m->cell); }
+	void SetUniform(int index, Matrix3 <double> const *m, int count=1) { UniformMatrix3dv  (params[index],count,GL_FALSE,m->cell); }
+	void SetUniform(int index, Matrix4 <double> const *m, int count=1) { UniformMatrix4dv  (params[index],count,GL_FALSE,m->cell); }
+	void SetUniform(int index, Matrix34<double> const *m, int count=1) { UniformMatrix4x3dv(params[index],count,GL_FALSE,m->cell); }
 # endif
 #endif
 	//!@}
 
 
-	//!@{ glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 )
+	//!@{ Bind(); int id = GetUniformLocation( name ); if ( id >= 0 )
 	//! Sets the value of the uniform parameter with the given name, if the uniform parameter is found. 
 	//! Since it searches for the uniform parameter first, it is not as efficient as setting the uniform parameter using
 	//! a previously registered id. There is no need to bind the program before calling this method.
-	void SetUniform (char const *name, float x)                                { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform1f  (id,x); }
-	void SetUniform (char const *name, float x, float y)                       { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform2f  (id,x,y); }
-	void SetUniform (char const *name, float x, float y, float z)              { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform3f  (id,x,y,z); }
-	void SetUniform (char const *name, float x, float y, float z, float w)     { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform4f  (id,x,y,z,w); }
-	void SetUniform1(char const *name, float  const *data, int count=1)        { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform1fv (id,count,data); }
-	void SetUniform2(char const *name, float  const *data, int count=1)        { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform2fv (id,count,data); }
-	void SetUniform3(char const *name, float  const *data, int count=1)        { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform3fv (id,count,data); }
-	void SetUniform4(char const *name, float  const *data, int count=1)        { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform4fv (id,count,data); }
-	void SetUniform (char const *name, int x)                                  { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform1i  (id,x); }
-	void SetUniform (char const *name, int x, int y)                           { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform2i  (id,x,y); }
-	void SetUniform (char const *name, int x, int y, int z)                    { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform3i  (id,x,y,z); }
-	void SetUniform (char const *name, int x, int y, int z, int w)             { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform4i  (id,x,y,z,w); }
-	void SetUniform1(char const *name, int    const *data, int count=1)        { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform1iv (id,count,data); }
-	void SetUniform2(char const *name, int    const *data, int count=1)        { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform2iv (id,count,data); }
-	void SetUniform3(char const *name, int    const *data, int count=1)        { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform3iv (id,count,data); }
-	void SetUniform4(char const *name, int    const *data, int count=1)        { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform4iv (id,count,data); }
+	void SetUniform (char const *name, float x)                                { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform1f  (id,x); }
+	void SetUniform (char const *name, float x, float y)                       { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform2f  (id,x,y); }
+	void SetUniform (char const *name, float x, float y, float z)              { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform3f  (id,x,y,z); }
+	void SetUniform (char const *name, float x, float y, float z, float w)     { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform4f  (id,x,y,z,w); }
+	void SetUniform1(char const *name, float  const *data, int count=1)        { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform1fv (id,count,data); }
+	void SetUniform2(char const *name, float  const *data, int count=1)        { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform2fv (id,count,data); }
+	void SetUniform3(char const *name, float  const *data, int count=1)        { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform3fv (id,count,data); }
+	void SetUniform4(char const *name, float  const *data, int count=1)        { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform4fv (id,count,data); }
+	void SetUniform (char const *name, int x)                                  { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform1i  (id,x); }
+	void SetUniform (char const *name, int x, int y)                           { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform2i  (id,x,y); }
+	void SetUniform (char const *name, int x, int y, int z)                    { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform3i  (id,x,y,z); }
+	void SetUniform (char const *name, int x, int y, int z, int w)             { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform4i  (id,x,y,z,w); }
+	void SetUniform1(char const *name, int    const *data, int count=1)        { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform1iv (id,count,data); }
+	void SetUniform2(char const *name, int    const *data, int count=1)        { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform2iv (id,count,data); }
+	void SetUniform3(char const *name, int    const *data, int count=1)        { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform3iv (id,count,data); }
+	void SetUniform4(char const *name, int    const *data, int count=1)        { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform4iv (id,count,data); }
 #ifdef GL_VERSION_3_0
-	void SetUniform (char const *name, GLuint x)                               { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform1ui (id,x); }
-	void SetUniform (char const *name, GLuint x, GLuint y)                     { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform2ui (id,x,y); }
-	void SetUniform (char const *name, GLuint x, GLuint y, GLuint z)           { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform3ui (id,x,y,z); }
-	void SetUniform (char const *name, GLuint x, GLuint y, GLuint z, GLuint w) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform4ui (id,x,y,z,w); }
-	void SetUniform1(char const *name, GLuint const *data, int count=1)        { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform1uiv(id,count,data); }
-	void SetUniform2(char const *name, GLuint const *data, int count=1)        { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform2uiv(id,count,data); }
-	void SetUniform3(char const *name, GLuint const *data, int count=1)        { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform3uiv(id,count,data); }
-	void SetUniform4(char const *name, GLuint const *data, int count=1)        { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform4uiv(id,count,data); }
+	void SetUniform (char const *name, GLuint x)                               { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform1ui (id,x); }
+	void SetUniform (char const *name, GLuint x, GLuint y)                     { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform2ui (id,x,y); }
+	void SetUniform (char const *name, GLuint x, GLuint y, GLuint z)           { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform3ui (id,x,y,z); }
+	void SetUniform (char const *name, GLuint x, GLuint y, GLuint z, GLuint w) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform4ui (id,x,y,z,w); }
+	void SetUniform1(char const *name, GLuint const *data, int count=1)        { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform1uiv(id,count,data); }
+	void SetUniform2(char const *name, GLuint const *data, int count=1)        { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform2uiv(id,count,data); }
+	void SetUniform3(char const *name, GLuint const *data, int count=1)        { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform3uiv(id,count,data); }
+	void SetUniform4(char const *name, GLuint const *data, int count=1)        { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform4uiv(id,count,data); }
 #endif
 #ifdef GL_VERSION_4_0
-	void SetUniform (char const *name, double x)                               { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform1d  (id,x); }
-	void SetUniform (char const *name, double x, double y)                     { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform2d  (id,x,y); }
-	void SetUniform (char const *name, double x, double y, double z)           { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform3d  (id,x,y,z); }
-	void SetUniform (char const *name, double x, double y, double z, double w) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform4d  (id,x,y,z,w); }
-	void SetUniform1(char const *name, double const *data, int count=1)        { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform1dv (id,count,data); }
-	void SetUniform2(char const *name, double const *data, int count=1)        { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform2dv (id,count,data); }
-	void SetUniform3(char const *name, double const *data, int count=1)        { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform3dv (id,count,data); }
-	void SetUniform4(char const *name, double const *data, int count=1)        { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform4dv (id,count,data); }
-#endif
-
-	void SetUniformMatrix2  (char const *name, float  const *m, int count=1, bool transpose=false) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniformMatrix2fv  (id,count,transpose,m); }
-	void SetUniformMatrix3  (char const *name, float  const *m, int count=1, bool transpose=false) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniformMatrix3fv  (id,count,transpose,m); }
-	void SetUniformMatrix4  (char const *name, float  const *m, int count=1, bool transpose=false) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniformMatrix4fv  (id,count,transpose,m); }
+	void SetUniform (char const *name, double x)                               { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform1d  (id,x); }
+	void SetUniform (char const *name, double x, double y)                     { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform2d  (id,x,y); }
+	void SetUniform (char const *name, double x, double y, double z)           { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform3d  (id,x,y,z); }
+	void SetUniform (char const *name, double x, double y, double z, double w) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform4d  (id,x,y,z,w); }
+	void SetUniform1(char const *name, double const *data, int count=1)        { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform1dv (id,count,data); }
+	void SetUniform2(char const *name, double const *data, int count=1)        { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform2dv (id,count,data); }
+	void SetUniform3(char const *name, double const *data, int count=1)        { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform3dv (id,count,data); }
+	void SetUniform4(char const *name, double const *data, int count=1)        { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform4dv (id,count,data); }
+#endif
+
+	void SetUniformMatrix2  (char const *name, float  const *m, int count=1, bool transpose=false) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) UniformMatrix2fv  (id,count,transpose,m); }
+	void SetUniformMatrix3  (char const *name, float  const *m, int count=1, bool transpose=false) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) UniformMatrix3fv  (id,count,transpose,m); }
+	void SetUniformMatrix4  (char const *name, float  const *m, int count=1, bool transpose=false) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) UniformMatrix4fv  (id,count,transpose,m); }
 #ifdef GL_VERSION_2_1
-	void SetUniformMatrix2x3(char const *name, float  const *m, int count=1, bool transpose=false) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniformMatrix2x3fv(id,count,transpose,m); }
-	void SetUniformMatrix2x4(char const *name, float  const *m, int count=1, bool transpose=false) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniformMatrix2x4fv(id,count,transpose,m); }
-	void SetUniformMatrix3x2(char const *name, float  const *m, int count=1, bool transpose=false) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniformMatrix3x2fv(id,count,transpose,m); }
-	void SetUniformMatrix3x4(char const *name, float  const *m, int count=1, bool transpose=false) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniformMatrix3x4fv(id,count,transpose,m); }
-	void SetUniformMatrix4x2(char const *name, float  const *m, int count=1, bool transpose=false) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniformMatrix4x2fv(id,count,transpose,m); }
-	void SetUniformMatrix4x3(char const *name, float  const *m, int count=1, bool transpose=false) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniformMatrix4x3fv(id,count,transpose,m); }
+	void SetUniformMatrix2x3(char const *name, float  const *m, int count=1, bool transpose=false) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) UniformMatrix2x3fv(id,count,transpose,m); }
+	void SetUniformMatrix2x4(char const *name, float  const *m, int count=1, bool transpose=false) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) UniformMatrix2x4fv(id,count,transpose,m); }
+	void SetUniformMatrix3x2(char const *name, float  const *m, int count=1, bool transpose=false) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) UniformMatrix3x2fv(id,count,transpose,m); }
+	void SetUniformMatrix3x4(char const *name, float  const *m, int count=1, bool transpose=false) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) UniformMatrix3x4fv(id,count,transpose,m); }
+	void SetUniformMatrix4x2(char const *name, float  const *m, int count=1, bool transpose=false) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) UniformMatrix4x2fv(id,count,transpose,m); }
+	void SetUniformMatrix4x3(char const *name, float  const *m, int count=1, bool transpose=false) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) UniformMatrix4x3fv(id,count,transpose,m); }
 #endif
 #ifdef GL_VERSION_4_0
-	void SetUniformMatrix2  (char const *name, double const *m, int count=1, bool transpose=false) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniformMatrix2dv  (id,count,transpose,m); }
-	void SetUniformMatrix3  (char const *name, double const *m, int count=1, bool transpose=false) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniformMatrix3dv  (id,count,transpose,m); }
-	void SetUniformMatrix4  (char const *name, double const *m, int count=1, bool transpose=false) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniformMatrix4dv  (id,count,transpose,m); }
-	void SetUniformMatrix2x3(char const *name, double const *m, int count=1, bool transpose=false) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniformMatrix2x3dv(id,count,transpose,m); }
-	void SetUniformMatrix2x4(char const *name, double const *m, int count=1, bool transpose=false) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniformMatrix2x4dv(id,count,transpose,m); }
-	void SetUniformMatrix3x2(char const *name, double const *m, int count=1, bool transpose=false) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniformMatrix3x2dv(id,count,transpose,m); }	
-	void SetUniformMatrix3x4(char const *name, double const *m, int count=1, bool transpose=false) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniformMatrix3x4dv(id,count,transpose,m); }	
-	void SetUniformMatrix4x2(char const *name, double const *m, int count=1, bool transpose=false) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniformMatrix4x2dv(id,count,transpose,m); }	
-	void SetUniformMatrix4x3(char const *name, double const *m, int count=1, bool transpose=false) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniformMatrix4x3dv(id,count,transpose,m); }	
+	void SetUniformMatrix2  (char const *name, double const *m, int count=1, bool transpose=false) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) UniformMatrix2dv  (id,count,transpose,m); }
+	void SetUniformMatrix3  (char const *name, double const *m, int count=1, bool transpose=false) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) UniformMatrix3dv  (id,count,transpose,m); }
+	void SetUniformMatrix4  (char const *name, double const *m, int count=1, bool transpose=false) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) UniformMatrix4dv  (id,count,transpose,m); }
+	void SetUniformMatrix2x3(char const *name, double const *m, int count=1, bool transpose=false) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) UniformMatrix2x3dv(id,count,transpose,m); }
+	void SetUniformMatrix2x4(char const *name, double const *m, int count=1, bool transpose=false) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) UniformMatrix2x4dv(id,count,transpose,m); }
+	void SetUniformMatrix3x2(char const *name, double const *m, int count=1, bool transpose=false) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) UniformMatrix3x2dv(id,count,transpose,m); }	
+	void SetUniformMatrix3x4(char const *name, double const *m, int count=1, bool transpose=false) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) UniformMatrix3x4dv(id,count,transpose,m); }	
+	void SetUniformMatrix4x2(char const *name, double const *m, int count=1, bool transpose=false) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) UniformMatrix4x2dv(id,count,transpose,m); }	
+	void SetUniformMatrix4x3(char const *name, double const *m, int count=1, bool transpose=false) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) UniformMatrix4x3dv(id,count,transpose,m); }	
 #endif
 
 #ifdef _CY_VECTOR_H_INCLUDED_
-	void SetUniform(char const *name, Vec2<float>  const &p)              { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform2fv (id,1,    &p.x ); }
-	void SetUniform(char const *name, Vec3<float>  const &p)              { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform3fv (id,1,    &p.x ); }
-	void SetUniform(char const *name, Vec4<float>  const &p)              { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform4fv (id,1,    &p.x ); }
-	void SetUniform(char const *name, Vec2<int>    const &p)              { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform2iv (id,1,    &p.x ); }
-	void SetUniform(char const *name, Vec3<int>    const &p)              { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform3iv (id,1,    &p.x ); }
-	void SetUniform(char const *name, Vec4<int>    const &p)              { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform4iv (id,1,    &p.x ); }
-	void SetUniform(char const *name, Vec2<float>  const *p, int count=1) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform2fv (id,count,&p->x); }
-	void SetUniform(char const *name, Vec3<float>  const *p, int count=1) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform3fv (id,count,&p->x); }
-	void SetUniform(char const *name, Vec4<float>  const *p, int count=1) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform4fv (id,count,&p->x); }
-	void SetUniform(char const *name, Vec2<int>    const *p, int count=1) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform2iv (id,count,&p->x); }
-	void SetUniform(char const *name, Vec3<int>    const *p, int count=1) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform3iv (id,count,&p->x); }
-	void SetUniform(char const *name, Vec4<int>    const *p, int count=1) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform4iv (id,count,&p->x); }
+	void SetUniform(char const *name, Vec2<float>  const &p)              { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform2fv (id,1,    &p.x ); }
+	void SetUniform(char const *name, Vec3<float>  const &p)              { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform3fv (id,1,    &p.x ); }
+	void SetUniform(char const *name, Vec4<float>  const &p)              { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform4fv (id,1,    &p.x ); }
+	void SetUniform(char const *name, Vec2<int>    const &p)              { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform2iv (id,1,    &p.x ); }
+	void SetUniform(char const *name, Vec3<int>    const &p)              { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform3iv (id,1,    &p.x ); }
+	void SetUniform(char const *name, Vec4<int>    const &p)              { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform4iv (id,1,    &p.x ); }
+	void SetUniform(char const *name, Vec2<float>  const *p, int count=1) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform2fv (id,count,&p->x); }
+	void SetUniform(char const *name, Vec3<float>  const *p, int count=1) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform3fv (id,count,&p->x); }
+	void SetUniform(char const *name, Vec4<float>  const *p, int count=1) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform4fv (id,count,&p->x); }
+	void SetUniform(char const *name, Vec2<int>    const *p, int count=1) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform2iv (id,count,&p->x); }
+	void SetUniform(char const *name, Vec3<int>    const *p, int count=1) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform3iv (id,count,&p->x); }
+	void SetUniform(char const *name, Vec4<int>    const *p, int count=1) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform4iv (id,count,&p->x); }
 # ifdef GL_VERSION_3_0
-	void SetUniform(char const *name, Vec2<GLuint> const &p)              { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform2uiv(id,1,    &p.x ); }
-	void SetUniform(char const *name, Vec3<GLuint> const &p)              { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform3uiv(id,1,    &p.x ); }
-	void SetUniform(char const *name, Vec4<GLuint> const &p)              { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform4uiv(id,1,    &p.x ); }
-	void SetUniform(char const *name, Vec2<GLuint> const *p, int count=1) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform2uiv(id,count,&p->x); }
-	void SetUniform(char const *name, Vec3<GLuint> const *p, int count=1) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform3uiv(id,count,&p->x); }
-	void SetUniform(char const *name, Vec4<GLuint> const *p, int count=1) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform4uiv(id,count,&p->x); }
+	void SetUniform(char const *name, Vec2<GLuint> const &p)              { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform2uiv(id,1,    &p.x ); }
+	void SetUniform(char const *name, Vec3<GLuint> const &p)              { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform3uiv(id,1,    &p.x ); }
+	void SetUniform(char const *name, Vec4<GLuint> const &p)              { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform4uiv(id,1,    &p.x ); }
+	void SetUniform(char const *name, Vec2<GLuint> const *p, int count=1) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform2uiv(id,count,&p->x); }
+	void SetUniform(char const *name, Vec3<GLuint> const *p, int count=1) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform3uiv(id,count,&p->x); }
+	void SetUniform(char const *name, Vec4<GLuint> const *p, int count=1) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform4uiv(id,count,&p->x); }
 # endif
 # ifdef GL_VERSION_4_0
-	void SetUniform(char const *name, Vec2<double> const &p)              { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform2dv (id,1,    &p.x ); }
-	void SetUniform(char const *name, Vec3<double> const &p)              { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform3dv (id,1,    &p.x ); }
-	void SetUniform(char const *name, Vec4<double> const &p)              { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform4dv (id,1,    &p.x ); }
-	void SetUniform(char const *name, Vec2<double> const *p, int count=1) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform2dv (id,count,&p->x); }
-	void SetUniform(char const *name, Vec3<double> const *p, int count=1) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform3dv (id,count,&p->x); }
-	void SetUniform(char const *name, Vec4<double> const *p, int count=1) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform4dv (id,count,&p->x); }
+	void SetUniform(char const *name, Vec2<double> const &p)              { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform2dv (id,1,    &p.x ); }
+	void SetUniform(char const *name, Vec3<double> const &p)              { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform3dv (id,1,    &p.x ); }
+	void SetUniform(char const *name, Vec4<double> const &p)              { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform4dv (id,1,    &p.x ); }
+	void SetUniform(char const *name, Vec2<double> const *p, int count=1) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform2dv (id,count,&p->x); }
+	void SetUniform(char const *name, Vec3<double> const *p, int count=1) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform3dv (id,count,&p->x); }
+	void SetUniform(char const *name, Vec4<double> const *p, int count=1) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform4dv (id,count,&p->x); }
 # endif
 #endif
 
 #ifdef _CY_IVECTOR_H_INCLUDED_
-	void SetUniform(char const *name, IVec2<int>    const &p)              { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform2iv (id,1,    &p.x ); }
-	void SetUniform(char const *name, IVec3<int>    const &p)              { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform3iv (id,1,    &p.x ); }
-	void SetUniform(char const *name, IVec4<int>    const &p)              { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform4iv (id,1,    &p.x ); }
-	void SetUniform(char const *name, IVec2<int>    const *p, int count=1) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform2iv (id,count,&p->x); }
-	void SetUniform(char const *name, IVec3<int>    const *p, int count=1) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform3iv (id,count,&p->x); }
-	void SetUniform(char const *name, IVec4<int>    const *p, int count=1) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform4iv (id,count,&p->x); }
+	void SetUniform(char const *name, IVec2<int>    const &p)              { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform2iv (id,1,    &p.x ); }
+	void SetUniform(char const *name, IVec3<int>    const &p)              { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform3iv (id,1,    &p.x ); }
+	void SetUniform(char const *name, IVec4<int>    const &p)              { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform4iv (id,1,    &p.x ); }
+	void SetUniform(char const *name, IVec2<int>    const *p, int count=1) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform2iv (id,count,&p->x); }
+	void SetUniform(char const *name, IVec3<int>    const *p, int count=1) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform3iv (id,count,&p->x); }
+	void SetUniform(char const *name, IVec4<int>    const *p, int count=1) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform4iv (id,count,&p->x); }
 # ifdef GL_VERSION_3_0
-	void SetUniform(char const *name, IVec2<GLuint> const &p)              { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform2uiv(id,1,    &p.x ); }
-	void SetUniform(char const *name, IVec3<GLuint> const &p)              { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform3uiv(id,1,    &p.x ); }
-	void SetUniform(char const *name, IVec4<GLuint> const &p)              { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform4uiv(id,1,    &p.x ); }
-	void SetUniform(char const *name, IVec2<GLuint> const *p, int count=1) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform2uiv(id,count,&p->x); }
-	void SetUniform(char const *name, IVec3<GLuint> const *p, int count=1) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform3uiv(id,count,&p->x); }
-	void SetUniform(char const *name, IVec4<GLuint> const *p, int count=1) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniform4uiv(id,count,&p->x); }
+	void SetUniform(char const *name, IVec2<GLuint> const &p)              { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform2uiv(id,1,    &p.x ); }
+	void SetUniform(char const *name, IVec3<GLuint> const &p)              { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform3uiv(id,1,    &p.x ); }
+	void SetUniform(char const *name, IVec4<GLuint> const &p)              { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform4uiv(id,1,    &p.x ); }
+	void SetUniform(char const *name, IVec2<GLuint> const *p, int count=1) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform2uiv(id,count,&p->x); }
+	void SetUniform(char const *name, IVec3<GLuint> const *p, int count=1) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform3uiv(id,count,&p->x); }
+	void SetUniform(char const *name, IVec4<GLuint> const *p, int count=1) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) Uniform4uiv(id,count,&p->x); }
 # endif
 #endif
 
 #ifdef _CY_MATRIX_H_INCLUDED_
-	void SetUniform(char const *name, Matrix2 <float>  const &m)              { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniformMatrix2fv  (id,1,    GL_FALSE,m.cell ); }
-	void SetUniform(char const *name, Matrix3 <float>  const &m)              { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniformMatrix3fv  (id,1,    GL_FALSE,m.cell ); }
-	void SetUniform(char const *name, Matrix4 <float>  const &m)              { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniformMatrix4fv  (id,1,    GL_FALSE,m.cell ); }
-	void SetUniform(char const *name, Matrix2 <float>  const *m, int count=1) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniformMatrix2fv  (id,count,GL_FALSE,m->cell); }
-	void SetUniform(char const *name, Matrix3 <float>  const *m, int count=1) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniformMatrix3fv  (id,count,GL_FALSE,m->cell); }
-	void SetUniform(char const *name, Matrix4 <float>  const *m, int count=1) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniformMatrix4fv  (id,count,GL_FALSE,m->cell); }
+	void SetUniform(char const *name, Matrix2 <float>  const &m)              { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) UniformMatrix2fv  (id,1,    GL_FALSE,m.cell ); }
+	void SetUniform(char const *name, Matrix3 <float>  const &m)              { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) UniformMatrix3fv  (id,1,    GL_FALSE,m.cell ); }
+	void SetUniform(char const *name, Matrix4 <float>  const &m)              { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) UniformMatrix4fv  (id,1,    GL_FALSE,m.cell ); }
+	void SetUniform(char const *name, Matrix2 <float>  const *m, int count=1) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) UniformMatrix2fv  (id,count,GL_FALSE,m->cell); }
+	void SetUniform(char const *name, Matrix3 <float>  const *m, int count=1) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) UniformMatrix3fv  (id,count,GL_FALSE,m->cell); }
+	void SetUniform(char const *name, Matrix4 <float>  const *m, int count=1) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) UniformMatrix4fv  (id,count,GL_FALSE,m->cell); }
 # ifdef GL_VERSION_2_1
-	void SetUniform(char const *name, Matrix34<float>  const &m)              { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniformMatrix3x4fv(id,1,    GL_FALSE,m.cell ); }
-	void SetUniform(char const *name, Matrix34<float>  const *m, int count=1) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniformMatrix3x4fv(id,count,GL_FALSE,m->cell); }
+	void SetUniform(char const *name, Matrix34<float>  const &m)              { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) UniformMatrix4x3fv(id,1,    GL_FALSE,m.cell ); }
+	void SetUniform(char const *name, Matrix34<float>  const *m, int count=1) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) UniformMatrix4x3fv(id,count,GL_FALSE,m->cell); }
 # endif
 # ifdef GL_VERSION_4_0
-	void SetUniform(char const *name, Matrix2 <double> const &m)              { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniformMatrix2dv  (id,1,    GL_FALSE,m.cell ); }
-	void SetUniform(char const *name, Matrix3 <double> const &m)              { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniformMatrix3dv  (id,1,    GL_FALSE,m.cell ); }
-	void SetUniform(char const *name, Matrix4 <double> const &m)              { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniformMatrix4dv  (id,1,    GL_FALSE,m.cell ); }
-	void SetUniform(char const *name, Matrix34<double> const &m)              { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniformMatrix3x4dv(id,1,    GL_FALSE,m.cell ); }
-	void SetUniform(char const *name, Matrix2 <double> const *m, int count=1) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniformMatrix2dv  (id,count,GL_FALSE,m->cell); }
-	void SetUniform(char const *name, Matrix3 <double> const *m, int count=1) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniformMatrix3dv  (id,count,GL_FALSE,m->cell); }
-	void SetUniform(char const *name, Matrix4 <double> const *m, int count=1) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniformMatrix4dv  (id,count,GL_FALSE,m->cell); }
-	void SetUniform(char const *name, Matrix34<double> const *m, int count=1) { glUseProgram(programID); int id = glGetUniformLocation( programID, name ); if ( id >= 0 ) glUniformMatrix3x4dv(id,count,GL_FALSE,m->cell); }
+	void SetUniform(char const *name, Matrix2 <double> const &m)              { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) UniformMatrix2dv  (id,1,    GL_FALSE,m.cell ); }
+	void SetUniform(char const *name, Matrix3 <double> const &m)              { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) UniformMatrix3dv  (id,1,    GL_FALSE,m.cell ); }
+	void SetUniform(char const *name, Matrix4 <double> const &m)              { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) UniformMatrix4dv  (id,1,    GL_FALSE,m.cell ); }
+	void SetUniform(char const *name, Matrix34<double> const &m)              { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) UniformMatrix4x3dv(id,1,    GL_FALSE,m.cell ); }
+	void SetUniform(char const *name, Matrix2 <double> const *m, int count=1) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) UniformMatrix2dv  (id,count,GL_FALSE,m->cell); }
+	void SetUniform(char const *name, Matrix3 <double> const *m, int count=1) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) UniformMatrix3dv  (id,count,GL_FALSE,m->cell); }
+	void SetUniform(char const *name, Matrix4 <double> const *m, int count=1) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) UniformMatrix4dv  (id,count,GL_FALSE,m->cell); }
+	void SetUniform(char const *name, Matrix34<double> const *m, int count=1) { Bind(); int id = GetUniformLocation( name ); if ( id >= 0 ) UniformMatrix4x3dv(id,count,GL_FALSE,m->cell); }
 # endif
 #endif
 	//!@}
@@ -1339,150 +1717,847 @@ public:
 	}
 	void EnableAttrib ( char const *name ) { glEnableVertexAttribArray ( AttribLocation(name) ); }
 	void DisableAttrib( char const *name ) { glDisableVertexAttribArray( AttribLocation(name) ); }
+
+#ifdef GL_VERSION_3_1
+	//! Assigns the uniform block with the given name to the given binding point.
+	//! This is only needed for blocks that do not specify a binding in the shader source.
+	//! Returns false if the program does not have an active uniform block with the given name.
+	bool SetUniformBlockBinding( char const *name, GLuint binding )
+	{
+		GLuint index = glGetUniformBlockIndex( programID, name );
+		if ( index == GL_INVALID_INDEX ) return false;
+		glUniformBlockBinding( programID, index, binding );
+		return true;
+	}
+#endif
+#ifdef GL_VERSION_4_3
+	//! Assigns the shader storage block with the given name to the given binding point.
+	//! Returns false if the program does not have an active shader storage block with the given name.
+	bool SetStorageBlockBinding( char const *name, GLuint binding )
+	{
+		GLuint index = glGetProgramResourceIndex( programID, GL_SHADER_STORAGE_BLOCK, name );
+		if ( index == GL_INVALID_INDEX ) return false;
+		glShaderStorageBlockBinding( programID, index, binding );
+		return true;
+	}
+#endif
 };
 
-//-------------------------------------------------------------------------------
-// Implementation of GL
 //-------------------------------------------------------------------------------
 
-inline void GL::PrintVersion(std::ostream *outStream)
+#ifdef GL_VERSION_4_5
+
+//! Memory layout rules for uniform and shader storage blocks
+enum GLBlockLayoutRule
 {
-	const GLubyte* version = glGetString(GL_VERSION);
-	if ( version ) *outStream << version;
-	else {
-		int versionMajor=0, versionMinor=0;
-#ifdef GL_VERSION_3_0
-		glGetIntegerv(GL_MAJOR_VERSION,&versionMajor);
-		glGetIntegerv(GL_MINOR_VERSION,&versionMinor);
-#endif
-		if ( versionMajor > 0 && versionMajor < 100 ) {
-			*outStream << versionMajor << "." << versionMinor;
-		} else *outStream << "Unknown";
-	}
-}
+	STD140,	//!< std140 layout, used for uniform blocks and shader storage blocks
+	STD430,	//!< std430 layout, only available for shader storage blocks
+};
 
-inline void GL::CheckError( char const *sourcefile, int line, char const *call, std::ostream *outStream )
+//! \cond HIDDEN_SYMBOLS
+
+// The alignment, size, and block memory access functions of the types that can be placed in a block.
+// Only the types with a specialization of GLBlockType can be block members.
+template <typename T> struct GLBlockType;
+
+constexpr GLsizeiptr GLBlockRoundUp( GLsizeiptr size, GLsizeiptr alignment ) { return ( size + alignment - 1 ) / alignment * alignment; }
+
+template <typename T, int N>
+struct GLBlockVector
 {
-	GLenum error;
-	while ( (error = glGetError()) != GL_NO_ERROR) {
-		*outStream << "OpenGL ERROR: " << sourcefile << " (line " << line << "): ";
-		if ( call ) *outStream << call << " triggered ";
-		*outStream << gluErrorString(error) << std::endl;
-	}
-}
+	static constexpr GLsizeiptr Alignment( GLBlockLayoutRule ) { return ( N == 3 ? 4 : N ) * sizeof(T); }	// vec3 is aligned like vec4
+	static constexpr GLsizeiptr Size     ( GLBlockLayoutRule ) { return N * sizeof(T); }
+	template <typename V> static void Write( GLBlockLayoutRule, void       *dst, V const &v ) { memcpy( dst, &v, N*sizeof(T) ); }
+	template <typename V> static void Read ( GLBlockLayoutRule, void const *src, V       &v ) { memcpy( &v, src, N*sizeof(T) ); }
+};
 
-inline GLenum GL::TextureFormat( GL::Type type, int numChannels )
+// Matrices are stored as arrays of column vectors. With std140, the column stride is rounded up to the size of a vec4.
+template <typename T, int COLS, int ROWS>
+struct GLBlockMatrix
 {
-	assert( numChannels > 0 && numChannels <= 4 );
-	GLenum const internalFormats[][4] = {
-#ifdef CY_GL_TEXTURE_LUMINANCE
-		{ GL_LUMINANCE8,   GL_LUMINANCE8_ALPHA8,    GL_RGB8,    GL_RGBA8	},
-		{ GL_LUMINANCE16,  GL_LUMINANCE16_ALPHA16,  GL_RGB16,   GL_RGBA16   },
-# ifdef GL_VERSION_3_0
-		{ GL_LUMINANCE16F_ARB,  GL_LUMINANCE_ALPHA16F_ARB,  GL_RGB16F,  GL_RGBA16F  },
-		{ GL_LUMINANCE32F_ARB,  GL_LUMINANCE_ALPHA32F_ARB,  GL_RGB32F,  GL_RGBA32F  },
-		{ GL_LUMINANCE8I_EXT,   GL_LUMINANCE_ALPHA8I_EXT,   GL_RGB8I,   GL_RGBA8I   },
-		{ GL_LUMINANCE8UI_EXT,  GL_LUMINANCE_ALPHA8UI_EXT,  GL_RGB8UI,  GL_RGBA8UI  },
-		{ GL_LUMINANCE16I_EXT,  GL_LUMINANCE_ALPHA16I_EXT,  GL_RGB16I,  GL_RGBA16I  },
-		{ GL_LUMINANCE16UI_EXT, GL_LUMINANCE_ALPHA16UI_EXT, GL_RGB16UI, GL_RGBA16UI },
-		{ GL_LUMINANCE32I_EXT,  GL_LUMINANCE_ALPHA32I_EXT,  GL_RGB32I,  GL_RGBA32I  },
-		{ GL_LUMINANCE32UI_EXT, GL_LUMINANCE_ALPHA32UI_EXT, GL_RGB32UI, GL_RGBA32UI },
-# else
-		{ GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB, GL_RGBA },
-		{ GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB, GL_RGBA },
-		{ GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB, GL_RGBA },
-		{ GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB, GL_RGBA },
-		{ GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB, GL_RGBA },
-		{ GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB, GL_RGBA },
-		{ GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB, GL_RGBA },
-		{ GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB, GL_RGBA },
-# endif
-#else
-		{ GL_R8,    GL_RG8,    GL_RGB8,    GL_RGBA8	   },
-		{ GL_R16,   GL_RG16,   GL_RGB16,   GL_RGBA16   },
-# ifdef GL_VERSION_3_0
-		{ GL_R16F,  GL_RG16F,  GL_RGB16F,  GL_RGBA16F  },
-		{ GL_R32F,  GL_RG32F,  GL_RGB32F,  GL_RGBA32F  },
-		{ GL_R8I,   GL_RG8I,   GL_RGB8I,   GL_RGBA8I   },
-		{ GL_R8UI,  GL_RG8UI,  GL_RGB8UI,  GL_RGBA8UI  },
-		{ GL_R16I,  GL_RG16I,  GL_RGB16I,  GL_RGBA16I  },
-		{ GL_R16UI, GL_RG16UI, GL_RGB16UI, GL_RGBA16UI },
-		{ GL_R32I,  GL_RG32I,  GL_RGB32I,  GL_RGBA32I  },
-		{ GL_R32UI, GL_RG32UI, GL_RGB32UI, GL_RGBA32UI },
-# else
-		{ GL_RED, GL_RG, GL_RGB, GL_RGBA },
-		{ GL_RED, GL_RG, GL_RGB, GL_RGBA },
-		{ GL_RED, GL_RG, GL_RGB, GL_RGBA },
-		{ GL_RED, GL_RG, GL_RGB, GL_RGBA },
-		{ GL_RED, GL_RG, GL_RGB, GL_RGBA },
-		{ GL_RED, GL_RG, GL_RGB, GL_RGBA },
-		{ GL_RED, GL_RG, GL_RGB, GL_RGBA },
-		{ GL_RED, GL_RG, GL_RGB, GL_RGBA },
-# endif
+	static constexpr GLsizeiptr Stride   ( GLBlockLayoutRule rule ) { return rule == STD140 ? GLBlockRoundUp( GLBlockVector<T,ROWS>::Alignment(rule), 16 ) : GLBlockVector<T,ROWS>::Alignment(rule); }
+	static constexpr GLsizeiptr Alignment( GLBlockLayoutRule rule ) { return Stride(rule); }
+	static constexpr GLsizeiptr Size     ( GLBlockLayoutRule rule ) { return COLS * Stride(rule); }
+	template <typename M> static void Write( GLBlockLayoutRule rule, void *dst, M const &m )
+	{
+		for ( int c=0; c<COLS; ++c ) memcpy( (char*)dst + c*Stride(rule), m.cell + c*ROWS, ROWS*sizeof(T) );
+	}
+	template <typename M> static void Read( GLBlockLayoutRule rule, void const *src, M &m )
+	{
+		for ( int c=0; c<COLS; ++c ) memcpy( m.cell + c*ROWS, (char const*)src + c*Stride(rule), ROWS*sizeof(T) );
+	}
+};
+
+template <> struct GLBlockType<float > : GLBlockVector<float ,1> {};
+template <> struct GLBlockType<int   > : GLBlockVector<int   ,1> {};
+template <> struct GLBlockType<GLuint> : GLBlockVector<GLuint,1> {};
+template <> struct GLBlockType<double> : GLBlockVector<double,1> {};
+
+#ifdef _CY_VECTOR_H_INCLUDED_
+template <typename T> struct GLBlockType< Vec2<T> > : GLBlockVector<T,2> {};
+template <typename T> struct GLBlockType< Vec3<T> > : GLBlockVector<T,3> {};
+template <typename T> struct GLBlockType< Vec4<T> > : GLBlockVector<T,4> {};
 #endif
-	};
-	
-	return internalFormats[type][numChannels-1];
-}
 
-inline GLenum GL::TextureDataFormat( GL::Type type, int numChannels )
-{
-	GLenum const formats[][4] = {
-#ifdef CY_GL_TEXTURE_LUMINANCE
-		{ GL_LUMINANCE,             GL_LUMINANCE_ALPHA,             GL_RGB,         GL_RGBA         },
-# ifdef GL_VERSION_3_0
-		{ GL_LUMINANCE_INTEGER_EXT, GL_LUMINANCE_ALPHA_INTEGER_EXT, GL_RGB_INTEGER, GL_RGBA_INTEGER },
-# else
-		{ GL_LUMINANCE,             GL_LUMINANCE_ALPHA,             GL_RGB,         GL_RGBA         },
-# endif
-#else
-		{ GL_RED,         GL_RG,         GL_RGB,         GL_RGBA         },
-# ifdef GL_VERSION_3_0
-		{ GL_RED_INTEGER, GL_RG_INTEGER, GL_RGB_INTEGER, GL_RGBA_INTEGER },
-# else
-		{ GL_RED,         GL_RG,         GL_RGB,         GL_RGBA         },
-# endif
+#ifdef _CY_IVECTOR_H_INCLUDED_
+template <typename T> struct GLBlockType< IVec2<T> > : GLBlockVector<T,2> {};
+template <typename T> struct GLBlockType< IVec3<T> > : GLBlockVector<T,3> {};
+template <typename T> struct GLBlockType< IVec4<T> > : GLBlockVector<T,4> {};
 #endif
-	};
-	return formats[type>=GL::TYPE_INT8][numChannels-1];
-}
 
-//-------------------------------------------------------------------------------
-// Implementation of GLDebugCallback
-//-------------------------------------------------------------------------------
-#ifdef _CY_GLDebugCallback
+#ifdef _CY_MATRIX_H_INCLUDED_
+template <typename T> struct GLBlockType< Matrix2 <T> > : GLBlockMatrix<T,2,2> {};
+template <typename T> struct GLBlockType< Matrix3 <T> > : GLBlockMatrix<T,3,3> {};
+template <typename T> struct GLBlockType< Matrix34<T> > : GLBlockMatrix<T,4,3> {};	// mat4x3: 4 columns with 3 rows
+template <typename T> struct GLBlockType< Matrix4 <T> > : GLBlockMatrix<T,4,4> {};
+#endif
 
-inline void _CY_APIENTRY GLDebugCallback::Callback( GLenum source,
-                                                    GLenum type,
-                                                    GLuint id,
-                                                    GLenum severity,
-                                                    GLsizei length,
-                                                    GLchar const* message,
-                                                    void const* userParam )
+// Array elements are placed with the stride of the element alignment, which is rounded up to the size of a vec4 with std140.
+template <typename T, size_t N>
+struct GLBlockType< T[N] >
 {
-	length;
+	typedef GLBlockType<T> Element;
+	static constexpr GLsizeiptr Alignment( GLBlockLayoutRule rule ) { return rule == STD140 ? GLBlockRoundUp( Element::Alignment(rule), 16 ) : Element::Alignment(rule); }
+	static constexpr GLsizeiptr Stride   ( GLBlockLayoutRule rule ) { return GLBlockRoundUp( Element::Size(rule), Alignment(rule) ); }
+	static constexpr GLsizeiptr Size     ( GLBlockLayoutRule rule ) { return N * Stride(rule); }
+	static void Write( GLBlockLayoutRule rule, void *dst, T const (&v)[N] )
+	{
+		for ( size_t i=0; i<N; ++i ) Element::Write( rule, (char*)dst + i*Stride(rule), v[i] );
+	}
+	static void Read( GLBlockLayoutRule rule, void const *src, T (&v)[N] )
+	{
+		for ( size_t i=0; i<N; ++i ) Element::Read( rule, (char const*)src + i*Stride(rule), v[i] );
+	}
+};
 
-	std::ostream *outStream = (std::ostream*) userParam;
+//! \endcond
 
-	*outStream << std::endl;
-	*outStream << "OpenGL Debug Output:" << std::endl;
-	*outStream << "VERSION:  ";
-	GL::PrintVersion(outStream);
-	*outStream << std::endl;
+//-------------------------------------------------------------------------------
 
-	*outStream << "SOURCE:   ";
-	switch (source) {
-		case GL_DEBUG_SOURCE_API:             *outStream << "API";             break;
-		case GL_DEBUG_SOURCE_WINDOW_SYSTEM:   *outStream << "Window System";   break;
-		case GL_DEBUG_SOURCE_SHADER_COMPILER: *outStream << "Shader Compiler"; break;
-		case GL_DEBUG_SOURCE_THIRD_PARTY:     *outStream << "Third Party";     break;
-		case GL_DEBUG_SOURCE_APPLICATION:     *outStream << "Application";     break;
-		case GL_DEBUG_SOURCE_OTHER:           *outStream << "Other";           break;
-		default:                              *outStream << "Unknown";         break;
-	}
-	*outStream << std::endl;
+//! Compile-time memory layout of a uniform or shader storage block.
+//!
+//! This class computes the offsets of the block members using the given layout rule,
+//! so that the block contents can be written to CPU memory and uploaded to a buffer
+//! with a single call. The MEMBERS are the C++ types of the block members in the order 
+//! they appear in the shader. A struct member in the shader can be listed as its members
+//! when the struct is the first member of the block or when its preceding members end
+//! on a 16-byte boundary. For example, the block
+//! \code
+//! layout(std140, binding=0) uniform Light { vec3 position; vec3 intensity; float ambient; };
+//! \endcode
+//! can be described as
+//! \code
+//! typedef cy::GLBlockLayout<cy::STD140, cy::Vec3f, cy::Vec3f, float> LightLayout;
+//! LightLayout::Write<0>( lightBlock, position );
+//! \endcode
+template <GLBlockLayoutRule RULE, typename... MEMBERS>
+class GLBlockLayout
+{
+public:
+	static constexpr int NumMembers() { return int(sizeof...(MEMBERS)); }	//!< Returns the number of block members.
 
-	*outStream << "TYPE:     ";
+	template <int I> using MemberType = typename std::tuple_element< I, std::tuple<MEMBERS...> >::type;	//!< The type of the block member I.
+
+	//! Returns the offset of the block member i in bytes.
+	static constexpr GLsizeiptr Offset( int i )
+	{
+		GLsizeiptr offset = 0;
+		for ( int j=0; j<i; ++j ) offset = GLBlockRoundUp( offset, alignment[j] ) + size[j];
+		return GLBlockRoundUp( offset, alignment[i] );
+	}
+
+	//! Returns the base alignment of the block, which is the largest member alignment, rounded up to the size of a vec4 with std140.
+	static constexpr GLsizeiptr Alignment()
+	{
+		GLsizeiptr a = RULE == STD140 ? 16 : 1;
+		for ( int j=0; j<NumMembers(); ++j ) if ( a < alignment[j] ) a = alignment[j];
+		return a;
+	}
+
+	//! Returns the size of the block in bytes, padded to the block alignment.
+	static constexpr GLsizeiptr Size() { return GLBlockRoundUp( Offset(NumMembers()-1) + size[NumMembers()-1], Alignment() ); }
+
+	//! Writes the value of the block member I to the given block memory.
+	template <int I> static void Write( void *block, MemberType<I> const &value ) { GLBlockType< MemberType<I> >::Write( RULE, (char*)block + Offset(I), value ); }
+
+	//! Reads the value of the block member I from the given block memory.
+	template <int I> static void Read( void const *block, MemberType<I> &value ) { GLBlockType< MemberType<I> >::Read( RULE, (char const*)block + Offset(I), value ); }
+
+private:
+	static constexpr GLsizeiptr alignment[] = { GLBlockType<MEMBERS>::Alignment(RULE)... };
+	static constexpr GLsizeiptr size     [] = { GLBlockType<MEMBERS>::Size     (RULE)... };
+};
+
+//-------------------------------------------------------------------------------
+
+//! OpenGL buffer object for uniform and shader storage blocks.
+//!
+//! The template argument BUFFER_TYPE should be GL_UNIFORM_BUFFER or
+//! GL_SHADER_STORAGE_BUFFER. The buffer storage is immutable and it is
+//! updated using glNamedBufferSubData. This class merely stores the buffer id.
+//! Note that deleting an object of this class does not automatically delete
+//! the buffer from the GPU memory. You must explicitly call the Delete() 
+//! method to free the buffer storage on the GPU.
+template <GLenum BUFFER_TYPE>
+class GLBuffer
+{
+private:
+	GLuint     bufferID;	//!< The buffer ID
+	GLsizeiptr bufferSize;	//!< The size of the buffer storage in bytes
+
+public:
+	GLBuffer() : bufferID(CY_GL_INVALID_ID), bufferSize(0) {}	//!< Constructor.
+
+	//!@name General Methods
+
+	void       Delete () { if ( bufferID != CY_GL_INVALID_ID ) glDeleteBuffers(1,&bufferID); bufferID = CY_GL_INVALID_ID; bufferSize = 0; }	//!< Deletes the buffer.
+	GLuint     GetID  () const { return bufferID; }								//!< Returns the buffer ID.
+	bool       IsNull () const { return bufferID == CY_GL_INVALID_ID; }			//!< Returns true if the buffer is not initialized, i.e. the buffer id is invalid.
+	GLsizeiptr GetSize() const { return bufferSize; }							//!< Returns the size of the buffer storage in bytes.
+	GLenum     Type   () const { return BUFFER_TYPE; }
+
+	//! Binds the entire buffer to the given binding point.
+	void Bind( GLuint binding ) const { glBindBufferBase( BUFFER_TYPE, binding, bufferID ); }
+
+	//! Binds a range of the buffer to the given binding point. The offset must be a multiple of GetOffsetAlignment().
+	void Bind( GLuint binding, GLintptr offset, GLsizeiptr size ) const { glBindBufferRange( BUFFER_TYPE, binding, bufferID, offset, size ); }
+
+	//!@name Buffer Creation and Initialization
+
+	//! Deletes the previous buffer storage (if any) and creates an immutable buffer storage with the given size and initial data.
+	//! The default flags allow updating the buffer contents with SetData.
+	void Initialize( GLsizeiptr size, void const *data=nullptr, GLbitfield flags=GL_DYNAMIC_STORAGE_BIT )
+	{
+		Delete();
+		glCreateBuffers( 1, &bufferID );
+		glNamedBufferStorage( bufferID, size, data, flags );
+		bufferSize = size;
+	}
+
+	//! Copies the given data to the buffer storage starting from the given offset.
+	void SetData( void const *data, GLsizeiptr size, GLintptr offset=0 ) { glNamedBufferSubData( bufferID, offset, size, data ); }
+
+	//! Returns the required alignment of the offsets used for binding a range of the buffer.
+	static GLint GetOffsetAlignment()
+	{
+		GLint alignment = 256;
+		glGetIntegerv( BUFFER_TYPE == GL_UNIFORM_BUFFER ? GL_UNIFORM_BUFFER_OFFSET_ALIGNMENT : GL_SHADER_STORAGE_BUFFER_OFFSET_ALIGNMENT, &alignment );
+		return alignment;
+	}
+};
+
+//-------------------------------------------------------------------------------
+
+//! An array of uniform or shader storage blocks that are updated once per frame.
+//!
+//! The block contents are kept in CPU memory and each call to Upload() copies all
+//! blocks to the buffer with a single call. Each block is padded to the buffer offset
+//! alignment, so that a single block can be bound before a draw call using its index.
+//! Per-frame data, such as the camera and light parameters, can use a single block
+//! that is bound once for all programs. Per-object data can use one block per object.
+//!
+//! The buffer holds multiple copies of the blocks (regions) and each upload writes to
+//! the next region in a ring, so that the update does not modify the data that the
+//! GPU may still be reading for a previous frame.
+template <GLenum BUFFER_TYPE>
+class GLBlockBuffer
+{
+private:
+	GLBuffer<BUFFER_TYPE> buffer;		//!< The buffer that holds all regions
+	std::vector<char>     blocks;		//!< CPU copy of the blocks
+	GLsizeiptr            blockSize;	//!< The size of a block in bytes
+	GLsizeiptr            blockStride;	//!< The distance between two consecutive blocks in bytes
+	int                   numBlocks;	//!< The number of blocks in a region
+	int                   numRegions;	//!< The number of regions in the ring
+	int                   region;		//!< The region that was last uploaded
+
+public:
+	GLBlockBuffer() : blockSize(0), blockStride(0), numBlocks(0), numRegions(0), region(0) {}	//!< Constructor.
+
+	//!@name General Methods
+
+	void Delete() { buffer.Delete(); blocks.clear(); numBlocks = 0; }	//!< Deletes the buffer and the CPU copy of the blocks.
+	bool IsNull() const { return buffer.IsNull(); }						//!< Returns true if the buffer is not initialized.
+	GLBuffer<BUFFER_TYPE> const & GetBuffer() const { return buffer; }	//!< Returns the buffer that holds all regions.
+
+	//! Creates the buffer for the given number of blocks with the given size in bytes.
+	//! The buffer keeps the given number of copies of the blocks, so that the previous frames can still be in flight while the blocks are updated.
+	void Initialize( GLsizeiptr size, int count=1, int regions=3 );
+
+	//!@name Block Access Methods
+
+	int        NumBlocks   () const { return numBlocks; }	//!< Returns the number of blocks.
+	GLsizeiptr GetBlockSize() const { return blockSize; }	//!< Returns the size of a block in bytes.
+
+	void       * GetBlock( int i )       { return blocks.data() + i*blockStride; }	//!< Returns the CPU memory of block i.
+	void const * GetBlock( int i ) const { return blocks.data() + i*blockStride; }	//!< Returns the CPU memory of block i.
+
+	//! Writes the value of member I of block i using the given layout.
+	template <typename LAYOUT, int I> void Write( int i, typename LAYOUT::template MemberType<I> const &value ) { LAYOUT::template Write<I>( GetBlock(i), value ); }
+
+	//!@name Update and Binding
+
+	//! Copies the first count blocks (or all blocks if count is negative) to the next region of the buffer with a single call.
+	//! This should be called once per frame after all blocks are written and before they are bound.
+	//! Nothing is copied if there are no blocks to copy, and the blocks of the last uploaded region stay bound.
+	void Upload( int count=-1 )
+	{
+		if ( count < 0 || count > numBlocks ) count = numBlocks;
+		if ( count == 0 ) return;
+		region = ( region + 1 ) % numRegions;
+		buffer.SetData( blocks.data(), (count-1)*blockStride + blockSize, region*RegionSize() );
+	}
+
+	//! Binds block i of the last uploaded region to the given binding point.
+	void Bind( GLuint binding, int i=0 ) const { buffer.Bind( binding, region*RegionSize() + i*blockStride, blockSize ); }
+
+protected:
+	GLsizeiptr RegionSize() const { return numBlocks * blockStride; }
+};
+
+//-------------------------------------------------------------------------------
+
+//! Persistently mapped buffer for streaming data that is rewritten every frame.
+//!
+//! This class is intended for data such as instance transforms, particle positions,
+//! or debug lines. The buffer storage is mapped once with persistent and coherent
+//! mapping, so the CPU writes directly to the buffer memory without any buffer update
+//! or map/unmap calls. The storage is split into regions that are used in a ring, one
+//! region per frame. The region is fenced at the end of the frame, and BeginFrame waits
+//! for the fence only when the ring returns to the region while the GPU is still reading
+//! it, which does not happen unless the GPU falls behind by all other regions.
+//!
+//! Allocate hands out aligned suballocations within the region of the current frame
+//! along with their offsets in the buffer, which can be used for binding the data as
+//! vertex, index, uniform, or shader storage buffers.
+//! Note that deleting an object of this class does not automatically delete
+//! the buffer from the GPU memory. You must explicitly call the Delete() 
+//! method to free the buffer storage on the GPU.
+class GLStreamBuffer
+{
+private:
+	GLuint              bufferID;		//!< The buffer ID
+	char               *mappedData;		//!< The persistently mapped buffer storage
+	GLsizeiptr          regionSize;		//!< The size of a region in bytes
+	int                 numRegions;		//!< The number of regions in the ring
+	int                 region;			//!< The region of the current frame
+	GLsizeiptr          regionUsed;		//!< The number of bytes allocated from the current region
+	std::vector<GLsync> fences;			//!< The fences of the frames that used each region
+	size_t              stallCount;		//!< The number of times BeginFrame waited for the GPU
+
+public:
+	GLStreamBuffer() : bufferID(CY_GL_INVALID_ID), mappedData(nullptr), regionSize(0), numRegions(0), region(0), regionUsed(0), stallCount(0) {}	//!< Constructor.
+
+	//!@name General Methods
+
+	void       Delete       ();													//!< Unmaps and deletes the buffer.
+	GLuint     GetID        () const { return bufferID; }						//!< Returns the buffer ID.
+	bool       IsNull       () const { return bufferID == CY_GL_INVALID_ID; }	//!< Returns true if the buffer is not initialized, i.e. the buffer id is invalid.
+	GLsizeiptr GetRegionSize() const { return regionSize; }						//!< Returns the size of a region, which is the maximum data size of a frame.
+	int        NumRegions   () const { return numRegions; }						//!< Returns the number of regions.
+	GLsizeiptr GetUsedSize  () const { return regionUsed; }						//!< Returns the number of bytes allocated in the current frame, including the alignment padding.
+
+	size_t GetStallCount  () const { return stallCount; }	//!< Returns the number of times BeginFrame waited for the GPU to finish reading a region.
+	void   ResetStallCount() { stallCount = 0; }			//!< Resets the number of stalls.
+
+	//! Creates and maps the buffer storage with the given number of regions, each with the given size in bytes.
+	//! Three regions allow the CPU to write a frame while the GPU processes the two previous frames.
+	void Initialize( GLsizeiptr size, int regions=3 );
+
+	//!@name Frame Methods
+
+	//! Moves to the next region and waits until the GPU finishes reading it, if necessary.
+	//! This must be called once per frame before any Allocate call.
+	void BeginFrame();
+
+	//! Places a fence after the commands that use the data of the current frame.
+	//! This must be called once per frame after the last draw call that reads the data.
+	void EndFrame();
+
+	//! Allocates the given number of bytes in the current region with the given alignment.
+	//! Returns the pointer for writing the data and sets the offset of the allocation in the buffer.
+	//! Returns nullptr if the region does not have enough space left.
+	//! Uniform and shader storage buffer bindings require the offset alignment of GLBuffer::GetOffsetAlignment().
+	void* Allocate( GLsizeiptr size, GLsizeiptr alignment, GLintptr &offset );
+
+	//! Allocates an array of the given number of items in the current region.
+	//! Returns nullptr if the region does not have enough space left.
+	template <typename T> T* Allocate( size_t count, GLintptr &offset, GLsizeiptr alignment=alignof(T) ) { return (T*) Allocate( GLsizeiptr(count*sizeof(T)), alignment, offset ); }
+
+	//!@name Binding Methods
+
+	//! Binds the buffer to the given target, such as GL_ARRAY_BUFFER or GL_DRAW_INDIRECT_BUFFER.
+	void Bind( GLenum target ) const { glBindBuffer( target, bufferID ); }
+
+	//! Binds a range of the buffer to the given indexed target, such as GL_UNIFORM_BUFFER or GL_SHADER_STORAGE_BUFFER.
+	void Bind( GLenum target, GLuint binding, GLintptr offset, GLsizeiptr size ) const { glBindBufferRange( target, binding, bufferID, offset, size ); }
+};
+
+//-------------------------------------------------------------------------------
+
+//! Asynchronous texture uploads through a persistently mapped pixel unpack buffer.
+//!
+//! Worker threads decode images directly into the staging memory returned by Allocate
+//! and queue the upload with Submit. The thread that owns the OpenGL context calls
+//! Process once per frame, which issues the queued uploads from the pixel unpack buffer
+//! and fences them. The driver copies the pixels from the buffer asynchronously, so the
+//! main thread never waits for the copy from client memory, and the staging memory of
+//! an upload is reused only after its fence is signaled.
+//!
+//! The upload functions are called by Process while the buffer is bound to
+//! GL_PIXEL_UNPACK_BUFFER. Their argument is the buffer offset of the staging memory,
+//! which must be passed as the pixel data pointer to the texture functions, such as
+//! glTextureSubImage2D or the SetImage methods of GLTexture2 and GLTextureCubeMap.
+//! Allocate and Submit can be called from any thread; all other methods must be called
+//! from the thread that owns the OpenGL context.
+class GLTextureUploader
+{
+public:
+	typedef uint64_t Ticket;									//!< Identifies an allocation until its upload is submitted
+	typedef std::function<void(void const *pixels)> UploadFunc;	//!< Issues the upload using the given pixel data pointer (buffer offset)
+
+private:
+	struct Allocation
+	{
+		GLsizeiptr begin, end;	//!< The staging memory range in the buffer
+		UploadFunc upload;		//!< The upload function, empty until the upload is submitted
+		GLsync     fence;		//!< The fence after the upload, nullptr until the upload is issued
+	};
+	GLuint                  bufferID;		//!< The pixel unpack buffer ID
+	char                   *mappedData;		//!< The persistently mapped buffer storage
+	GLsizeiptr              bufferSize;		//!< The size of the buffer in bytes
+	GLsizeiptr              head;			//!< The end of the last allocation in the ring
+	std::deque<Allocation>  allocations;	//!< The allocations that are not freed yet, in allocation order
+	Ticket                  firstTicket;	//!< The ticket of the first allocation in the queue
+	bool                    closed;			//!< True if Allocate no longer hands out memory
+	std::mutex              mutex;
+	std::condition_variable spaceAvailable;
+
+	bool FindSpace( GLsizeiptr size, GLsizeiptr &begin ) const;
+
+public:
+	GLTextureUploader() : bufferID(CY_GL_INVALID_ID), mappedData(nullptr), bufferSize(0), head(0), firstTicket(0), closed(true) {}	//!< Constructor.
+
+	//!@name General Methods
+
+	//! Creates and maps the staging buffer with the given size in bytes, which limits the total size of the uploads in flight.
+	void Initialize( GLsizeiptr size );
+
+	//! Wakes the threads waiting in Allocate and makes all further Allocate calls fail.
+	//! This should be called before joining the worker threads that may be waiting for staging memory.
+	void Close() { std::lock_guard<std::mutex> lock(mutex); closed = true; spaceAvailable.notify_all(); }
+
+	//! Closes the uploader and deletes the buffer. The uploads that are not issued yet are discarded.
+	//! The worker threads must not use the uploader after this call.
+	void Delete();
+
+	GLuint     GetID  () const { return bufferID; }						//!< Returns the buffer ID.
+	bool       IsNull () const { return bufferID == CY_GL_INVALID_ID; }	//!< Returns true if the uploader is not initialized.
+	GLsizeiptr GetSize() const { return bufferSize; }					//!< Returns the size of the staging buffer in bytes.
+
+	//! Returns the number of uploads whose staging memory is not freed yet, including the ones that are not submitted.
+	size_t NumPending() { std::lock_guard<std::mutex> lock(mutex); return allocations.size(); }
+
+	//!@name Worker Thread Methods
+
+	//! Allocates staging memory with the given size and returns the pointer for writing the pixels.
+	//! If there is not enough free memory and wait is true, the call blocks until Process frees enough memory.
+	//! Returns nullptr if the size is larger than the buffer, the uploader is closed, or wait is false and there is no space.
+	//! Every successful allocation must be followed by a Submit call with the returned ticket.
+	void* Allocate( GLsizeiptr size, Ticket &ticket, bool wait=true );
+
+	//! Queues the upload function of the given allocation, which is called by the next Process call.
+	void Submit( Ticket ticket, UploadFunc upload );
+
+	//! Queues an upload to a region of a 2D texture level using glTextureSubImage2D.
+	void SubmitSubImage2D( Ticket ticket, GLuint texture, GLint level, GLint x, GLint y, GLsizei width, GLsizei height, GLenum format, GLenum type )
+	{
+		Submit( ticket, [=]( void const *pixels ) { glTextureSubImage2D( texture, level, x, y, width, height, format, type, pixels ); } );
+	}
+
+	//! Queues an upload to a region of a layer of an array texture or a face of a cube map texture using glTextureSubImage3D.
+	void SubmitSubImage3D( Ticket ticket, GLuint texture, GLint level, GLint x, GLint y, GLint layer, GLsizei width, GLsizei height, GLenum format, GLenum type )
+	{
+		Submit( ticket, [=]( void const *pixels ) { glTextureSubImage3D( texture, level, x, y, layer, width, height, 1, format, type, pixels ); } );
+	}
+
+	//!@name Main Thread Methods
+
+	//! Frees the staging memory of the completed uploads and issues the submitted uploads.
+	//! Returns the number of uploads issued. This should be called once per frame.
+	int Process();
+};
+
+//-------------------------------------------------------------------------------
+
+//! Builds the mipmap levels of textures using compute shaders.
+//!
+//! Unlike glGenerateMipmap, the filter is explicit: a box filter that
+//! handles odd sizes by weighting the covered texels, or a Kaiser-windowed
+//! sinc filter that keeps more detail in the smaller levels. sRGB textures
+//! are filtered in linear space, and alpha-weighted filtering keeps the
+//! color of transparent texels from bleeding into the visible ones.
+//!
+//! The texture must have immutable storage (see GLTexture2::SetStorage),
+//! since its levels are accessed through texture views. The generator
+//! supports 2D textures, 2D texture arrays, and cube maps with 8-bit or
+//! 16-bit normalized and floating point formats. For other textures it
+//! falls back to glGenerateTextureMipmap.
+//! The compute programs are compiled the first time they are needed for a
+//! texture format. Generate leaves no program bound and resets the
+//! bindings of texture unit 0 and image unit 0.
+class GLMipmapGenerator
+{
+public:
+	//! Mipmap filters
+	enum Filter {
+		FILTER_BOX,		//!< Box filter
+		FILTER_KAISER,	//!< Kaiser-windowed sinc filter
+	};
+
+private:
+	struct Program
+	{
+		GLenum internalFormat;	//!< The texture format of the image view written by the program
+		Filter filter;			//!< The filter of the program
+		GLuint programID;		//!< The compute program ID
+		GLint  srcLevel, srgb, alphaWeighted;	//!< Uniform locations
+	};
+	std::vector<Program> programs;	//!< The compiled programs for each image format and filter
+	GLuint        samplerID;		//!< Bilinear sampler for the levels that are exactly half the size of the previous level
+	std::ostream *outStream;
+
+	static char const* ShaderSource();
+	static bool ImageFormat( GLenum internalFormat, GLenum &viewFormat, char const *&layoutFormat, bool &srgb );
+	Program const* GetProgram( GLenum viewFormat, char const *layoutFormat, Filter filter );
+
+public:
+	GLMipmapGenerator( std::ostream *outStream=&std::cout ) : samplerID(CY_GL_INVALID_ID), outStream(outStream) {}	//!< Constructor. Compilation errors are written to the given stream.
+
+	//! Deletes the compute programs and the sampler.
+	void Delete();
+
+	//! Builds all mipmap levels of the texture from its base level.
+	//! Returns false if the generator had to fall back to glGenerateTextureMipmap.
+	bool Generate( GLuint textureID, Filter filter=FILTER_BOX, bool alphaWeighted=false );
+
+	//! Builds all mipmap levels of the texture from its base level.
+	template <GLenum TEXTURE_TYPE>
+	bool Generate( GLTexture<TEXTURE_TYPE> const &texture, Filter filter=FILTER_BOX, bool alphaWeighted=false ) { return Generate( texture.GetID(), filter, alphaWeighted ); }
+};
+
+#endif // GL_VERSION_4_5
+
+//-------------------------------------------------------------------------------
+
+#ifdef GL_VERSION_3_3
+
+//! GPU profiler with timer queries.
+//!
+//! The time of each zone of a frame is measured on the GPU with a pair of
+//! GL_TIMESTAMP queries, so zones can be nested, and the whole frame is
+//! measured with a GL_TIME_ELAPSED query. Optionally, top-level zones also
+//! collect pipeline statistics counters (GL_ARB_pipeline_statistics_query).
+//! The queries of a frame are read when its query set is reused a few frames
+//! later. If the results are still not available at that point, the frame is
+//! dropped instead of waiting for the GPU, so profiling never stalls the
+//! pipeline. The results update rolling statistics of each zone over a
+//! window of frames, and they can be recorded as a Chrome trace
+//! (chrome://tracing or Perfetto) using StartTrace and WriteTrace.
+//!
+//! BeginZone/EndZone calls (or Zone objects) must be placed between
+//! BeginFrame and EndFrame. Zones are identified by their names.
+class GLProfiler
+{
+public:
+	//! Pipeline statistics counters
+	enum Counter {
+		VERTICES_SUBMITTED,
+		PRIMITIVES_SUBMITTED,
+		VERTEX_SHADER_INVOCATIONS,
+		FRAGMENT_SHADER_INVOCATIONS,
+		CLIPPING_INPUT_PRIMITIVES,
+		CLIPPING_OUTPUT_PRIMITIVES,
+		NUM_COUNTERS
+	};
+
+	//! Rolling statistics of a zone. The times are in milliseconds.
+	struct Statistics
+	{
+		std::string name;
+		double   lastTime    = 0;	//!< The time of the last collected frame
+		double   averageTime = 0;	//!< The average time over the window of the last collected frames
+		double   minTime     = 0;	//!< The minimum time over the window
+		double   maxTime     = 0;	//!< The maximum time over the window
+		uint64_t count       = 0;	//!< The total number of collected samples
+		GLuint64 counters[NUM_COUNTERS] = {};	//!< The pipeline statistics counters of the last collected frame (top-level zones only)
+		std::vector<double> samples;	//!< The samples in the window, used as a ring buffer
+	};
+
+	//! Measures a zone from its construction to its destruction.
+	class Zone
+	{
+		GLProfiler &profiler;
+	public:
+		Zone( GLProfiler &p, char const *name ) : profiler(p) { profiler.BeginZone(name); }	//!< Begins the zone.
+		~Zone() { profiler.EndZone(); }	//!< Ends the zone.
+	};
+
+private:
+	struct ZoneRecord
+	{
+		int    statsIndex;		//!< The index of the statistics of the zone
+		int    depth;			//!< The nesting depth of the zone
+		GLuint beginQuery;		//!< Timestamp query at the beginning of the zone
+		GLuint endQuery;		//!< Timestamp query at the end of the zone
+		int    counterQueries;	//!< The index of the first pipeline statistics query of the zone, or -1
+	};
+	struct FrameQueries
+	{
+		GLuint                  frameQuery = 0;		//!< GL_TIME_ELAPSED query of the frame
+		std::vector<GLuint>     timestamps;			//!< Timestamp query pool
+		std::vector<GLuint>     counterQueries;		//!< Pipeline statistics query pool
+		std::vector<ZoneRecord> zones;				//!< The zones of the frame in the order they began
+		size_t                  usedTimestamps = 0;
+		size_t                  usedCounterQueries = 0;
+		uint64_t                frameIndex = 0;
+		bool                    pending = false;	//!< True if the queries are issued but not collected
+	};
+	struct TraceEvent
+	{
+		int      statsIndex;
+		int      depth;
+		GLuint64 begin, duration;	//!< In nanoseconds
+		uint64_t frameIndex;
+	};
+
+	std::vector<FrameQueries> frames;		//!< Query sets, used in a round-robin order
+	size_t                    frameSlot;	//!< The query set of the current frame
+	uint64_t                  frameIndex;	//!< The number of frames begun
+	std::vector<Statistics>   zoneStats;	//!< The statistics of all zones
+	Statistics                frameStats;	//!< The statistics of the frame times
+	std::vector<int>          openZones;	//!< The records of the zones that have begun but not ended
+	int                       openCounterZone;	//!< The record of the zone with active pipeline statistics queries, or -1
+	size_t                    windowSize;
+	bool                      collectCounters;
+	bool                      inFrame;
+	uint64_t                  droppedFrames;
+	bool                      tracing;
+	size_t                    maxTraceEvents;
+	std::vector<TraceEvent>   traceEvents;
+
+	int  FindStats( char const *name );
+	void AddSample( Statistics &stats, double time );
+	void Collect( FrameQueries &frame, bool wait );
+	static GLenum CounterTarget( int counter );
+	GLuint NextQuery( std::vector<GLuint> &pool, size_t &used, size_t count );
+
+public:
+	GLProfiler() : frameSlot(0), frameIndex(0), openCounterZone(-1), windowSize(64), collectCounters(false), inFrame(false), droppedFrames(0), tracing(false), maxTraceEvents(0) { frameStats.name = "frame"; }	//!< Constructor.
+
+	//!@name General Methods
+
+	//! Creates the query sets. The results of a frame are read numFrames frames later.
+	//! The rolling statistics are computed over the last windowSize collected frames.
+	//! If pipelineStatistics is true and the pipeline statistics queries are supported, top-level zones also collect the counters.
+	void Initialize( int numFrames=3, int windowSize=64, bool pipelineStatistics=false );
+
+	//! Deletes all queries. The collected statistics are kept.
+	void Delete();
+
+	//! Waits for the results of all issued frames and collects them.
+	void Finish();
+
+	//! Clears the statistics of all zones and the number of dropped frames.
+	void ResetStatistics();
+
+	//!@name Frame and Zone Methods
+
+	void BeginFrame();						//!< Begins a frame. This also collects the results of an earlier frame, if they are available.
+	void EndFrame();						//!< Ends the frame.
+	void BeginZone( char const *name );		//!< Begins a zone with the given name.
+	void EndZone();							//!< Ends the last zone that has begun.
+
+	//!@name Results
+
+	int               NumZones() const { return (int) zoneStats.size(); }		//!< Returns the number of zones seen so far.
+	Statistics const& GetZone( int i ) const { return zoneStats[i]; }			//!< Returns the statistics of the zone with the given index.
+	Statistics const* FindZone( char const *name ) const { for ( Statistics const &z : zoneStats ) if ( z.name == name ) return &z; return nullptr; }	//!< Returns the statistics of the zone with the given name, or nullptr.
+	Statistics const& GetFrame() const { return frameStats; }					//!< Returns the statistics of the GPU frame times.
+	uint64_t          GetDroppedFrames() const { return droppedFrames; }		//!< Returns the number of frames whose results were not available in time.
+	bool              IsCollectingCounters() const { return collectCounters; }	//!< Returns true if the pipeline statistics counters are collected.
+	static char const* CounterName( int counter );							//!< Returns the name of the given pipeline statistics counter.
+
+	//! Prints the rolling statistics of the frame and all zones.
+	void PrintStatistics( std::ostream *outStream=&std::cout ) const;
+
+	//!@name Chrome Trace
+
+	//! Starts recording the zones of the collected frames, up to the given number of events.
+	void StartTrace( size_t maxEvents=100000 ) { traceEvents.clear(); maxTraceEvents = maxEvents; tracing = true; }
+	void StopTrace() { tracing = false; }	//!< Stops recording. The recorded events are kept until the next StartTrace call.
+
+	//! Writes the recorded events in the Chrome trace event format. Returns false if the file cannot be written.
+	bool WriteTrace( char const *filename ) const;
+};
+
+#endif // GL_VERSION_3_3
+
+//-------------------------------------------------------------------------------
+// Implementation of GL
+//-------------------------------------------------------------------------------
+
+#ifdef GL_VERSION_3_0
+inline bool GL::IsExtensionSupported( char const *name )
+{
+	GLint numExtensions = 0;
+	glGetIntegerv( GL_NUM_EXTENSIONS, &numExtensions );
+	for ( GLint i=0; i<numExtensions; ++i ) {
+		char const *ext = (char const *) glGetStringi( GL_EXTENSIONS, i );
+		if ( ext && strcmp( ext, name ) == 0 ) return true;
+	}
+	return false;
+}
+#endif
+
+inline void GL::PrintVersion(std::ostream *outStream)
+{
+	const GLubyte* version = glGetString(GL_VERSION);
+	if ( version ) *outStream << version;
+	else {
+		int versionMajor=0, versionMinor=0;
+#ifdef GL_VERSION_3_0
+		glGetIntegerv(GL_MAJOR_VERSION,&versionMajor);
+		glGetIntegerv(GL_MINOR_VERSION,&versionMinor);
+#endif
+		if ( versionMajor > 0 && versionMajor < 100 ) {
+			*outStream << versionMajor << "." << versionMinor;
+		} else *outStream << "Unknown";
+	}
+}
+
+inline void GL::CheckError( char const *sourcefile, int line, char const *call, std::ostream *outStream )
+{
+	GLenum error;
+	while ( (error = glGetError()) != GL_NO_ERROR) {
+		*outStream << "OpenGL ERROR: " << sourcefile << " (line " << line << "): ";
+		if ( call ) *outStream << call << " triggered ";
+		*outStream << gluErrorString(error) << std::endl;
+	}
+}
+
+inline GLenum GL::TextureFormat( GL::Type type, int numChannels )
+{
+	assert( numChannels > 0 && numChannels <= 4 );
+	GLenum const internalFormats[][4] = {
+#ifdef CY_GL_TEXTURE_LUMINANCE
+		{ GL_LUMINANCE8,   GL_LUMINANCE8_ALPHA8,    GL_RGB8,    GL_RGBA8	},
+		{ GL_LUMINANCE16,  GL_LUMINANCE16_ALPHA16,  GL_RGB16,   GL_RGBA16   },
+# ifdef GL_VERSION_3_0
+		{ GL_LUMINANCE16F_ARB,  GL_LUMINANCE_ALPHA16F_ARB,  GL_RGB16F,  GL_RGBA16F  },
+		{ GL_LUMINANCE32F_ARB,  GL_LUMINANCE_ALPHA32F_ARB,  GL_RGB32F,  GL_RGBA32F  },
+		{ GL_LUMINANCE8I_EXT,   GL_LUMINANCE_ALPHA8I_EXT,   GL_RGB8I,   GL_RGBA8I   },
+		{ GL_LUMINANCE8UI_EXT,  GL_LUMINANCE_ALPHA8UI_EXT,  GL_RGB8UI,  GL_RGBA8UI  },
+		{ GL_LUMINANCE16I_EXT,  GL_LUMINANCE_ALPHA16I_EXT,  GL_RGB16I,  GL_RGBA16I  },
+		{ GL_LUMINANCE16UI_EXT, GL_LUMINANCE_ALPHA16UI_EXT, GL_RGB16UI, GL_RGBA16UI },
+		{ GL_LUMINANCE32I_EXT,  GL_LUMINANCE_ALPHA32I_EXT,  GL_RGB32I,  GL_RGBA32I  },
+		{ GL_LUMINANCE32UI_EXT, GL_LUMINANCE_ALPHA32UI_EXT, GL_RGB32UI, GL_RGBA32UI },
+# else
+		{ GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB, GL_RGBA },
+		{ GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB, GL_RGBA },
+		{ GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB, GL_RGBA },
+		{ GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB, GL_RGBA },
+		{ GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB, GL_RGBA },
+		{ GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB, GL_RGBA },
+		{ GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB, GL_RGBA },
+		{ GL_LUMINANCE, GL_LUMINANCE_ALPHA, GL_RGB, GL_RGBA },
+# endif
+#else
+		{ GL_R8,    GL_RG8,    GL_RGB8,    GL_RGBA8	   },
+		{ GL_R16,   GL_RG16,   GL_RGB16,   GL_RGBA16   },
+# ifdef GL_VERSION_3_0
+		{ GL_R16F,  GL_RG16F,  GL_RGB16F,  GL_RGBA16F  },
+		{ GL_R32F,  GL_RG32F,  GL_RGB32F,  GL_RGBA32F  },
+		{ GL_R8I,   GL_RG8I,   GL_RGB8I,   GL_RGBA8I   },
+		{ GL_R8UI,  GL_RG8UI,  GL_RGB8UI,  GL_RGBA8UI  },
+		{ GL_R16I,  GL_RG16I,  GL_RGB16I,  GL_RGBA16I  },
+		{ GL_R16UI, GL_RG16UI, GL_RGB16UI, GL_RGBA16UI },
+		{ GL_R32I,  GL_RG32I,  GL_RGB32I,  GL_RGBA32I  },
+		{ GL_R32UI, GL_RG32UI, GL_RGB32UI, GL_RGBA32UI },
+# else
+		{ GL_RED, GL_RG, GL_RGB, GL_RGBA },
+		{ GL_RED, GL_RG, GL_RGB, GL_RGBA },
+		{ GL_RED, GL_RG, GL_RGB, GL_RGBA },
+		{ GL_RED, GL_RG, GL_RGB, GL_RGBA },
+		{ GL_RED, GL_RG, GL_RGB, GL_RGBA },
+		{ GL_RED, GL_RG, GL_RGB, GL_RGBA },
+		{ GL_RED, GL_RG, GL_RGB, GL_RGBA },
+		{ GL_RED, GL_RG, GL_RGB, GL_RGBA },
+# endif
+#endif
+	};
+	
+	return internalFormats[type][numChannels-1];
+}
+
+inline GLenum GL::TextureDataFormat( GL::Type type, int numChannels )
+{
+	GLenum const formats[][4] = {
+#ifdef CY_GL_TEXTURE_LUMINANCE
+		{ GL_LUMINANCE,             GL_LUMINANCE_ALPHA,             GL_RGB,         GL_RGBA         },
+# ifdef GL_VERSION_3_0
+		{ GL_LUMINANCE_INTEGER_EXT, GL_LUMINANCE_ALPHA_INTEGER_EXT, GL_RGB_INTEGER, GL_RGBA_INTEGER },
+# else
+		{ GL_LUMINANCE,             GL_LUMINANCE_ALPHA,             GL_RGB,         GL_RGBA         },
+# endif
+#else
+		{ GL_RED,         GL_RG,         GL_RGB,         GL_RGBA         },
+# ifdef GL_VERSION_3_0
+		{ GL_RED_INTEGER, GL_RG_INTEGER, GL_RGB_INTEGER, GL_RGBA_INTEGER },
+# else
+		{ GL_RED,         GL_RG,         GL_RGB,         GL_RGBA         },
+# endif
+#endif
+	};
+	return formats[type>=GL::TYPE_INT8][numChannels-1];
+}
+
+//-------------------------------------------------------------------------------
+// Implementation of GLDebugCallback
+//-------------------------------------------------------------------------------
+#ifdef _CY_GLDebugCallback
+
+inline void _CY_APIENTRY GLDebugCallback::Callback( GLenum source,
+                                                    GLenum type,
+                                                    GLuint id,
+                                                    GLenum severity,
+                                                    GLsizei length,
+                                                    GLchar const* message,
+                                                    void const* userParam )
+{
+	length;
+
+	std::ostream *outStream = (std::ostream*) userParam;
+
+	*outStream << std::endl;
+	*outStream << "OpenGL Debug Output:" << std::endl;
+	*outStream << "VERSION:  ";
+	GL::PrintVersion(outStream);
+	*outStream << std::endl;
+
+	*outStream << "SOURCE:   ";
+	switch (source) {
+		case GL_DEBUG_SOURCE_API:             *outStream << "API";             break;
+		case GL_DEBUG_SOURCE_WINDOW_SYSTEM:   *outStream << "Window System";   break;
+		case GL_DEBUG_SOURCE_SHADER_COMPILER: *outStream << "Shader Compiler"; break;
+		case GL_DEBUG_SOURCE_THIRD_PARTY:     *outStream << "Third Party";     break;
+		case GL_DEBUG_SOURCE_APPLICATION:     *outStream << "Application";     break;
+		case GL_DEBUG_SOURCE_OTHER:           *outStream << "Other";           break;
+		default:                              *outStream << "Unknown";         break;
+	}
+	*outStream << std::endl;
+
+	*outStream << "TYPE:     ";
 	switch (type) {
 		case GL_DEBUG_TYPE_ERROR:               *outStream << "Error";               break;
 		case GL_DEBUG_TYPE_DEPRECATED_BEHAVIOR: *outStream << "Deprecated Behavior"; break;
@@ -1492,397 +2567,1474 @@ inline void _CY_APIENTRY GLDebugCallback::Callback( GLenum source,
 		case GL_DEBUG_TYPE_OTHER:               *outStream << "Other";               break;
 		default:                                *outStream << "Unknown";             break;
 	}
-	*outStream << std::endl;
+	*outStream << std::endl;
+
+	*outStream << "ID:       " << id << std::endl;
+
+	*outStream << "SEVERITY: ";
+	switch (severity) {
+		case GL_DEBUG_SEVERITY_HIGH:         *outStream << "High";         break;
+		case GL_DEBUG_SEVERITY_MEDIUM:       *outStream << "Medium";       break;
+		case GL_DEBUG_SEVERITY_LOW:          *outStream << "Low";          break;
+		case GL_DEBUG_SEVERITY_NOTIFICATION: *outStream << "Notification"; break;
+		default:                             *outStream << "Unknown";      break;
+	}
+	*outStream << std::endl;
+
+	*outStream << "MESSAGE:  ";
+	*outStream << message << std::endl;
+
+	// You can set a breakpoint at the following line. Your debugger will stop the execution,
+	// and the call stack will show the OpenGL call causing this callback.
+	*outStream << std::endl;
+}
+
+#endif
+//-------------------------------------------------------------------------------
+// GLState Implementation
+//-------------------------------------------------------------------------------
+
+inline GLState::State::State()
+	: program(CY_GL_INVALID_ID), vertexArray(CY_GL_INVALID_ID), drawFramebuffer(CY_GL_INVALID_ID), readFramebuffer(CY_GL_INVALID_ID)
+	, activeUnit(-1), depthMask(-1), depthFunc(CY_GL_INVALID_ID), cullFace(CY_GL_INVALID_ID), frontFace(CY_GL_INVALID_ID), elided(0), issued(0)
+{
+	for ( int i=0; i<NUM_TEXTURE_UNITS; i++ ) { textures[i].target = CY_GL_INVALID_ID; textures[i].texture = CY_GL_INVALID_ID; }
+	for ( int i=0; i<4; i++ ) viewport[i] = -1;
+	for ( int i=0; i<NUM_CAPABILITIES; i++ ) capabilities[i] = -1;
+}
+
+inline void GLState::Invalidate()
+{
+	State &s = Current();
+	size_t elided = s.elided, issued = s.issued;
+	s = State();
+	s.elided = elided;
+	s.issued = issued;
+}
+
+inline void GLState::UseProgram( GLuint program )
+{
+	State &s = Current();
+	if ( Skip( s.program == program ) ) return;
+	glUseProgram( program );
+	s.program = program;
+}
+
+inline void GLState::ActiveTexture( int textureUnit )
+{
+	State &s = Current();
+	if ( Skip( s.activeUnit == textureUnit ) ) return;
+	glActiveTexture( GL_TEXTURE0 + textureUnit );
+	s.activeUnit = textureUnit;
+}
+
+inline void GLState::BindTexture( GLenum target, GLuint texture )
+{
+	State &s = Current();
+	int unit = s.activeUnit;
+	if ( unit >= 0 && unit < NUM_TEXTURE_UNITS ) {
+		TextureBinding &b = s.textures[unit];
+		if ( Skip( b.target == target && b.texture == texture ) ) return;
+		glBindTexture( target, texture );
+		b.target  = target;
+		b.texture = texture;
+	} else {
+		Skip( false );
+		glBindTexture( target, texture );
+		// The texture went to an unknown unit, which can be any of the cached ones.
+		if ( unit < 0 ) for ( int i=0; i<NUM_TEXTURE_UNITS; i++ ) s.textures[i].texture = CY_GL_INVALID_ID;
+	}
+}
+
+inline void GLState::BindTexture( int textureUnit, GLenum target, GLuint texture )
+{
+	// The unit is made active even if the texture is already bound, since the
+	// non-DSA texture methods that follow a bind operate on the active unit.
+	ActiveTexture( textureUnit );
+	BindTexture( target, texture );
+}
+
+inline void GLState::DeleteTexture( GLuint texture )
+{
+	State &s = Current();
+	for ( int i=0; i<NUM_TEXTURE_UNITS; i++ ) if ( s.textures[i].texture == texture ) s.textures[i].texture = CY_GL_INVALID_ID;
+}
+
+#ifdef GL_VERSION_3_0
+
+inline void GLState::BindVertexArray( GLuint vertexArray )
+{
+	State &s = Current();
+	if ( Skip( s.vertexArray == vertexArray ) ) return;
+	glBindVertexArray( vertexArray );
+	s.vertexArray = vertexArray;
+}
+
+inline void GLState::BindFramebuffer( GLenum target, GLuint framebuffer )
+{
+	State &s = Current();
+	bool draw = target != GL_READ_FRAMEBUFFER;
+	bool read = target != GL_DRAW_FRAMEBUFFER;
+	if ( Skip( ( ! draw || s.drawFramebuffer == framebuffer ) && ( ! read || s.readFramebuffer == framebuffer ) ) ) return;
+	glBindFramebuffer( target, framebuffer );
+	if ( draw ) s.drawFramebuffer = framebuffer;
+	if ( read ) s.readFramebuffer = framebuffer;
+}
+
+inline void GLState::DeleteFramebuffer( GLuint framebuffer )
+{
+	State &s = Current();
+	if ( s.drawFramebuffer == framebuffer ) s.drawFramebuffer = CY_GL_INVALID_ID;
+	if ( s.readFramebuffer == framebuffer ) s.readFramebuffer = CY_GL_INVALID_ID;
+}
+
+#endif
+
+inline void GLState::Viewport( GLint x, GLint y, GLsizei width, GLsizei height )
+{
+	GLint *v = Current().viewport;
+	if ( Skip( v[0] == x && v[1] == y && v[2] == width && v[3] == height ) ) return;
+	glViewport( x, y, width, height );
+	v[0] = x;
+	v[1] = y;
+	v[2] = width;
+	v[3] = height;
+}
+
+inline int GLState::CapabilityIndex( GLenum capability )
+{
+	switch ( capability ) {
+		case GL_DEPTH_TEST:   return 0;
+		case GL_CULL_FACE:    return 1;
+		case GL_BLEND:        return 2;
+		case GL_STENCIL_TEST: return 3;
+		case GL_SCISSOR_TEST: return 4;
+		default:              return -1;
+	}
+}
+
+inline void GLState::SetEnabled( GLenum capability, bool enable )
+{
+	int i = CapabilityIndex( capability );
+	if ( i >= 0 ) {
+		signed char &c = Current().capabilities[i];
+		if ( Skip( c == (enable ? 1 : 0) ) ) return;
+		c = enable ? 1 : 0;
+	} else Skip( false );
+	if ( enable ) glEnable( capability );
+	else glDisable( capability );
+}
+
+inline void GLState::DepthMask( bool write )
+{
+	signed char &m = Current().depthMask;
+	if ( Skip( m == (write ? 1 : 0) ) ) return;
+	glDepthMask( write ? GL_TRUE : GL_FALSE );
+	m = write ? 1 : 0;
+}
+
+inline void GLState::DepthFunc( GLenum func )
+{
+	GLenum &f = Current().depthFunc;
+	if ( Skip( f == func ) ) return;
+	glDepthFunc( func );
+	f = func;
+}
+
+inline void GLState::CullFace( GLenum mode )
+{
+	GLenum &m = Current().cullFace;
+	if ( Skip( m == mode ) ) return;
+	glCullFace( mode );
+	m = mode;
+}
+
+inline void GLState::FrontFace( GLenum mode )
+{
+	GLenum &m = Current().frontFace;
+	if ( Skip( m == mode ) ) return;
+	glFrontFace( mode );
+	m = mode;
+}
+
+//-------------------------------------------------------------------------------
+// GLTexture Implementation
+//-------------------------------------------------------------------------------
+
+template <GLenum TEXTURE_TYPE>
+inline void GLTexture<TEXTURE_TYPE>::Initialize()
+{
+	if ( textureID == CY_GL_INVALID_ID ) glGenTextures(1,&textureID);
+	Bind();
+	glTexParameteri(TEXTURE_TYPE, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+	glTexParameteri(TEXTURE_TYPE, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+}
+
+template <GLenum TEXTURE_TYPE>
+void GLTexture<TEXTURE_TYPE>::SetFilteringMode(GLenum magnificationFilter, GLenum minificationFilter)
+{
+	Bind();
+	if ( magnificationFilter != 0 ) glTexParameteri(TEXTURE_TYPE, GL_TEXTURE_MAG_FILTER, magnificationFilter);
+	if ( minificationFilter  != 0 ) glTexParameteri(TEXTURE_TYPE, GL_TEXTURE_MIN_FILTER, minificationFilter);
+}
+
+//-------------------------------------------------------------------------------
+// GLRenderBuffer Implementation
+//-------------------------------------------------------------------------------
+#ifdef _CY_GLRenderBuffer
+
+template <GLenum TEXTURE_TYPE>
+inline void GLRenderBuffer<TEXTURE_TYPE>::Delete()
+{
+	if ( framebufferID != CY_GL_INVALID_ID ) { GLState::DeleteFramebuffer(framebufferID); glDeleteFramebuffers(1,&framebufferID); }
+	if ( depthbufferID != CY_GL_INVALID_ID ) glDeleteRenderbuffers(1,&depthbufferID);
+	framebufferID = CY_GL_INVALID_ID;
+	depthbufferID = CY_GL_INVALID_ID;
+	texture.Delete();
+}
+
+template <GLenum TEXTURE_TYPE>
+inline void GLRenderBuffer<TEXTURE_TYPE>::Bind() const
+{
+	glGetIntegerv(GL_VIEWPORT, prevViewport);
+	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prevBufferID);
+	GLState::BindFramebuffer(GL_DRAW_FRAMEBUFFER, framebufferID);
+	GLState::Viewport(0,0,bufferWidth,bufferHeight);
+}
+
+template <GLenum TEXTURE_TYPE>
+inline void GLRenderBuffer<TEXTURE_TYPE>::Unbind() const
+{
+	GLState::BindFramebuffer(GL_DRAW_FRAMEBUFFER, prevBufferID);
+	GLState::Viewport(prevViewport[0],prevViewport[1],prevViewport[2],prevViewport[3]);
+}
+
+template <GLenum TEXTURE_TYPE>
+inline bool GLRenderBuffer<TEXTURE_TYPE>::IsComplete() const
+{
+	GLint prevbuffer;
+	glGetIntegerv(GL_FRAMEBUFFER_BINDING,&prevbuffer);
+	GLState::BindFramebuffer(GL_FRAMEBUFFER,framebufferID);
+	bool complete = (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
+	GLState::BindFramebuffer(GL_FRAMEBUFFER,prevbuffer);
+	return complete;  
+}
+
+template <GLenum TEXTURE_TYPE>
+inline void GLRenderBuffer<TEXTURE_TYPE>::GenerateBuffer()
+{
+	GLRenderBuffer<TEXTURE_TYPE>::Delete();
+	glGenFramebuffers(1, &framebufferID);
+	GLState::BindFramebuffer(GL_FRAMEBUFFER, framebufferID);
+	texture.Initialize();
+	texture.SetFilteringMode(GL_NEAREST,GL_NEAREST);
+	texture.SetWrappingMode(GL_CLAMP_TO_EDGE,GL_CLAMP_TO_EDGE);
+}
+
+template <GLenum TEXTURE_TYPE>
+inline bool GLRenderTexture<TEXTURE_TYPE>::Initialize( bool useDepthBuffer )
+{
+	GLint prevBuffer;
+	glGetIntegerv( GL_FRAMEBUFFER_BINDING, &prevBuffer );
+	GLRenderBuffer<TEXTURE_TYPE>::GenerateBuffer();
+	if ( useDepthBuffer ) {
+		glGenRenderbuffers(1, &this->depthbufferID);
+		glBindRenderbuffer(GL_RENDERBUFFER, this->depthbufferID);
+		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, this->depthbufferID);
+	}
+	if ( TEXTURE_TYPE != GL_TEXTURE_CUBE_MAP ) {
+		glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GLRenderBuffer<TEXTURE_TYPE>::GetTextureID(), 0);
+	}
+	glDrawBuffer(GL_COLOR_ATTACHMENT0);
+	GLState::BindFramebuffer(GL_FRAMEBUFFER, prevBuffer);
+	return GLRenderBuffer<TEXTURE_TYPE>::IsReady();
+}
+
+template <GLenum TEXTURE_TYPE>
+inline bool GLRenderTexture<TEXTURE_TYPE>::Resize( int numChannels, GLsizei width, GLsizei height, GL::Type type )
+{
+	GLenum textureFormat = GL::TextureFormat(type,numChannels);
+	if ( TEXTURE_TYPE == GL_TEXTURE_CUBE_MAP ) {
+		for ( int i=0; i<6; ++i ) {
+			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X+i,0,textureFormat,width,height,0,GL_RGBA,GL_UNSIGNED_BYTE,nullptr);
+		}
+	} else {
+		this->texture.SetImage(textureFormat,GL_RGBA,GL_UNSIGNED_BYTE,nullptr,width,height);
+	}
+	if ( this->depthbufferID != CY_GL_INVALID_ID ) {
+		glBindRenderbuffer(GL_RENDERBUFFER, this->depthbufferID);
+		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, width, height);
+	}
+	GLRenderBuffer<TEXTURE_TYPE>::SetSize(width,height);
+	return GLRenderBuffer<TEXTURE_TYPE>::IsComplete();
+}
+
+template <GLenum TEXTURE_TYPE>
+inline bool GLRenderDepth<TEXTURE_TYPE>::Initialize( bool depthComparisonTexture )
+{
+	GLint prevBuffer;
+	glGetIntegerv( GL_FRAMEBUFFER_BINDING, &prevBuffer );
+	GLRenderBuffer<TEXTURE_TYPE>::GenerateBuffer();
+	if ( depthComparisonTexture ) {
+		glTexParameteri(TEXTURE_TYPE, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+		glTexParameteri(TEXTURE_TYPE, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+	}
+	if ( TEXTURE_TYPE != GL_TEXTURE_CUBE_MAP ) {
+		glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GLRenderBuffer<TEXTURE_TYPE>::GetTextureID(), 0);
+	}
+	glDrawBuffer(GL_NONE);
+	glReadBuffer(GL_NONE);
+	GLState::BindFramebuffer(GL_FRAMEBUFFER, prevBuffer);
+	return GLRenderBuffer<TEXTURE_TYPE>::IsReady();
+}
+
+template <GLenum TEXTURE_TYPE>
+inline bool GLRenderDepth<TEXTURE_TYPE>::Resize( GLsizei width, GLsizei height, GLenum depthFormat )
+{
+	if ( TEXTURE_TYPE == GL_TEXTURE_CUBE_MAP ) {
+		for ( int i=0; i<6; ++i ) {
+			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X+i,0,depthFormat,width,height,0,GL_DEPTH_COMPONENT,GL_FLOAT,nullptr);
+		}
+	} else {
+		this->texture.SetImage(depthFormat,GL_DEPTH_COMPONENT,GL_FLOAT,nullptr,width,height);
+	}
+	GLRenderBuffer<TEXTURE_TYPE>::SetSize(width,height);
+	return GLRenderBuffer<TEXTURE_TYPE>::IsComplete();
+}
+
+#endif
+//-------------------------------------------------------------------------------
+// GLSLShader Implementation
+//-------------------------------------------------------------------------------
+
+inline bool GLSLShader::Source::LoadFile( char const *filename, std::ostream *outStream )
+{
+	std::ifstream shaderStream(filename, std::ios::in);
+	if( ! shaderStream.is_open() ) {
+		if ( outStream ) *outStream << "ERROR: Cannot open file \"" << filename << "\"" << std::endl;
+		return false;
+	}
+	assign( (std::istreambuf_iterator<char>(shaderStream)), std::istreambuf_iterator<char>() );
+	shaderStream.close();
+	return true;
+}
+
+inline bool GLSLShader::Source::ParseIncludesFile( std::vector<std::string> &sources, char const *filename, std::string const &includePath, std::ostream *outStream )
+{
+	Source source;
+	if ( source.LoadFile( filename, outStream ) ) return source.ParseIncludes( sources, source.data(), includePath, outStream );
+	else return false;
+}
+
+inline bool GLSLShader::Source::ParseIncludes( std::vector<std::string> &sources, char const *sourceString, std::string const &includePath, std::ostream *outStream )
+{
+	std::regex includeRegex(R"(\#include\s+\"([^\"]+)\")");
+	std::smatch matches;
+	std::string remainingSource = sourceString;
+	size_t lastIndex = 0;
+
+	while ( std::regex_search(remainingSource, matches, includeRegex) ) {
+		sources.push_back( remainingSource.substr(0, matches.position()) );
+		std::string includeFileName = includePath;
+		includeFileName += matches[1];
+		if ( ! ParseIncludesFile( sources, includeFileName.data(), includePath, outStream ) ) return false;
+		lastIndex = matches.position() + matches.length();
+		remainingSource = remainingSource.substr(lastIndex);
+	}
+
+	if (!remainingSource.empty()) {
+		sources.push_back(remainingSource);
+	}
+
+	return true;
+}
+
+template <bool file, bool parse>
+inline bool GLSLShader::LoadSource( std::string &sourceCode, char const *shaderSource, std::ostream *outStream )
+{
+	Source source;
+	char const *shaderSourceCode = shaderSource;
+	std::string includePath = "";
+	if ( file ) {
+		if ( ! source.LoadFile(shaderSource,outStream) ) return false;
+		shaderSourceCode = source.data();
+		if ( parse ) {
+			includePath = shaderSource;
+			size_t pos = includePath.find_last_of("/\\");
+			includePath.erase( pos+1 );
+		}
+	}
+	if ( parse ) {
+		std::vector<std::string> sources;
+		if ( ! Source::ParseIncludes( sources, shaderSourceCode, includePath, outStream ) ) return false;
+		sourceCode.clear();
+		for ( std::string const &s : sources ) sourceCode += s;
+	} else if ( file ) {
+		sourceCode.swap( source );
+	} else {
+		sourceCode = shaderSourceCode;
+	}
+	return true;
+}
+
+template <bool file, bool parse>
+inline bool GLSLShader::Compile( char const *shaderSource, GLenum shaderType, int prependSourceCount, char const **prependSources, std::ostream *outStream )
+{
+	std::string source;
+	char const *shaderSourceCode = shaderSource;
+	if ( file || parse ) {
+		if ( ! LoadSource<file,parse>( source, shaderSource, outStream ) ) return false;
+		shaderSourceCode = source.data();
+	}
+
+	std::vector<char const*> pSources;
+
+	char const **sourceData = &shaderSourceCode;
+	GLsizei sourceDataCount = 1;
+	if ( prependSourceCount > 0 ) {
+		sourceDataCount = prependSourceCount + 1;
+		pSources.resize( sourceDataCount );
+		for ( int i=0; i<prependSourceCount; i++ ) pSources[i] = prependSources[i];
+		pSources[prependSourceCount] = shaderSourceCode;
+		sourceData = pSources.data();
+	}
+
+	Delete();
+	shaderID = glCreateShader( shaderType );
+	glShaderSource(shaderID, sourceDataCount, sourceData, nullptr);
+	glCompileShader(shaderID);
 
-	*outStream << "ID:       " << id << std::endl;
+	bool result = CheckCompileStatus( shaderID, outStream );
 
-	*outStream << "SEVERITY: ";
-	switch (severity) {
-		case GL_DEBUG_SEVERITY_HIGH:         *outStream << "High";         break;
-		case GL_DEBUG_SEVERITY_MEDIUM:       *outStream << "Medium";       break;
-		case GL_DEBUG_SEVERITY_LOW:          *outStream << "Low";          break;
-		case GL_DEBUG_SEVERITY_NOTIFICATION: *outStream << "Notification"; break;
-		default:                             *outStream << "Unknown";      break;
+	if ( result ) {
+		GLint stype;
+		glGetShaderiv(shaderID, GL_SHADER_TYPE, &stype);
+		if ( stype != (GLint)shaderType ) {
+			if ( outStream ) *outStream << "ERROR: Incorrect shader type." << std::endl;
+			return false;
+		}
 	}
-	*outStream << std::endl;
 
-	*outStream << "MESSAGE:  ";
-	*outStream << message << std::endl;
+	return result;
+}
 
-	// You can set a breakpoint at the following line. Your debugger will stop the execution,
-	// and the call stack will show the OpenGL call causing this callback.
-	*outStream << std::endl;
+inline bool GLSLShader::CheckCompileStatus( GLuint shaderID, std::ostream *outStream )
+{
+	GLint result = GL_FALSE;
+	glGetShaderiv(shaderID, GL_COMPILE_STATUS, &result);
+
+	int infoLogLength;
+	glGetShaderiv(shaderID, GL_INFO_LOG_LENGTH, &infoLogLength);
+	if ( infoLogLength > 1 ) {
+		std::vector<char> compilerMessage(infoLogLength);
+		glGetShaderInfoLog( shaderID, infoLogLength, nullptr, compilerMessage.data() );
+		if ( outStream ) {
+			if ( !result ) *outStream << "ERROR: Cannot compile shader." << std::endl;
+			*outStream << "OpenGL Version: ";
+			GL::PrintVersion(outStream);
+			*outStream << std::endl;
+			*outStream << compilerMessage.data() << std::endl;
+		}
+	}
+	return result == GL_TRUE;
 }
 
-#endif
 //-------------------------------------------------------------------------------
-// GLTexture Implementation
+// GLSLProgram Implementation
 //-------------------------------------------------------------------------------
 
-template <GLenum TEXTURE_TYPE>
-inline void GLTexture<TEXTURE_TYPE>::Initialize()
+inline bool GLSLProgram::Link( std::ostream *outStream )
 {
-	if ( textureID == CY_GL_INVALID_ID ) glGenTextures(1,&textureID);
-	glBindTexture(TEXTURE_TYPE, textureID);
-	glTexParameteri(TEXTURE_TYPE, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-	glTexParameteri(TEXTURE_TYPE, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+#ifdef GL_VERSION_4_1
+	if ( ! BinaryCacheDirectory().empty() ) glProgramParameteri( programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
+#endif
+	glLinkProgram(programID);
+	return CheckLinkStatus(outStream);
 }
 
-template <GLenum TEXTURE_TYPE>
-void GLTexture<TEXTURE_TYPE>::SetFilteringMode(GLenum magnificationFilter, GLenum minificationFilter)
+inline bool GLSLProgram::CheckLinkStatus( std::ostream *outStream )
 {
-	Bind();
-	if ( magnificationFilter != 0 ) glTexParameteri(TEXTURE_TYPE, GL_TEXTURE_MAG_FILTER, magnificationFilter);
-	if ( minificationFilter  != 0 ) glTexParameteri(TEXTURE_TYPE, GL_TEXTURE_MIN_FILTER, minificationFilter);
+	GLint result = GL_FALSE;
+	glGetProgramiv(programID, GL_LINK_STATUS, &result);
+
+	int infoLogLength;
+	glGetProgramiv(programID, GL_INFO_LOG_LENGTH, &infoLogLength);
+	if ( infoLogLength > 1 ) {
+		std::vector<char> compilerMessage(infoLogLength);
+		glGetProgramInfoLog( programID, infoLogLength, nullptr, compilerMessage.data() );
+		if ( outStream ) *outStream << "ERROR: " << compilerMessage.data() << std::endl;
+	}
+
+	if ( result == GL_TRUE ) BuildUniformTable();
+	return result == GL_TRUE;
+}
+
+inline void GLSLProgram::BuildUniformTable()
+{
+	uniforms.clear();
+	numUniforms = 0;
+	values.clear();	// linking resets the uniform values
+#ifdef GL_VERSION_4_3
+	GLint numActive = 0, maxNameLength = 0;
+	glGetProgramInterfaceiv( programID, GL_UNIFORM, GL_ACTIVE_RESOURCES, &numActive );
+	glGetProgramInterfaceiv( programID, GL_UNIFORM, GL_MAX_NAME_LENGTH,  &maxNameLength );
+	std::vector<char> name(maxNameLength+1);
+	GLenum const prop = GL_LOCATION;
+	for ( GLint i=0; i<numActive; ++i ) {
+		GLint location = -1;
+		glGetProgramResourceiv( programID, GL_UNIFORM, i, 1, &prop, 1, nullptr, &location );
+		if ( location < 0 ) continue;	// members of uniform blocks have no location
+		GLsizei length = 0;
+		glGetProgramResourceName( programID, GL_UNIFORM, i, (GLsizei)name.size(), &length, name.data() );
+		AddUniformEntry( name.data(), HashName(name.data()), location );
+		// Arrays are listed as "name[0]", but they are usually set using their names only
+		if ( length > 3 && strcmp( name.data()+length-3, "[0]" ) == 0 ) {
+			name[length-3] = '\0';
+			AddUniformEntry( name.data(), HashName(name.data()), location );
+		}
+	}
+#endif
+}
+
+inline void GLSLProgram::AddUniformEntry( char const *name, GLuint hash, GLint location )
+{
+	if ( 2*(numUniforms+1) > uniforms.size() ) {
+		// keep the table at most half full, so that the probe sequences stay short
+		std::vector<UniformEntry> oldTable( uniforms.size() < 16 ? 16 : 2*uniforms.size() );
+		oldTable.swap(uniforms);
+		numUniforms = 0;
+		for ( UniformEntry &e : oldTable ) if ( ! e.name.empty() ) AddUniformEntry( e.name.c_str(), e.hash, e.location );
+	}
+	GLuint mask = (GLuint)uniforms.size() - 1;
+	GLuint i = hash & mask;
+	while ( ! uniforms[i].name.empty() ) {
+		if ( uniforms[i].hash == hash && uniforms[i].name == name ) { uniforms[i].location = location; return; }
+		i = (i+1) & mask;
+	}
+	uniforms[i].name     = name;
+	uniforms[i].hash     = hash;
+	uniforms[i].location = location;
+	numUniforms++;
+}
+
+inline bool GLSLProgram::IsNewValue( GLint location, void const *data, size_t size, GLsizei count, GLboolean transpose )
+{
+	if ( location < 0 ) return true;
+	if ( count != 1 || transpose ) {
+		for ( GLint i=location; i<location+count && i<(GLint)values.size(); ++i ) values[i].clear();
+		return true;
+	}
+	if ( (size_t)location >= values.size() ) values.resize(location+1);
+	std::vector<char> &v = values[location];
+	if ( v.size() == size && memcmp( v.data(), data, size ) == 0 ) {
+		ElidedCount()++;
+		return false;
+	}
+	v.assign( (char const*)data, (char const*)data + size );
+	return true;
+}
+
+inline GLint GLSLProgram::GetUniformLocation( char const *name )
+{
+	GLuint hash = HashName(name);
+	if ( ! uniforms.empty() ) {
+		GLuint mask = (GLuint)uniforms.size() - 1;
+		for ( GLuint i = hash & mask; ! uniforms[i].name.empty(); i = (i+1) & mask ) {
+			if ( uniforms[i].hash == hash && uniforms[i].name == name ) return uniforms[i].location;
+		}
+	}
+	// Not an active uniform name (possibly an array element or an inactive uniform), so query it once
+	GLint location = glGetUniformLocation( programID, name );
+	AddUniformEntry( name, hash, location );
+	return location;
+}
+
+inline bool GLSLProgram::Build( GLSLShader const *vertexShader, 
+                                GLSLShader const *fragmentShader,
+	                            GLSLShader const *geometryShader,
+	                            GLSLShader const *tessControlShader,
+	                            GLSLShader const *tessEvaluationShader,
+	                            std::ostream *outStream )
+{
+	CreateProgram();
+	std::stringstream output;
+	AttachShader(*vertexShader);
+	AttachShader(*fragmentShader);
+	if ( geometryShader ) AttachShader(*geometryShader);
+	if ( tessControlShader ) AttachShader(*tessControlShader);
+	if ( tessEvaluationShader ) AttachShader(*tessEvaluationShader);
+	return Link(outStream);
+}
+
+template <bool files, bool parse>
+inline bool GLSLProgram::Build( char const *vertexShader, 
+                                char const *fragmentShader,
+	                            char const *geometryShader,
+	                            char const *tessControlShader,
+	                            char const *tessEvaluationShader,
+	                            int         prependSourceCount,
+	                            char const **prependSource,
+	                            std::ostream *outStream )
+{
+	return BuildAsync<files,parse>(vertexShader,fragmentShader,geometryShader,tessControlShader,tessEvaluationShader,prependSourceCount,prependSource,outStream) && Finish(outStream);
+}
+
+template <bool files, bool parse>
+inline bool GLSLProgram::Submit( char const * const *shaders, int prependSourceCount, char const **prependSource, std::ostream *outStream )
+{
+	Delete();
+	std::string sources[5];
+	for ( int i=0; i<5; ++i ) {
+		if ( ! shaders[i] ) continue;
+		std::stringstream shaderOutput;
+		if ( ! GLSLShader::LoadSource<files,parse>( sources[i], shaders[i], &shaderOutput ) ) {
+			if ( outStream ) {
+				*outStream << "ERROR: Failed compiling " << ShaderStageName(i);
+				if ( files ) *outStream << " \"" << shaders[i] << "\"";
+				*outStream << std::endl << shaderOutput.str();
+			}
+			return false;
+		}
+	}
+
+#ifdef GL_VERSION_4_1
+	std::string binaryFile = BinaryCacheFile( sources, prependSourceCount, prependSource );
+	if ( ! binaryFile.empty() && LoadBinary( binaryFile ) ) return true;
+#endif
+
+	CreateProgram();
+	std::vector<char const*> pSources( prependSourceCount + 1 );
+	for ( int i=0; i<prependSourceCount; i++ ) pSources[i] = prependSource[i];
+	for ( int i=0; i<5; ++i ) {
+		if ( ! shaders[i] ) continue;
+		PendingShader shader;
+		shader.shaderID = glCreateShader( ShaderStageType(i) );
+		shader.stage    = i;
+		if ( files ) shader.name = shaders[i];
+		pSources[prependSourceCount] = sources[i].data();
+		glShaderSource( shader.shaderID, GLsizei(pSources.size()), pSources.data(), nullptr );
+		glCompileShader( shader.shaderID );
+		AttachShader( shader.shaderID );
+		pendingShaders.push_back( shader );
+	}
+#ifdef GL_VERSION_4_1
+	pendingBinaryFile = binaryFile;
+	if ( ! binaryFile.empty() ) glProgramParameteri( programID, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE );
+#endif
+	glLinkProgram( programID );	// linking waits for the compilation only when the link status is queried
+	PendingPrograms().push_back( this );
+	return true;
+}
+
+inline bool GLSLProgram::IsReady() const
+{
+	if ( pendingShaders.empty() ) return true;
+#ifdef GL_KHR_parallel_shader_compile
+	if ( ParallelCompileSupported() ) {
+		GLint completed = GL_FALSE;
+		glGetProgramiv( programID, GL_COMPLETION_STATUS_KHR, &completed );
+		return completed == GL_TRUE;
+	}
+#endif
+	return true;
+}
+
+inline bool GLSLProgram::Finish( std::ostream *outStream )
+{
+	if ( pendingShaders.empty() ) return ! IsNull();
+	RemovePending();
+
+	bool result = true;
+	for ( PendingShader const &shader : pendingShaders ) {
+		if ( result ) {
+			std::stringstream shaderOutput;
+			if ( ! GLSLShader::CheckCompileStatus( shader.shaderID, &shaderOutput ) ) {
+				if ( outStream ) {
+					*outStream << "ERROR: Failed compiling " << ShaderStageName(shader.stage);
+					if ( ! shader.name.empty() ) *outStream << " \"" << shader.name << "\"";
+					*outStream << std::endl << shaderOutput.str();
+				}
+				result = false;
+			}
+		}
+		glDeleteShader( shader.shaderID );	// attached shaders are released with the program
+	}
+	pendingShaders.clear();
+
+	if ( result ) result = CheckLinkStatus( outStream );
+#ifdef GL_VERSION_4_1
+	if ( result && ! pendingBinaryFile.empty() ) SaveBinary( pendingBinaryFile );
+#endif
+	pendingBinaryFile.clear();
+	return result;
+}
+
+#ifdef GL_VERSION_4_1
+
+inline std::string GLSLProgram::BinaryCacheFile( std::string const *sources, int prependSourceCount, char const **prependSource )
+{
+	if ( BinaryCacheDirectory().empty() ) return std::string();
+	GLint numBinaryFormats = 0;
+	glGetIntegerv( GL_NUM_PROGRAM_BINARY_FORMATS, &numBinaryFormats );
+	if ( numBinaryFormats <= 0 ) return std::string();
+
+	// The program binary depends on the complete sources and the driver, so all of them are included in the hash (64-bit FNV-1a).
+	uint64_t hash = 14695981039346656037ull;
+	auto hashString = [&hash]( char const *str ) { do { hash = ( hash ^ uint8_t(*str) ) * 1099511628211ull; } while ( *str++ ); };
+	GLenum const driverStrings[] = { GL_VENDOR, GL_RENDERER, GL_VERSION };
+	for ( GLenum d : driverStrings ) { char const *str = (char const *) glGetString(d); hashString( str ? str : "" ); }
+	for ( int i=0; i<prependSourceCount; ++i ) hashString( prependSource[i] );
+	for ( int i=0; i<5; ++i ) hashString( sources[i].c_str() );
+
+	char hashStr[17];
+	snprintf( hashStr, sizeof(hashStr), "%016llx", (unsigned long long) hash );
+	return ( std::filesystem::path( BinaryCacheDirectory() ) / ( std::string(hashStr) + ".bin" ) ).string();
+}
+
+#endif
+
+#ifdef GL_VERSION_4_1
+
+inline bool GLSLProgram::LoadBinary( std::string const &filename )
+{
+	std::ifstream file( filename, std::ios::in | std::ios::binary );
+	if ( ! file.is_open() ) return false;
+	std::vector<char> data( (std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>() );
+	file.close();
+
+	// The file begins with a 4-character tag and the binary format, followed by the program binary.
+	size_t const headerSize = 4 + sizeof(GLenum);
+	if ( data.size() <= headerSize || memcmp( data.data(), "CYPB", 4 ) != 0 ) return false;
+	GLenum format;
+	memcpy( &format, data.data() + 4, sizeof(GLenum) );
+
+	CreateProgram();
+	glProgramBinary( programID, format, data.data() + headerSize, GLsizei( data.size() - headerSize ) );
+	GLint result = GL_FALSE;
+	glGetProgramiv( programID, GL_LINK_STATUS, &result );
+	if ( result != GL_TRUE ) {
+		while ( glGetError() != GL_NO_ERROR ) {}	// an unsupported binary format is reported as an error
+		Delete();
+		return false;
+	}
+	BuildUniformTable();
+	fromBinaryCache = true;
+	return true;
+}
+
+inline void GLSLProgram::SaveBinary( std::string const &filename ) const
+{
+	GLint length = 0;
+	glGetProgramiv( programID, GL_PROGRAM_BINARY_LENGTH, &length );
+	if ( length <= 0 ) return;
+	size_t const headerSize = 4 + sizeof(GLenum);
+	std::vector<char> data( headerSize + length );
+	GLenum format = 0;
+	glGetProgramBinary( programID, length, &length, &format, data.data() + headerSize );
+	memcpy( data.data(), "CYPB", 4 );
+	memcpy( data.data() + 4, &format, sizeof(GLenum) );
+
+	// Write to a temporary file first, so that other processes never read a partially written binary.
+	std::error_code ec;
+	std::filesystem::create_directories( std::filesystem::path(filename).parent_path(), ec );
+	std::string tempname = filename + ".tmp";
+	std::ofstream file( tempname, std::ios::out | std::ios::binary );
+	if ( ! file.is_open() ) return;
+	file.write( data.data(), headerSize + length );
+	file.close();
+	if ( file ) std::filesystem::rename( tempname, filename, ec );
+	else std::filesystem::remove( tempname, ec );
+}
+
+#endif
+
+inline void GLSLProgram::RegisterUniform( unsigned int index, char const *name, std::ostream *outStream )
+{
+	if ( params.size() <= index ) params.resize( index+1, -1 );
+	params[index] = glGetUniformLocation( programID, name );
+	if ( params[index] < 0 ) {
+		GLenum error = glGetError();
+		GLenum newError;
+		while ( (newError = glGetError()) != GL_NO_ERROR ) error = newError; // get the latest error.
+		if ( outStream ) {
+			*outStream << "ERROR: ";
+			switch (error) {
+				case GL_INVALID_VALUE:     *outStream << "GL_INVALID_VALUE.";     break;
+				case GL_INVALID_OPERATION: *outStream << "GL_INVALID_OPERATION."; break;
+			}
+			*outStream << " Parameter \"" << name << "\" could not be registered." << std::endl;
+		}
+	}
+}
+
+inline void GLSLProgram::RegisterUniforms( char const *names, unsigned int startingIndex, std::ostream *outStream )
+{
+	std::stringstream ss(names);
+	unsigned int index = startingIndex;
+	while ( ss.good() ) {
+		std::string name;
+		ss >> name;
+		RegisterUniform( index++, name.c_str(), outStream );
+	}
 }
 
 //-------------------------------------------------------------------------------
-// GLRenderBuffer Implementation
+// GLBlockBuffer Implementation
 //-------------------------------------------------------------------------------
-#ifdef _CY_GLRenderBuffer
+#ifdef GL_VERSION_4_5
 
-template <GLenum TEXTURE_TYPE>
-inline void GLRenderBuffer<TEXTURE_TYPE>::Delete()
+template <GLenum BUFFER_TYPE>
+inline void GLBlockBuffer<BUFFER_TYPE>::Initialize( GLsizeiptr size, int count, int regions )
 {
-	if ( framebufferID != CY_GL_INVALID_ID ) glDeleteFramebuffers (1,&framebufferID); framebufferID = CY_GL_INVALID_ID; 
-	if ( depthbufferID != CY_GL_INVALID_ID ) glDeleteRenderbuffers(1,&depthbufferID); depthbufferID = CY_GL_INVALID_ID; 
-	texture.Delete();
+	blockSize   = size;
+	blockStride = GLBlockRoundUp( blockSize, GLBuffer<BUFFER_TYPE>::GetOffsetAlignment() );
+	numBlocks   = count   > 0 ? count   : 1;
+	numRegions  = regions > 0 ? regions : 1;
+	region      = 0;
+	blocks.assign( numBlocks*blockStride, 0 );
+	buffer.Initialize( numRegions*RegionSize() );
 }
 
-template <GLenum TEXTURE_TYPE>
-inline void GLRenderBuffer<TEXTURE_TYPE>::Bind() const
+#endif
+//-------------------------------------------------------------------------------
+// GLStreamBuffer Implementation
+//-------------------------------------------------------------------------------
+#ifdef GL_VERSION_4_5
+
+inline void GLStreamBuffer::Delete()
 {
-	glGetIntegerv(GL_VIEWPORT, prevViewport);
-	glGetIntegerv(GL_DRAW_FRAMEBUFFER_BINDING, &prevBufferID);
-	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, framebufferID);
-	glViewport(0,0,bufferWidth,bufferHeight);
+	for ( GLsync &fence : fences ) if ( fence ) glDeleteSync( fence );
+	fences.clear();
+	if ( bufferID != CY_GL_INVALID_ID ) {
+		if ( mappedData ) glUnmapNamedBuffer( bufferID );
+		glDeleteBuffers( 1, &bufferID );
+	}
+	bufferID   = CY_GL_INVALID_ID;
+	mappedData = nullptr;
+	regionSize = 0;
+	numRegions = 0;
+	regionUsed = 0;
 }
 
-template <GLenum TEXTURE_TYPE>
-inline void GLRenderBuffer<TEXTURE_TYPE>::Unbind() const
+inline void GLStreamBuffer::Initialize( GLsizeiptr size, int regions )
 {
-	glBindFramebuffer(GL_DRAW_FRAMEBUFFER, prevBufferID);
-	glViewport(prevViewport[0],prevViewport[1],prevViewport[2],prevViewport[3]);
+	Delete();
+	regionSize = GLBlockRoundUp( size, 256 );	// keeps the regions aligned for any binding offset alignment
+	numRegions = regions > 0 ? regions : 1;
+	region     = numRegions - 1;				// the first BeginFrame moves to region zero
+	stallCount = 0;
+	fences.resize( numRegions, nullptr );
+	GLbitfield const flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glCreateBuffers( 1, &bufferID );
+	glNamedBufferStorage( bufferID, numRegions*regionSize, nullptr, flags );
+	mappedData = (char*) glMapNamedBufferRange( bufferID, 0, numRegions*regionSize, flags );
 }
 
-template <GLenum TEXTURE_TYPE>
-inline bool GLRenderBuffer<TEXTURE_TYPE>::IsComplete() const
+inline void GLStreamBuffer::BeginFrame()
 {
-	GLint prevbuffer;
-	glGetIntegerv(GL_FRAMEBUFFER_BINDING,&prevbuffer);
-	glBindFramebuffer(GL_FRAMEBUFFER,framebufferID);
-	bool complete = (glCheckFramebufferStatus(GL_FRAMEBUFFER) == GL_FRAMEBUFFER_COMPLETE);
-	glBindFramebuffer(GL_FRAMEBUFFER,prevbuffer);
-	return complete;  
+	region = ( region + 1 ) % numRegions;
+	regionUsed = 0;
+	GLsync &fence = fences[region];
+	if ( ! fence ) return;
+	GLenum result = glClientWaitSync( fence, 0, 0 );
+	if ( result == GL_TIMEOUT_EXPIRED ) {
+		stallCount++;
+		do { result = glClientWaitSync( fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000 ); } while ( result == GL_TIMEOUT_EXPIRED );
+	}
+	glDeleteSync( fence );
+	fence = nullptr;
 }
 
-template <GLenum TEXTURE_TYPE>
-inline void GLRenderBuffer<TEXTURE_TYPE>::GenerateBuffer()
+inline void GLStreamBuffer::EndFrame()
 {
-	GLRenderBuffer<TEXTURE_TYPE>::Delete();
-	glGenFramebuffers(1, &framebufferID);
-	glBindFramebuffer(GL_FRAMEBUFFER, framebufferID);
-	texture.Initialize();
-	texture.SetFilteringMode(GL_NEAREST,GL_NEAREST);
-	texture.SetWrappingMode(GL_CLAMP_TO_EDGE,GL_CLAMP_TO_EDGE);
+	GLsync &fence = fences[region];
+	if ( fence ) glDeleteSync( fence );
+	fence = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
 }
 
-template <GLenum TEXTURE_TYPE>
-inline bool GLRenderTexture<TEXTURE_TYPE>::Initialize( bool useDepthBuffer )
+inline void* GLStreamBuffer::Allocate( GLsizeiptr size, GLsizeiptr alignment, GLintptr &offset )
 {
-	GLint prevBuffer;
-	glGetIntegerv( GL_FRAMEBUFFER_BINDING, &prevBuffer );
-	GLRenderBuffer<TEXTURE_TYPE>::GenerateBuffer();
-	if ( useDepthBuffer ) {
-		glGenRenderbuffers(1, &this->depthbufferID);
-		glBindRenderbuffer(GL_RENDERBUFFER, this->depthbufferID);
-		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, this->depthbufferID);
+	GLsizeiptr start = GLBlockRoundUp( regionUsed, alignment > 0 ? alignment : 1 );
+	if ( ! mappedData || start + size > regionSize ) return nullptr;
+	regionUsed = start + size;
+	offset = region*regionSize + start;
+	return mappedData + offset;
+}
+
+#endif
+//-------------------------------------------------------------------------------
+// GLTextureUploader Implementation
+//-------------------------------------------------------------------------------
+#ifdef GL_VERSION_4_5
+
+inline void GLTextureUploader::Initialize( GLsizeiptr size )
+{
+	Delete();
+	GLbitfield const flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+	glCreateBuffers( 1, &bufferID );
+	glNamedBufferStorage( bufferID, size, nullptr, flags );
+	mappedData = (char*) glMapNamedBufferRange( bufferID, 0, size, flags );
+	bufferSize = size;
+	std::lock_guard<std::mutex> lock(mutex);
+	head   = 0;
+	closed = false;
+}
+
+inline void GLTextureUploader::Delete()
+{
+	Close();
+	std::lock_guard<std::mutex> lock(mutex);
+	for ( Allocation &a : allocations ) if ( a.fence ) glDeleteSync( a.fence );
+	firstTicket += allocations.size();
+	allocations.clear();
+	if ( bufferID != CY_GL_INVALID_ID ) {
+		if ( mappedData ) glUnmapNamedBuffer( bufferID );
+		glDeleteBuffers( 1, &bufferID );
 	}
-	if ( TEXTURE_TYPE != GL_TEXTURE_CUBE_MAP ) {
-		glFramebufferTexture(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GLRenderBuffer<TEXTURE_TYPE>::GetTextureID(), 0);
+	bufferID   = CY_GL_INVALID_ID;
+	mappedData = nullptr;
+	bufferSize = 0;
+}
+
+inline bool GLTextureUploader::FindSpace( GLsizeiptr size, GLsizeiptr &begin ) const
+{
+	GLsizeiptr const alignment = 64;
+	if ( allocations.empty() ) { begin = 0; return size <= bufferSize; }
+	GLsizeiptr tail = allocations.front().begin;
+	begin = GLBlockRoundUp( head, alignment );
+	if ( head > tail ) {
+		// the used memory is between the tail and the head, so try the end of the buffer first, then wrap around
+		if ( begin + size <= bufferSize ) return true;
+		begin = 0;
 	}
-	glDrawBuffer(GL_COLOR_ATTACHMENT0);
-	glBindFramebuffer(GL_FRAMEBUFFER, prevBuffer);
-	return GLRenderBuffer<TEXTURE_TYPE>::IsReady();
+	return begin + size <= tail;
 }
 
-template <GLenum TEXTURE_TYPE>
-inline bool GLRenderTexture<TEXTURE_TYPE>::Resize( int numChannels, GLsizei width, GLsizei height, GL::Type type )
+inline void* GLTextureUploader::Allocate( GLsizeiptr size, Ticket &ticket, bool wait )
 {
-	GLenum textureFormat = GL::TextureFormat(type,numChannels);
-	if ( TEXTURE_TYPE == GL_TEXTURE_CUBE_MAP ) {
-		for ( int i=0; i<6; ++i ) {
-			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X+i,0,textureFormat,width,height,0,GL_RGBA,GL_UNSIGNED_BYTE,nullptr);
+	std::unique_lock<std::mutex> lock(mutex);
+	if ( size < 1 ) size = 1;	// keeps the head and the tail apart
+	if ( size > bufferSize ) return nullptr;
+	for (;;) {
+		if ( closed ) return nullptr;
+		GLsizeiptr begin;
+		if ( FindSpace( size, begin ) ) {
+			allocations.push_back( Allocation{ begin, begin + size, UploadFunc(), nullptr } );
+			head   = begin + size;
+			ticket = firstTicket + allocations.size() - 1;
+			return mappedData + begin;
 		}
-	} else {
-		this->texture.SetImage(textureFormat,GL_RGBA,GL_UNSIGNED_BYTE,nullptr,width,height);
+		if ( ! wait ) return nullptr;
+		spaceAvailable.wait( lock );
 	}
-	if ( this->depthbufferID != CY_GL_INVALID_ID ) {
-		glBindRenderbuffer(GL_RENDERBUFFER, this->depthbufferID);
-		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT, width, height);
-	}
-	GLRenderBuffer<TEXTURE_TYPE>::SetSize(width,height);
-	return GLRenderBuffer<TEXTURE_TYPE>::IsComplete();
 }
 
-template <GLenum TEXTURE_TYPE>
-inline bool GLRenderDepth<TEXTURE_TYPE>::Initialize( bool depthComparisonTexture )
+inline void GLTextureUploader::Submit( Ticket ticket, UploadFunc upload )
 {
-	GLint prevBuffer;
-	glGetIntegerv( GL_FRAMEBUFFER_BINDING, &prevBuffer );
-	GLRenderBuffer<TEXTURE_TYPE>::GenerateBuffer();
-	if ( depthComparisonTexture ) {
-		glTexParameteri(TEXTURE_TYPE, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
-		glTexParameteri(TEXTURE_TYPE, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
-	}
-	if ( TEXTURE_TYPE != GL_TEXTURE_CUBE_MAP ) {
-		glFramebufferTexture(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GLRenderBuffer<TEXTURE_TYPE>::GetTextureID(), 0);
-	}
-	glDrawBuffer(GL_NONE);
-	glReadBuffer(GL_NONE);
-	glBindFramebuffer(GL_FRAMEBUFFER, prevBuffer);
-	return GLRenderBuffer<TEXTURE_TYPE>::IsReady();
+	std::lock_guard<std::mutex> lock(mutex);
+	if ( ticket < firstTicket || ticket - firstTicket >= allocations.size() ) return;	// discarded by Delete
+	allocations[ size_t(ticket - firstTicket) ].upload = std::move(upload);
 }
 
-template <GLenum TEXTURE_TYPE>
-inline bool GLRenderDepth<TEXTURE_TYPE>::Resize( GLsizei width, GLsizei height, GLenum depthFormat )
+inline int GLTextureUploader::Process()
 {
-	if ( TEXTURE_TYPE == GL_TEXTURE_CUBE_MAP ) {
-		for ( int i=0; i<6; ++i ) {
-			glTexImage2D(GL_TEXTURE_CUBE_MAP_POSITIVE_X+i,0,depthFormat,width,height,0,GL_DEPTH_COMPONENT,GL_FLOAT,nullptr);
-		}
-	} else {
-		this->texture.SetImage(depthFormat,GL_DEPTH_COMPONENT,GL_FLOAT,nullptr,width,height);
+	std::lock_guard<std::mutex> lock(mutex);
+
+	// Free the staging memory of the completed uploads in allocation order
+	bool freed = false;
+	while ( ! allocations.empty() && allocations.front().fence ) {
+		GLenum result = glClientWaitSync( allocations.front().fence, 0, 0 );
+		if ( result != GL_ALREADY_SIGNALED && result != GL_CONDITION_SATISFIED ) break;
+		glDeleteSync( allocations.front().fence );
+		allocations.pop_front();
+		firstTicket++;
+		freed = true;
 	}
-	GLRenderBuffer<TEXTURE_TYPE>::SetSize(width,height);
-	return GLRenderBuffer<TEXTURE_TYPE>::IsComplete();
+	if ( freed ) spaceAvailable.notify_all();
+
+	// Issue the submitted uploads
+	int count = 0;
+	for ( Allocation &a : allocations ) {
+		if ( a.fence || ! a.upload ) continue;
+		if ( count++ == 0 ) glBindBuffer( GL_PIXEL_UNPACK_BUFFER, bufferID );
+		a.upload( (void const *) (uintptr_t) a.begin );
+		a.upload = UploadFunc();
+		a.fence  = glFenceSync( GL_SYNC_GPU_COMMANDS_COMPLETE, 0 );
+	}
+	if ( count > 0 ) glBindBuffer( GL_PIXEL_UNPACK_BUFFER, 0 );
+	return count;
 }
 
 #endif
 //-------------------------------------------------------------------------------
-// GLSLShader Implementation
+// GLMipmapGenerator Implementation
 //-------------------------------------------------------------------------------
+#ifdef GL_VERSION_4_5
 
-inline bool GLSLShader::Source::LoadFile( char const *filename, std::ostream *outStream )
+inline char const* GLMipmapGenerator::ShaderSource()
 {
-	std::ifstream shaderStream(filename, std::ios::in);
-	if( ! shaderStream.is_open() ) {
-		if ( outStream ) *outStream << "ERROR: Cannot open file \"" << filename << "\"" << std::endl;
-		return false;
+	return R"(
+layout(local_size_x = 8, local_size_y = 8) in;
+layout(binding = 0) uniform sampler2DArray src;
+layout(binding = 0, IMAGE_FORMAT) writeonly uniform image2DArray dst;
+uniform int  srcLevel;
+uniform bool srgb;
+uniform bool alphaWeighted;
+
+#if FILTER_KAISER
+const int   MAX_TAPS = 12;
+const float RADIUS   = 1.5;	// in destination texels
+const float ALPHA    = 4.0;
+
+float BesselI0( float x )
+{
+	float sum = 1.0, term = 1.0, q = x*x/4.0;
+	for ( int k=1; k<10; k++ ) { term *= q / float(k*k); sum += term; }
+	return sum;
+}
+
+// Kaiser-windowed sinc weights of the source texels along one axis for the destination texel i
+int Taps( int i, float scale, out int first, out float weights[MAX_TAPS] )
+{
+	float center = (float(i)+0.5)*scale;
+	first = int(floor(center - RADIUS*scale));
+	int n = min( int(ceil(center + RADIUS*scale)) - first, MAX_TAPS );
+	float norm = 1.0 / BesselI0(ALPHA);
+	for ( int k=0; k<n; k++ ) {
+		float x = (float(first+k)+0.5 - center) / scale;
+		float t = x / RADIUS;
+		float window = abs(t) < 1.0 ? BesselI0( ALPHA*sqrt(1.0-t*t) ) * norm : 0.0;
+		weights[k] = abs(x) < 1e-5 ? window : window * sin(3.14159265*x) / (3.14159265*x);
 	}
-	assign( (std::istreambuf_iterator<char>(shaderStream)), std::istreambuf_iterator<char>() );
-	shaderStream.close();
-	return true;
+	return n;
 }
+#else
+const int MAX_TAPS = 4;
 
-inline bool GLSLShader::Source::ParseIncludesFile( std::vector<std::string> &sources, char const *filename, std::string const &includePath, std::ostream *outStream )
+// Box filter weights along one axis for the destination texel i, which are the overlaps of the source texels with its footprint
+int Taps( int i, float scale, out int first, out float weights[MAX_TAPS] )
 {
-	Source source;
-	if ( source.LoadFile( filename, outStream ) ) return source.ParseIncludes( sources, source.data(), includePath, outStream );
-	else return false;
+	float lo = float(i)*scale, hi = float(i+1)*scale;
+	first = int(floor(lo));
+	int n = min( int(ceil(hi)) - first, MAX_TAPS );
+	for ( int k=0; k<n; k++ ) weights[k] = min(float(first+k+1),hi) - max(float(first+k),lo);
+	return n;
 }
+#endif
 
-inline bool GLSLShader::Source::ParseIncludes( std::vector<std::string> &sources, char const *sourceString, std::string const &includePath, std::ostream *outStream )
+vec3 LinearToSRGB( vec3 c )
 {
-	std::regex includeRegex(R"(\#include\s+\"([^\"]+)\")");
-	std::smatch matches;
-	std::string remainingSource = sourceString;
-	size_t lastIndex = 0;
+	c = clamp( c, 0.0, 1.0 );
+	return mix( c*12.92, 1.055*pow(c,vec3(1.0/2.4)) - 0.055, step(vec3(0.0031308),c) );
+}
 
-	while ( std::regex_search(remainingSource, matches, includeRegex) ) {
-		sources.push_back( remainingSource.substr(0, matches.position()) );
-		std::string includeFileName = includePath;
-		includeFileName += matches[1];
-		if ( ! ParseIncludesFile( sources, includeFileName.data(), includePath, outStream ) ) return false;
-		lastIndex = matches.position() + matches.length();
-		remainingSource = remainingSource.substr(lastIndex);
+void main()
+{
+	ivec3 dstSize = imageSize(dst);
+	ivec3 p = ivec3(gl_GlobalInvocationID);
+	if ( p.x >= dstSize.x || p.y >= dstSize.y ) return;
+	ivec2 srcSize = textureSize(src,srcLevel).xy;
+	vec4 c;
+
+#if ! FILTER_KAISER
+	if ( srcSize == dstSize.xy*2 && ! alphaWeighted ) {
+		// a single bilinear fetch at the shared corner of the 2x2 source texels averages them
+		c = textureLod( src, vec3( (vec2(p.xy)+0.5)/vec2(dstSize.xy), p.z ), float(srcLevel) );
+	} else
+#endif
+	{
+		int   fx, fy;
+		float wx[MAX_TAPS], wy[MAX_TAPS];
+		int   nx = Taps( p.x, float(srcSize.x)/float(dstSize.x), fx, wx );
+		int   ny = Taps( p.y, float(srcSize.y)/float(dstSize.y), fy, wy );
+		vec4  sum = vec4(0.0);
+		vec3  weightedColor = vec3(0.0);
+		float weightSum = 0.0;
+		for ( int y=0; y<ny; y++ ) {
+			int sy = clamp( fy+y, 0, srcSize.y-1 );
+			for ( int x=0; x<nx; x++ ) {
+				float w = wx[x] * wy[y];
+				vec4 t = texelFetch( src, ivec3( clamp(fx+x,0,srcSize.x-1), sy, p.z ), srcLevel );
+				sum += w * t;
+				weightedColor += w * t.a * t.rgb;
+				weightSum += w;
+			}
+		}
+		c = sum / weightSum;
+		if ( alphaWeighted && sum.a > 1e-5 ) c.rgb = weightedColor / sum.a;
 	}
+	c = max( c, vec4(0.0) );
+	if ( srgb ) c.rgb = LinearToSRGB( c.rgb );
+	imageStore( dst, p, c );
+}
+)";
+}
 
-	if (!remainingSource.empty()) {
-		sources.push_back(remainingSource);
+inline bool GLMipmapGenerator::ImageFormat( GLenum internalFormat, GLenum &viewFormat, char const *&layoutFormat, bool &srgb )
+{
+	srgb = false;
+	viewFormat = internalFormat;
+	switch ( internalFormat ) {
+		case GL_SRGB8_ALPHA8: srgb = true; viewFormat = GL_RGBA8; layoutFormat = "rgba8"; return true;
+		case GL_RGBA8:   layoutFormat = "rgba8";   return true;
+		case GL_RG8:     layoutFormat = "rg8";     return true;
+		case GL_R8:      layoutFormat = "r8";      return true;
+		case GL_RGBA16:  layoutFormat = "rgba16";  return true;
+		case GL_RG16:    layoutFormat = "rg16";    return true;
+		case GL_R16:     layoutFormat = "r16";     return true;
+		case GL_RGBA16F: layoutFormat = "rgba16f"; return true;
+		case GL_RG16F:   layoutFormat = "rg16f";   return true;
+		case GL_R16F:    layoutFormat = "r16f";    return true;
+		case GL_RGBA32F: layoutFormat = "rgba32f"; return true;
+		case GL_RG32F:   layoutFormat = "rg32f";   return true;
+		case GL_R32F:    layoutFormat = "r32f";    return true;
 	}
+	return false;
+}
 
-	return true;
+inline void GLMipmapGenerator::Delete()
+{
+	for ( Program &p : programs ) if ( p.programID != CY_GL_INVALID_ID ) glDeleteProgram( p.programID );
+	programs.clear();
+	if ( samplerID != CY_GL_INVALID_ID ) glDeleteSamplers( 1, &samplerID );
+	samplerID = CY_GL_INVALID_ID;
 }
 
-template <bool file, bool parse>
-inline bool GLSLShader::Compile( char const *shaderSource, GLenum shaderType, int prependSourceCount, char const **prependSources, std::ostream *outStream )
+inline GLMipmapGenerator::Program const* GLMipmapGenerator::GetProgram( GLenum viewFormat, char const *layoutFormat, Filter filter )
 {
-	Source source;
-	char const *shaderSourceCode = shaderSource;
-	std::string includePath = "";
-	if ( file ) {
-		if ( ! source.LoadFile(shaderSource,outStream) ) return false;
-		shaderSourceCode = source.data();
-		if ( parse ) {
-			includePath = shaderSource;
-			size_t pos = includePath.find_last_of("/\\");
-			includePath.erase( pos+1 );
+	for ( Program const &p : programs ) if ( p.internalFormat == viewFormat && p.filter == filter ) return p.programID != CY_GL_INVALID_ID ? &p : nullptr;
+
+	Program p;
+	p.internalFormat = viewFormat;
+	p.filter = filter;
+	p.programID = CY_GL_INVALID_ID;
+	std::string header = std::string("#version 430\n#define IMAGE_FORMAT ") + layoutFormat + "\n#define FILTER_KAISER " + ( filter == FILTER_KAISER ? "1" : "0" ) + "\n";
+	char const *prepend = header.c_str();
+	GLSLShader shader;
+	if ( shader.Compile( ShaderSource(), GL_COMPUTE_SHADER, prepend, outStream ) ) {
+		p.programID = glCreateProgram();
+		glAttachShader( p.programID, shader.GetID() );
+		glLinkProgram( p.programID );
+		GLint result = GL_FALSE;
+		glGetProgramiv( p.programID, GL_LINK_STATUS, &result );
+		if ( result == GL_FALSE ) {
+			if ( outStream ) *outStream << "ERROR: Failed linking the mipmap generator program." << std::endl;
+			glDeleteProgram( p.programID );
+			p.programID = CY_GL_INVALID_ID;
 		}
 	}
+	shader.Delete();
+	if ( p.programID != CY_GL_INVALID_ID ) {
+		p.srcLevel      = glGetUniformLocation( p.programID, "srcLevel" );
+		p.srgb          = glGetUniformLocation( p.programID, "srgb" );
+		p.alphaWeighted = glGetUniformLocation( p.programID, "alphaWeighted" );
+	}
+	programs.push_back( p );	// failed programs are kept, so that they are not compiled again
+	return p.programID != CY_GL_INVALID_ID ? &programs.back() : nullptr;
+}
 
-	std::vector<std::string> sources;
-	std::vector<char const*> pSources;
+inline bool GLMipmapGenerator::Generate( GLuint textureID, Filter filter, bool alphaWeighted )
+{
+	GLint target=0, immutable=0, levels=0, internalFormat=0, width=0, height=0, layers=0;
+	glGetTextureParameteriv( textureID, GL_TEXTURE_TARGET, &target );
+	glGetTextureParameteriv( textureID, GL_TEXTURE_IMMUTABLE_FORMAT, &immutable );
+	glGetTextureParameteriv( textureID, GL_TEXTURE_IMMUTABLE_LEVELS, &levels );
+	glGetTextureLevelParameteriv( textureID, 0, GL_TEXTURE_INTERNAL_FORMAT, &internalFormat );
+	glGetTextureLevelParameteriv( textureID, 0, GL_TEXTURE_WIDTH,  &width  );
+	glGetTextureLevelParameteriv( textureID, 0, GL_TEXTURE_HEIGHT, &height );
+	switch ( target ) {
+		case GL_TEXTURE_2D:       layers = 1; break;
+		case GL_TEXTURE_CUBE_MAP: layers = 6; break;
+		case GL_TEXTURE_2D_ARRAY: glGetTextureLevelParameteriv( textureID, 0, GL_TEXTURE_DEPTH, &layers ); break;
+	}
 
-	char const **sourceData = &shaderSourceCode;
-	GLsizei sourceDataCount = 1;
-	bool addSources = parse || (prependSourceCount > 0);
-	if ( addSources ) {
-		if ( parse ) if ( ! Source::ParseIncludes( sources, shaderSourceCode, includePath, outStream ) ) return false;
-		sourceDataCount = (parse ? (int)sources.size() : 1 ) + prependSourceCount;
-		pSources.resize( sourceDataCount );
-		for ( int i=0; i<prependSourceCount; i++ ) pSources[i] = prependSources[i];
-		if ( parse ) for ( int i=0; i<(int)sources.size(); i++ ) pSources[i+prependSourceCount] = sources[i].data();
-		else pSources[prependSourceCount] = shaderSourceCode;
-		sourceData = pSources.data();
+	GLenum viewFormat;
+	char const *layoutFormat;
+	bool srgb;
+	Program const *program = nullptr;
+	if ( layers > 0 && immutable && ImageFormat( internalFormat, viewFormat, layoutFormat, srgb ) ) program = GetProgram( viewFormat, layoutFormat, filter );
+	if ( ! program ) {
+		glGenerateTextureMipmap( textureID );
+		return false;
+	}
+	if ( levels < 2 ) return true;
+
+	// The levels are read through a view with the texture format, so that sRGB textures are decoded,
+	// and written through a view with the matching linear format, since image stores do not support sRGB.
+	GLuint views[2];
+	glGenTextures( 2, views );
+	glTextureView( views[0], GL_TEXTURE_2D_ARRAY, textureID, internalFormat, 0, levels, 0, layers );
+	glTextureView( views[1], GL_TEXTURE_2D_ARRAY, textureID, viewFormat,     0, levels, 0, layers );
+
+	if ( samplerID == CY_GL_INVALID_ID ) {
+		glCreateSamplers( 1, &samplerID );
+		glSamplerParameteri( samplerID, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_NEAREST );
+		glSamplerParameteri( samplerID, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+		glSamplerParameteri( samplerID, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE );
+		glSamplerParameteri( samplerID, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE );
 	}
 
-	Delete();
-	shaderID = glCreateShader( shaderType );
-	glShaderSource(shaderID, sourceDataCount, sourceData, nullptr);
-	glCompileShader(shaderID);
+	GLState::UseProgram( program->programID );
+	glUniform1i( program->srgb, srgb );
+	glUniform1i( program->alphaWeighted, alphaWeighted );
+	GLState::BindTexture( 0, GL_TEXTURE_2D_ARRAY, views[0] );
+	glBindSampler( 0, samplerID );
+	for ( GLint level=1; level<levels; level++ ) {
+		GLuint w = (std::max)( width >>level, 1 );
+		GLuint h = (std::max)( height>>level, 1 );
+		glUniform1i( program->srcLevel, level-1 );
+		glBindImageTexture( 0, views[1], level, GL_TRUE, 0, GL_WRITE_ONLY, viewFormat );
+		glDispatchCompute( (w+7)/8, (h+7)/8, layers );
+		glMemoryBarrier( GL_TEXTURE_FETCH_BARRIER_BIT );
+	}
+	glMemoryBarrier( GL_TEXTURE_UPDATE_BARRIER_BIT | GL_FRAMEBUFFER_BARRIER_BIT );
+	GLState::BindTexture( 0, GL_TEXTURE_2D_ARRAY, 0 );
+	glBindSampler( 0, 0 );
+	glBindImageTexture( 0, 0, 0, GL_FALSE, 0, GL_WRITE_ONLY, GL_RGBA8 );
+	GLState::UseProgram( 0 );
+	glDeleteTextures( 2, views );
+	return true;
+}
 
-	GLint result = GL_FALSE;
-	glGetShaderiv(shaderID, GL_COMPILE_STATUS, &result);
+#endif
+//-------------------------------------------------------------------------------
+// GLProfiler Implementation
+//-------------------------------------------------------------------------------
+#ifdef GL_VERSION_3_3
 
-	int infoLogLength;
-	glGetShaderiv(shaderID, GL_INFO_LOG_LENGTH, &infoLogLength);
-	if ( infoLogLength > 1 ) {
-		std::vector<char> compilerMessage(infoLogLength);
-		glGetShaderInfoLog( shaderID, infoLogLength, nullptr, compilerMessage.data() );
-		if ( outStream ) {
-			if ( !result ) *outStream << "ERROR: Cannot compile shader." << std::endl;
-			*outStream << "OpenGL Version: ";
-			GL::PrintVersion(outStream);
-			*outStream << std::endl;
-			*outStream << compilerMessage.data() << std::endl;
-		}
+inline void GLProfiler::Initialize( int numFrames, int windowSize, bool pipelineStatistics )
+{
+	Delete();
+	frames.resize( (std::max)( numFrames, 1 ) );
+	for ( FrameQueries &f : frames ) glGenQueries( 1, &f.frameQuery );
+	frameSlot = 0;
+	this->windowSize = (std::max)( windowSize, 1 );
+	collectCounters = false;
+#ifdef GL_ARB_pipeline_statistics_query
+	if ( pipelineStatistics ) {
+		GLint major = 0, minor = 0;
+		glGetIntegerv( GL_MAJOR_VERSION, &major );
+		glGetIntegerv( GL_MINOR_VERSION, &minor );
+		collectCounters = major > 4 || ( major == 4 && minor >= 6 ) || GL::IsExtensionSupported( "GL_ARB_pipeline_statistics_query" );
 	}
+#endif
+}
 
-	if ( result ) {
-		GLint stype;
-		glGetShaderiv(shaderID, GL_SHADER_TYPE, &stype);
-		if ( stype != (GLint)shaderType ) {
-			if ( outStream ) *outStream << "ERROR: Incorrect shader type." << std::endl;
-			return false;
-		}
+inline void GLProfiler::Delete()
+{
+	for ( FrameQueries &f : frames ) {
+		if ( f.frameQuery ) glDeleteQueries( 1, &f.frameQuery );
+		if ( ! f.timestamps.empty() ) glDeleteQueries( (GLsizei) f.timestamps.size(), f.timestamps.data() );
+		if ( ! f.counterQueries.empty() ) glDeleteQueries( (GLsizei) f.counterQueries.size(), f.counterQueries.data() );
 	}
+	frames.clear();
+	openZones.clear();
+	openCounterZone = -1;
+	inFrame = false;
+}
 
-	return result == GL_TRUE;
+inline void GLProfiler::ResetStatistics()
+{
+	for ( Statistics &z : zoneStats ) { std::string name = z.name; z = Statistics(); z.name = name; }
+	frameStats = Statistics();
+	frameStats.name = "frame";
+	droppedFrames = 0;
 }
 
-//-------------------------------------------------------------------------------
-// GLSLProgram Implementation
-//-------------------------------------------------------------------------------
+inline GLenum GLProfiler::CounterTarget( int counter )
+{
+#ifdef GL_ARB_pipeline_statistics_query
+	static GLenum const targets[NUM_COUNTERS] = {
+		GL_VERTICES_SUBMITTED_ARB,
+		GL_PRIMITIVES_SUBMITTED_ARB,
+		GL_VERTEX_SHADER_INVOCATIONS_ARB,
+		GL_FRAGMENT_SHADER_INVOCATIONS_ARB,
+		GL_CLIPPING_INPUT_PRIMITIVES_ARB,
+		GL_CLIPPING_OUTPUT_PRIMITIVES_ARB,
+	};
+	return targets[counter];
+#else
+	return 0;
+#endif
+}
 
-inline bool GLSLProgram::Link( std::ostream *outStream )
+inline char const* GLProfiler::CounterName( int counter )
 {
-	glLinkProgram(programID);
+	static char const *names[NUM_COUNTERS] = { "vertices", "primitives", "vs_invocations", "fs_invocations", "clip_in", "clip_out" };
+	return names[counter];
+}
 
-	GLint result = GL_FALSE;
-	glGetProgramiv(programID, GL_LINK_STATUS, &result);
+inline int GLProfiler::FindStats( char const *name )
+{
+	for ( size_t i=0; i<zoneStats.size(); ++i ) if ( zoneStats[i].name == name ) return (int) i;
+	zoneStats.emplace_back();
+	zoneStats.back().name = name;
+	return (int) zoneStats.size() - 1;
+}
 
-	int infoLogLength;
-	glGetProgramiv(programID, GL_INFO_LOG_LENGTH, &infoLogLength);
-	if ( infoLogLength > 1 ) {
-		std::vector<char> compilerMessage(infoLogLength);
-		glGetProgramInfoLog( programID, infoLogLength, nullptr, compilerMessage.data() );
-		if ( outStream ) *outStream << "ERROR: " << compilerMessage.data() << std::endl;
+inline void GLProfiler::AddSample( Statistics &stats, double time )
+{
+	if ( stats.samples.size() < windowSize ) stats.samples.push_back( time );
+	else stats.samples[ stats.count % windowSize ] = time;
+	stats.count++;
+	stats.lastTime = time;
+	double sum = 0;
+	stats.minTime = stats.maxTime = time;
+	for ( double t : stats.samples ) {
+		sum += t;
+		stats.minTime = (std::min)( stats.minTime, t );
+		stats.maxTime = (std::max)( stats.maxTime, t );
 	}
-
-	return result == GL_TRUE;
+	stats.averageTime = sum / stats.samples.size();
 }
 
-inline bool GLSLProgram::Build( GLSLShader const *vertexShader, 
-                                GLSLShader const *fragmentShader,
-	                            GLSLShader const *geometryShader,
-	                            GLSLShader const *tessControlShader,
-	                            GLSLShader const *tessEvaluationShader,
-	                            std::ostream *outStream )
+inline GLuint GLProfiler::NextQuery( std::vector<GLuint> &pool, size_t &used, size_t count )
 {
-	CreateProgram();
-	std::stringstream output;
-	AttachShader(*vertexShader);
-	AttachShader(*fragmentShader);
-	if ( geometryShader ) AttachShader(*geometryShader);
-	if ( tessControlShader ) AttachShader(*tessControlShader);
-	if ( tessEvaluationShader ) AttachShader(*tessEvaluationShader);
-	return Link(outStream);
+	if ( used + count > pool.size() ) {
+		size_t n = pool.size();
+		pool.resize( used + count );
+		glGenQueries( (GLsizei)( pool.size() - n ), pool.data() + n );
+	}
+	GLuint first = (GLuint) used;
+	used += count;
+	return first;
 }
 
-template <bool files, bool parse>
-inline bool GLSLProgram::Build( char const *vertexShader, 
-                                char const *fragmentShader,
-	                            char const *geometryShader,
-	                            char const *tessControlShader,
-	                            char const *tessEvaluationShader,
-	                            int         prependSourceCount,
-	                            char const **prependSource,
-	                            std::ostream *outStream )
+inline void GLProfiler::Collect( FrameQueries &frame, bool wait )
 {
-	auto compile = [&]( GLSLShader &s, char const *source, GLenum type, char const *typeStr )
-	{
-		std::stringstream shaderOutput;
-		if ( s.Compile<files,parse>( source, type, prependSourceCount, prependSource, &shaderOutput ) ) return true;
-		if ( outStream ) {
-			*outStream << "ERROR: Failed compiling " << typeStr;
-			if ( files ) *outStream << " \"" << source << "\"";
-			*outStream << std::endl << shaderOutput.str();
+	if ( ! frame.pending ) return;
+	frame.pending = false;
+
+	// The queries complete in order, so the frame is ready when its last query is
+	GLuint last = frame.usedTimestamps > 0 ? frame.timestamps[ frame.usedTimestamps-1 ] : frame.frameQuery;
+	GLint available = GL_FALSE;
+	glGetQueryObjectiv( last, GL_QUERY_RESULT_AVAILABLE, &available );
+	if ( available ) glGetQueryObjectiv( frame.frameQuery, GL_QUERY_RESULT_AVAILABLE, &available );
+	if ( ! available && ! wait ) { droppedFrames++; return; }
+
+	GLuint64 frameTime = 0;
+	glGetQueryObjectui64v( frame.frameQuery, GL_QUERY_RESULT, &frameTime );
+	AddSample( frameStats, frameTime * 1e-6 );
+
+	for ( ZoneRecord const &z : frame.zones ) {
+		GLuint64 begin = 0, end = 0;
+		glGetQueryObjectui64v( z.beginQuery, GL_QUERY_RESULT, &begin );
+		glGetQueryObjectui64v( z.endQuery,   GL_QUERY_RESULT, &end   );
+		Statistics &stats = zoneStats[ z.statsIndex ];
+		AddSample( stats, ( end > begin ? end - begin : 0 ) * 1e-6 );
+		if ( z.counterQueries >= 0 ) {
+			for ( int c=0; c<NUM_COUNTERS; ++c ) glGetQueryObjectui64v( frame.counterQueries[ z.counterQueries + c ], GL_QUERY_RESULT, &stats.counters[c] );
 		}
-		return false;
-	};
+		if ( tracing && traceEvents.size() < maxTraceEvents ) traceEvents.push_back( TraceEvent{ z.statsIndex, z.depth, begin, end > begin ? end - begin : 0, frame.frameIndex } );
+	}
+}
 
-	CreateProgram();
-	GLSLShader vs, fs, gs, tcs, tes;
-	if ( ! compile( vs, vertexShader, GL_VERTEX_SHADER, "vertex shader" ) ) return false;
-	AttachShader(vs);
-	if ( ! compile( fs, fragmentShader, GL_FRAGMENT_SHADER, "fragment shader" ) ) return false;
-	AttachShader(fs);
-	if ( geometryShader ) {
-		if ( ! compile( gs, geometryShader, GL_GEOMETRY_SHADER, "geometry shader" ) ) return false;
-		AttachShader(gs);
-	}
-	if ( tessControlShader ) {
-		if ( ! compile( tcs, tessControlShader, GL_TESS_CONTROL_SHADER, "tessellation control shader" ) ) return false;
-		AttachShader(tcs);
-	}
-	if ( tessEvaluationShader ) {
-		if ( ! compile( tes, tessEvaluationShader, GL_TESS_EVALUATION_SHADER, "tessellation evaluation shader" ) ) return false;
-		AttachShader(tes);
+inline void GLProfiler::Finish()
+{
+	for ( size_t i=1; i<=frames.size(); ++i ) Collect( frames[ ( frameSlot + i ) % frames.size() ], true );
+}
+
+inline void GLProfiler::BeginFrame()
+{
+	if ( frames.empty() ) return;
+	frameSlot = frameIndex % frames.size();
+	FrameQueries &frame = frames[ frameSlot ];
+	Collect( frame, false );
+	frame.zones.clear();
+	frame.usedTimestamps = 0;
+	frame.usedCounterQueries = 0;
+	frame.frameIndex = frameIndex++;
+	openZones.clear();
+	openCounterZone = -1;
+	glBeginQuery( GL_TIME_ELAPSED, frame.frameQuery );
+	inFrame = true;
+}
+
+inline void GLProfiler::EndFrame()
+{
+	if ( ! inFrame ) return;
+	while ( ! openZones.empty() ) EndZone();
+	glEndQuery( GL_TIME_ELAPSED );
+	frames[ frameSlot ].pending = true;
+	inFrame = false;
+}
+
+inline void GLProfiler::BeginZone( char const *name )
+{
+	if ( ! inFrame ) return;
+	FrameQueries &frame = frames[ frameSlot ];
+	ZoneRecord z;
+	z.statsIndex = FindStats( name );
+	z.depth      = (int) openZones.size();
+	GLuint q     = NextQuery( frame.timestamps, frame.usedTimestamps, 2 );
+	z.beginQuery = frame.timestamps[q];
+	z.endQuery   = frame.timestamps[q+1];
+	z.counterQueries = -1;
+	glQueryCounter( z.beginQuery, GL_TIMESTAMP );
+	// Only one query of each pipeline statistics target can be active, so nested zones do not collect counters
+	if ( collectCounters && openCounterZone < 0 ) {
+		z.counterQueries = (int) NextQuery( frame.counterQueries, frame.usedCounterQueries, NUM_COUNTERS );
+		for ( int c=0; c<NUM_COUNTERS; ++c ) glBeginQuery( CounterTarget(c), frame.counterQueries[ z.counterQueries + c ] );
+		openCounterZone = (int) frame.zones.size();
 	}
-	return Link(outStream);
+	openZones.push_back( (int) frame.zones.size() );
+	frame.zones.push_back( z );
 }
 
-inline void GLSLProgram::RegisterUniform( unsigned int index, char const *name, std::ostream *outStream )
+inline void GLProfiler::EndZone()
 {
-	if ( params.size() <= index ) params.resize( index+1, -1 );
-	params[index] = glGetUniformLocation( programID, name );
-	if ( params[index] < 0 ) {
-		GLenum error = glGetError();
-		GLenum newError;
-		while ( (newError = glGetError()) != GL_NO_ERROR ) error = newError; // get the latest error.
-		if ( outStream ) {
-			*outStream << "ERROR: ";
-			switch (error) {
-				case GL_INVALID_VALUE:     *outStream << "GL_INVALID_VALUE.";     break;
-				case GL_INVALID_OPERATION: *outStream << "GL_INVALID_OPERATION."; break;
-			}
-			*outStream << " Parameter \"" << name << "\" could not be registered." << std::endl;
-		}
+	if ( ! inFrame || openZones.empty() ) return;
+	FrameQueries &frame = frames[ frameSlot ];
+	int i = openZones.back();
+	openZones.pop_back();
+	if ( i == openCounterZone ) {
+		for ( int c=0; c<NUM_COUNTERS; ++c ) glEndQuery( CounterTarget(c) );
+		openCounterZone = -1;
 	}
+	glQueryCounter( frame.zones[i].endQuery, GL_TIMESTAMP );
 }
 
-inline void GLSLProgram::RegisterUniforms( char const *names, unsigned int startingIndex, std::ostream *outStream )
+inline void GLProfiler::PrintStatistics( std::ostream *outStream ) const
 {
-	std::stringstream ss(names);
-	unsigned int index = startingIndex;
-	while ( ss.good() ) {
+	char line[256];
+	auto print = [&]( Statistics const &s ) {
+		snprintf( line, sizeof(line), "%-24s avg %8.3f ms  min %8.3f  max %8.3f  last %8.3f", s.name.c_str(), s.averageTime, s.minTime, s.maxTime, s.lastTime );
+		*outStream << line;
+		if ( collectCounters && s.counters[FRAGMENT_SHADER_INVOCATIONS] > 0 ) {
+			for ( int c=0; c<NUM_COUNTERS; ++c ) *outStream << "  " << CounterName(c) << " " << s.counters[c];
+		}
+		*outStream << std::endl;
+	};
+	print( frameStats );
+	for ( Statistics const &z : zoneStats ) print( z );
+	if ( droppedFrames > 0 ) *outStream << "dropped frames: " << droppedFrames << std::endl;
+}
+
+inline bool GLProfiler::WriteTrace( char const *filename ) const
+{
+	std::ofstream file( filename );
+	if ( ! file.good() ) return false;
+	GLuint64 start = traceEvents.empty() ? 0 : traceEvents.front().begin;
+	for ( TraceEvent const &e : traceEvents ) start = (std::min)( start, e.begin );
+	file << "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+	file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"GPU\"}}";
+	char buffer[128];
+	for ( TraceEvent const &e : traceEvents ) {
 		std::string name;
-		ss >> name;
-		RegisterUniform( index++, name.c_str(), outStream );
+		for ( char c : zoneStats[ e.statsIndex ].name ) {
+			if ( c == '"' || c == '\\' ) name += '\\';
+			if ( (unsigned char) c >= 0x20 ) name += c;
+		}
+		// Timestamps are in microseconds
+		snprintf( buffer, sizeof(buffer), "\"ts\":%.3f,\"dur\":%.3f", ( e.begin - start ) * 1e-3, e.duration * 1e-3 );
+		file << ",\n{\"name\":\"" << name << "\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":1," << buffer
+		     << ",\"args\":{\"frame\":" << e.frameIndex << ",\"depth\":" << e.depth << "}}";
 	}
+	file << "\n]}\n";
+	return file.good();
 }
 
+#endif // GL_VERSION_3_3
 //-------------------------------------------------------------------------------
 
 typedef GLTexture1<GL_TEXTURE_1D       >     GLTexture1D;			//!< OpenGL 1D Texture
@@ -1907,11 +4059,19 @@ typedef GLRenderDepth  <GL_TEXTURE_RECTANGLE> GLRenderDepthRect;	//!< OpenGL ren
 typedef GLRenderTextureCubeBase< GL_COLOR_ATTACHMENT0, GLRenderTexture<GL_TEXTURE_CUBE_MAP> > GLRenderTextureCube;	//!< OpenGL render color buffer with a cube map texture
 typedef GLRenderTextureCubeBase< GL_DEPTH_ATTACHMENT,  GLRenderDepth  <GL_TEXTURE_CUBE_MAP> > GLRenderDepthCube;	//!< OpenGL render depth buffer with a cube map texture
 
+#ifdef GL_VERSION_4_5
+typedef GLBuffer<GL_UNIFORM_BUFFER>             GLUniformBuffer;		//!< OpenGL uniform buffer
+typedef GLBuffer<GL_SHADER_STORAGE_BUFFER>      GLStorageBuffer;		//!< OpenGL shader storage buffer
+typedef GLBlockBuffer<GL_UNIFORM_BUFFER>        GLUniformBlockBuffer;	//!< Ring-buffered array of uniform blocks
+typedef GLBlockBuffer<GL_SHADER_STORAGE_BUFFER> GLStorageBlockBuffer;	//!< Ring-buffered array of shader storage blocks
+#endif
+
 //-------------------------------------------------------------------------------
 } // namespace cy
 //-------------------------------------------------------------------------------
 
 typedef cy::GL cyGL;									//!< General OpenGL queries
+typedef cy::GLState cyGLState;							//!< OpenGL state cache
 
 #ifdef GL_KHR_debug
 typedef cy::GLDebugCallback    cyGLDebugCallback;		//!< OpenGL debug callback class
@@ -1946,5 +4106,19 @@ typedef cy::GLRenderDepthCube   cyGLRenderDepthCube;	//!< OpenGL render depth bu
 typedef cy::GLSLShader         cyGLSLShader;			//!< GLSL shader class
 typedef cy::GLSLProgram        cyGLSLProgram;			//!< GLSL program class
 
+#ifdef GL_VERSION_4_5
+typedef cy::GLUniformBuffer      cyGLUniformBuffer;			//!< OpenGL uniform buffer
+typedef cy::GLStorageBuffer      cyGLStorageBuffer;			//!< OpenGL shader storage buffer
+typedef cy::GLUniformBlockBuffer cyGLUniformBlockBuffer;	//!< Ring-buffered array of uniform blocks
+typedef cy::GLStorageBlockBuffer cyGLStorageBlockBuffer;	//!< Ring-buffered array of shader storage blocks
+typedef cy::GLStreamBuffer       cyGLStreamBuffer;			//!< Persistently mapped buffer for streaming per-frame data
+typedef cy::GLTextureUploader    cyGLTextureUploader;		//!< Asynchronous texture uploads through a pixel unpack buffer
+typedef cy::GLMipmapGenerator    cyGLMipmapGenerator;		//!< Compute shader mipmap generation with explicit filters
+#endif
+
+#ifdef GL_VERSION_3_3
+typedef cy::GLProfiler           cyGLProfiler;				//!< GPU profiler with timer queries
+#endif
+
 //-------------------------------------------------------------------------------
 #endif
\ No newline at end of file
@@ -1033,9 +1033,11 @@ public:
 //-------------------------------------------------------------------------------
 
 #ifdef CY_NONVECTORIZED_MATRIX3
-# define _CY_INIT_MATRIX34_VECTORIZATION const int N = 3; T const *cell_9 = cell + 9;
+# define _CY_INIT_MATRIX34_N const int N = 3;
+# define _CY_INIT_MATRIX34_VECTORIZATION _CY_INIT_MATRIX34_N T const *cell_9 = cell + 9;
 #else
-# define _CY_INIT_MATRIX34_VECTORIZATION const int N = 4; T cell_9[4] = { cell[9], cell[10], cell[11], cell[11] };
+# define _CY_INIT_MATRIX34_N const int N = 4;
+# define _CY_INIT_MATRIX34_VECTORIZATION _CY_INIT_MATRIX34_N T cell_9[4] = { cell[9], cell[10], cell[11], cell[11] };
 #endif
 
 //-------------------------------------------------------------------------------
@@ -1308,7 +1310,7 @@ public:
 	CY_NODISCARD Matrix34 operator - ( Matrix34 const &right ) const { Matrix34 r; _CY_FOR_12i( r.cell[i] = cell[i] - right.cell[i] ); return r; }	//!< subtract one Matrix4 from another
 	CY_NODISCARD Matrix34 operator * ( Matrix34 const &right ) const	//!< multiply a matrix with another
 	{
-		_CY_INIT_MATRIX34_VECTORIZATION;
+		_CY_INIT_MATRIX34_N;
 		Matrix34 rm;
 		T *rd = rm.cell;
 		for ( int i=0; i<12; i+=3, rd+=3 ) {
@@ -1325,7 +1327,7 @@ public:
 	}
 	CY_NODISCARD Matrix34 operator * ( Matrix3<T> const &right ) const	//!< multiply a matrix with another
 	{
-		_CY_INIT_MATRIX34_VECTORIZATION;
+		_CY_INIT_MATRIX34_N;
 		Matrix34 rm;
 		T *rd = rm.cell;
 		for ( int i=0; i<9; i+=3, rd+=3 ) {
@@ -1370,7 +1372,7 @@ public:
 		_CY_IVDEP_FOR ( int i=0; i<N; ++i ) d[i] = p.w * cell_9[i];
 		_CY_IVDEP_FOR ( int i=0; i<N; ++i ) e[i] = a[i] + b[i];
 		_CY_IVDEP_FOR ( int i=0; i<N; ++i ) f[i] = c[i] + d[i];
-		_CY_IVDEP_FOR ( int i=0; i<N; ++i ) r[i] = e[i] + f[3+i];
+		_CY_IVDEP_FOR ( int i=0; i<N; ++i ) r[i] = e[i] + f[i];
 		r[3] = p.w;
 		return r;
 	}
@@ -1388,7 +1390,7 @@ public:
 	//! Transforms the vector by multiplying it with the matrix, ignoring the translation component.
 	CY_NODISCARD Vec3<T> VectorTransform( Vec3<T> const &p ) const
 	{
-		_CY_INIT_MATRIX34_VECTORIZATION;
+		_CY_INIT_MATRIX34_N;
 		//return Vec3<T>( p.x*cell[0] + p.y*cell[3] + p.z*cell[6], 
 		//                p.x*cell[1] + p.y*cell[4] + p.z*cell[7],
 		//                p.x*cell[2] + p.y*cell[5] + p.z*cell[8] );
@@ -2331,6 +2333,14 @@ template<typename T> inline Matrix4<T> operator & ( Vec4<T> const &v0, Vec4<T> c
 
 //-------------------------------------------------------------------------------
 
+//! Returns the model-view matrix of a model placed at a double precision origin.
+//! The origin is transformed to camera space in double precision before the view is converted,
+//! so the returned matrix holds only the camera-relative offset and large world coordinates do not cause jitter.
+template<typename T> inline Matrix34<T> CameraRelativeModelView( Matrix34<double> const &view, Vec3<double> const &origin, Matrix34<T> const &model ) { Matrix34<double> v=view; v.Column(3)=view*origin; return Matrix34<T>(v) * model; }
+template<typename T> inline Matrix4 <T> CameraRelativeModelView( Matrix4 <double> const &view, Vec3<double> const &origin, Matrix34<T> const &model ) { Matrix4 <double> v=view; v.Column(3)=view*origin; return Matrix4 <T>(v) * model; }	//!< Returns the model-view matrix of a model placed at a double precision origin using a 4x4 view matrix
+
+//-------------------------------------------------------------------------------
+
 // Definitions of the conversion constructors
 template <typename T>  Matrix2 <T>::Matrix2 ( Matrix3 <T> const &m ) { MemCopy(cell,m.cell,2); MemCopy(cell+2,m.cell+3,2); }
 template <typename T>  Matrix2 <T>::Matrix2 ( Matrix34<T> const &m ) { MemCopy(cell,m.cell,2); MemCopy(cell+2,m.cell+3,2); }
@@ -2339,6 +2349,55 @@ template <typename T>  Matrix3 <T>::Matrix3 ( Matrix34<T> const &m ) { MemCopy(c
 template <typename T>  Matrix3 <T>::Matrix3 ( Matrix4 <T> const &m ) { MemCopy(cell,m.cell,3); MemCopy(cell+3,m.cell+4,3); MemCopy(cell+6,m.cell+8,3); }
 template <typename T>  Matrix34<T>::Matrix34( Matrix4 <T> const &m ) { MemCopy(cell,m.cell,3); MemCopy(cell+3,m.cell+4,3); MemCopy(cell+6,m.cell+8,3); MemCopy(cell+9,m.cell+12,3); }
 
+#ifdef _CY_SSE
+
+//! SSE version of the 3x4 matrix product. The 12 values are loaded and stored as 3 groups of 4 floats,
+//! so that a product of a matrix that was just computed, as in a chain of transformations, can forward
+//! its values from the stores instead of waiting for them to reach the cache. Each group of the result is
+//! computed in place from shuffled rows of the left matrix and shuffled values of the right matrix, so
+//! the result needs no shuffles before it is stored. The right matrix is usually not the one that was
+//! just computed, so its shuffles are not on the critical path of a chain.
+template<> CY_NODISCARD inline Matrix34<float> Matrix34<float>::operator * ( Matrix34<float> const &right ) const
+{
+	// the left matrix, with the columns c0 = l0.xyz, c1 = (l0.w,l1.x,l1.y), c2 = (l1.z,l1.w,l2.x), c3 = l2.yzw
+	__m128 l0 = _mm_loadu_ps( cell   );
+	__m128 l1 = _mm_loadu_ps( cell+4 );
+	__m128 l2 = _mm_loadu_ps( cell+8 );
+	__m128 c1 = _mm_shuffle_ps( l0, l1, _MM_SHUFFLE(1,0,3,3) );	// c1.x c1.x c1.y c1.z
+	__m128 c2 = _mm_shuffle_ps( l1, l2, _MM_SHUFFLE(0,0,3,2) );	// c2.x c2.y c2.z c2.z
+	__m128 c3 = _mm_and_ps( l2, _mm_castsi128_ps( _mm_set_epi32(-1,-1,-1,0) ) );	// 0 c3.x c3.y c3.z
+	// the right matrix
+	__m128 r0 = _mm_loadu_ps( right.cell   );
+	__m128 r1 = _mm_loadu_ps( right.cell+4 );
+	__m128 r2 = _mm_loadu_ps( right.cell+8 );
+	__m128 q0 = _mm_shuffle_ps( r0, r1, _MM_SHUFFLE(0,0,1,1) );	// r1 r1 r4  r4
+	__m128 q1 = _mm_shuffle_ps( r0, r1, _MM_SHUFFLE(1,1,2,2) );	// r2 r2 r5  r5
+	__m128 q2 = _mm_shuffle_ps( r1, r2, _MM_SHUFFLE(1,1,2,2) );	// r6 r6 r9  r9
+	__m128 q3 = _mm_shuffle_ps( r1, r2, _MM_SHUFFLE(2,2,3,3) );	// r7 r7 r10 r10
+	// cells 0-3: rows 0,1,2,0 of the columns 0,0,0,1
+	__m128 a = _mm_mul_ps( _mm_shuffle_ps(l0,l0,_MM_SHUFFLE(0,2,1,0)), _mm_shuffle_ps(r0,r0,_MM_SHUFFLE(3,0,0,0)) );
+	__m128 b = _mm_mul_ps( _mm_shuffle_ps(c1,c1,_MM_SHUFFLE(0,3,2,0)), _mm_shuffle_ps(q0,q0,_MM_SHUFFLE(2,0,0,0)) );
+	__m128 c = _mm_mul_ps( _mm_shuffle_ps(c2,c2,_MM_SHUFFLE(0,2,1,0)), _mm_shuffle_ps(q1,q1,_MM_SHUFFLE(2,0,0,0)) );
+	__m128 g0 = _mm_add_ps( _mm_add_ps(a,c), b );
+	// cells 4-7: rows 1,2,0,1 of the columns 1,1,2,2
+	a = _mm_mul_ps( _mm_shuffle_ps(l0,l0,_MM_SHUFFLE(1,0,2,1)), _mm_shuffle_ps(r0,r1,_MM_SHUFFLE(2,2,3,3)) );
+	b = _mm_mul_ps( _mm_shuffle_ps(c1,c1,_MM_SHUFFLE(2,0,3,2)), _mm_shuffle_ps(r1,r1,_MM_SHUFFLE(3,3,0,0)) );
+	c = _mm_mul_ps( _mm_shuffle_ps(c2,c2,_MM_SHUFFLE(1,0,2,1)), _mm_shuffle_ps(r1,r2,_MM_SHUFFLE(0,0,1,1)) );
+	__m128 g1 = _mm_add_ps( _mm_add_ps(a,c), b );
+	// cells 8-11: rows 2,0,1,2 of the columns 2,3,3,3, plus the translation of the left matrix
+	a = _mm_mul_ps( _mm_shuffle_ps(l0,l0,_MM_SHUFFLE(2,1,0,2)), _mm_shuffle_ps(q2,q2,_MM_SHUFFLE(2,2,2,0)) );
+	b = _mm_mul_ps( _mm_shuffle_ps(c1,c1,_MM_SHUFFLE(3,2,0,3)), _mm_shuffle_ps(q3,q3,_MM_SHUFFLE(2,2,2,0)) );
+	c = _mm_mul_ps( _mm_shuffle_ps(c2,c2,_MM_SHUFFLE(2,1,0,2)), _mm_shuffle_ps(r2,r2,_MM_SHUFFLE(3,3,3,0)) );
+	__m128 g2 = _mm_add_ps( _mm_add_ps(a,c), _mm_add_ps(b,c3) );
+	Matrix34<float> rm;
+	_mm_storeu_ps( rm.cell,   g0 );
+	_mm_storeu_ps( rm.cell+4, g1 );
+	_mm_storeu_ps( rm.cell+8, g2 );
+	return rm;
+}
+
+#endif
+
 template <typename T> inline Matrix4<T> Matrix34<T>::GetTranspose() const
 {
 	Matrix4<T> m;
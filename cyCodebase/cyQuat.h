@@ -0,0 +1,367 @@
+// cyCodeBase by Cem Yuksel
+// [www.cemyuksel.com]
+//-------------------------------------------------------------------------------
+//! \file   cyQuat.h
+//!
+//! \brief  Quaternion and dual quaternion classes for rigid transformations
+//!
+//! Quat stores a rotation in 4 values and DualQuat stores a rigid transformation
+//! (rotation followed by translation) in 8 values, compared to the 12 values of
+//! Matrix34 and 16 values of Matrix4. Composing two dual quaternions takes
+//! 48 multiplications and 40 additions, more than the 36 and 27 of Matrix34
+//! (64 and 48 of Matrix4), so DualQuat saves memory rather than arithmetic.
+//! It suits transformations that are stored or sent per node or bone, or that
+//! are blended, since the blend stays rigid after normalization.
+//!
+//-------------------------------------------------------------------------------
+//
+// Copyright (c) 2016, Cem Yuksel <cem@cemyuksel.com>
+// All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+//-------------------------------------------------------------------------------
+
+#ifndef _CY_QUAT_H_INCLUDED_
+#define _CY_QUAT_H_INCLUDED_
+
+//-------------------------------------------------------------------------------
+
+#include "cyMatrix.h"
+
+//-------------------------------------------------------------------------------
+namespace cy {
+//-------------------------------------------------------------------------------
+
+//! Quaternion class.
+//!
+//! The quaternion is stored as x,y,z (vector part) and w (scalar part), in this
+//! order, so that it can be loaded into a single SIMD register.
+//! Unit quaternions represent rotations. The product q1*q2 represents
+//! the rotation q2 followed by q1, matching the order of matrix multiplication.
+
+template <typename T>
+class Quat
+{
+	CY_NODISCARD friend Quat operator * ( T v, Quat const &q ) { return q*v; }	//!< Multiplication with a constant
+
+public:
+
+	//!@name Components of the quaternion
+	T x, y, z, w;
+
+	//////////////////////////////////////////////////////////////////////////
+	//!@name Constructors
+
+	Quat() CY_CLASS_FUNCTION_DEFAULT
+	Quat( T _x, T _y, T _z, T _w )          : x(_x),  y(_y),  z(_z),  w(_w) {}
+	Quat( Vec3<T> const &v, T _w )          : x(v.x), y(v.y), z(v.z), w(_w) {}
+	template <typename S> explicit Quat( Quat<S> const &q ) : x(T(q.x)), y(T(q.y)), z(T(q.z)), w(T(q.w)) {}
+	explicit Quat( Matrix3 <T> const &m ) { SetRotation(m); }					//!< Initialize using the rotation matrix m, which must be orthonormal
+	explicit Quat( Matrix34<T> const &m ) { SetRotation(Matrix3<T>(m)); }		//!< Initialize using the rotation portion of m, which must not contain scale or shear
+	explicit Quat( Matrix4 <T> const &m ) { SetRotation(Matrix3<T>(m)); }		//!< Initialize using the rotation portion of m, which must not contain scale, shear, or projection
+
+	//////////////////////////////////////////////////////////////////////////
+	//!@name Set & Get Methods
+
+	void Zero       ()                       { x=0; y=0; z=0; w=0; }			//!< Sets all components as zero.
+	void SetIdentity()                       { x=0; y=0; z=0; w=1; }			//!< Sets the quaternion as identity (no rotation).
+	void Set        ( T _x, T _y, T _z, T _w ) { x=_x; y=_y; z=_z; w=_w; }		//!< Sets the components using the given values.
+	void Set        ( Vec3<T> const &v, T _w ) { x=v.x; y=v.y; z=v.z; w=_w; }	//!< Sets the vector and scalar parts.
+
+	//! Set as rotation about the given axis by angle. The axis must be normalized.
+	void SetRotation( Vec3<T> const &axis, T angle ) { T h=angle*T(0.5); Set( axis*std::sin(h), std::cos(h) ); }
+	void SetRotationX( T angle ) { T h=angle*T(0.5); Set( std::sin(h), 0, 0, std::cos(h) ); }	//!< Set as rotation about x axis
+	void SetRotationY( T angle ) { T h=angle*T(0.5); Set( 0, std::sin(h), 0, std::cos(h) ); }	//!< Set as rotation about y axis
+	void SetRotationZ( T angle ) { T h=angle*T(0.5); Set( 0, 0, std::sin(h), std::cos(h) ); }	//!< Set as rotation about z axis
+
+	//! Set as the rotation of the given orthonormal matrix.
+	void SetRotation( Matrix3<T> const &m )
+	{
+		T const *c = m.cell;
+		T trace = c[0] + c[4] + c[8];
+		if ( trace > 0 ) {
+			T s = T(0.5) / Sqrt( trace + T(1) );
+			Set( (c[5]-c[7])*s, (c[6]-c[2])*s, (c[1]-c[3])*s, T(0.25)/s );
+		} else if ( c[0] > c[4] && c[0] > c[8] ) {
+			T s = T(0.5) / Sqrt( T(1) + c[0] - c[4] - c[8] );
+			Set( T(0.25)/s, (c[3]+c[1])*s, (c[6]+c[2])*s, (c[5]-c[7])*s );
+		} else if ( c[4] > c[8] ) {
+			T s = T(0.5) / Sqrt( T(1) + c[4] - c[0] - c[8] );
+			Set( (c[3]+c[1])*s, T(0.25)/s, (c[7]+c[5])*s, (c[6]-c[2])*s );
+		} else {
+			T s = T(0.5) / Sqrt( T(1) + c[8] - c[0] - c[4] );
+			Set( (c[6]+c[2])*s, (c[7]+c[5])*s, T(0.25)/s, (c[1]-c[3])*s );
+		}
+	}
+
+	CY_NODISCARD Vec3<T>       & V()       { return *((Vec3<T>*)&x); }		//!< Returns the vector part
+	CY_NODISCARD Vec3<T> const & V() const { return *((Vec3<T>*)&x); }		//!< Returns the vector part
+
+	//! Returns the equivalent 3x3 rotation matrix. The quaternion must be normalized.
+	CY_NODISCARD Matrix3<T> GetMatrix3() const
+	{
+		T xx=x*x, yy=y*y, zz=z*z, xy=x*y, xz=x*z, yz=y*z, wx=w*x, wy=w*y, wz=w*z;
+		return Matrix3<T>( T(1)-2*(yy+zz),      2*(xy-wz),      2*(xz+wy),
+		                        2*(xy+wz), T(1)-2*(xx+zz),      2*(yz-wx),
+		                        2*(xz-wy),      2*(yz+wx), T(1)-2*(xx+yy) );
+	}
+	CY_NODISCARD Matrix34<T> GetMatrix34( Vec3<T> const &pos=Vec3<T>(T(0)) ) const { return Matrix34<T>(GetMatrix3(),pos); }	//!< Returns the rotation with the given translation as a 3x4 matrix
+	CY_NODISCARD Matrix4 <T> GetMatrix4 ( Vec3<T> const &pos=Vec3<T>(T(0)) ) const { return Matrix4 <T>(GetMatrix3(),pos); }	//!< Returns the rotation with the given translation as a 4x4 matrix
+
+	//////////////////////////////////////////////////////////////////////////
+	//!@name General methods
+
+	CY_NODISCARD T    Dot          ( Quat const &q ) const { return x*q.x + y*q.y + z*q.z + w*q.w; }	//!< Dot product
+	CY_NODISCARD T    LengthSquared() const { return Dot(*this); }										//!< Returns the square of the length
+	CY_NODISCARD T    Length       () const { return cy::Sqrt(LengthSquared()); }						//!< Returns the length
+	CY_NODISCARD Quat GetNormalized() const { return *this / Length(); }								//!< Returns a normalized copy
+	CY_NODISCARD Quat GetConjugate () const { return Quat(-x,-y,-z,w); }								//!< Returns the conjugate, which is the inverse of a unit quaternion
+	CY_NODISCARD Quat GetInverse   () const { return GetConjugate() / LengthSquared(); }				//!< Returns the inverse
+	CY_NODISCARD bool IsUnit       () const { return std::abs(LengthSquared()-T(1)) < T(0.001); }		//!< Returns true if the length is close to 1
+	void Normalize() { *this /= Length(); }		//!< Normalizes the quaternion, such that its length becomes 1
+	void Conjugate() { x=-x; y=-y; z=-z; }		//!< Converts the quaternion to its conjugate
+
+	//! Rotates the given vector. The quaternion must be normalized.
+	//! This takes 15 multiplications, as opposed to 9 for a 3x3 matrix;
+	//! prefer GetMatrix3() for transforming many vectors with the same rotation.
+	CY_NODISCARD Vec3<T> Rotate( Vec3<T> const &p ) const
+	{
+		Vec3<T> const &v = V();
+		Vec3<T> t = T(2) * v.Cross(p);
+		return p + w*t + v.Cross(t);
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	//!@name Unary and binary operators
+
+	CY_NODISCARD Quat operator - () const { return Quat(-x,-y,-z,-w); }
+
+	CY_NODISCARD Quat operator + ( Quat const &q ) const { return Quat( x+q.x, y+q.y, z+q.z, w+q.w ); }
+	CY_NODISCARD Quat operator - ( Quat const &q ) const { return Quat( x-q.x, y-q.y, z-q.z, w-q.w ); }
+	CY_NODISCARD Quat operator * ( T    const  v ) const { return Quat( x*v,   y*v,   z*v,   w*v   ); }
+	CY_NODISCARD Quat operator / ( T    const  v ) const { return operator*( T(1)/v ); }
+
+	//! Quaternion (Hamilton) product
+	CY_NODISCARD Quat operator * ( Quat const &q ) const
+	{
+		return Quat( w*q.x + x*q.w + y*q.z - z*q.y,
+		             w*q.y - x*q.z + y*q.w + z*q.x,
+		             w*q.z + x*q.y - y*q.x + z*q.w,
+		             w*q.w - x*q.x - y*q.y - z*q.z );
+	}
+
+	Quat const& operator += ( Quat const &q ) { *this = *this + q; return *this; }
+	Quat const& operator -= ( Quat const &q ) { *this = *this - q; return *this; }
+	Quat const& operator *= ( Quat const &q ) { *this = *this * q; return *this; }
+	Quat const& operator *= ( T    const  v ) { x*=v; y*=v; z*=v; w*=v; return *this; }
+	Quat const& operator /= ( T    const  v ) { return operator*=( T(1)/v ); }
+
+	CY_NODISCARD Vec3<T> operator * ( Vec3<T> const &p ) const { return Rotate(p); }	//!< Rotates the given vector
+
+	//!@name Test operators
+	CY_NODISCARD bool operator == ( Quat const &q ) const { return x==q.x && y==q.y && z==q.z && w==q.w; }
+	CY_NODISCARD bool operator != ( Quat const &q ) const { return x!=q.x || y!=q.y || z!=q.z || w!=q.w; }
+
+	//////////////////////////////////////////////////////////////////////////
+	//!@name Interpolation
+
+	//! Normalized linear interpolation. It is not constant speed, but it is much cheaper than Slerp
+	//! and it is commutative, so it is preferable for blending more than two rotations.
+	CY_NODISCARD static Quat Nlerp( Quat const &q0, Quat const &q1, T t )
+	{
+		T s = q0.Dot(q1) < 0 ? -t : t;	// take the shorter path
+		return ( q0*(T(1)-t) + q1*s ).GetNormalized();
+	}
+
+	//! Spherical linear interpolation with constant angular speed along the shorter path.
+	CY_NODISCARD static Quat Slerp( Quat const &q0, Quat const &q1, T t )
+	{
+		T c = q0.Dot(q1);
+		T sign = T(1);
+		if ( c < 0 ) { c = -c; sign = T(-1); }
+		if ( c > T(0.9995) ) return Nlerp( q0, q1, t );		// nearly parallel, avoid dividing by sin(0)
+		T theta = std::acos(c);
+		T invSin = T(1) / std::sin(theta);
+		T s0 = std::sin( (T(1)-t) * theta ) * invSin;
+		T s1 = std::sin( t * theta ) * invSin * sign;
+		return q0*s0 + q1*s1;
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	//!@name Static Methods
+
+	CY_NODISCARD static Quat Identity() { return Quat(0,0,0,1); }	//!< Returns the identity quaternion
+	CY_NODISCARD static Quat Rotation ( Vec3<T> const &axis, T angle ) { Quat q; q.SetRotation(axis,angle); return q; }	//!< Returns a rotation about the given axis by angle
+	CY_NODISCARD static Quat RotationX( T angle ) { Quat q; q.SetRotationX(angle); return q; }	//!< Returns a rotation about x axis
+	CY_NODISCARD static Quat RotationY( T angle ) { Quat q; q.SetRotationY(angle); return q; }	//!< Returns a rotation about y axis
+	CY_NODISCARD static Quat RotationZ( T angle ) { Quat q; q.SetRotationZ(angle); return q; }	//!< Returns a rotation about z axis
+
+	//////////////////////////////////////////////////////////////////////////
+};
+
+//-------------------------------------------------------------------------------
+
+#ifdef _CY_SSE
+
+//! SSE version of the quaternion product: each component of this quaternion
+//! scales a sign-flipped permutation of q, so the product takes 4 vector multiplications.
+template<> CY_NODISCARD inline Quat<float> Quat<float>::operator * ( Quat<float> const &q ) const
+{
+	__m128 b  = _mm_loadu_ps( &q.x );
+	__m128 rx = _mm_xor_ps( _mm_shuffle_ps(b,b,_MM_SHUFFLE(0,1,2,3)), _mm_set_ps(-0.0f, 0.0f,-0.0f, 0.0f) );	// ( w,-z, y,-x)
+	__m128 ry = _mm_xor_ps( _mm_shuffle_ps(b,b,_MM_SHUFFLE(1,0,3,2)), _mm_set_ps(-0.0f,-0.0f, 0.0f, 0.0f) );	// ( z, w,-x,-y)
+	__m128 rz = _mm_xor_ps( _mm_shuffle_ps(b,b,_MM_SHUFFLE(2,3,0,1)), _mm_set_ps(-0.0f, 0.0f, 0.0f,-0.0f) );	// (-y, x, w,-z)
+	__m128 r  = _mm_mul_ps( _mm_set1_ps(w), b );
+	r = _mm_add_ps( r, _mm_mul_ps( _mm_set1_ps(x), rx ) );
+	r = _mm_add_ps( r, _mm_mul_ps( _mm_set1_ps(y), ry ) );
+	r = _mm_add_ps( r, _mm_mul_ps( _mm_set1_ps(z), rz ) );
+	Quat<float> p;
+	_mm_storeu_ps( &p.x, r );
+	return p;
+}
+
+#endif
+
+//-------------------------------------------------------------------------------
+
+//! Dual quaternion class for rigid transformations.
+//!
+//! The real part holds the rotation and the dual part holds half of the translation
+//! multiplied by the rotation. A unit dual quaternion represents the rotation
+//! followed by the translation; it cannot represent scale or shear.
+//! The product d1*d2 represents the transformation d2 followed by d1,
+//! matching the order of matrix multiplication.
+
+template <typename T>
+class DualQuat
+{
+public:
+
+	//!@name Components of the dual quaternion
+	Quat<T> real;	//!< Rotation
+	Quat<T> dual;	//!< Half of the translation multiplied by the rotation
+
+	//////////////////////////////////////////////////////////////////////////
+	//!@name Constructors
+
+	DualQuat() CY_CLASS_FUNCTION_DEFAULT
+	DualQuat( Quat<T> const &r, Quat<T> const &d ) : real(r), dual(d) {}
+	explicit DualQuat( Quat<T> const &rotation, Vec3<T> const &translation=Vec3<T>(T(0)) ) { Set(rotation,translation); }
+	template <typename S> explicit DualQuat( DualQuat<S> const &d ) : real(d.real), dual(d.dual) {}
+	explicit DualQuat( Matrix34<T> const &m ) { Set( Quat<T>(m), m.GetTranslation() ); }	//!< Initialize using a rigid transformation matrix
+	explicit DualQuat( Matrix4 <T> const &m ) { Set( Quat<T>(m), Vec3<T>(m.Column(3)) ); }	//!< Initialize using a rigid transformation matrix
+
+	//////////////////////////////////////////////////////////////////////////
+	//!@name Set & Get Methods
+
+	void SetIdentity() { real.SetIdentity(); dual.Zero(); }		//!< Sets as identity transformation
+
+	//! Sets as the given rotation followed by the given translation. The rotation must be normalized.
+	void Set( Quat<T> const &rotation, Vec3<T> const &translation )
+	{
+		real = rotation;
+		dual = Quat<T>( translation*T(0.5), T(0) ) * rotation;
+	}
+	void SetRotation   ( Quat<T> const &rotation ) { real = rotation; dual.Zero(); }						//!< Sets as pure rotation
+	void SetTranslation( Vec3<T> const &move )     { real.SetIdentity(); dual.Set(move*T(0.5),T(0)); }	//!< Sets as pure translation
+
+	CY_NODISCARD Quat<T> GetRotation   () const { return real; }								//!< Returns the rotation
+	CY_NODISCARD Vec3<T> GetTranslation() const { return T(2) * (dual * real.GetConjugate()).V(); }	//!< Returns the translation
+
+	CY_NODISCARD Matrix34<T> GetMatrix34() const { return real.GetMatrix34( GetTranslation() ); }	//!< Returns the equivalent 3x4 matrix
+	CY_NODISCARD Matrix4 <T> GetMatrix4 () const { return real.GetMatrix4 ( GetTranslation() ); }	//!< Returns the equivalent 4x4 matrix
+
+	//////////////////////////////////////////////////////////////////////////
+	//!@name General methods
+
+	//! Normalizes the dual quaternion, also removing the drift that accumulates in long chains of products.
+	void Normalize()
+	{
+		T invLen = T(1) / real.Length();
+		real *= invLen;
+		dual *= invLen;
+		dual -= real * real.Dot(dual);
+	}
+	CY_NODISCARD DualQuat GetNormalized() const { DualQuat d=*this; d.Normalize(); return d; }		//!< Returns a normalized copy
+	CY_NODISCARD DualQuat GetInverse   () const { return DualQuat( real.GetConjugate(), dual.GetConjugate() ); }	//!< Returns the inverse of a unit dual quaternion
+
+	CY_NODISCARD Vec3<T> TransformPoint ( Vec3<T> const &p ) const { return real.Rotate(p) + GetTranslation(); }	//!< Transforms the given point
+	CY_NODISCARD Vec3<T> TransformVector( Vec3<T> const &v ) const { return real.Rotate(v); }						//!< Transforms the given vector, ignoring translation
+
+	//////////////////////////////////////////////////////////////////////////
+	//!@name Binary operators
+
+	//! Composes two transformations using 3 quaternion products
+	CY_NODISCARD DualQuat operator * ( DualQuat const &d ) const { return DualQuat( real*d.real, real*d.dual + dual*d.real ); }
+	CY_NODISCARD Vec3<T>  operator * ( Vec3<T>  const &p ) const { return TransformPoint(p); }		//!< Transforms the given point
+
+	DualQuat const& operator *= ( DualQuat const &d ) { *this = *this * d; return *this; }
+
+	//////////////////////////////////////////////////////////////////////////
+	//!@name Interpolation
+
+	//! Dual quaternion linear blending. It is cheap and commutative, so it is suitable for skinning with multiple bones.
+	CY_NODISCARD static DualQuat Nlerp( DualQuat const &d0, DualQuat const &d1, T t )
+	{
+		T s = d0.real.Dot(d1.real) < 0 ? -t : t;	// take the shorter path
+		DualQuat d( d0.real*(T(1)-t) + d1.real*s, d0.dual*(T(1)-t) + d1.dual*s );
+		d.Normalize();
+		return d;
+	}
+
+	//! Interpolates the rotation using Slerp and the translation linearly.
+	CY_NODISCARD static DualQuat Slerp( DualQuat const &d0, DualQuat const &d1, T t )
+	{
+		Vec3<T> p0 = d0.GetTranslation();
+		Vec3<T> p1 = d1.GetTranslation();
+		return DualQuat( Quat<T>::Slerp(d0.real,d1.real,t), p0 + (p1-p0)*t );
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	//!@name Static Methods
+
+	CY_NODISCARD static DualQuat Identity() { DualQuat d; d.SetIdentity(); return d; }									//!< Returns the identity transformation
+	CY_NODISCARD static DualQuat Rotation   ( Quat<T> const &rotation ) { DualQuat d; d.SetRotation(rotation); return d; }	//!< Returns a pure rotation
+	CY_NODISCARD static DualQuat Translation( Vec3<T> const &move )     { DualQuat d; d.SetTranslation(move);  return d; }	//!< Returns a pure translation
+
+	//////////////////////////////////////////////////////////////////////////
+};
+
+//-------------------------------------------------------------------------------
+
+typedef Quat    <float>  Quatf;		//!< Single precision (float) quaternion class
+typedef DualQuat<float>  DualQuatf;	//!< Single precision (float) dual quaternion class
+
+typedef Quat    <double> Quatd;		//!< Double precision (double) quaternion class
+typedef DualQuat<double> DualQuatd;	//!< Double precision (double) dual quaternion class
+
+//-------------------------------------------------------------------------------
+} // namespace cy
+//-------------------------------------------------------------------------------
+
+typedef cy::Quatf     cyQuatf;		//!< Single precision (float) quaternion class
+typedef cy::DualQuatf cyDualQuatf;	//!< Single precision (float) dual quaternion class
+
+typedef cy::Quatd     cyQuatd;		//!< Double precision (double) quaternion class
+typedef cy::DualQuatd cyDualQuatd;	//!< Double precision (double) dual quaternion class
+
+//-------------------------------------------------------------------------------
+
+#endif
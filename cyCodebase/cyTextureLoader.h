@@ -0,0 +1,459 @@
+// cyCodeBase by Cem Yuksel
+// [www.cemyuksel.com]
+//-------------------------------------------------------------------------------
+//! \file   cyTextureLoader.h
+//!
+//! \brief  Concurrent PNG decoding for texture loading.
+//!
+//! TaskPool is a small work-stealing thread pool: each worker owns a queue,
+//! and a worker whose queue is empty takes tasks from the back of the others.
+//! TextureBatchLoader decodes PNG files on such a pool with lodepng, one file
+//! per task, and hands out shared futures of the decoded images. Requests
+//! for a path that is already loading or loaded return the same future, so
+//! models that use a file for several materials decode it once.
+//!
+//! The GL calls stay on the main thread: it polls the futures (see IsReady)
+//! and creates the textures of the images that are done. With an allocator,
+//! such as a GLTextureUploader, the workers decode straight into the staging
+//! memory of the upload.
+//!
+//! If cyGL.h is included before this file, GLTextureReceiver does that part:
+//! it creates the 2D textures of the finished images and submits their
+//! uploads and mipmap generation to a GLTextureUploader.
+//!
+//-------------------------------------------------------------------------------
+//
+// Copyright (c) 2016, Cem Yuksel <cem@cemyuksel.com>
+// All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+//-------------------------------------------------------------------------------
+
+#ifndef _CY_TEXTURE_LOADER_H_INCLUDED_
+#define _CY_TEXTURE_LOADER_H_INCLUDED_
+
+//-------------------------------------------------------------------------------
+
+#include "lodepng.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <unordered_map>
+#include <vector>
+
+//-------------------------------------------------------------------------------
+namespace cy {
+//-------------------------------------------------------------------------------
+
+//! A thread pool with a task queue per worker thread.
+//!
+//! Submitted tasks are spread over the queues in turn. A worker runs the tasks
+//! of its own queue in submission order, and when its queue is empty, it steals
+//! the most recently submitted task of another queue, so that a few long tasks
+//! in one queue do not hold back the tasks behind them.
+
+class TaskPool
+{
+public:
+	typedef std::function<void(unsigned worker)> Task;	//!< A task, called with the index of the worker that runs it
+
+private:
+	struct Queue
+	{
+		std::mutex      mutex;
+		std::deque<Task> tasks;
+	};
+	std::unique_ptr<Queue[]>  queues;		//!< The task queue of each worker
+	std::vector<std::thread>  threads;		//!< The worker threads
+	std::atomic<unsigned>     nextQueue;	//!< The queue of the next submitted task
+	std::atomic<bool>         stopped;		//!< True once Close is called
+	size_t                    pending;		//!< The number of queued tasks that no worker has claimed yet
+	std::mutex                mutex;		//!< Guards pending
+	std::condition_variable   taskAvailable;
+
+	void Run( unsigned worker );
+	bool Pop( unsigned worker, Task &task );
+
+public:
+	//! Starts the given number of worker threads. Zero uses one thread per hardware thread.
+	explicit TaskPool( unsigned numThreads=0 );
+	~TaskPool() { Close(); }	//!< Destructor, see Close.
+
+	TaskPool( TaskPool const & ) = delete;
+	TaskPool& operator = ( TaskPool const & ) = delete;
+
+	//! Queues a task. The tasks submitted after Close are discarded.
+	void Submit( Task task );
+
+	//! Discards the tasks that are not started yet and waits for the running ones to finish.
+	void Close();
+
+	unsigned NumThreads() const { return (unsigned) threads.size(); }	//!< Returns the number of worker threads.
+};
+
+//-------------------------------------------------------------------------------
+
+//! Decodes PNG files concurrently on a TaskPool.
+//!
+//! Load returns a shared future of the decoded RGBA8 image. Repeated requests
+//! for the same path return the future of the first one, so each file is read
+//! and decoded once. The loader keeps its futures until Clear is called, and
+//! the pixels of an image without an allocator stay in memory while any copy
+//! of its future exists.
+//!
+//! An allocator moves the pixels to memory of the caller's choosing, such as
+//! the staging buffer of a GLTextureUploader. It is called on the worker
+//! threads and returns nullptr if it cannot provide the memory. The caller
+//! then owns the memory of each image with non-null pixels, including the
+//! ones that failed to decode, and the allocator's ticket identifies it.
+//! The pixels of such an image are valid until the caller releases them.
+
+class TextureBatchLoader
+{
+public:
+	//! A decoded image. The pixels are 8-bit RGBA rows after each other, without padding.
+	struct Image
+	{
+		std::string                path;		//!< The file path
+		unsigned                   width;		//!< The image width, or 0 if the file could not be read
+		unsigned                   height;		//!< The image height, or 0 if the file could not be read
+		unsigned                   error;		//!< The lodepng error code, 0 on success (see lodepng_error_text)
+		unsigned char             *pixels;		//!< The pixels, in the storage or the memory from the allocator
+		uint64_t                   ticket;		//!< The allocator's ticket for the pixels
+		std::vector<unsigned char> storage;		//!< Holds the pixels if there is no allocator
+
+		size_t Size() const { return size_t(width) * height * 4; }	//!< Returns the size of the pixels in bytes.
+	};
+	typedef std::shared_future<std::shared_ptr<Image const>> Future;	//!< The result of a Load call
+	typedef std::function<void*(size_t size, uint64_t &ticket)> Allocator;	//!< Provides the memory of the pixels
+
+private:
+	Allocator                                allocator;
+	std::unique_ptr<lodepng::Arena[]>        arenas;	//!< The decoder scratch memory of each worker
+	std::unordered_map<std::string, Future>  cache;		//!< The futures of the requested paths
+	std::mutex                               cacheMutex;
+	TaskPool                                 pool;		//!< Declared last, so that it stops before the members above are destroyed
+
+	std::shared_ptr<Image const> Decode( std::string const &path, unsigned worker );
+
+public:
+	//! Starts the given number of decoding threads. Zero uses one thread per hardware thread.
+	explicit TextureBatchLoader( unsigned numThreads=0 ) : arenas(new lodepng::Arena[ numThreads ? numThreads : std::max( 1u, std::thread::hardware_concurrency() ) ]), pool(numThreads) {}
+
+	//! Sets the allocator of the pixels. This must be called before the first Load call.
+	void SetAllocator( Allocator alloc ) { allocator = std::move(alloc); }
+
+	//! Queues the given file for decoding, unless it is requested before, and returns the future of its image.
+	Future Load( std::string const &path );
+
+	//! Queues the given files and returns their futures in the same order. Repeated paths share their futures.
+	std::vector<Future> Load( std::vector<std::string> const &paths )
+	{
+		std::vector<Future> futures;
+		futures.reserve( paths.size() );
+		for ( std::string const &path : paths ) futures.push_back( Load(path) );
+		return futures;
+	}
+
+	//! Forgets the requested paths. The images that are still loading are completed.
+	void Clear() { std::lock_guard<std::mutex> lock(cacheMutex); cache.clear(); }
+
+	//! Discards the files that are not started yet and waits for the ones being decoded.
+	//! The futures of the discarded files hold a std::future_error with broken_promise.
+	//! If the allocator can block, it must be released before this call.
+	void Close() { pool.Close(); }
+
+	unsigned NumThreads() const { return pool.NumThreads(); }	//!< Returns the number of decoding threads.
+
+	//! Returns true if the image of the given future is available without waiting.
+	static bool IsReady( Future const &future ) { return future.wait_for( std::chrono::seconds(0) ) == std::future_status::ready; }
+};
+
+//-------------------------------------------------------------------------------
+// TaskPool Implementation
+//-------------------------------------------------------------------------------
+
+inline TaskPool::TaskPool( unsigned numThreads ) : nextQueue(0), stopped(false), pending(0)
+{
+	if ( numThreads == 0 ) numThreads = std::max( 1u, std::thread::hardware_concurrency() );
+	queues.reset( new Queue[ numThreads ] );
+	threads.reserve( numThreads );
+	for ( unsigned i=0; i<numThreads; ++i ) threads.emplace_back( [this,i]{ Run(i); } );
+}
+
+inline void TaskPool::Submit( Task task )
+{
+	if ( stopped ) return;
+	Queue &q = queues[ nextQueue++ % threads.size() ];
+	{
+		std::lock_guard<std::mutex> lock(q.mutex);
+		q.tasks.push_back( std::move(task) );
+	}
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		++pending;
+	}
+	taskAvailable.notify_one();
+}
+
+inline void TaskPool::Close()
+{
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		if ( stopped ) return;
+		stopped = true;
+	}
+	taskAvailable.notify_all();
+	for ( std::thread &t : threads ) t.join();
+	// Destroy the discarded tasks only now, since a task may still be submitted while the workers stop
+	for ( size_t i=0; i<threads.size(); ++i ) {
+		std::lock_guard<std::mutex> lock(queues[i].mutex);
+		queues[i].tasks.clear();
+	}
+}
+
+inline bool TaskPool::Pop( unsigned worker, Task &task )
+{
+	unsigned const n = (unsigned) threads.size();
+	for ( unsigned k=0; k<n; ++k ) {
+		Queue &q = queues[ (worker + k) % n ];
+		std::lock_guard<std::mutex> lock(q.mutex);
+		if ( q.tasks.empty() ) continue;
+		if ( k == 0 ) { task = std::move( q.tasks.front() ); q.tasks.pop_front(); }
+		else          { task = std::move( q.tasks.back()  ); q.tasks.pop_back();  }
+		return true;
+	}
+	return false;
+}
+
+inline void TaskPool::Run( unsigned worker )
+{
+	for (;;) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			taskAvailable.wait( lock, [this]{ return pending > 0 || stopped; } );
+			if ( stopped ) return;
+			--pending;
+		}
+		// A task is pushed before it is counted, so the claimed one is in some queue,
+		// though another worker may take it first and leave a later one in its place.
+		Task task;
+		while ( ! Pop( worker, task ) ) {
+			if ( stopped ) return;
+			std::this_thread::yield();
+		}
+		task( worker );
+	}
+}
+
+//-------------------------------------------------------------------------------
+// TextureBatchLoader Implementation
+//-------------------------------------------------------------------------------
+
+inline TextureBatchLoader::Future TextureBatchLoader::Load( std::string const &path )
+{
+	std::lock_guard<std::mutex> lock(cacheMutex);
+	auto it = cache.find( path );
+	if ( it != cache.end() ) return it->second;
+	// std::function needs a copyable task, so the promise is shared with it
+	auto promise = std::make_shared<std::promise<std::shared_ptr<Image const>>>();
+	Future future = promise->get_future().share();
+	cache.emplace( path, future );
+	pool.Submit( [this,path,promise]( unsigned worker ) {
+		try { promise->set_value( Decode( path, worker ) ); }
+		catch ( ... ) { promise->set_exception( std::current_exception() ); }
+	} );
+	return future;
+}
+
+inline std::shared_ptr<TextureBatchLoader::Image const> TextureBatchLoader::Decode( std::string const &path, unsigned worker )
+{
+	std::shared_ptr<Image> image = std::make_shared<Image>();
+	image->path   = path;
+	image->width  = 0;
+	image->height = 0;
+	image->pixels = nullptr;
+	image->ticket = 0;
+
+	std::vector<unsigned char> file;
+	lodepng::State state;
+	state.decoder.num_threads = 1;	// the files are decoded in parallel instead
+	unsigned width = 0, height = 0;
+	unsigned error = lodepng::load_file( file, path );
+	if ( ! error ) error = lodepng_inspect( &width, &height, &state, file.data(), file.size() );
+	if ( ! error ) {
+		size_t size = lodepng_get_raw_size( width, height, &state.info_raw );
+		image->width  = width;
+		image->height = height;
+		if ( allocator ) {
+			image->pixels = (unsigned char*) allocator( size, image->ticket );
+		} else {
+			image->storage.resize( size );
+			image->pixels = image->storage.data();
+		}
+		if ( image->pixels == nullptr ) error = 83;	// memory allocation failed
+		else error = lodepng_decode_into( image->pixels, size, 0, &width, &height, &state, file.data(), file.size(), &arenas[worker] );
+	}
+	image->error = error;
+	return image;
+}
+
+//-------------------------------------------------------------------------------
+
+#ifdef _CY_GL_H_INCLUDED_
+
+//! Creates the 2D textures of the images of a TextureBatchLoader on the main thread.
+//!
+//! The images are requested with Add, which also takes the texture ID variable
+//! that receives the texture. Receive polls the futures, creates an RGBA8 texture
+//! with mipmaps for each image that is done and submits its upload to the
+//! GLTextureUploader, so the following Process call issues it. Requests that
+//! share an image share its texture. A texture ID stays 0 if its image fails.
+//!
+//! The loader should decode into the staging memory of the uploader (see
+//! GetAllocator), but images with their own storage are copied into it too.
+
+class GLTextureReceiver
+{
+	typedef TextureBatchLoader::Image Image;
+	struct Request
+	{
+		TextureBatchLoader::Future future;
+		GLuint                    *texture;	//!< Receives the texture ID
+		char const                *type;	//!< The kind of texture in the messages, such as "diffuse"
+	};
+	GLTextureUploader                         &uploader;
+	GLMipmapGenerator                         *mipmapGenerator;
+	std::vector<Request>                       requests;	//!< The requests whose images are not done yet
+	std::unordered_map<Image const*, GLuint>   textures;	//!< The textures of the received images
+	std::ostream                              *outStream;
+	std::ostream                              *errStream;
+
+public:
+	//! Constructor. The textures are uploaded with the given uploader, and their mipmaps are built with the
+	//! given generator, or with glGenerateTextureMipmap if it is null. The loaded files are reported to
+	//! outStream and the failures to errStream, either of which can be null.
+	GLTextureReceiver( GLTextureUploader &uploader, GLMipmapGenerator *mipmapGenerator=nullptr, std::ostream *outStream=&std::cout, std::ostream *errStream=&std::cerr )
+		: uploader(uploader), mipmapGenerator(mipmapGenerator), outStream(outStream), errStream(errStream) {}
+
+	//! Returns an allocator for TextureBatchLoader::SetAllocator that decodes the images into the staging memory
+	//! of the uploader. It waits for free memory, so the uploader must be closed before the loader.
+	TextureBatchLoader::Allocator GetAllocator() { GLTextureUploader *u = &uploader; return [u]( size_t size, uint64_t &ticket ) { return u->Allocate( GLsizeiptr(size), ticket ); }; }
+
+	//! Requests the texture of the given image. The texture ID is written by the Receive call that finds the
+	//! image done, so the variable must stay valid until then. The type names the texture in the messages.
+	void Add( TextureBatchLoader::Future const &future, GLuint *texture, char const *type="" ) { requests.push_back( { future, texture, type } ); }
+
+	//! Sets the texture IDs of the requests whose images are done and submits the uploads of the new textures.
+	//! Returns the number of requests that are still waiting.
+	size_t Receive();
+
+	size_t NumPending() const { return requests.size(); }	//!< Returns the number of requests whose images are not done yet.
+
+	//! Creates the texture of a decoded image with storage for all mipmap levels and submits the upload of
+	//! the pixels followed by the mipmap generation. Returns 0 and releases the staging memory if the image
+	//! could not be decoded.
+	GLuint CreateTexture( TextureBatchLoader::Image const &image );
+};
+
+//-------------------------------------------------------------------------------
+// GLTextureReceiver Implementation
+//-------------------------------------------------------------------------------
+
+inline size_t GLTextureReceiver::Receive()
+{
+	for ( size_t i=0; i<requests.size(); ) {
+		Request &r = requests[i];
+		if ( ! TextureBatchLoader::IsReady( r.future ) ) { ++i; continue; }
+		std::shared_ptr<TextureBatchLoader::Image const> image = r.future.get();
+		auto found = textures.find( image.get() );
+		if ( found == textures.end() ) found = textures.emplace( image.get(), CreateTexture( *image ) ).first;
+		*r.texture = found->second;
+		char const *space = r.type[0] ? " " : "";
+		if ( found->second != 0 ) {
+			if ( outStream ) *outStream << "Loaded " << r.type << space << "texture: " << image->path << std::endl;
+		} else if ( errStream ) {
+			if ( image->pixels == nullptr && GLsizeiptr(image->Size()) > uploader.GetSize() ) {
+				*errStream << "Texture is too large for the upload buffer: " << image->path << std::endl;
+			} else {
+				*errStream << "Failed to load " << r.type << space << "texture: " << image->path << std::endl;
+			}
+		}
+		r = std::move( requests.back() );
+		requests.pop_back();
+	}
+	return requests.size();
+}
+
+inline GLuint GLTextureReceiver::CreateTexture( TextureBatchLoader::Image const &image )
+{
+	if ( image.error ) {
+		if ( image.pixels != nullptr && image.storage.empty() ) uploader.Submit( image.ticket, []( void const * ){} );
+		return 0;
+	}
+	GLsizei width = image.width, height = image.height;
+	GLuint id;
+	glCreateTextures( GL_TEXTURE_2D, 1, &id );
+	glTextureStorage2D( id, GLTexture2D::NumMipmapLevels(width,height), GL_RGBA8, width, height );
+	glTextureParameteri( id, GL_TEXTURE_MAG_FILTER, GL_LINEAR );
+	glTextureParameteri( id, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR );
+	uint64_t ticket = image.ticket;
+	if ( ! image.storage.empty() ) {
+		void *pixels = uploader.Allocate( GLsizeiptr(image.Size()), ticket, false );
+		if ( pixels == nullptr ) {
+			glDeleteTextures( 1, &id );
+			return 0;
+		}
+		memcpy( pixels, image.pixels, image.Size() );
+	}
+	GLMipmapGenerator *generator = mipmapGenerator;
+	uploader.Submit( ticket, [id,width,height,generator]( void const *pixels ) {
+		glTextureSubImage2D( id, 0, 0, 0, width, height, GL_RGBA, GL_UNSIGNED_BYTE, pixels );
+		// Alpha-weighted filtering keeps the color of cut-out texels from bleeding into the smaller levels
+		if ( generator ) generator->Generate( id, GLMipmapGenerator::FILTER_BOX, true );
+		else glGenerateTextureMipmap( id );
+	} );
+	return id;
+}
+
+#endif // _CY_GL_H_INCLUDED_
+
+//-------------------------------------------------------------------------------
+} // namespace cy
+//-------------------------------------------------------------------------------
+
+typedef cy::TaskPool           cyTaskPool;				//!< A thread pool with a task queue per worker thread
+typedef cy::TextureBatchLoader cyTextureBatchLoader;	//!< Decodes PNG files concurrently on a TaskPool
+#ifdef _CY_GL_H_INCLUDED_
+typedef cy::GLTextureReceiver  cyGLTextureReceiver;		//!< Creates and uploads the textures of a TextureBatchLoader
+#endif
+
+//-------------------------------------------------------------------------------
+
+#endif
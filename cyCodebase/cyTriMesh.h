@@ -37,6 +37,7 @@
 //-------------------------------------------------------------------------------
 
 #include "cyVector.h"
+#include "cyVec3Array.h"
 #include <vector>
 #include <iostream>
 
@@ -121,14 +122,15 @@ protected:
 
 	Vec3f boundMin;	//!< Bounding box minimum bound
 	Vec3f boundMax;	//!< Bounding box maximum bound
+	Vec3d origin;	//!< Double precision origin that the vertex positions are relative to
 
 public:
 
 	//!@name Constructors and Destructor
 	TriMesh() : v(nullptr), f(nullptr), vn(nullptr), fn(nullptr), vt(nullptr), ft(nullptr), m(nullptr), mcfc(nullptr)
-				, nv(0), nf(0), nvn(0), nvt(0), nm(0),boundMin(1,1,1), boundMax(0,0,0) {}
+				, nv(0), nf(0), nvn(0), nvt(0), nm(0),boundMin(1,1,1), boundMax(0,0,0), origin(0,0,0) {}
 	TriMesh( TriMesh const &t ) : v(nullptr), f(nullptr), vn(nullptr), fn(nullptr), vt(nullptr), ft(nullptr), m(nullptr), mcfc(nullptr)
-				, nv(0), nf(0), nvn(0), nvt(0), nm(0),boundMin(1,1,1), boundMax(0,0,0) { *this = t; }
+				, nv(0), nf(0), nvn(0), nvt(0), nm(0),boundMin(1,1,1), boundMax(0,0,0), origin(0,0,0) { *this = t; }
 	virtual ~TriMesh() { Clear(); }
 
 	//!@name Component Access Methods
@@ -157,18 +159,21 @@ public:
 	bool HasTextureVertices() const { return NVT() > 0; }	//!< returns true if the mesh has texture vertices
 
 	//!@name Set Component Count
-	void Clear() { SetNumVertex(0); SetNumFaces(0); SetNumNormals(0); SetNumTexVerts(0); SetNumMtls(0); boundMin.Set(1,1,1); boundMax.Zero(); }	//!< Deletes all components of the mesh
+	void Clear() { SetNumVertex(0); SetNumFaces(0); SetNumNormals(0); SetNumTexVerts(0); SetNumMtls(0); boundMin.Set(1,1,1); boundMax.Zero(); origin.Zero(); }	//!< Deletes all components of the mesh
 	void SetNumVertex  ( unsigned int n ) { Allocate(n,v,nv); }															//!< Sets the number of vertices and allocates memory for vertex positions
 	void SetNumFaces   ( unsigned int n ) { Allocate(n,f,nf); if (fn||vn) Allocate(n,fn); if (ft||vt) Allocate(n,ft); }	//!< Sets the number of faces and allocates memory for face data. Normal faces and texture faces are also allocated, if they are used.
 	void SetNumNormals ( unsigned int n ) { Allocate(n,vn,nvn); Allocate(n==0?0:nf,fn); }									//!< Sets the number of normals and allocates memory for normals and normal faces.
 	void SetNumTexVerts( unsigned int n ) { Allocate(n,vt,nvt); Allocate(n==0?0:nf,ft); }									//!< Sets the number of texture coordinates and allocates memory for texture coordinates and texture faces.
 	void SetNumMtls    ( unsigned int n ) { Allocate(n,m,nm); Allocate(n,mcfc); }											//!< Sets the number of materials and allocates memory for material data.
+	void SetOrigin     ( Vec3d const &o ) { origin = o; }																		//!< Sets the double precision origin without modifying the vertex positions relative to it.
 	void operator = ( TriMesh const &t );																					//!< Copies mesh data from the given mesh.
 
 	//!@name Get Property Methods
 	bool  IsBoundBoxReady() const { return boundMin.x<=boundMax.x && boundMin.y<=boundMax.y && boundMin.z<=boundMax.z; }	//!< Returns true if the bounding box has been computed.
 	Vec3f GetBoundMin() const { return boundMin; }		//!< Returns the minimum values of the bounding box
 	Vec3f GetBoundMax() const { return boundMax; }		//!< Returns the maximum values of the bounding box
+	Vec3d GetOrigin() const { return origin; }			//!< Returns the double precision origin that the vertex positions and the bounding box are relative to
+	Vec3d GetWorldVertex(int i) const { return origin + Vec3d(v[i]); }	//!< Returns the i^th vertex position in double precision world coordinates
 	Vec3f GetVec     (int faceID, Vec3f const &bc) const { return Interpolate(faceID,v,f,bc); }		//!< Returns the point on the given face with the given barycentric coordinates (bc).
 	Vec3f GetNormal  (int faceID, Vec3f const &bc) const { return Interpolate(faceID,vn,fn,bc); }	//!< Returns the the surface normal on the given face at the given barycentric coordinates (bc). The returned vector is not normalized.
 	Vec3f GetTexCoord(int faceID, Vec3f const &bc) const { return Interpolate(faceID,vt,ft,bc); }	//!< Returns the texture coordinate on the given face at the given barycentric coordinates (bc).
@@ -176,12 +181,23 @@ public:
 	int   GetMaterialFaceCount(int mtlID) const { return mtlID>0 ? mcfc[mtlID]-mcfc[mtlID-1] : mcfc[0]; }	//!< Returns the number of faces associated with the given material ID.
 	int   GetMaterialFirstFace(int mtlID) const { return mtlID>0 ? mcfc[mtlID-1] : 0; }	//!< Returns the first face index associated with the given material ID. Other faces associated with the same material are placed are placed consecutively.
 
+	//!@name Structure of Arrays Access
+	void GetVertexArray  ( Vec3fArray &a ) const { a.SetAoS(v, nv); }		//!< Copies the vertex positions to the given structure of arrays
+	void GetNormalArray  ( Vec3fArray &a ) const { a.SetAoS(vn,nvn); }		//!< Copies the vertex normals to the given structure of arrays
+	void GetTexVertArray ( Vec3fArray &a ) const { a.SetAoS(vt,nvt); }		//!< Copies the texture coordinates to the given structure of arrays
+	void SetVertexArray  ( Vec3fArray const &a ) { SetNumVertex  ((unsigned int)a.Size()); a.GetAoS(v ); }	//!< Sets the vertex positions from the given structure of arrays. Faces are not modified.
+	void SetNormalArray  ( Vec3fArray const &a ) { SetNumNormals ((unsigned int)a.Size()); a.GetAoS(vn); }	//!< Sets the vertex normals from the given structure of arrays. Normal faces are reallocated, if the number of normals changes.
+	void SetTexVertArray ( Vec3fArray const &a ) { SetNumTexVerts((unsigned int)a.Size()); a.GetAoS(vt); }	//!< Sets the texture coordinates from the given structure of arrays. Texture faces are reallocated, if the number of texture coordinates changes.
+
 	//!@name Compute Methods
 	void ComputeBoundingBox();						//!< Computes the bounding box
+	void ComputeMaterialBounds( Vec3fArray &boundMin, Vec3fArray &boundMax ) const;	//!< Computes the bounding box of the faces of each material. Materials without faces get an empty box with boundMin > boundMax.
+	void ComputeBoundingBox( Vec3fArray const &vertices ) { if ( ! vertices.GetBounds(boundMin,boundMax) ) { boundMin.Set(1,1,1); boundMax.Set(0,0,0); } }	//!< Computes the bounding box using the SIMD reduction of the given vertex positions, which must match the mesh vertices
 	void ComputeNormals(bool clockwise=false);		//!< Computes and stores vertex normals
+	void Recenter();								//!< Moves the origin to the center of the bounding box, keeping the world positions of the vertices
 
 	//!@name Load and Save methods
-	bool LoadFromFileObj( char const *filename, bool loadMtl=true, std::ostream *outStream=&std::cout );	//!< Loads the mesh from an OBJ file. Automatically converts all faces to triangles.
+	bool LoadFromFileObj( char const *filename, bool loadMtl=true, std::ostream *outStream=&std::cout, bool recenter=false );	//!< Loads the mesh from an OBJ file. Automatically converts all faces to triangles. If recenter is true, vertex positions are read in double precision and stored relative to the center of their bounding box, which becomes the origin.
 	bool SaveToFileObj( char const *filename, std::ostream *outStream );									//!< Saves the mesh to an OBJ file with the given name.
 
 private:
@@ -217,6 +233,7 @@ inline void TriMesh::operator = ( TriMesh const &t )
 	Copy( t.mcfc, t.nm,  mcfc );
 	boundMin = t.boundMin;
 	boundMax = t.boundMax;
+	origin   = t.origin;
 }
 
 inline int TriMesh::GetMaterialIndex(int faceID) const
@@ -246,6 +263,42 @@ inline void TriMesh::ComputeBoundingBox()
 	}
 }
 
+inline void TriMesh::ComputeMaterialBounds( Vec3fArray &boundMin, Vec3fArray &boundMax ) const
+{
+	boundMin.Resize(nm);
+	boundMax.Resize(nm);
+	for ( unsigned int mi=0; mi<nm; mi++ ) {
+		Vec3f bmin(1,1,1), bmax(0,0,0);
+		int first = GetMaterialFirstFace(mi);
+		int count = GetMaterialFaceCount(mi);
+		if ( count > 0 ) {
+			bmin = bmax = v[ f[first].v[0] ];
+			for ( int i=first; i<first+count; i++ ) {
+				for ( int j=0; j<3; j++ ) {
+					Vec3f const &p = v[ f[i].v[j] ];
+					for ( int k=0; k<3; k++ ) {
+						if ( bmin[k] > p[k] ) bmin[k] = p[k];
+						if ( bmax[k] < p[k] ) bmax[k] = p[k];
+					}
+				}
+			}
+		}
+		boundMin.Set(mi,bmin);
+		boundMax.Set(mi,bmax);
+	}
+}
+
+inline void TriMesh::Recenter()
+{
+	if ( nv == 0 ) return;
+	ComputeBoundingBox();
+	Vec3f center = (boundMin + boundMax) * 0.5f;
+	for ( unsigned int i=0; i<nv; i++ ) v[i] -= center;
+	boundMin -= center;
+	boundMax -= center;
+	origin += Vec3d(center);
+}
+
 inline void TriMesh::ComputeNormals(bool clockwise)
 {
 	SetNumNormals(nv);
@@ -261,7 +314,7 @@ inline void TriMesh::ComputeNormals(bool clockwise)
 	for ( unsigned int i=0; i<nvn; i++ ) vn[i].Normalize();
 }
 
-inline bool TriMesh::LoadFromFileObj( char const *filename, bool loadMtl, std::ostream *outStream )
+inline bool TriMesh::LoadFromFileObj( char const *filename, bool loadMtl, std::ostream *outStream, bool recenter )
 {
 	FILE *fp = fopen(filename,"r");
 	if ( !fp ) {
@@ -303,6 +356,7 @@ inline bool TriMesh::LoadFromFileObj( char const *filename, bool loadMtl, std::o
 		}
 		char& operator[](int i) { return data[i]; }
 		void ReadVertex( Vec3f &v ) const { v.Zero(); sscanf( data+2, "%f %f %f", &v.x, &v.y, &v.z ); }
+		void ReadVertex( Vec3d &v ) const { v.Zero(); sscanf( data+2, "%lf %lf %lf", &v.x, &v.y, &v.z ); }
 		void ReadFloat3( float f[3] ) const { f[2]=f[1]=f[0]=0; int n = sscanf( data+2, "%f %f %f", &f[0], &f[1], &f[2] ); if ( n==1 ) f[2]=f[1]=f[0]; }
 		void ReadFloat( float *f ) const { sscanf( data+2, "%f", f ); }
 		void ReadInt( int *i, int start ) const { sscanf( data+start, "%d", i ); }
@@ -347,7 +401,7 @@ inline bool TriMesh::LoadFromFileObj( char const *filename, bool loadMtl, std::o
 	};
 	MtlList mtlList;
 
-	std::vector<Vec3f>      _v;		// vertices
+	std::vector<Vec3d>      _v;		// vertices (in double precision until the origin is known)
 	std::vector<TriFace>    _f;		// faces
 	std::vector<Vec3f>      _vn;	// vertex normal
 	std::vector<TriFace>    _fn;	// normal faces
@@ -361,7 +415,7 @@ inline bool TriMesh::LoadFromFileObj( char const *filename, bool loadMtl, std::o
 
 	while ( int rb = buffer.ReadLine(fp) ) {
 		if ( buffer.IsCommand("v") ) {
-			Vec3f vertex;
+			Vec3d vertex;
 			buffer.ReadVertex(vertex);
 			_v.push_back(vertex);
 		}
@@ -461,7 +515,18 @@ inline bool TriMesh::LoadFromFileObj( char const *filename, bool loadMtl, std::o
 	if ( loadMtl ) SetNumMtls((unsigned int)mtlList.mtlData.size());
 
 	// Copy data
-	memcpy(v, _v.data(), sizeof(Vec3f)*_v.size());
+	origin.Zero();
+	if ( recenter && nv > 0 ) {
+		Vec3d vmin = _v[0], vmax = _v[0];
+		for ( Vec3d const &p : _v ) {
+			for ( int j=0; j<3; j++ ) {
+				if ( vmin[j] > p[j] ) vmin[j] = p[j];
+				if ( vmax[j] < p[j] ) vmax[j] = p[j];
+			}
+		}
+		origin = (vmin + vmax) * 0.5;
+	}
+	for ( unsigned int i=0; i<nv; i++ ) v[i] = Vec3f(_v[i] - origin);
 	if ( _vt.size() > 0 ) memcpy(vt, _vt.data(), sizeof(Vec3f)*_vt.size());
 	if ( _vn.size() > 0 ) memcpy(vn, _vn.data(), sizeof(Vec3f)*_vn.size());
 
@@ -558,7 +623,8 @@ inline bool TriMesh::SaveToFileObj( char const *filename, std::ostream *outStrea
 	}
 
 	for ( unsigned int i=0; i<nv; i++ ) {
-		fprintf(fp,"v %f %f %f\n",v[i].x, v[i].y, v[i].z);
+		Vec3d p = GetWorldVertex(i);
+		fprintf(fp,"v %f %f %f\n",p.x, p.y, p.z);
 	}
 	for ( unsigned int i=0; i<nvt; i++ ) {
 		fprintf(fp,"vt %f %f %f\n",vt[i].x, vt[i].y, vt[i].z);
@@ -0,0 +1,349 @@
+// cyCodeBase by Cem Yuksel
+// [www.cemyuksel.com]
+//-------------------------------------------------------------------------------
+//! \file   cyVec3Array.h
+//!
+//! \brief  Structure-of-arrays container for 3D vectors.
+//!
+//! Vec3Array keeps the x, y, and z components of an array of 3D vectors in
+//! three separate 32-byte aligned streams, so that batch operations over all
+//! vectors load full SIMD registers without shuffling. It is meant for CPU-side
+//! processing (bounding boxes, normalization, projections); the AoS layout
+//! of Vec3 arrays is still what the GPU vertex buffers expect, so
+//! conversions in both directions are provided.
+//!
+//-------------------------------------------------------------------------------
+//
+// Copyright (c) 2016, Cem Yuksel <cem@cemyuksel.com>
+// All rights reserved.
+//
+// Permission is hereby granted, free of charge, to any person obtaining a copy
+// of this software and associated documentation files (the "Software"), to deal
+// in the Software without restriction, including without limitation the rights
+// to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+// copies of the Software, and to permit persons to whom the Software is
+// furnished to do so, subject to the following conditions:
+//
+// The above copyright notice and this permission notice shall be included in all
+// copies or substantial portions of the Software.
+//
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+// IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+// FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+// AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+// LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+// OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+// SOFTWARE.
+//
+//-------------------------------------------------------------------------------
+
+#ifndef _CY_VEC3_ARRAY_H_INCLUDED_
+#define _CY_VEC3_ARRAY_H_INCLUDED_
+
+//-------------------------------------------------------------------------------
+
+#include "cyVector.h"
+#include <new>
+
+//-------------------------------------------------------------------------------
+namespace cy {
+//-------------------------------------------------------------------------------
+
+#define _CY_VEC3_ARRAY_ALIGNMENT 32
+
+// The reductions below keep 8 partial results per component, processed in fixed-size
+// inner loops, so that the compiler can map them to SIMD registers.
+#define _CY_VEC3_ARRAY_LANES 8
+
+//-------------------------------------------------------------------------------
+
+//! Structure-of-arrays container for 3D vectors.
+//!
+//! Each component stream starts at a 32-byte aligned address and the stream
+//! length is padded to a multiple of 8 values. The padding is kept at zero.
+
+template <typename T>
+class Vec3Array
+{
+public:
+
+	//////////////////////////////////////////////////////////////////////////
+	//!@name Constructors and Destructor
+
+	Vec3Array() : data(nullptr), size(0), capacity(0) {}
+	explicit Vec3Array( size_t n ) : data(nullptr), size(0), capacity(0) { Resize(n); }
+	Vec3Array( Vec3<T> const *aos, size_t n ) : data(nullptr), size(0), capacity(0) { SetAoS(aos,n); }	//!< Initialize using an array of 3D vectors
+	Vec3Array( Vec3Array const &a ) : data(nullptr), size(0), capacity(0) { *this = a; }
+	Vec3Array( Vec3Array &&a ) noexcept : data(a.data), size(a.size), capacity(a.capacity) { a.data=nullptr; a.size=0; a.capacity=0; }
+	~Vec3Array() { Free(); }
+
+	Vec3Array& operator = ( Vec3Array const &a ) { if ( this != &a ) { Resize(a.size); MemCopy(data,a.data,3*capacity); } return *this; }
+	Vec3Array& operator = ( Vec3Array &&a ) noexcept { Swap(data,a.data); Swap(size,a.size); Swap(capacity,a.capacity); return *this; }
+
+	//////////////////////////////////////////////////////////////////////////
+	//!@name Size and Memory Methods
+
+	CY_NODISCARD size_t Size    () const { return size; }		//!< Returns the number of vectors
+	CY_NODISCARD size_t Capacity() const { return capacity; }	//!< Returns the padded length of each component stream
+	CY_NODISCARD bool   IsEmpty () const { return size == 0; }	//!< Returns true if the array contains no vectors
+
+	//! Sets the number of vectors, keeping the existing values that fit in the new size.
+	void Resize( size_t n )
+	{
+		static_assert( (_CY_VEC3_ARRAY_LANES*sizeof(T)) % _CY_VEC3_ARRAY_ALIGNMENT == 0, "Padded streams must keep the alignment" );
+		size_t newCap = (n + _CY_VEC3_ARRAY_LANES - 1) / _CY_VEC3_ARRAY_LANES * _CY_VEC3_ARRAY_LANES;
+		if ( newCap != capacity ) {
+			T *newData = newCap > 0 ? Alloc(3*newCap) : nullptr;
+			if ( newData ) MemClear( newData, 3*newCap );
+			size_t keep = Min(size,n);
+			for ( int c=0; c<3; ++c ) if ( keep > 0 ) MemCopy( newData + c*newCap, data + c*capacity, keep );
+			Free();
+			data = newData;
+			capacity = newCap;
+		} else if ( n < size ) {
+			for ( int c=0; c<3; ++c ) MemClear( Stream(c) + n, size - n );
+		}
+		size = n;
+	}
+	void Clear() { Free(); size=0; capacity=0; }	//!< Deletes all vectors and releases the memory
+
+	//////////////////////////////////////////////////////////////////////////
+	//!@name Component Access Methods
+
+	CY_NODISCARD T       * Stream( int c )       { assert(c>=0 && c<3); return data + c*capacity; }	//!< Returns the stream of the given component
+	CY_NODISCARD T const * Stream( int c ) const { assert(c>=0 && c<3); return data + c*capacity; }	//!< Returns the stream of the given component
+	CY_NODISCARD T       * X()       { return data; }				//!< Returns the x component stream
+	CY_NODISCARD T const * X() const { return data; }				//!< Returns the x component stream
+	CY_NODISCARD T       * Y()       { return data +   capacity; }	//!< Returns the y component stream
+	CY_NODISCARD T const * Y() const { return data +   capacity; }	//!< Returns the y component stream
+	CY_NODISCARD T       * Z()       { return data + 2*capacity; }	//!< Returns the z component stream
+	CY_NODISCARD T const * Z() const { return data + 2*capacity; }	//!< Returns the z component stream
+
+	CY_NODISCARD Vec3<T> Get( size_t i ) const { assert(i<size); return Vec3<T>( X()[i], Y()[i], Z()[i] ); }	//!< Returns the i^th vector
+	void Set( size_t i, Vec3<T> const &p ) { assert(i<size); X()[i]=p.x; Y()[i]=p.y; Z()[i]=p.z; }				//!< Sets the i^th vector
+	CY_NODISCARD Vec3<T> operator [] ( size_t i ) const { return Get(i); }
+
+	//////////////////////////////////////////////////////////////////////////
+	//!@name Conversion Methods
+
+	//! Sets the array using n vectors in array-of-structures form
+	void SetAoS( Vec3<T> const *aos, size_t n )
+	{
+		Resize(n);
+		T *x=X(), *y=Y(), *z=Z();
+		for ( size_t i=0; i<n; ++i ) { x[i]=aos[i].x; y[i]=aos[i].y; z[i]=aos[i].z; }
+	}
+	//! Writes Size() vectors to the given array in array-of-structures form
+	void GetAoS( Vec3<T> *aos ) const
+	{
+		T const *x=X(), *y=Y(), *z=Z();
+		for ( size_t i=0; i<size; ++i ) aos[i].Set( x[i], y[i], z[i] );
+	}
+
+	//////////////////////////////////////////////////////////////////////////
+	//!@name Reductions
+
+	//! Computes the component-wise minimum and maximum of all vectors. Returns false if the array is empty.
+	bool GetBounds( Vec3<T> &boundMin, Vec3<T> &boundMax ) const;
+	CY_NODISCARD Vec3<T> GetMin() const { Vec3<T> bmin, bmax; GetBounds(bmin,bmax); return bmin; }	//!< Returns the component-wise minimum
+	CY_NODISCARD Vec3<T> GetMax() const { Vec3<T> bmin, bmax; GetBounds(bmin,bmax); return bmax; }	//!< Returns the component-wise maximum
+	CY_NODISCARD Vec3<T> Sum() const { return Vec3<T>( SumStream(X()), SumStream(Y()), SumStream(Z()) ); }	//!< Returns the sum of all vectors
+
+	//! Returns the sum of the dot products of the corresponding vectors of the two arrays, which must have the same size.
+	CY_NODISCARD T Dot( Vec3Array const &a ) const;
+
+	//! Writes the dot products of all vectors with the given vector to the result array, which must hold Size() values.
+	void Dot( Vec3<T> const &p, T *result ) const;
+
+	//! Normalizes all vectors. Zero-length vectors remain zero.
+	void Normalize();
+
+	//////////////////////////////////////////////////////////////////////////
+
+private:
+	T      *data;		// x, y, and z streams back to back, each of length capacity
+	size_t  size;
+	size_t  capacity;
+
+	static T*   Alloc( size_t n ) { return static_cast<T*>( ::operator new[]( n*sizeof(T), std::align_val_t(_CY_VEC3_ARRAY_ALIGNMENT) ) ); }
+	void        Free () { if ( data ) ::operator delete[]( data, std::align_val_t(_CY_VEC3_ARRAY_ALIGNMENT) ); data = nullptr; }
+	T SumStream( T const *s ) const;
+};
+
+//-------------------------------------------------------------------------------
+// Generic implementations
+//-------------------------------------------------------------------------------
+
+template <typename T>
+inline bool Vec3Array<T>::GetBounds( Vec3<T> &boundMin, Vec3<T> &boundMax ) const
+{
+	if ( size == 0 ) return false;
+	for ( int c=0; c<3; ++c ) {
+		T const *s = Stream(c);
+		T mn[_CY_VEC3_ARRAY_LANES], mx[_CY_VEC3_ARRAY_LANES];
+		_CY_IVDEP_FOR ( int j=0; j<_CY_VEC3_ARRAY_LANES; ++j ) { mn[j]=s[0]; mx[j]=s[0]; }
+		size_t i=0;
+		for ( ; i+_CY_VEC3_ARRAY_LANES<=size; i+=_CY_VEC3_ARRAY_LANES ) {
+			_CY_IVDEP_FOR ( int j=0; j<_CY_VEC3_ARRAY_LANES; ++j ) mn[j] = s[i+j] < mn[j] ? s[i+j] : mn[j];
+			_CY_IVDEP_FOR ( int j=0; j<_CY_VEC3_ARRAY_LANES; ++j ) mx[j] = s[i+j] > mx[j] ? s[i+j] : mx[j];
+		}
+		for ( ; i<size; ++i ) { mn[0] = Min(mn[0],s[i]); mx[0] = Max(mx[0],s[i]); }
+		boundMin[c] = mn[0];
+		boundMax[c] = mx[0];
+		for ( int j=1; j<_CY_VEC3_ARRAY_LANES; ++j ) { boundMin[c] = Min(boundMin[c],mn[j]); boundMax[c] = Max(boundMax[c],mx[j]); }
+	}
+	return true;
+}
+
+template <typename T>
+inline T Vec3Array<T>::SumStream( T const *s ) const
+{
+	// The padding is zero, so the whole padded stream can be summed.
+	T sum[_CY_VEC3_ARRAY_LANES] = {};
+	for ( size_t i=0; i<capacity; i+=_CY_VEC3_ARRAY_LANES ) {
+		_CY_IVDEP_FOR ( int j=0; j<_CY_VEC3_ARRAY_LANES; ++j ) sum[j] += s[i+j];
+	}
+	T r = sum[0];
+	for ( int j=1; j<_CY_VEC3_ARRAY_LANES; ++j ) r += sum[j];
+	return r;
+}
+
+template <typename T>
+inline T Vec3Array<T>::Dot( Vec3Array const &a ) const
+{
+	assert( a.size == size );
+	T const *x=X(), *y=Y(), *z=Z(), *ax=a.X(), *ay=a.Y(), *az=a.Z();
+	T sum[_CY_VEC3_ARRAY_LANES] = {};
+	for ( size_t i=0; i<capacity; i+=_CY_VEC3_ARRAY_LANES ) {
+		_CY_IVDEP_FOR ( int j=0; j<_CY_VEC3_ARRAY_LANES; ++j ) sum[j] += x[i+j]*ax[i+j] + y[i+j]*ay[i+j] + z[i+j]*az[i+j];
+	}
+	T r = sum[0];
+	for ( int j=1; j<_CY_VEC3_ARRAY_LANES; ++j ) r += sum[j];
+	return r;
+}
+
+template <typename T>
+inline void Vec3Array<T>::Dot( Vec3<T> const &p, T *result ) const
+{
+	T const *x=X(), *y=Y(), *z=Z();
+	_CY_IVDEP_FOR ( size_t i=0; i<size; ++i ) result[i] = x[i]*p.x + y[i]*p.y + z[i]*p.z;
+}
+
+template <typename T>
+inline void Vec3Array<T>::Normalize()
+{
+	T *x=X(), *y=Y(), *z=Z();
+	_CY_IVDEP_FOR ( size_t i=0; i<size; ++i ) {
+		T len2 = x[i]*x[i] + y[i]*y[i] + z[i]*z[i];
+		T s = len2 > T(0) ? T(1) / Sqrt(len2) : T(0);
+		x[i] *= s;
+		y[i] *= s;
+		z[i] *= s;
+	}
+}
+
+//-------------------------------------------------------------------------------
+// AVX implementations for single precision
+//-------------------------------------------------------------------------------
+
+#if defined(_CY_SSE) && defined(__AVX__)
+
+template <> inline bool Vec3Array<float>::GetBounds( Vec3<float> &boundMin, Vec3<float> &boundMax ) const
+{
+	if ( size == 0 ) return false;
+	for ( int c=0; c<3; ++c ) {
+		float const *s = Stream(c);
+		__m256 mn = _mm256_set1_ps(s[0]);
+		__m256 mx = mn;
+		size_t i=0;
+		for ( ; i+8<=size; i+=8 ) {
+			__m256 v = _mm256_load_ps(s+i);
+			mn = _mm256_min_ps(mn,v);
+			mx = _mm256_max_ps(mx,v);
+		}
+		alignas(32) float fmn[8], fmx[8];
+		_mm256_store_ps(fmn,mn);
+		_mm256_store_ps(fmx,mx);
+		for ( ; i<size; ++i ) { fmn[0] = Min(fmn[0],s[i]); fmx[0] = Max(fmx[0],s[i]); }
+		boundMin[c] = Min(fmn[0],fmn[1],fmn[2],fmn[3],fmn[4],fmn[5],fmn[6],fmn[7]);
+		boundMax[c] = Max(fmx[0],fmx[1],fmx[2],fmx[3],fmx[4],fmx[5],fmx[6],fmx[7]);
+	}
+	return true;
+}
+
+//! \cond HIDDEN_SYMBOLS
+inline float _cy_hsum( __m256 v )
+{
+	__m128 s = _mm_add_ps( _mm256_castps256_ps128(v), _mm256_extractf128_ps(v,1) );
+	s = _mm_add_ps( s, _mm_movehl_ps(s,s) );
+	s = _mm_add_ss( s, _mm_shuffle_ps(s,s,1) );
+	return _mm_cvtss_f32(s);
+}
+//! \endcond
+
+template <> inline float Vec3Array<float>::SumStream( float const *s ) const
+{
+	__m256 sum = _mm256_setzero_ps();
+	for ( size_t i=0; i<capacity; i+=8 ) sum = _mm256_add_ps( sum, _mm256_load_ps(s+i) );
+	return _cy_hsum(sum);
+}
+
+template <> inline float Vec3Array<float>::Dot( Vec3Array const &a ) const
+{
+	assert( a.size == size );
+	float const *x=X(), *y=Y(), *z=Z(), *ax=a.X(), *ay=a.Y(), *az=a.Z();
+	__m256 sum = _mm256_setzero_ps();
+	for ( size_t i=0; i<capacity; i+=8 ) {
+		__m256 dx = _mm256_mul_ps( _mm256_load_ps(x+i), _mm256_load_ps(ax+i) );
+		__m256 dy = _mm256_mul_ps( _mm256_load_ps(y+i), _mm256_load_ps(ay+i) );
+		__m256 dz = _mm256_mul_ps( _mm256_load_ps(z+i), _mm256_load_ps(az+i) );
+		sum = _mm256_add_ps( sum, _mm256_add_ps( _mm256_add_ps(dx,dy), dz ) );
+	}
+	return _cy_hsum(sum);
+}
+
+template <> inline void Vec3Array<float>::Dot( Vec3<float> const &p, float *result ) const
+{
+	float const *x=X(), *y=Y(), *z=Z();
+	__m256 px = _mm256_set1_ps(p.x), py = _mm256_set1_ps(p.y), pz = _mm256_set1_ps(p.z);
+	size_t i=0;
+	for ( ; i+8<=size; i+=8 ) {
+		__m256 d = _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps(_mm256_load_ps(x+i),px), _mm256_mul_ps(_mm256_load_ps(y+i),py) ), _mm256_mul_ps(_mm256_load_ps(z+i),pz) );
+		_mm256_storeu_ps( result+i, d );
+	}
+	for ( ; i<size; ++i ) result[i] = x[i]*p.x + y[i]*p.y + z[i]*p.z;
+}
+
+template <> inline void Vec3Array<float>::Normalize()
+{
+	float *x=X(), *y=Y(), *z=Z();
+	__m256 zero = _mm256_setzero_ps();
+	__m256 one  = _mm256_set1_ps(1.0f);
+	for ( size_t i=0; i<capacity; i+=8 ) {
+		__m256 vx = _mm256_load_ps(x+i), vy = _mm256_load_ps(y+i), vz = _mm256_load_ps(z+i);
+		__m256 len2 = _mm256_add_ps( _mm256_add_ps( _mm256_mul_ps(vx,vx), _mm256_mul_ps(vy,vy) ), _mm256_mul_ps(vz,vz) );
+		__m256 s = _mm256_div_ps( one, _mm256_sqrt_ps(len2) );
+		s = _mm256_and_ps( s, _mm256_cmp_ps(len2,zero,_CMP_GT_OQ) );	// keeps zero vectors and the padding at zero
+		_mm256_store_ps( x+i, _mm256_mul_ps(vx,s) );
+		_mm256_store_ps( y+i, _mm256_mul_ps(vy,s) );
+		_mm256_store_ps( z+i, _mm256_mul_ps(vz,s) );
+	}
+}
+
+#endif
+
+//-------------------------------------------------------------------------------
+
+typedef Vec3Array<float>  Vec3fArray;	//!< Structure-of-arrays container for single precision (float) 3D vectors
+typedef Vec3Array<double> Vec3dArray;	//!< Structure-of-arrays container for double precision (double) 3D vectors
+
+//-------------------------------------------------------------------------------
+} // namespace cy
+//-------------------------------------------------------------------------------
+
+typedef cy::Vec3fArray cyVec3fArray;	//!< Structure-of-arrays container for single precision (float) 3D vectors
+typedef cy::Vec3dArray cyVec3dArray;	//!< Structure-of-arrays container for double precision (double) 3D vectors
+
+//-------------------------------------------------------------------------------
+
+#endif
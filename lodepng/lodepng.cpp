@@ -39,6 +39,35 @@ Rename this file to lodepng.cpp to use it for C++, or to lodepng.c to use it for
 #include <stdlib.h> /* allocations */
 #endif /* LODEPNG_COMPILE_ALLOCATORS */
 
+/*x86-64 always has SSE2, the kernels that need SSSE3, AVX2 or PCLMUL are compiled for them with a target
+attribute and only called if the CPU supports them. Unoptimized GCC/Clang builds keep the scalar code,
+without inlining the intrinsics are slower than the plain loops.*/
+#if defined(LODEPNG_COMPILE_SIMD) && (defined(__x86_64__) || defined(_M_X64)) \
+    && (defined(__OPTIMIZE__) || defined(_MSC_VER))
+#define LODEPNG_SIMD_X86
+#include <immintrin.h>
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h> /* __cpuid */
+#define LODEPNG_TARGET(features) /*MSVC compiles all intrinsics without target options*/
+#define LODEPNG_SIMD_INLINE __forceinline
+#else
+#define LODEPNG_TARGET(features) __attribute__((target(features)))
+/*the kernels are only fast with their helpers inlined, which is also needed in unoptimized builds*/
+#define LODEPNG_SIMD_INLINE __inline__ __attribute__((always_inline))
+#endif
+#endif /*LODEPNG_SIMD_X86*/
+
+/*the pipelined decoder and the parallel deflate use the C++11 thread library, C and older C++ builds run on one
+thread*/
+#if defined(LODEPNG_COMPILE_THREADS) && defined(LODEPNG_COMPILE_ZLIB) && defined(__cplusplus) && \
+    (__cplusplus >= 201103L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201103L))
+#define LODEPNG_THREADS
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+#endif /*LODEPNG_THREADS*/
+
 #if defined(_MSC_VER) && (_MSC_VER >= 1310) /*Visual Studio: A few warning types are not desired here.*/
 #pragma warning( disable : 4244 ) /*implicit conversions: not warned by gcc -Wall -Wextra and requires too much casts*/
 #pragma warning( disable : 4996 ) /*VS does not like fopen, but fopen_s is not standard C so unusable here*/
@@ -141,6 +170,89 @@ static size_t lodepng_strlen(const char* a) {
 #define LODEPNG_MAX(a, b) (((a) > (b)) ? (a) : (b))
 #define LODEPNG_MIN(a, b) (((a) < (b)) ? (a) : (b))
 
+#ifdef LODEPNG_SIMD_X86
+/*CPU features beyond SSE2 used by the SIMD code: the unfilter kernels, CRC32 and Adler-32*/
+#define LODEPNG_SIMD_SSSE3 2
+#define LODEPNG_SIMD_AVX2 4
+#define LODEPNG_SIMD_PCLMUL 8
+
+static int lodepng_detect_simd(void) {
+  int features = 0;
+#if defined(_MSC_VER) && !defined(__clang__)
+  int info[4], maxLeaf, ecx1;
+  __cpuid(info, 0);
+  maxLeaf = info[0];
+  __cpuid(info, 1);
+  ecx1 = info[2];
+  if(ecx1 & (1 << 9)) features |= LODEPNG_SIMD_SSSE3;
+  if(ecx1 & (1 << 1)) features |= LODEPNG_SIMD_PCLMUL;
+  /*AVX2 also needs the OS to save the ymm registers (OSXSAVE, and bits 1 and 2 of XCR0)*/
+  if(maxLeaf >= 7 && (ecx1 & (1 << 27)) && (_xgetbv(0) & 6) == 6) {
+    __cpuidex(info, 7, 0);
+    if(info[1] & (1 << 5)) features |= LODEPNG_SIMD_AVX2;
+  }
+#else
+  __builtin_cpu_init();
+  if(__builtin_cpu_supports("ssse3")) features |= LODEPNG_SIMD_SSSE3;
+  if(__builtin_cpu_supports("avx2")) features |= LODEPNG_SIMD_AVX2;
+  if(__builtin_cpu_supports("pclmul")) features |= LODEPNG_SIMD_PCLMUL;
+#endif
+  return features;
+}
+
+/*Bit field of the LODEPNG_SIMD_ values supported by the CPU. The decoder threads, the deflate workers and any
+threads of the application read it concurrently, so it must never be written after they start.*/
+#ifdef __cplusplus
+/*detected during static initialization, before main starts any threads. Code running in other static initializers
+before this one sees 0 and takes the scalar paths*/
+static int lodepng_simd_features = lodepng_detect_simd();
+
+static int lodepng_get_simd_features(void) {
+  return lodepng_simd_features;
+}
+#else /*__cplusplus*/
+/*C has no dynamic initialization of statics, so the value is detected on first use, -1 until then. Threads that
+race there detect the same value, the atomic accesses keep that free of data races.*/
+static int lodepng_simd_features = -1;
+
+static int lodepng_get_simd_features(void) {
+  int features;
+#if defined(_MSC_VER) && !defined(__clang__)
+  /*aligned volatile accesses are atomic on x64, with acquire/release semantics under the default /volatile:ms*/
+  features = *(volatile int*)&lodepng_simd_features;
+  if(features < 0) {
+    features = lodepng_detect_simd();
+    *(volatile int*)&lodepng_simd_features = features;
+  }
+#else
+  features = __atomic_load_n(&lodepng_simd_features, __ATOMIC_RELAXED);
+  if(features < 0) {
+    features = lodepng_detect_simd();
+    __atomic_store_n(&lodepng_simd_features, features, __ATOMIC_RELAXED);
+  }
+#endif
+  return features;
+}
+#endif /*__cplusplus*/
+#endif /*LODEPNG_SIMD_X86*/
+
+#ifdef LODEPNG_THREADS
+/*starts a thread running func(context), returns 0 instead of throwing if the system can't*/
+template<typename T>
+static int lodepng_start_thread(std::thread& thread, void (*func)(T*), T* context) {
+#if defined(__cpp_exceptions) || defined(__EXCEPTIONS) || defined(_CPPUNWIND)
+  try {
+    thread = std::thread(func, context);
+  } catch(...) {
+    return 0;
+  }
+#else
+  thread = std::thread(func, context);
+#endif
+  return 1;
+}
+#endif /*LODEPNG_THREADS*/
+
 #if defined(LODEPNG_COMPILE_PNG) || defined(LODEPNG_COMPILE_DECODER)
 /* Safely check if adding two integers will overflow (no undefined
 behavior, compiler removing the code, etc...) and output result. */
@@ -438,6 +550,11 @@ static void writeBitsReversed(LodePNGBitWriter* writer, unsigned value, size_t n
     WRITEBIT(writer, (unsigned char)((value >> (nbits - 1u - i)) & 1u));
   }
 }
+
+/*makes room for nbits more bits, so that writeBits and writeBitsReversed don't run out of memory for them*/
+static unsigned reserveBits(LodePNGBitWriter* writer, size_t nbits) {
+  return ucvector_reserve(writer->data, writer->data->size + (nbits + 7u) / 8u) ? 0 : 83; /*alloc fail*/
+}
 #endif /*LODEPNG_COMPILE_ENCODER*/
 
 #ifdef LODEPNG_COMPILE_DECODER
@@ -1069,6 +1186,118 @@ static unsigned huffmanDecodeSymbol(LodePNGBitReader* reader, const HuffmanTree*
     return codetree->table_value[value];
   }
 }
+
+/*
+Tables for the fast inflate loop, in the style of libdeflate. Each entry is 32 bits and holds everything needed to
+decode one table lookup, so the loop does not need LENGTHBASE, DISTANCEBASE and their extra bits arrays:
+bits 0-7: amount of bits to consume, the code length plus the extra bits of a length or distance
+bits 8-11: code length for length/distance symbols, amount of literals (1 or 2) for literals, or the amount of
+index bits of the secondary table for FAST_SUBTABLE
+bits 12-15: flags, none of them set for a length or distance symbol
+bits 16-31: base length or distance, one or two literal bytes, offset of the secondary table, or the error code
+for FAST_INVALID
+*/
+#define FAST_INVALID 0x1000u
+#define FAST_END 0x2000u
+#define FAST_SUBTABLE 0x4000u
+#define FAST_LITERAL 0x8000u
+/* root table bits for the literal/length and distance codes. Literal pairs only fit in the literal/length table if
+both codes together are at most this many bits, 11 gives plenty of them for PNG data at a 8 KiB table */
+#define FAST_LL_BITS 11u
+#define FAST_D_BITS 8u
+
+/*table entry for a symbol, l is the code length, minus the root bits if it is in a secondary table*/
+static unsigned fastSymbolEntry(unsigned symbol, unsigned l, int litlen) {
+  if(litlen) {
+    if(symbol <= 255) return (symbol << 16u) | FAST_LITERAL | (1u << 8u) | l;
+    if(symbol == 256) return FAST_END | l;
+    if(symbol <= LAST_LENGTH_CODE_INDEX) {
+      symbol -= FIRST_LENGTH_CODE_INDEX;
+      return (LENGTHBASE[symbol] << 16u) | (l << 8u) | (l + LENGTHEXTRA[symbol]);
+    }
+    return (16u << 16u) | FAST_INVALID | l; /*error: tried to read disallowed huffman symbol*/
+  }
+  if(symbol <= 29) return (DISTANCEBASE[symbol] << 16u) | (l << 8u) | (l + DISTANCEEXTRA[symbol]);
+  return (18u << 16u) | FAST_INVALID | l; /*error: invalid distance code (30-31 are never used)*/
+}
+
+/*
+Makes the fast lookup table of a tree whose HuffmanTree_makeTable already succeeded, so the tree is known not to be
+oversubscribed. The result is allocated in *table, which the caller must free.
+*/
+static unsigned HuffmanTree_makeFastTable(unsigned** table, const HuffmanTree* tree, unsigned rootbits, int litlen) {
+  const size_t headsize = (size_t)1 << rootbits;
+  const unsigned mask = (1u << rootbits) - 1u;
+  size_t i, pointer, size;
+  unsigned* t;
+  unsigned* maxlens = (unsigned*)lodepng_malloc(headsize * sizeof(unsigned));
+  if(!maxlens) return 83; /*alloc fail*/
+
+  /*same layout as HuffmanTree_makeTable, but with entries made by fastSymbolEntry*/
+  lodepng_memset(maxlens, 0, headsize * sizeof(*maxlens));
+  for(i = 0; i < tree->numcodes; i++) {
+    unsigned l = tree->lengths[i];
+    unsigned index;
+    if(l <= rootbits) continue;
+    index = reverseBits(tree->codes[i] >> (l - rootbits), rootbits);
+    maxlens[index] = LODEPNG_MAX(maxlens[index], l);
+  }
+  size = headsize;
+  for(i = 0; i < headsize; ++i) {
+    if(maxlens[i] > rootbits) size += ((size_t)1) << (maxlens[i] - rootbits);
+  }
+  t = *table = (unsigned*)lodepng_malloc(size * sizeof(*t));
+  if(!t) {
+    lodepng_free(maxlens);
+    return 83; /*alloc fail*/
+  }
+  /*entries no symbol reaches, only possible for trees with less than 2 symbols*/
+  for(i = 0; i < size; ++i) t[i] = (16u << 16u) | FAST_INVALID | 1u;
+
+  pointer = headsize;
+  for(i = 0; i < headsize; ++i) {
+    unsigned l = maxlens[i];
+    if(l <= rootbits) continue;
+    t[i] = ((unsigned)pointer << 16u) | FAST_SUBTABLE | ((l - rootbits) << 8u) | rootbits;
+    pointer += ((size_t)1) << (l - rootbits);
+  }
+  lodepng_free(maxlens);
+
+  for(i = 0; i < tree->numcodes; ++i) {
+    unsigned l = tree->lengths[i];
+    unsigned reverse, j;
+    if(l == 0) continue;
+    reverse = reverseBits(tree->codes[i], l);
+    if(l <= rootbits) {
+      unsigned entry = fastSymbolEntry((unsigned)i, l, litlen);
+      for(j = 0; j < (1u << (rootbits - l)); ++j) t[reverse | (j << l)] = entry;
+    } else {
+      unsigned sub = t[reverse & mask];
+      unsigned subbits = (sub >> 8u) & 15u;
+      unsigned start = sub >> 16u;
+      unsigned entry = fastSymbolEntry((unsigned)i, l - rootbits, litlen);
+      for(j = 0; j < (1u << (subbits - (l - rootbits))); ++j) {
+        t[start + ((reverse >> rootbits) | (j << (l - rootbits)))] = entry;
+      }
+    }
+  }
+
+  /*combine two short literals into one entry if both codes fit in the root bits. Going downwards, the entry of the
+  second literal at index >> l1 <= index is not yet combined itself when it is read.*/
+  if(litlen) {
+    for(i = headsize; i-- > 0;) {
+      unsigned entry = t[i], entry2, l1;
+      if((entry & (FAST_LITERAL | 0xf00u)) != (FAST_LITERAL | (1u << 8u))) continue;
+      l1 = entry & 0xffu;
+      entry2 = t[i >> l1];
+      if((entry2 & (FAST_LITERAL | 0xf00u)) != (FAST_LITERAL | (1u << 8u))) continue;
+      if(l1 + (entry2 & 0xffu) > rootbits) continue;
+      t[i] = (entry & 0xff0000u) | ((entry2 & 0xff0000u) << 8u) | FAST_LITERAL | (2u << 8u) |
+             (l1 + (entry2 & 0xffu));
+    }
+  }
+  return 0;
+}
 #endif /*LODEPNG_COMPILE_DECODER*/
 
 #ifdef LODEPNG_COMPILE_DECODER
@@ -1219,13 +1448,171 @@ static unsigned getTreeInflateDynamic(HuffmanTree* tree_ll, HuffmanTree* tree_d,
   return error;
 }
 
+/*
+Lets the pipelined decoder follow inflate: func is called with the output size each time at least step more bytes of
+output are final. Output bytes never change once written, back references only read them.
+*/
+typedef struct LodePNGInflateProgress {
+  void (*func)(void* context, size_t size);
+  void* context;
+  size_t step;
+  size_t next; /*output size at which func is called next*/
+} LodePNGInflateProgress;
+
+static LODEPNG_INLINE void inflateProgress(LodePNGInflateProgress* progress, const ucvector* out) {
+  if(progress && out->size >= progress->next) {
+    progress->next = out->size + progress->step;
+    progress->func(progress->context, out->size);
+  }
+}
+
+/*little endian load of a size_t, the bit buffer of inflateHuffmanFast*/
+static LODEPNG_INLINE size_t readWordLE(const unsigned char* p) {
+  size_t result = 0, i;
+  const unsigned one = 1;
+  if(*(const unsigned char*)&one) {
+    lodepng_memcpy(&result, p, sizeof(result));
+  } else {
+    for(i = 0; i < sizeof(result); ++i) result |= (size_t)p[i] << (i * 8u);
+  }
+  return result;
+}
+
+/*
+Decodes symbols of a huffman block while the input has at least 16 bytes left, using the tables of
+HuffmanTree_makeFastTable and a 64-bit bit buffer that is refilled with one unaligned load rather than byte by byte.
+Stops earlier at the end code, with *done set, or on error. The remaining symbols, if any, are left to the bounds
+checked loop in inflateHuffmanBlock, with reader->bp pointing at the first unread bit.
+Only used if size_t has 64 bits: after a refill there must be enough bits for a length and a distance symbol with their
+extra bits.
+*/
+static unsigned inflateHuffmanFast(ucvector* out, LodePNGBitReader* reader, const unsigned* table_ll,
+                                   const unsigned* table_d, size_t reserved_size, size_t max_output_size, int* done,
+                                   LodePNGInflateProgress* progress) {
+  const unsigned char* in = reader->data;
+  size_t inpos = reader->bp >> 3u;
+  size_t bitbuf = 0;
+  unsigned bitsleft = 0;
+  unsigned error = 0;
+
+  /*each iteration refills twice, each refill reads sizeof(size_t) bytes and advances inpos by at most 7*/
+  if(reader->size < 16 || inpos > reader->size - 16) return 0;
+
+/*fill the bit buffer up to 56 to 63 bits, the bits loaded above bitsleft are valid input as well and read again by the
+next refill*/
+#define FAST_REFILL() {\
+  bitbuf |= readWordLE(in + inpos) << bitsleft;\
+  inpos += (63u - bitsleft) >> 3u;\
+  bitsleft |= 56u;\
+}
+#define FAST_CONSUME(n) { bitbuf >>= (n); bitsleft -= (n); }
+
+  FAST_REFILL();
+  FAST_CONSUME(reader->bp & 7u);
+
+  while(inpos <= reader->size - 16) {
+    unsigned entry, length, distance, n;
+    size_t saved;
+    unsigned char* dst;
+    const unsigned char* src;
+
+    /*checked before growing, so the output never grows past max_output_size + reserved_size*/
+    if(max_output_size && out->size > max_output_size) ERROR_BREAK(109); /*error, larger than max size*/
+    if(out->allocsize - out->size < reserved_size) {
+      if(!ucvector_reserve(out, out->size + reserved_size)) ERROR_BREAK(83); /*alloc fail*/
+    }
+    inflateProgress(progress, out);
+
+    FAST_REFILL();
+    entry = table_ll[bitbuf & ((1u << FAST_LL_BITS) - 1u)];
+    if(entry & FAST_LITERAL) {
+      /*one or two literals, at most FAST_LL_BITS bits, which leaves enough for a second lookup without refill*/
+      FAST_CONSUME(entry & 0xffu);
+      out->data[out->size] = (unsigned char)(entry >> 16u);
+      out->data[out->size + 1] = (unsigned char)(entry >> 24u);
+      out->size += (entry >> 8u) & 15u;
+      entry = table_ll[bitbuf & ((1u << FAST_LL_BITS) - 1u)];
+      if(entry & FAST_LITERAL) {
+        FAST_CONSUME(entry & 0xffu);
+        out->data[out->size] = (unsigned char)(entry >> 16u);
+        out->data[out->size + 1] = (unsigned char)(entry >> 24u);
+        out->size += (entry >> 8u) & 15u;
+        continue;
+      }
+      FAST_REFILL();
+    }
+    if(entry & FAST_SUBTABLE) {
+      FAST_CONSUME(FAST_LL_BITS);
+      entry = table_ll[(entry >> 16u) + (bitbuf & ((1u << ((entry >> 8u) & 15u)) - 1u))];
+      if(entry & FAST_LITERAL) {
+        FAST_CONSUME(entry & 0xffu);
+        out->data[out->size++] = (unsigned char)(entry >> 16u);
+        continue;
+      }
+    }
+    if(entry & (FAST_END | FAST_INVALID)) {
+      if(entry & FAST_INVALID) ERROR_BREAK(entry >> 16u);
+      FAST_CONSUME(entry & 0xffu);
+      *done = 1;
+      break;
+    }
+
+    /*length symbol: the code and the extra bits are consumed at once, the extra bits are above the code bits*/
+    saved = bitbuf;
+    n = entry & 0xffu;
+    FAST_CONSUME(n);
+    length = (entry >> 16u) + (unsigned)((saved & (((size_t)1 << n) - 1u)) >> ((entry >> 8u) & 15u));
+
+    /*at most 20 bits used since the last refill, the distance needs at most 15 + 13*/
+    entry = table_d[bitbuf & ((1u << FAST_D_BITS) - 1u)];
+    if(entry & FAST_SUBTABLE) {
+      FAST_CONSUME(FAST_D_BITS);
+      entry = table_d[(entry >> 16u) + (bitbuf & ((1u << ((entry >> 8u) & 15u)) - 1u))];
+    }
+    if(entry & FAST_INVALID) ERROR_BREAK(entry >> 16u);
+    saved = bitbuf;
+    n = entry & 0xffu;
+    FAST_CONSUME(n);
+    distance = (entry >> 16u) + (unsigned)((saved & (((size_t)1 << n) - 1u)) >> ((entry >> 8u) & 15u));
+    if(distance > out->size) ERROR_BREAK(52); /*too long backward distance*/
+
+    /*copy the match in 8-byte words, which may write up to 7 bytes past its end, within reserved_size*/
+    dst = out->data + out->size;
+    src = dst - distance;
+    out->size += length;
+    if(distance >= 8) {
+      unsigned char* end = dst + length;
+      do {
+        lodepng_memcpy(dst, src, 8);
+        dst += 8;
+        src += 8;
+      } while(dst < end);
+    } else if(distance == 1) {
+      lodepng_memset(dst, *src, length);
+    } else {
+      unsigned char* end = dst + length;
+      while(dst < end) *dst++ = *src++;
+    }
+  }
+
+#undef FAST_REFILL
+#undef FAST_CONSUME
+
+  reader->bp = (inpos << 3u) - bitsleft;
+  return error;
+}
+
 /*inflate a block with dynamic of fixed Huffman tree. btype must be 1 or 2.*/
 static unsigned inflateHuffmanBlock(ucvector* out, LodePNGBitReader* reader,
-                                    unsigned btype, size_t max_output_size) {
+                                    unsigned btype, size_t max_output_size, LodePNGInflateProgress* progress) {
   unsigned error = 0;
   HuffmanTree tree_ll; /*the huffman tree for literal and length codes*/
   HuffmanTree tree_d; /*the huffman tree for distance codes*/
-  const size_t reserved_size = 260; /* must be at least 258 for max length, and a few extra for adding a few extra literals */
+  unsigned* table_ll = 0; /*fast lookup tables for inflateHuffmanFast*/
+  unsigned* table_d = 0;
+  /* must be at least 258 for max length, and a few extra for adding a few extra literals. inflateHuffmanFast also
+  needs room for a literal pair before the match, and overwrites up to 7 bytes after it */
+  const size_t reserved_size = 270;
   int done = 0;
 
   if(!ucvector_reserve(out, out->size + reserved_size)) return 83; /*alloc fail*/
@@ -1236,6 +1623,17 @@ static unsigned inflateHuffmanBlock(ucvector* out, LodePNGBitReader* reader,
   if(btype == 1) error = getTreeInflateFixed(&tree_ll, &tree_d);
   else /*if(btype == 2)*/ error = getTreeInflateDynamic(&tree_ll, &tree_d, reader);
 
+  if(!error && sizeof(size_t) >= 8) {
+    error = HuffmanTree_makeFastTable(&table_ll, &tree_ll, FAST_LL_BITS, 1);
+    if(!error) error = HuffmanTree_makeFastTable(&table_d, &tree_d, FAST_D_BITS, 0);
+    if(!error) {
+      error = inflateHuffmanFast(out, reader, table_ll, table_d, reserved_size, max_output_size, &done, progress);
+    }
+    if(!error && max_output_size && out->size > max_output_size) error = 109; /*error, larger than max size*/
+    if(!error && out->allocsize - out->size < reserved_size) {
+      if(!ucvector_reserve(out, out->size + reserved_size)) error = 83; /*alloc fail*/
+    }
+  }
 
   while(!error && !done) /*decode all symbols until end reached, breaks at end code*/ {
     /*code_ll is literal, length or end code*/
@@ -1307,9 +1705,6 @@ static unsigned inflateHuffmanBlock(ucvector* out, LodePNGBitReader* reader,
     } else /*if(code_ll == INVALIDSYMBOL)*/ {
       ERROR_BREAK(16); /*error: tried to read disallowed huffman symbol*/
     }
-    if(out->allocsize - out->size < reserved_size) {
-      if(!ucvector_reserve(out, out->size + reserved_size)) ERROR_BREAK(83); /*alloc fail*/
-    }
     /*check if any of the ensureBits above went out of bounds*/
     if(reader->bp > reader->bitsize) {
       /*return error code 10 or 11 depending on the situation that happened in huffmanDecodeSymbol
@@ -1320,10 +1715,16 @@ static unsigned inflateHuffmanBlock(ucvector* out, LodePNGBitReader* reader,
     if(max_output_size && out->size > max_output_size) {
       ERROR_BREAK(109); /*error, larger than max size*/
     }
+    if(out->allocsize - out->size < reserved_size) {
+      if(!ucvector_reserve(out, out->size + reserved_size)) ERROR_BREAK(83); /*alloc fail*/
+    }
+    inflateProgress(progress, out);
   }
 
   HuffmanTree_cleanup(&tree_ll);
   HuffmanTree_cleanup(&tree_d);
+  lodepng_free(table_ll);
+  lodepng_free(table_d);
 
   return error;
 }
@@ -1347,10 +1748,12 @@ static unsigned inflateNoCompression(ucvector* out, LodePNGBitReader* reader,
     return 21; /*error: NLEN is not one's complement of LEN*/
   }
 
-  if(!ucvector_resize(out, out->size + LEN)) return 83; /*alloc fail*/
-
   /*read the literal data: LEN bytes are now stored in the out buffer*/
   if(bytepos + LEN > size) return 23; /*error: reading outside of in buffer*/
+  if(settings->max_output_size && out->size + LEN > settings->max_output_size) {
+    return 109; /*error, larger than max size, checked before growing the output*/
+  }
+  if(!ucvector_resize(out, out->size + LEN)) return 83; /*alloc fail*/
 
   /*out->data can be NULL (when LEN is zero), and arithmetics on NULL ptr is undefined*/
   if (LEN) {
@@ -1365,7 +1768,7 @@ static unsigned inflateNoCompression(ucvector* out, LodePNGBitReader* reader,
 
 static unsigned lodepng_inflatev(ucvector* out,
                                  const unsigned char* in, size_t insize,
-                                 const LodePNGDecompressSettings* settings) {
+                                 const LodePNGDecompressSettings* settings, LodePNGInflateProgress* progress) {
   unsigned BFINAL = 0;
   LodePNGBitReader reader;
   unsigned error = LodePNGBitReader_init(&reader, in, insize);
@@ -1381,9 +1784,10 @@ static unsigned lodepng_inflatev(ucvector* out,
 
     if(BTYPE == 3) return 20; /*error: invalid BTYPE*/
     else if(BTYPE == 0) error = inflateNoCompression(out, &reader, settings); /*no compression*/
-    else error = inflateHuffmanBlock(out, &reader, BTYPE, settings->max_output_size); /*compression, BTYPE 01 or 10*/
+    else error = inflateHuffmanBlock(out, &reader, BTYPE, settings->max_output_size, progress); /*compression, BTYPE 01 or 10*/
     if(!error && settings->max_output_size && out->size > settings->max_output_size) error = 109;
     if(error) break;
+    inflateProgress(progress, out);
   }
 
   return error;
@@ -1393,14 +1797,14 @@ unsigned lodepng_inflate(unsigned char** out, size_t* outsize,
                          const unsigned char* in, size_t insize,
                          const LodePNGDecompressSettings* settings) {
   ucvector v = ucvector_init(*out, *outsize);
-  unsigned error = lodepng_inflatev(&v, in, insize, settings);
+  unsigned error = lodepng_inflatev(&v, in, insize, settings, 0);
   *out = v.data;
   *outsize = v.size;
   return error;
 }
 
 static unsigned inflatev(ucvector* out, const unsigned char* in, size_t insize,
-                        const LodePNGDecompressSettings* settings) {
+                        const LodePNGDecompressSettings* settings, LodePNGInflateProgress* progress) {
   if(settings->custom_inflate) {
     unsigned error = settings->custom_inflate(&out->data, &out->size, in, insize, settings);
     out->allocsize = out->size;
@@ -1412,7 +1816,7 @@ static unsigned inflatev(ucvector* out, const unsigned char* in, size_t insize,
     }
     return error;
   } else {
-    return lodepng_inflatev(out, in, insize, settings);
+    return lodepng_inflatev(out, in, insize, settings, progress);
   }
 }
 
@@ -1442,7 +1846,7 @@ static size_t searchCodeIndex(const unsigned* array, size_t array_size, size_t v
   return left;
 }
 
-static void addLengthDistance(uivector* values, size_t length, size_t distance) {
+static unsigned addLengthDistance(uivector* values, size_t length, size_t distance) {
   /*values in encoded vector are those used by deflate:
   0-255: literal bytes
   256: end
@@ -1455,14 +1859,12 @@ static void addLengthDistance(uivector* values, size_t length, size_t distance)
   unsigned extra_distance = (unsigned)(distance - DISTANCEBASE[dist_code]);
 
   size_t pos = values->size;
-  /*TODO: return error when this fails (out of memory)*/
-  unsigned ok = uivector_resize(values, values->size + 4);
-  if(ok) {
-    values->data[pos + 0] = length_code + FIRST_LENGTH_CODE_INDEX;
-    values->data[pos + 1] = extra_length;
-    values->data[pos + 2] = dist_code;
-    values->data[pos + 3] = extra_distance;
-  }
+  if(!uivector_resize(values, values->size + 4)) return 83; /*alloc fail*/
+  values->data[pos + 0] = length_code + FIRST_LENGTH_CODE_INDEX;
+  values->data[pos + 1] = extra_length;
+  values->data[pos + 2] = dist_code;
+  values->data[pos + 3] = extra_distance;
+  return 0;
 }
 
 /*3 bytes of data get encoded into two bytes. The hash cannot use more than 3
@@ -1483,8 +1885,18 @@ typedef struct Hash {
   unsigned short* zeros; /*length of zeros streak, used as a second hash chain*/
 } Hash;
 
-static unsigned hash_init(Hash* hash, unsigned windowsize) {
+/*resets the hash to the state of no positions added yet*/
+static void hash_clear(Hash* hash, unsigned windowsize) {
   unsigned i;
+  for(i = 0; i != HASH_NUM_VALUES; ++i) hash->head[i] = -1;
+  for(i = 0; i != windowsize; ++i) hash->val[i] = -1;
+  for(i = 0; i != windowsize; ++i) hash->chain[i] = i; /*same value as index indicates uninitialized*/
+
+  for(i = 0; i <= MAX_SUPPORTED_DEFLATE_LENGTH; ++i) hash->headz[i] = -1;
+  for(i = 0; i != windowsize; ++i) hash->chainz[i] = i; /*same value as index indicates uninitialized*/
+}
+
+static unsigned hash_init(Hash* hash, unsigned windowsize) {
   hash->head = (int*)lodepng_malloc(sizeof(int) * HASH_NUM_VALUES);
   hash->val = (int*)lodepng_malloc(sizeof(int) * windowsize);
   hash->chain = (unsigned short*)lodepng_malloc(sizeof(unsigned short) * windowsize);
@@ -1497,14 +1909,7 @@ static unsigned hash_init(Hash* hash, unsigned windowsize) {
     return 83; /*alloc fail*/
   }
 
-  /*initialize hash table*/
-  for(i = 0; i != HASH_NUM_VALUES; ++i) hash->head[i] = -1;
-  for(i = 0; i != windowsize; ++i) hash->val[i] = -1;
-  for(i = 0; i != windowsize; ++i) hash->chain[i] = i; /*same value as index indicates uninitialized*/
-
-  for(i = 0; i <= MAX_SUPPORTED_DEFLATE_LENGTH; ++i) hash->headz[i] = -1;
-  for(i = 0; i != windowsize; ++i) hash->chainz[i] = i; /*same value as index indicates uninitialized*/
-
+  hash_clear(hash, windowsize);
   return 0;
 }
 
@@ -1571,11 +1976,10 @@ this hash technique is one out of several ways to speed this up.
 */
 static unsigned encodeLZ77(uivector* out, Hash* hash,
                            const unsigned char* in, size_t inpos, size_t insize, unsigned windowsize,
-                           unsigned minmatch, unsigned nicematch, unsigned lazymatching) {
+                           unsigned minmatch, unsigned nicematch, unsigned lazymatching,
+                           unsigned maxchainlength) {
   size_t pos;
   unsigned i, error = 0;
-  /*for large window lengths, assume the user wants no compression loss. Otherwise, max hash chain length speedup.*/
-  unsigned maxchainlength = windowsize >= 8192 ? windowsize : windowsize / 8u;
   unsigned maxlazymatch = windowsize >= 8192 ? MAX_SUPPORTED_DEFLATE_LENGTH : 64;
 
   unsigned usezeros = 1; /*not sure if setting it to false for windowsize < 8192 is better or worse*/
@@ -1595,6 +1999,8 @@ static unsigned encodeLZ77(uivector* out, Hash* hash,
   if((windowsize & (windowsize - 1)) != 0) return 90; /*error: must be power of two*/
 
   if(nicematch > MAX_SUPPORTED_DEFLATE_LENGTH) nicematch = MAX_SUPPORTED_DEFLATE_LENGTH;
+  /*for large window lengths, assume the user wants no compression loss. Otherwise, max hash chain length speedup.*/
+  if(maxchainlength == 0) maxchainlength = windowsize >= 8192 ? windowsize : windowsize / 8u;
 
   for(pos = inpos; pos < insize; ++pos) {
     size_t wpos = pos & (windowsize - 1); /*position for in 'circular' hash buffers*/
@@ -1699,7 +2105,7 @@ static unsigned encodeLZ77(uivector* out, Hash* hash,
       length of only 3 may be not worth it then*/
       if(!uivector_push_back(out, in[pos])) ERROR_BREAK(83 /*alloc fail*/);
     } else {
-      addLengthDistance(out, length, offset);
+      if(addLengthDistance(out, length, offset)) ERROR_BREAK(83 /*alloc fail*/);
       for(i = 1; i < length; ++i) {
         ++pos;
         wpos = pos & (windowsize - 1);
@@ -1718,6 +2124,98 @@ static unsigned encodeLZ77(uivector* out, Hash* hash,
   return error;
 }
 
+/*hash of the 4 bytes at data, for encodeLZ77Greedy. The caller ensures they are in the input*/
+static unsigned getHash4(const unsigned char* data) {
+  unsigned v = (unsigned)data[0] | ((unsigned)data[1] << 8u) | ((unsigned)data[2] << 16u) | ((unsigned)data[3] << 24u);
+  return ((v * 2654435761u) >> 16u) & HASH_BIT_MASK;
+}
+
+/*like updateHashChain but without the zeros chain, and the chain always ends at a position added without predecessor*/
+static void updateHashChain4(Hash* hash, size_t wpos, unsigned hashval) {
+  hash->val[wpos] = (int)hashval;
+  hash->chain[wpos] = (unsigned short)(hash->head[hashval] != -1 ? (size_t)hash->head[hashval] : wpos);
+  hash->head[hashval] = (int)wpos;
+}
+
+/*
+LZ77 encoding for fastmatching. Like encodeLZ77 this walks a hash chain per position, but with a hash of 4 bytes
+that makes the chains short and almost free of false candidates, without the zeros chain, and takes the first
+longest match without looking ahead. This is several times faster and compresses a few percent worse.
+*/
+static unsigned encodeLZ77Greedy(uivector* out, Hash* hash,
+                                 const unsigned char* in, size_t inpos, size_t insize, unsigned windowsize,
+                                 unsigned minmatch, unsigned nicematch, unsigned maxchainlength) {
+  size_t pos = inpos, n;
+  unsigned* data;
+
+  if(windowsize == 0 || windowsize > 32768) return 60; /*error: windowsize smaller/larger than allowed*/
+  if((windowsize & (windowsize - 1)) != 0) return 90; /*error: must be power of two*/
+
+  if(nicematch > MAX_SUPPORTED_DEFLATE_LENGTH) nicematch = MAX_SUPPORTED_DEFLATE_LENGTH;
+  if(maxchainlength == 0) maxchainlength = windowsize >= 8192 ? windowsize : windowsize / 8u;
+
+  /*a literal takes 1 value and a match of 3 or more bytes 4, so this is enough for any input*/
+  n = out->size;
+  if(!uivector_resize(out, n + (insize - inpos) / 3u * 4u + 4u)) return 83; /*alloc fail*/
+  data = out->data;
+
+  while(pos < insize) {
+    unsigned length = 0, offset = 0;
+    if(pos + 4 <= insize) {
+      size_t wpos = pos & (windowsize - 1);
+      unsigned hashval = getHash4(&in[pos]);
+      unsigned chainlength, prev_offset = 0;
+      size_t maxlength = LODEPNG_MIN(insize - pos, (size_t)MAX_SUPPORTED_DEFLATE_LENGTH);
+      size_t hashpos;
+
+      updateHashChain4(hash, wpos, hashval);
+      hashpos = hash->chain[wpos];
+      for(chainlength = 0; chainlength != maxchainlength && hashpos != wpos; ++chainlength) {
+        unsigned current_offset = (unsigned)((wpos - hashpos) & (windowsize - 1));
+        if(current_offset <= prev_offset) break; /*went around the circular buffer*/
+        prev_offset = current_offset;
+        if(hash->val[hashpos] != (int)hashval) break; /*overwritten by a later position*/
+        if(in[pos + length] == in[pos + length - current_offset]) {
+          const unsigned char* foreptr = &in[pos];
+          const unsigned char* backptr = foreptr - current_offset;
+          const unsigned char* lastptr = foreptr + maxlength;
+          while(foreptr != lastptr && *backptr == *foreptr) {
+            ++backptr;
+            ++foreptr;
+          }
+          if((unsigned)(foreptr - &in[pos]) > length) {
+            length = (unsigned)(foreptr - &in[pos]);
+            offset = current_offset;
+            if(length >= nicematch || length == maxlength) break;
+          }
+        }
+        if(hash->chain[hashpos] == hashpos) break;
+        hashpos = hash->chain[hashpos];
+      }
+    }
+
+    if(length >= 3 && length >= minmatch && !(length == 3 && offset > 4096)) {
+      unsigned length_code = (unsigned)searchCodeIndex(LENGTHBASE, 29, length);
+      unsigned dist_code = (unsigned)searchCodeIndex(DISTANCEBASE, 30, offset);
+      size_t end = pos + length;
+      data[n++] = length_code + FIRST_LENGTH_CODE_INDEX;
+      data[n++] = length - LENGTHBASE[length_code];
+      data[n++] = dist_code;
+      data[n++] = offset - DISTANCEBASE[dist_code];
+      /*the positions inside the match are added to the hash so that later data can refer to them*/
+      for(++pos; pos != end && pos + 4 <= insize; ++pos) {
+        updateHashChain4(hash, pos & (windowsize - 1), getHash4(&in[pos]));
+      }
+      pos = end;
+    } else {
+      data[n++] = in[pos++];
+    }
+  }
+
+  out->size = n;
+  return 0;
+}
+
 /* /////////////////////////////////////////////////////////////////////////// */
 
 static unsigned deflateNoCompression(ucvector* out, const unsigned char* data, size_t datasize) {
@@ -1757,13 +2255,35 @@ static unsigned deflateNoCompression(ucvector* out, const unsigned char* data, s
 write the lz77-encoded data, which has lit, len and dist codes, to compressed stream using huffman trees.
 tree_ll: the tree for lit and len codes.
 tree_d: the tree for distance codes.
+Unlike writeBits this collects the bits in an integer and stores whole bytes, with the codes reversed up front.
 */
-static void writeLZ77data(LodePNGBitWriter* writer, const uivector* lz77_encoded,
-                          const HuffmanTree* tree_ll, const HuffmanTree* tree_d) {
-  size_t i = 0;
+static unsigned writeLZ77data(LodePNGBitWriter* writer, const uivector* lz77_encoded,
+                              const HuffmanTree* tree_ll, const HuffmanTree* tree_d) {
+  unsigned codes_ll[288], codes_d[32];
+  ucvector* out = writer->data;
+  size_t i, pos = out->size;
+  unsigned bits = 0, numbits = writer->bp & 7u; /*bits not yet stored, at most 7 between the steps below*/
+
+  for(i = 0; i != tree_ll->numcodes; ++i) codes_ll[i] = reverseBits(tree_ll->codes[i], tree_ll->lengths[i]);
+  for(i = 0; i != tree_d->numcodes; ++i) codes_d[i] = reverseBits(tree_d->codes[i], tree_d->lengths[i]);
+
+  /*continue the partial last byte, and reserve for the worst case of 15 bits per value*/
+  if(numbits) bits = out->data[--pos];
+  if(!ucvector_reserve(out, pos + 1 + lz77_encoded->size * 2u)) return 83; /*alloc fail*/
+
+#define LODEPNG_PUT_BITS(value, num){\
+  bits |= (value) << numbits;\
+  numbits += (num);\
+  while(numbits >= 8) {\
+    out->data[pos++] = (unsigned char)bits;\
+    bits >>= 8;\
+    numbits -= 8;\
+  }\
+}
+
   for(i = 0; i != lz77_encoded->size; ++i) {
     unsigned val = lz77_encoded->data[i];
-    writeBitsReversed(writer, tree_ll->codes[val], tree_ll->lengths[val]);
+    LODEPNG_PUT_BITS(codes_ll[val], tree_ll->lengths[val]);
     if(val > 256) /*for a length code, 3 more things have to be added*/ {
       unsigned length_index = val - FIRST_LENGTH_CODE_INDEX;
       unsigned n_length_extra_bits = LENGTHEXTRA[length_index];
@@ -1775,11 +2295,18 @@ static void writeLZ77data(LodePNGBitWriter* writer, const uivector* lz77_encoded
       unsigned n_distance_extra_bits = DISTANCEEXTRA[distance_index];
       unsigned distance_extra_bits = lz77_encoded->data[++i];
 
-      writeBits(writer, length_extra_bits, n_length_extra_bits);
-      writeBitsReversed(writer, tree_d->codes[distance_code], tree_d->lengths[distance_code]);
-      writeBits(writer, distance_extra_bits, n_distance_extra_bits);
+      LODEPNG_PUT_BITS(length_extra_bits, n_length_extra_bits);
+      LODEPNG_PUT_BITS(codes_d[distance_code], tree_d->lengths[distance_code]);
+      LODEPNG_PUT_BITS(distance_extra_bits, n_distance_extra_bits);
     }
   }
+
+#undef LODEPNG_PUT_BITS
+
+  if(numbits) out->data[pos++] = (unsigned char)bits;
+  out->size = pos;
+  writer->bp = (unsigned char)numbits;
+  return 0;
 }
 
 /*Deflate for a block of type "dynamic", that is, with freely, optimally, created huffman trees*/
@@ -1844,8 +2371,14 @@ static unsigned deflateDynamic(LodePNGBitWriter* writer, Hash* hash,
     lodepng_memset(frequencies_cl, 0, NUM_CODE_LENGTH_CODES * sizeof(*frequencies_cl));
 
     if(settings->use_lz77) {
-      error = encodeLZ77(&lz77_encoded, hash, data, datapos, dataend, settings->windowsize,
-                         settings->minmatch, settings->nicematch, settings->lazymatching);
+      if(settings->fastmatching) {
+        error = encodeLZ77Greedy(&lz77_encoded, hash, data, datapos, dataend, settings->windowsize,
+                                 settings->minmatch, settings->nicematch, settings->maxchainlength);
+      } else {
+        error = encodeLZ77(&lz77_encoded, hash, data, datapos, dataend, settings->windowsize,
+                           settings->minmatch, settings->nicematch, settings->lazymatching,
+                           settings->maxchainlength);
+      }
       if(error) break;
     } else {
       if(!uivector_resize(&lz77_encoded, datasize)) ERROR_BREAK(83 /*alloc fail*/);
@@ -1953,6 +2486,9 @@ static unsigned deflateDynamic(LodePNGBitWriter* writer, Hash* hash,
     - 256 (end code)
     */
 
+    /*the header, each code length or repeat code takes at most 7 bits and its extra bits at most 7*/
+    if(reserveBits(writer, 17 + numcodes_cl * 3 + numcodes_lld_e * 7)) ERROR_BREAK(83 /*alloc fail*/);
+
     /*Write block type*/
     writeBits(writer, BFINAL, 1);
     writeBits(writer, 0, 1); /*first bit of BTYPE "dynamic"*/
@@ -1981,11 +2517,13 @@ static unsigned deflateDynamic(LodePNGBitWriter* writer, Hash* hash,
     }
 
     /*write the compressed data symbols*/
-    writeLZ77data(writer, &lz77_encoded, &tree_ll, &tree_d);
+    error = writeLZ77data(writer, &lz77_encoded, &tree_ll, &tree_d);
+    if(error) break;
     /*error: the length of the end code 256 must be larger than 0*/
     if(tree_ll.lengths[256] == 0) ERROR_BREAK(64);
 
     /*write the end code*/
+    if(reserveBits(writer, tree_ll.lengths[256])) ERROR_BREAK(83 /*alloc fail*/);
     writeBitsReversed(writer, tree_ll.codes[256], tree_ll.lengths[256]);
 
     break; /*end of error-while*/
@@ -2021,6 +2559,7 @@ static unsigned deflateFixed(LodePNGBitWriter* writer, Hash* hash,
 
   error = generateFixedLitLenTree(&tree_ll);
   if(!error) error = generateFixedDistanceTree(&tree_d);
+  if(!error) error = reserveBits(writer, 3);
 
   if(!error) {
     writeBits(writer, BFINAL, 1);
@@ -2030,16 +2569,24 @@ static unsigned deflateFixed(LodePNGBitWriter* writer, Hash* hash,
     if(settings->use_lz77) /*LZ77 encoded*/ {
       uivector lz77_encoded;
       uivector_init(&lz77_encoded);
-      error = encodeLZ77(&lz77_encoded, hash, data, datapos, dataend, settings->windowsize,
-                         settings->minmatch, settings->nicematch, settings->lazymatching);
-      if(!error) writeLZ77data(writer, &lz77_encoded, &tree_ll, &tree_d);
+      if(settings->fastmatching) {
+        error = encodeLZ77Greedy(&lz77_encoded, hash, data, datapos, dataend, settings->windowsize,
+                                 settings->minmatch, settings->nicematch, settings->maxchainlength);
+      } else {
+        error = encodeLZ77(&lz77_encoded, hash, data, datapos, dataend, settings->windowsize,
+                           settings->minmatch, settings->nicematch, settings->lazymatching,
+                           settings->maxchainlength);
+      }
+      if(!error) error = writeLZ77data(writer, &lz77_encoded, &tree_ll, &tree_d);
       uivector_cleanup(&lz77_encoded);
     } else /*no LZ77, but still will be Huffman compressed*/ {
-      for(i = datapos; i < dataend; ++i) {
+      error = reserveBits(writer, (dataend - datapos) * 9u); /*the fixed codes of literals have at most 9 bits*/
+      for(i = datapos; i < dataend && !error; ++i) {
         writeBitsReversed(writer, tree_ll.codes[data[i]], tree_ll.lengths[data[i]]);
       }
     }
     /*add END code*/
+    if(!error) error = reserveBits(writer, tree_ll.lengths[256]);
     if(!error) writeBitsReversed(writer,tree_ll.codes[256], tree_ll.lengths[256]);
   }
 
@@ -2050,6 +2597,146 @@ static unsigned deflateFixed(LodePNGBitWriter* writer, Hash* hash,
   return error;
 }
 
+#ifdef LODEPNG_THREADS
+/*
+Parallel version of the dynamic blocks of lodepng_deflatev: every thread takes the next block, starts from a hash
+primed with the window before it, so matches may still reach back into the previous block, and ends the block with a
+sync flush (an empty stored block) so that all blocks are whole bytes and can simply be appended. The output only
+depends on the blocks, not on the amount of threads, so num_threads 0 gives the same output on any machine, even one
+where it comes down to a single thread.
+*/
+struct LodePNGDeflateThreads {
+  std::mutex mutex;
+  const unsigned char* in;
+  size_t insize;
+  size_t blocksize;
+  size_t numblocks;
+  const LodePNGCompressSettings* settings;
+  ucvector* blocks; /*the compressed bytes of each block*/
+  /*the following are guarded by mutex*/
+  size_t next; /*first block not taken by a thread yet*/
+  unsigned error;
+};
+
+/*adds the positions of in[0..end) that are within the window before end to the hash, like encodeLZ77 or
+encodeLZ77Greedy do for the block that ends there*/
+static void hash_prime(Hash* hash, const unsigned char* in, size_t end, unsigned windowsize, unsigned fastmatching) {
+  size_t pos = end > windowsize ? end - windowsize : 0;
+  unsigned numzeros = 0;
+  if(fastmatching) {
+    for(; pos + 4 <= end; ++pos) updateHashChain4(hash, pos & (windowsize - 1), getHash4(&in[pos]));
+    return;
+  }
+  for(; pos < end; ++pos) {
+    unsigned hashval = getHash(in, end, pos);
+    if(hashval == 0) {
+      if(numzeros == 0) numzeros = countZeros(in, end, pos);
+      else if(pos + numzeros > end || in[pos + numzeros - 1] != 0) --numzeros;
+    } else {
+      numzeros = 0;
+    }
+    updateHashChain(hash, pos & (windowsize - 1), hashval, (unsigned short)numzeros);
+  }
+}
+
+static void deflateThread(LodePNGDeflateThreads* d) {
+  unsigned windowsize = d->settings->windowsize;
+  Hash hash;
+  unsigned error = hash_init(&hash, windowsize);
+
+  for(;;) {
+    size_t i, start, end;
+    unsigned final;
+    ucvector* block;
+    LodePNGBitWriter writer;
+    {
+      std::lock_guard<std::mutex> lock(d->mutex);
+      if(error && !d->error) d->error = error;
+      if(d->error || d->next == d->numblocks) break;
+      i = d->next++;
+    }
+    block = &d->blocks[i];
+    final = (i == d->numblocks - 1);
+    start = i * d->blocksize;
+    end = LODEPNG_MIN(start + d->blocksize, d->insize);
+
+    if(i != 0) {
+      hash_clear(&hash, windowsize);
+      hash_prime(&hash, d->in, start, windowsize, d->settings->fastmatching);
+    }
+    LodePNGBitWriter_init(&writer, block);
+    error = deflateDynamic(&writer, &hash, d->in, start, end, d->settings, final);
+    if(!error && !final) {
+      /*BFINAL 0 and BTYPE 00 are 3 zero bits, the rest of the byte is padding, then LEN 0 and NLEN 65535. The
+      unused bits of the last byte are 0 already, the 3 bits need a new byte if fewer than 3 of them are left.*/
+      unsigned used = writer.bp & 7u, newbyte = used == 0 || used > 5;
+      if(!ucvector_resize(block, block->size + newbyte + 4)) {
+        error = 83; /*alloc fail*/
+      } else {
+        if(newbyte) block->data[block->size - 5] = 0;
+        block->data[block->size - 4] = 0;
+        block->data[block->size - 3] = 0;
+        block->data[block->size - 2] = 255;
+        block->data[block->size - 1] = 255;
+      }
+    }
+  }
+
+  hash_cleanup(&hash);
+}
+
+/*amount of threads to deflate the blocks with deflateParallel, 0 if lodepng_deflatev should do it the sequential way*/
+static unsigned deflateThreads(const LodePNGCompressSettings* settings, size_t numblocks) {
+  unsigned windowsize = settings->windowsize;
+  unsigned threads = settings->num_threads;
+  if(threads == 1 || settings->btype != 2 || numblocks < 2) return 0;
+  /*encodeLZ77 reports invalid window sizes, but hash_prime would already use them*/
+  if(windowsize == 0 || windowsize > 32768 || (windowsize & (windowsize - 1)) != 0) return 0;
+  if(threads == 0) threads = std::thread::hardware_concurrency();
+  if(threads > numblocks) threads = (unsigned)numblocks;
+  return threads == 0 ? 1 : threads;
+}
+
+static unsigned deflateParallel(ucvector* out, const unsigned char* in, size_t insize, size_t blocksize,
+                                size_t numblocks, const LodePNGCompressSettings* settings, unsigned threads) {
+  LodePNGDeflateThreads d;
+  std::vector<std::thread> workers;
+  unsigned error;
+  size_t i;
+
+  d.blocks = (ucvector*)lodepng_malloc(numblocks * sizeof(*d.blocks));
+  if(!d.blocks) return 83; /*alloc fail*/
+  for(i = 0; i != numblocks; ++i) d.blocks[i] = ucvector_init(NULL, 0);
+  d.in = in;
+  d.insize = insize;
+  d.blocksize = blocksize;
+  d.numblocks = numblocks;
+  d.settings = settings;
+  d.next = 0;
+  d.error = 0;
+
+  for(i = 1; i < threads; ++i) {
+    std::thread thread;
+    if(!lodepng_start_thread(thread, deflateThread, &d)) break;
+    workers.push_back(std::move(thread));
+  }
+  deflateThread(&d);
+  for(i = 0; i != workers.size(); ++i) workers[i].join();
+
+  error = d.error;
+  for(i = 0; i != numblocks; ++i) {
+    size_t size = out->size;
+    if(!error) {
+      if(!ucvector_resize(out, size + d.blocks[i].size)) error = 83; /*alloc fail*/
+      else lodepng_memcpy(out->data + size, d.blocks[i].data, d.blocks[i].size);
+    }
+    lodepng_free(d.blocks[i].data);
+  }
+  lodepng_free(d.blocks);
+  return error;
+}
+#endif /*LODEPNG_THREADS*/
+
 static unsigned lodepng_deflatev(ucvector* out, const unsigned char* in, size_t insize,
                                  const LodePNGCompressSettings* settings) {
   unsigned error = 0;
@@ -2072,6 +2759,13 @@ static unsigned lodepng_deflatev(ucvector* out, const unsigned char* in, size_t
   numdeflateblocks = (insize + blocksize - 1) / blocksize;
   if(numdeflateblocks == 0) numdeflateblocks = 1;
 
+#ifdef LODEPNG_THREADS
+  {
+    unsigned threads = deflateThreads(settings, numdeflateblocks);
+    if(threads != 0) return deflateParallel(out, in, insize, blocksize, numdeflateblocks, settings, threads);
+  }
+#endif /*LODEPNG_THREADS*/
+
   error = hash_init(&hash, settings->windowsize);
 
   if(!error) {
@@ -2119,10 +2813,100 @@ static unsigned deflate(unsigned char** out, size_t* outsize,
 /* / Adler32                                                                / */
 /* ////////////////////////////////////////////////////////////////////////// */
 
-static unsigned update_adler32(unsigned adler, const unsigned char* data, unsigned len) {
+#ifdef LODEPNG_SIMD_X86
+/*
+Adler-32 over len bytes, a multiple of 32. Per 32-byte block, s1 grows by the byte sum and s2 by 32 times the s1 before
+the block plus the bytes weighted 32 down to 1. The weighted sums use pmaddubsw, the plain sums psadbw, and the s1
+before each block is accumulated in ps to multiply by 32 at the end. 173 blocks (5536 bytes) fit before the modulo as
+in the scalar code.
+*/
+LODEPNG_TARGET("ssse3")
+static unsigned update_adler32SSSE3(unsigned adler, const unsigned char* data, unsigned len) {
+  unsigned s1 = adler & 0xffffu;
+  unsigned s2 = (adler >> 16u) & 0xffffu;
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i ones = _mm_set1_epi16(1);
+  const __m128i tap1 = _mm_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17);
+  const __m128i tap2 = _mm_setr_epi8(16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+  unsigned blocks = len / 32u;
+
+  while(blocks != 0u) {
+    unsigned n = blocks > 173u ? 173u : blocks;
+    __m128i ps = _mm_cvtsi32_si128((int)(s1 * n)), v1 = zero, v2 = _mm_cvtsi32_si128((int)s2);
+    blocks -= n;
+    do {
+      __m128i a = _mm_loadu_si128((const __m128i*)data);
+      __m128i b = _mm_loadu_si128((const __m128i*)(data + 16));
+      ps = _mm_add_epi32(ps, v1);
+      v1 = _mm_add_epi32(v1, _mm_add_epi32(_mm_sad_epu8(a, zero), _mm_sad_epu8(b, zero)));
+      v2 = _mm_add_epi32(v2, _mm_madd_epi16(_mm_maddubs_epi16(a, tap1), ones));
+      v2 = _mm_add_epi32(v2, _mm_madd_epi16(_mm_maddubs_epi16(b, tap2), ones));
+      data += 32;
+    } while(--n);
+    v2 = _mm_add_epi32(v2, _mm_slli_epi32(ps, 5));
+    v1 = _mm_add_epi32(v1, _mm_shuffle_epi32(v1, _MM_SHUFFLE(1, 0, 3, 2)));
+    v2 = _mm_add_epi32(v2, _mm_shuffle_epi32(v2, _MM_SHUFFLE(2, 3, 0, 1)));
+    v2 = _mm_add_epi32(v2, _mm_shuffle_epi32(v2, _MM_SHUFFLE(1, 0, 3, 2)));
+    s1 = (s1 + (unsigned)_mm_cvtsi128_si32(v1)) % 65521u;
+    s2 = (unsigned)_mm_cvtsi128_si32(v2) % 65521u;
+  }
+  return (s2 << 16u) | s1;
+}
+
+/*same as update_adler32SSSE3 with one 32-byte block per 256-bit register*/
+LODEPNG_TARGET("avx2")
+static unsigned update_adler32AVX2(unsigned adler, const unsigned char* data, unsigned len) {
   unsigned s1 = adler & 0xffffu;
   unsigned s2 = (adler >> 16u) & 0xffffu;
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i ones = _mm256_set1_epi16(1);
+  const __m256i tap = _mm256_setr_epi8(32, 31, 30, 29, 28, 27, 26, 25, 24, 23, 22, 21, 20, 19, 18, 17,
+                                       16, 15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1);
+  unsigned blocks = len / 32u;
+
+  while(blocks != 0u) {
+    unsigned n = blocks > 173u ? 173u : blocks;
+    __m256i ps = _mm256_setr_epi32((int)(s1 * n), 0, 0, 0, 0, 0, 0, 0);
+    __m256i v1 = zero, v2 = _mm256_setr_epi32((int)s2, 0, 0, 0, 0, 0, 0, 0);
+    __m128i h1, h2;
+    blocks -= n;
+    do {
+      __m256i a = _mm256_loadu_si256((const __m256i*)data);
+      ps = _mm256_add_epi32(ps, v1);
+      v1 = _mm256_add_epi32(v1, _mm256_sad_epu8(a, zero));
+      v2 = _mm256_add_epi32(v2, _mm256_madd_epi16(_mm256_maddubs_epi16(a, tap), ones));
+      data += 32;
+    } while(--n);
+    v2 = _mm256_add_epi32(v2, _mm256_slli_epi32(ps, 5));
+    h1 = _mm_add_epi32(_mm256_castsi256_si128(v1), _mm256_extracti128_si256(v1, 1));
+    h2 = _mm_add_epi32(_mm256_castsi256_si128(v2), _mm256_extracti128_si256(v2, 1));
+    h1 = _mm_add_epi32(h1, _mm_shuffle_epi32(h1, _MM_SHUFFLE(1, 0, 3, 2)));
+    h2 = _mm_add_epi32(h2, _mm_shuffle_epi32(h2, _MM_SHUFFLE(2, 3, 0, 1)));
+    h2 = _mm_add_epi32(h2, _mm_shuffle_epi32(h2, _MM_SHUFFLE(1, 0, 3, 2)));
+    s1 = (s1 + (unsigned)_mm_cvtsi128_si32(h1)) % 65521u;
+    s2 = (unsigned)_mm_cvtsi128_si32(h2) % 65521u;
+  }
+  return (s2 << 16u) | s1;
+}
+#endif /*LODEPNG_SIMD_X86*/
+
+static unsigned update_adler32(unsigned adler, const unsigned char* data, unsigned len) {
+  unsigned s1, s2;
+
+#ifdef LODEPNG_SIMD_X86
+  if(len >= 64u) {
+    int features = lodepng_get_simd_features();
+    unsigned amount = len & ~31u;
+    if(features & LODEPNG_SIMD_AVX2) adler = update_adler32AVX2(adler, data, amount);
+    else if(features & LODEPNG_SIMD_SSSE3) adler = update_adler32SSSE3(adler, data, amount);
+    else amount = 0;
+    data += amount;
+    len -= amount;
+  }
+#endif /*LODEPNG_SIMD_X86*/
 
+  s1 = adler & 0xffffu;
+  s2 = (adler >> 16u) & 0xffffu;
   while(len != 0u) {
     unsigned i;
     /*at least 5552 sums can be done before the sums overflow, saving a lot of module divisions*/
@@ -2152,7 +2936,8 @@ static unsigned adler32(const unsigned char* data, unsigned len) {
 
 static unsigned lodepng_zlib_decompressv(ucvector* out,
                                          const unsigned char* in, size_t insize,
-                                         const LodePNGDecompressSettings* settings) {
+                                         const LodePNGDecompressSettings* settings,
+                                         LodePNGInflateProgress* progress) {
   unsigned error = 0;
   unsigned CM, CINFO, FDICT;
 
@@ -2179,7 +2964,7 @@ static unsigned lodepng_zlib_decompressv(ucvector* out,
     return 26;
   }
 
-  error = inflatev(out, in + 2, insize - 2, settings);
+  error = inflatev(out, in + 2, insize - 2, settings, progress);
   if(error) return error;
 
   if(!settings->ignore_adler32) {
@@ -2195,7 +2980,7 @@ static unsigned lodepng_zlib_decompressv(ucvector* out,
 unsigned lodepng_zlib_decompress(unsigned char** out, size_t* outsize, const unsigned char* in,
                                  size_t insize, const LodePNGDecompressSettings* settings) {
   ucvector v = ucvector_init(*out, *outsize);
-  unsigned error = lodepng_zlib_decompressv(&v, in, insize, settings);
+  unsigned error = lodepng_zlib_decompressv(&v, in, insize, settings, 0);
   *out = v.data;
   *outsize = v.size;
   return error;
@@ -2220,7 +3005,7 @@ static unsigned zlib_decompress(unsigned char** out, size_t* outsize, size_t exp
       ucvector_resize(&v, *outsize + expected_size);
       v.size = *outsize;
     }
-    error = lodepng_zlib_decompressv(&v, in, insize, settings);
+    error = lodepng_zlib_decompressv(&v, in, insize, settings, 0);
     *out = v.data;
     *outsize = v.size;
   }
@@ -2233,7 +3018,6 @@ static unsigned zlib_decompress(unsigned char** out, size_t* outsize, size_t exp
 
 unsigned lodepng_zlib_compress(unsigned char** out, size_t* outsize, const unsigned char* in,
                                size_t insize, const LodePNGCompressSettings* settings) {
-  size_t i;
   unsigned error;
   unsigned char* deflatedata = 0;
   size_t deflatesize = 0;
@@ -2260,7 +3044,7 @@ unsigned lodepng_zlib_compress(unsigned char** out, size_t* outsize, const unsig
 
     (*out)[0] = (unsigned char)(CMFFLG >> 8);
     (*out)[1] = (unsigned char)(CMFFLG & 255);
-    for(i = 0; i != deflatesize; ++i) (*out)[i + 2] = deflatedata[i];
+    lodepng_memcpy(*out + 2, deflatedata, deflatesize);
     lodepng_set32bitInt(&(*out)[*outsize - 4], ADLER32);
   }
 
@@ -2317,13 +3101,42 @@ void lodepng_compress_settings_init(LodePNGCompressSettings* settings) {
   settings->minmatch = 3;
   settings->nicematch = 128;
   settings->lazymatching = 1;
+  settings->fastmatching = 0;
+  settings->maxchainlength = 0;
+  settings->num_threads = 1;
 
   settings->custom_zlib = 0;
   settings->custom_deflate = 0;
   settings->custom_context = 0;
 }
 
-const LodePNGCompressSettings lodepng_default_compress_settings = {2, 1, DEFAULT_WINDOWSIZE, 3, 128, 1, 0, 0, 0};
+const LodePNGCompressSettings lodepng_default_compress_settings = {2, 1, DEFAULT_WINDOWSIZE, 3, 128, 1, 0, 0, 1, 0, 0, 0};
+
+/*windowsize, maxchainlength, nicematch and fastmatching of levels 1 to 9, the others use lazy matching. Each level
+was picked to be both slower and smaller than the one before on a set of textures and rendered frames. Greedy matching
+with a long chain beats lazy matching with a short one, so lazy matching only starts at level 7.*/
+static const unsigned LEVEL_SETTINGS[9][4] = {
+  {32768, 1, 8, 1}, {32768, 4, 32, 1}, {32768, 8, 64, 1},
+  {32768, 32, 258, 1}, {32768, 128, 258, 1}, {32768, 512, 258, 1},
+  {32768, 128, 258, 0}, {16384, 0, 258, 0}, {32768, 0, 258, 0}
+};
+
+void lodepng_compress_settings_level(LodePNGCompressSettings* settings, unsigned level) {
+  if(level > 9) level = 9;
+  if(level == 0) {
+    settings->btype = 0;
+    settings->use_lz77 = 0;
+    return;
+  }
+  settings->btype = 2;
+  settings->use_lz77 = 1;
+  settings->minmatch = 3;
+  settings->windowsize = LEVEL_SETTINGS[level - 1][0];
+  settings->maxchainlength = LEVEL_SETTINGS[level - 1][1];
+  settings->nicematch = LEVEL_SETTINGS[level - 1][2];
+  settings->fastmatching = LEVEL_SETTINGS[level - 1][3];
+  settings->lazymatching = !settings->fastmatching;
+}
 
 
 #endif /*LODEPNG_COMPILE_ENCODER*/
@@ -2639,10 +3452,73 @@ static const unsigned lodepng_crc32_table7[256] = {
   0x2c8e0fffu, 0xe0240f61u, 0x6eab0882u, 0xa201081cu, 0xa8c40105u, 0x646e019bu, 0xeae10678u, 0x264b06e6u
 };
 
+#ifdef LODEPNG_SIMD_X86
+/*
+CRC32 by folding with carry-less multiplication, from Intel's "Fast CRC Computation for Generic Polynomials Using
+PCLMULQDQ Instruction". Four 128-bit accumulators are folded forward over 64 bytes per step, then into one and
+reduced to 32 bits with a Barrett reduction. The constants are powers of x modulo the bit-reflected polynomial.
+length must be at least 64 and a multiple of 16. r is the running CRC before the final inversion.
+*/
+LODEPNG_TARGET("pclmul")
+static unsigned lodepng_crc32PCLMUL(const unsigned char* data, size_t length, unsigned r) {
+  /*64-bit constants as pairs of 32-bit halves, C90 has no 64-bit literals*/
+  const __m128i k1k2 = _mm_set_epi32(0x00000001, (int)0xc6e41596u, 0x00000001, 0x54442bd4);
+  const __m128i k3k4 = _mm_set_epi32(0x00000000, (int)0xccaa009eu, 0x00000001, 0x751997d0);
+  const __m128i k5 = _mm_set_epi32(0, 0, 0x00000001, 0x63cd6124);
+  const __m128i poly = _mm_set_epi32(0x00000001, (int)0xf7011641u, 0x00000001, (int)0xdb710641u);
+  const __m128i mask32 = _mm_set_epi32(0, -1, 0, -1);
+  __m128i x1 = _mm_xor_si128(_mm_loadu_si128((const __m128i*)data), _mm_cvtsi32_si128((int)r));
+  __m128i x2 = _mm_loadu_si128((const __m128i*)(data + 16));
+  __m128i x3 = _mm_loadu_si128((const __m128i*)(data + 32));
+  __m128i x4 = _mm_loadu_si128((const __m128i*)(data + 48));
+  __m128i t;
+  data += 64;
+  length -= 64;
+
+  while(length >= 64) {
+#define LODEPNG_CRC_FOLD(x, k, next) \
+  (x) = _mm_xor_si128(_mm_xor_si128(_mm_clmulepi64_si128((x), (k), 0x00), _mm_clmulepi64_si128((x), (k), 0x11)), (next))
+    LODEPNG_CRC_FOLD(x1, k1k2, _mm_loadu_si128((const __m128i*)data));
+    LODEPNG_CRC_FOLD(x2, k1k2, _mm_loadu_si128((const __m128i*)(data + 16)));
+    LODEPNG_CRC_FOLD(x3, k1k2, _mm_loadu_si128((const __m128i*)(data + 32)));
+    LODEPNG_CRC_FOLD(x4, k1k2, _mm_loadu_si128((const __m128i*)(data + 48)));
+    data += 64;
+    length -= 64;
+  }
+
+  LODEPNG_CRC_FOLD(x1, k3k4, x2);
+  LODEPNG_CRC_FOLD(x1, k3k4, x3);
+  LODEPNG_CRC_FOLD(x1, k3k4, x4);
+  while(length >= 16) {
+    LODEPNG_CRC_FOLD(x1, k3k4, _mm_loadu_si128((const __m128i*)data));
+    data += 16;
+    length -= 16;
+  }
+#undef LODEPNG_CRC_FOLD
+
+  /*128 to 64 bits, then to 32 bits*/
+  x1 = _mm_xor_si128(_mm_srli_si128(x1, 8), _mm_clmulepi64_si128(x1, k3k4, 0x10));
+  x1 = _mm_xor_si128(_mm_srli_si128(x1, 4), _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), k5, 0x00));
+  /*Barrett reduction*/
+  t = _mm_clmulepi64_si128(_mm_and_si128(x1, mask32), poly, 0x10);
+  t = _mm_clmulepi64_si128(_mm_and_si128(t, mask32), poly, 0x00);
+  x1 = _mm_xor_si128(x1, t);
+  return (unsigned)_mm_cvtsi128_si32(_mm_srli_si128(x1, 4));
+}
+#endif /*LODEPNG_SIMD_X86*/
+
 /* Computes the cyclic redundancy check as used by PNG chunks*/
 unsigned lodepng_crc32(const unsigned char* data, size_t length) {
   /*Using the Slicing by Eight algorithm*/
   unsigned r = 0xffffffffu;
+#ifdef LODEPNG_SIMD_X86
+  if(length >= 64 && (lodepng_get_simd_features() & LODEPNG_SIMD_PCLMUL)) {
+    size_t amount = length & ~(size_t)15;
+    r = lodepng_crc32PCLMUL(data, amount, r);
+    data += amount;
+    length -= amount;
+  }
+#endif /*LODEPNG_SIMD_X86*/
   while(length >= 8) {
     r = lodepng_crc32_table7[(data[0] ^ (r & 0xffu))] ^
         lodepng_crc32_table6[(data[1] ^ ((r >> 8) & 0xffu))] ^
@@ -2683,6 +3559,59 @@ unsigned lodepng_crc32(const unsigned char* data, size_t length) {
 unsigned lodepng_crc32(const unsigned char* data, size_t length);
 #endif /* LODEPNG_COMPILE_CRC */
 
+#ifdef LODEPNG_COMPILE_DECODER
+/*product of a 32x32 matrix over GF(2), given as its 32 columns, with the vector vec*/
+static unsigned crc32MatrixTimes(const unsigned* matrix, unsigned vec) {
+  unsigned sum = 0;
+  while(vec) {
+    if(vec & 1u) sum ^= *matrix;
+    vec >>= 1u;
+    ++matrix;
+  }
+  return sum;
+}
+
+static void crc32MatrixSquare(unsigned* square, const unsigned* matrix) {
+  unsigned n;
+  for(n = 0; n != 32; ++n) square[n] = crc32MatrixTimes(matrix, matrix[n]);
+}
+
+/*
+CRC of the concatenation of two pieces of data, given the CRC of each and the length of the second, as zlib's
+crc32_combine. This gives a running CRC of data that arrives in pieces with only lodepng_crc32, which may be
+defined externally. It takes O(log(length2)) 32x32 matrix products.
+*/
+static unsigned lodepng_crc32_combine(unsigned crc1, unsigned crc2, size_t length2) {
+  unsigned even[32]; /*operator for 2^n zero bits, for even n*/
+  unsigned odd[32]; /*operator for 2^n zero bits, for odd n*/
+  unsigned row = 1, n;
+
+  if(length2 == 0) return crc1;
+
+  /*the operator for one zero bit*/
+  odd[0] = 0xedb88320u; /*the CRC-32 polynomial*/
+  for(n = 1; n != 32; ++n) {
+    odd[n] = row;
+    row <<= 1u;
+  }
+  crc32MatrixSquare(even, odd); /*two zero bits*/
+  crc32MatrixSquare(odd, even); /*four zero bits*/
+
+  /*append length2 zero bytes to crc1, the first squaring gives the operator for one zero byte*/
+  for(;;) {
+    crc32MatrixSquare(even, odd);
+    if(length2 & 1u) crc1 = crc32MatrixTimes(even, crc1);
+    length2 >>= 1u;
+    if(length2 == 0) break;
+    crc32MatrixSquare(odd, even);
+    if(length2 & 1u) crc1 = crc32MatrixTimes(odd, crc1);
+    length2 >>= 1u;
+    if(length2 == 0) break;
+  }
+  return crc1 ^ crc2;
+}
+#endif /*LODEPNG_COMPILE_DECODER*/
+
 /* ////////////////////////////////////////////////////////////////////////// */
 /* / Reading and writing PNG color channel bits                             / */
 /* ////////////////////////////////////////////////////////////////////////// */
@@ -3492,57 +4421,62 @@ static unsigned color_tree_add(ColorTree* tree,
   return 0;
 }
 
-/*put a pixel, given its RGBA color, into image of any color type*/
-static unsigned rgba8ToPixel(unsigned char* out, size_t i,
-                             const LodePNGColorMode* mode, ColorTree* tree /*for palette*/,
-                             unsigned char r, unsigned char g, unsigned char b, unsigned char a) {
+/*put numpixels pixels, given as RGBA8 colors, into image of any color type, starting at pixel index start.
+Pixels must be put in order for bitdepths below 8.*/
+static unsigned rgba8ToPixels(unsigned char* LODEPNG_RESTRICT out, size_t start, size_t numpixels,
+                              const unsigned char* LODEPNG_RESTRICT rgba,
+                              const LodePNGColorMode* mode, ColorTree* tree /*for palette*/) {
+  size_t i, end = start + numpixels;
   if(mode->colortype == LCT_GREY) {
-    unsigned char gray = r; /*((unsigned short)r + g + b) / 3u;*/
-    if(mode->bitdepth == 8) out[i] = gray;
-    else if(mode->bitdepth == 16) out[i * 2 + 0] = out[i * 2 + 1] = gray;
-    else {
-      /*take the most significant bits of gray*/
-      gray = ((unsigned)gray >> (8u - mode->bitdepth)) & ((1u << mode->bitdepth) - 1u);
-      addColorBits(out, i, mode->bitdepth, gray);
+    if(mode->bitdepth == 8) {
+      for(i = start; i != end; ++i, rgba += 4) out[i] = rgba[0];
+    } else if(mode->bitdepth == 16) {
+      for(i = start; i != end; ++i, rgba += 4) out[i * 2 + 0] = out[i * 2 + 1] = rgba[0];
+    } else {
+      unsigned shift = 8u - mode->bitdepth;
+      for(i = start; i != end; ++i, rgba += 4) addColorBits(out, i, mode->bitdepth, (unsigned)rgba[0] >> shift);
     }
   } else if(mode->colortype == LCT_RGB) {
     if(mode->bitdepth == 8) {
-      out[i * 3 + 0] = r;
-      out[i * 3 + 1] = g;
-      out[i * 3 + 2] = b;
+      for(i = start; i != end; ++i, rgba += 4) lodepng_memcpy(&out[i * 3], rgba, 3);
     } else {
-      out[i * 6 + 0] = out[i * 6 + 1] = r;
-      out[i * 6 + 2] = out[i * 6 + 3] = g;
-      out[i * 6 + 4] = out[i * 6 + 5] = b;
+      for(i = start; i != end; ++i, rgba += 4) {
+        out[i * 6 + 0] = out[i * 6 + 1] = rgba[0];
+        out[i * 6 + 2] = out[i * 6 + 3] = rgba[1];
+        out[i * 6 + 4] = out[i * 6 + 5] = rgba[2];
+      }
     }
   } else if(mode->colortype == LCT_PALETTE) {
-    int index = color_tree_get(tree, r, g, b, a);
-    if(index < 0) return 82; /*color not in palette*/
-    if(mode->bitdepth == 8) out[i] = index;
-    else addColorBits(out, i, mode->bitdepth, (unsigned)index);
+    for(i = start; i != end; ++i, rgba += 4) {
+      int index = color_tree_get(tree, rgba[0], rgba[1], rgba[2], rgba[3]);
+      if(index < 0) return 82; /*color not in palette*/
+      if(mode->bitdepth == 8) out[i] = index;
+      else addColorBits(out, i, mode->bitdepth, (unsigned)index);
+    }
   } else if(mode->colortype == LCT_GREY_ALPHA) {
-    unsigned char gray = r; /*((unsigned short)r + g + b) / 3u;*/
     if(mode->bitdepth == 8) {
-      out[i * 2 + 0] = gray;
-      out[i * 2 + 1] = a;
+      for(i = start; i != end; ++i, rgba += 4) {
+        out[i * 2 + 0] = rgba[0];
+        out[i * 2 + 1] = rgba[3];
+      }
     } else if(mode->bitdepth == 16) {
-      out[i * 4 + 0] = out[i * 4 + 1] = gray;
-      out[i * 4 + 2] = out[i * 4 + 3] = a;
+      for(i = start; i != end; ++i, rgba += 4) {
+        out[i * 4 + 0] = out[i * 4 + 1] = rgba[0];
+        out[i * 4 + 2] = out[i * 4 + 3] = rgba[3];
+      }
     }
   } else if(mode->colortype == LCT_RGBA) {
     if(mode->bitdepth == 8) {
-      out[i * 4 + 0] = r;
-      out[i * 4 + 1] = g;
-      out[i * 4 + 2] = b;
-      out[i * 4 + 3] = a;
+      lodepng_memcpy(&out[start * 4], rgba, numpixels * 4);
     } else {
-      out[i * 8 + 0] = out[i * 8 + 1] = r;
-      out[i * 8 + 2] = out[i * 8 + 3] = g;
-      out[i * 8 + 4] = out[i * 8 + 5] = b;
-      out[i * 8 + 6] = out[i * 8 + 7] = a;
+      for(i = start; i != end; ++i, rgba += 4) {
+        out[i * 8 + 0] = out[i * 8 + 1] = rgba[0];
+        out[i * 8 + 2] = out[i * 8 + 3] = rgba[1];
+        out[i * 8 + 4] = out[i * 8 + 5] = rgba[2];
+        out[i * 8 + 6] = out[i * 8 + 7] = rgba[3];
+      }
     }
   }
-
   return 0; /*no error*/
 }
 
@@ -3650,6 +4584,163 @@ static void getPixelColorRGBA8(unsigned char* r, unsigned char* g,
   }
 }
 
+#ifdef LODEPNG_SIMD_X86
+/*
+SSSE3 versions of the cases of getPixelColorsRGBA8 with whole bytes per sample and no color key, and AVX2 for 8-bit
+palettes, which gathers 8 palette entries at once. The 16-bit cases keep the first byte of each big-endian sample,
+which is the low byte of a little-endian 16-bit lane. Return the amount of pixels done, the caller converts the rest.
+Loads and stores stay within numpixels of in and buffer.
+*/
+LODEPNG_TARGET("ssse3")
+static size_t getPixelColorsRGBA8SSSE3(unsigned char* buffer, size_t numpixels,
+                                       const unsigned char* in, const LodePNGColorMode* mode) {
+  size_t i = 0;
+  const __m128i alpha = _mm_set1_epi32((int)0xff000000u);
+  const __m128i low = _mm_set1_epi16(255);
+  const __m128i rgb = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1, 6, 7, 8, -1, 9, 10, 11, -1);
+  const __m128i ga = _mm_setr_epi8(0, 0, 0, 1, 2, 2, 2, 3, 4, 4, 4, 5, 6, 6, 6, 7);
+  const __m128i grey = _mm_setr_epi8(0, 0, 0, -1, 1, 1, 1, -1, 2, 2, 2, -1, 3, 3, 3, -1);
+  const __m128i four = _mm_set1_epi8(4);
+  if(mode->colortype == LCT_RGB && mode->bitdepth == 8) {
+    /*16 bytes are loaded for 4 pixels of 3 bytes*/
+    for(; i + 6 <= numpixels; i += 4) {
+      __m128i v = _mm_loadu_si128((const __m128i*)(in + i * 3));
+      _mm_storeu_si128((__m128i*)(buffer + i * 4), _mm_or_si128(_mm_shuffle_epi8(v, rgb), alpha));
+    }
+  } else if(mode->colortype == LCT_GREY && mode->bitdepth == 8) {
+    for(; i + 16 <= numpixels; i += 16) {
+      __m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+      __m128i shuffle = grey;
+      unsigned k;
+      for(k = 0; k != 4; ++k, shuffle = _mm_add_epi8(shuffle, four)) {
+        _mm_storeu_si128((__m128i*)(buffer + i * 4 + k * 16), _mm_or_si128(_mm_shuffle_epi8(v, shuffle), alpha));
+      }
+    }
+  } else if(mode->colortype == LCT_GREY_ALPHA && mode->bitdepth == 8) {
+    for(; i + 8 <= numpixels; i += 8) {
+      __m128i v = _mm_loadu_si128((const __m128i*)(in + i * 2));
+      _mm_storeu_si128((__m128i*)(buffer + i * 4), _mm_shuffle_epi8(v, ga));
+      _mm_storeu_si128((__m128i*)(buffer + i * 4 + 16), _mm_shuffle_epi8(_mm_srli_si128(v, 8), ga));
+    }
+  } else if(mode->colortype == LCT_RGBA && mode->bitdepth == 16) {
+    for(; i + 4 <= numpixels; i += 4) {
+      __m128i a = _mm_and_si128(_mm_loadu_si128((const __m128i*)(in + i * 8)), low);
+      __m128i b = _mm_and_si128(_mm_loadu_si128((const __m128i*)(in + i * 8 + 16)), low);
+      _mm_storeu_si128((__m128i*)(buffer + i * 4), _mm_packus_epi16(a, b));
+    }
+  } else if(mode->colortype == LCT_RGB && mode->bitdepth == 16) {
+    /*32 bytes are loaded for 4 pixels of 6 bytes*/
+    for(; i + 6 <= numpixels; i += 4) {
+      __m128i a = _mm_and_si128(_mm_loadu_si128((const __m128i*)(in + i * 6)), low);
+      __m128i b = _mm_and_si128(_mm_loadu_si128((const __m128i*)(in + i * 6 + 16)), low);
+      __m128i v = _mm_packus_epi16(a, b);
+      _mm_storeu_si128((__m128i*)(buffer + i * 4), _mm_or_si128(_mm_shuffle_epi8(v, rgb), alpha));
+    }
+  } else if(mode->colortype == LCT_GREY && mode->bitdepth == 16) {
+    for(; i + 8 <= numpixels; i += 8) {
+      __m128i v = _mm_and_si128(_mm_loadu_si128((const __m128i*)(in + i * 2)), low);
+      v = _mm_packus_epi16(v, v);
+      _mm_storeu_si128((__m128i*)(buffer + i * 4), _mm_or_si128(_mm_shuffle_epi8(v, grey), alpha));
+      v = _mm_srli_si128(v, 4);
+      _mm_storeu_si128((__m128i*)(buffer + i * 4 + 16), _mm_or_si128(_mm_shuffle_epi8(v, grey), alpha));
+    }
+  } else if(mode->colortype == LCT_GREY_ALPHA && mode->bitdepth == 16) {
+    for(; i + 4 <= numpixels; i += 4) {
+      __m128i v = _mm_and_si128(_mm_loadu_si128((const __m128i*)(in + i * 4)), low);
+      _mm_storeu_si128((__m128i*)(buffer + i * 4), _mm_shuffle_epi8(_mm_packus_epi16(v, v), ga));
+    }
+  }
+  return i;
+}
+
+/*same as getPixelColorsRGBA8SSSE3, for RGB output*/
+LODEPNG_TARGET("ssse3")
+static size_t getPixelColorsRGB8SSSE3(unsigned char* buffer, size_t numpixels,
+                                      const unsigned char* in, const LodePNGColorMode* mode) {
+  size_t i = 0;
+  const __m128i low = _mm_set1_epi16(255);
+  const __m128i rgba = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+  if(mode->colortype == LCT_RGBA && mode->bitdepth == 8) {
+    /*16 bytes are stored for 4 pixels of 3 bytes*/
+    for(; i + 6 <= numpixels; i += 4) {
+      __m128i v = _mm_loadu_si128((const __m128i*)(in + i * 4));
+      _mm_storeu_si128((__m128i*)(buffer + i * 3), _mm_shuffle_epi8(v, rgba));
+    }
+  } else if(mode->colortype == LCT_GREY && mode->bitdepth == 8) {
+    const __m128i grey0 = _mm_setr_epi8(0, 0, 0, 1, 1, 1, 2, 2, 2, 3, 3, 3, 4, 4, 4, 5);
+    const __m128i grey1 = _mm_setr_epi8(5, 5, 6, 6, 6, 7, 7, 7, 8, 8, 8, 9, 9, 9, 10, 10);
+    const __m128i grey2 = _mm_setr_epi8(10, 11, 11, 11, 12, 12, 12, 13, 13, 13, 14, 14, 14, 15, 15, 15);
+    for(; i + 16 <= numpixels; i += 16) {
+      __m128i v = _mm_loadu_si128((const __m128i*)(in + i));
+      _mm_storeu_si128((__m128i*)(buffer + i * 3), _mm_shuffle_epi8(v, grey0));
+      _mm_storeu_si128((__m128i*)(buffer + i * 3 + 16), _mm_shuffle_epi8(v, grey1));
+      _mm_storeu_si128((__m128i*)(buffer + i * 3 + 32), _mm_shuffle_epi8(v, grey2));
+    }
+  } else if(mode->colortype == LCT_GREY_ALPHA && mode->bitdepth == 8) {
+    const __m128i ga0 = _mm_setr_epi8(0, 0, 0, 2, 2, 2, 4, 4, 4, 6, 6, 6, 8, 8, 8, 10);
+    const __m128i ga1 = _mm_setr_epi8(10, 10, 12, 12, 12, 14, 14, 14, -1, -1, -1, -1, -1, -1, -1, -1);
+    for(; i + 8 <= numpixels; i += 8) {
+      __m128i v = _mm_loadu_si128((const __m128i*)(in + i * 2));
+      _mm_storeu_si128((__m128i*)(buffer + i * 3), _mm_shuffle_epi8(v, ga0));
+      _mm_storel_epi64((__m128i*)(buffer + i * 3 + 16), _mm_shuffle_epi8(v, ga1));
+    }
+  } else if(mode->colortype == LCT_RGB && mode->bitdepth == 16) {
+    /*32 bytes in give 16 bytes out, of which the 5 whole pixels are kept*/
+    for(; i + 6 <= numpixels; i += 5) {
+      __m128i a = _mm_and_si128(_mm_loadu_si128((const __m128i*)(in + i * 6)), low);
+      __m128i b = _mm_and_si128(_mm_loadu_si128((const __m128i*)(in + i * 6 + 16)), low);
+      _mm_storeu_si128((__m128i*)(buffer + i * 3), _mm_packus_epi16(a, b));
+    }
+  } else if(mode->colortype == LCT_RGBA && mode->bitdepth == 16) {
+    for(; i + 6 <= numpixels; i += 4) {
+      __m128i a = _mm_and_si128(_mm_loadu_si128((const __m128i*)(in + i * 8)), low);
+      __m128i b = _mm_and_si128(_mm_loadu_si128((const __m128i*)(in + i * 8 + 16)), low);
+      _mm_storeu_si128((__m128i*)(buffer + i * 3), _mm_shuffle_epi8(_mm_packus_epi16(a, b), rgba));
+    }
+  }
+  return i;
+}
+
+/*8-bit palette to RGBA8 or RGB8 (channels 4 or 3). The palette always has room for 256 colors.*/
+LODEPNG_TARGET("avx2")
+static size_t getPixelColorsPaletteAVX2(unsigned char* buffer, size_t numpixels, const unsigned char* in,
+                                        const unsigned char* palette, unsigned channels) {
+  size_t i = 0;
+  if(channels == 4) {
+    for(; i + 8 <= numpixels; i += 8) {
+      __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(in + i)));
+      _mm256_storeu_si256((__m256i*)(buffer + i * 4), _mm256_i32gather_epi32((const int*)palette, index, 4));
+    }
+  } else {
+    const __m256i rgba = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1,
+                                          0, 1, 2, 4, 5, 6, 8, 9, 10, 12, 13, 14, -1, -1, -1, -1);
+    /*each half gives 12 bytes, stored as 16: the second store overwrites the 4 extra bytes of the first*/
+    for(; i + 10 <= numpixels; i += 8) {
+      __m256i index = _mm256_cvtepu8_epi32(_mm_loadl_epi64((const __m128i*)(in + i)));
+      __m256i v = _mm256_shuffle_epi8(_mm256_i32gather_epi32((const int*)palette, index, 4), rgba);
+      _mm_storeu_si128((__m128i*)(buffer + i * 3), _mm256_castsi256_si128(v));
+      _mm_storeu_si128((__m128i*)(buffer + i * 3 + 12), _mm256_extracti128_si256(v, 1));
+    }
+  }
+  return i;
+}
+
+/*converts the first pixels with the SIMD functions above if the CPU has them, returns how many*/
+static size_t getPixelColorsSIMD(unsigned char* buffer, size_t numpixels, const unsigned char* in,
+                                 const LodePNGColorMode* mode, unsigned channels) {
+  int features = lodepng_get_simd_features();
+  if(mode->colortype == LCT_PALETTE) {
+    if(mode->bitdepth != 8 || !(features & LODEPNG_SIMD_AVX2)) return 0;
+    return getPixelColorsPaletteAVX2(buffer, numpixels, in, mode->palette, channels);
+  }
+  if(!(features & LODEPNG_SIMD_SSSE3) || mode->bitdepth < 8) return 0;
+  /*the color key is applied by a second pass in getPixelColorsRGBA8 or per pixel, let that code do it all*/
+  if(mode->key_defined && channels == 4) return 0;
+  if(channels == 4) return getPixelColorsRGBA8SSSE3(buffer, numpixels, in, mode);
+  return getPixelColorsRGB8SSSE3(buffer, numpixels, in, mode);
+}
+#endif /*LODEPNG_SIMD_X86*/
+
 /*Similar to getPixelColorRGBA8, but with all the for loops inside of the color
 mode test cases, optimized to convert the colors much faster, when converting
 to the common case of RGBA with 8 bit per channel. buffer must be RGBA with
@@ -3659,6 +4750,12 @@ static void getPixelColorsRGBA8(unsigned char* LODEPNG_RESTRICT buffer, size_t n
                                 const LodePNGColorMode* mode) {
   unsigned num_channels = 4;
   size_t i;
+#ifdef LODEPNG_SIMD_X86
+  i = getPixelColorsSIMD(buffer, numpixels, in, mode, num_channels);
+  buffer += i * num_channels;
+  in += i * (lodepng_get_bpp(mode) / 8u);
+  numpixels -= i;
+#endif /*LODEPNG_SIMD_X86*/
   if(mode->colortype == LCT_GREY) {
     if(mode->bitdepth == 8) {
       for(i = 0; i != numpixels; ++i, buffer += num_channels) {
@@ -3755,6 +4852,12 @@ static void getPixelColorsRGB8(unsigned char* LODEPNG_RESTRICT buffer, size_t nu
                                const LodePNGColorMode* mode) {
   const unsigned num_channels = 3;
   size_t i;
+#ifdef LODEPNG_SIMD_X86
+  i = getPixelColorsSIMD(buffer, numpixels, in, mode, num_channels);
+  buffer += i * num_channels;
+  in += i * (lodepng_get_bpp(mode) / 8u);
+  numpixels -= i;
+#endif /*LODEPNG_SIMD_X86*/
   if(mode->colortype == LCT_GREY) {
     if(mode->bitdepth == 8) {
       for(i = 0; i != numpixels; ++i, buffer += num_channels) {
@@ -3908,11 +5011,14 @@ unsigned lodepng_convert(unsigned char* out, const unsigned char* in,
     } else if(mode_out->bitdepth == 8 && mode_out->colortype == LCT_RGB) {
       getPixelColorsRGB8(out, numpixels, in, mode_in);
     } else {
-      unsigned char r = 0, g = 0, b = 0, a = 0;
-      for(i = 0; i != numpixels; ++i) {
-        getPixelColorRGBA8(&r, &g, &b, &a, in, i, mode_in);
-        error = rgba8ToPixel(out, i, mode_out, &tree, r, g, b, a);
-        if(error) break;
+      /*convert through an RGBA8 buffer, so the color types are checked once per chunk rather than per pixel. The
+      chunk size is a multiple of 8 pixels so that each chunk of the input starts at a whole byte.*/
+      unsigned char rgba[256 * 4];
+      size_t bpp = lodepng_get_bpp(mode_in);
+      for(i = 0; i < numpixels && !error; i += 256) {
+        size_t n = numpixels - i < 256 ? numpixels - i : 256;
+        getPixelColorsRGBA8(rgba, n, &in[i * bpp / 8], mode_in);
+        error = rgba8ToPixels(out, i, n, rgba, mode_out, &tree);
       }
     }
   }
@@ -4435,6 +5541,209 @@ unsigned lodepng_inspect(unsigned* w, unsigned* h, LodePNGState* state,
   return state->error;
 }
 
+#ifdef LODEPNG_SIMD_X86
+/*
+SIMD unfilter kernels for x86-64. SSE2 is always available there, SSSE3 and AVX2 are
+detected once at runtime. Sub and Up process whole vectors: Sub with a prefix sum over
+the pixels in the vector. Average and Paeth depend on the previous output pixel, so they
+reconstruct one pixel per step with all its channels in one register.
+Every kernel reads scanline bytes before it writes the recon bytes at the same position and
+never writes past the end of the line, so recon may alias scanline as in unfilterScanline.
+*/
+
+/*loads and stores exactly the bytes of one pixel with bytewidth 3, 4, 6 or 8*/
+static LODEPNG_SIMD_INLINE __m128i loadPixelSSE2(const unsigned char* p, size_t bytewidth) {
+  int lo;
+  if(bytewidth == 8) return _mm_loadl_epi64((const __m128i*)p);
+  if(bytewidth == 3) return _mm_cvtsi32_si128(p[0] | (p[1] << 8) | (p[2] << 16));
+  memcpy(&lo, p, 4);
+  if(bytewidth == 4) return _mm_cvtsi32_si128(lo);
+  return _mm_insert_epi16(_mm_cvtsi32_si128(lo), p[4] | (p[5] << 8), 2);
+}
+
+static LODEPNG_SIMD_INLINE void storePixelSSE2(unsigned char* p, __m128i v, size_t bytewidth) {
+  int lo = _mm_cvtsi128_si32(v);
+  if(bytewidth == 8) {
+    _mm_storel_epi64((__m128i*)p, v);
+    return;
+  }
+  memcpy(p, &lo, bytewidth == 3 ? 3 : 4);
+  if(bytewidth == 6) {
+    int hi = _mm_extract_epi16(v, 2);
+    memcpy(p + 4, &hi, 2);
+  }
+}
+
+LODEPNG_TARGET("avx2")
+static void unfilterUpAVX2(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon, size_t length) {
+  size_t i = 0;
+  for(; i + 32 <= length; i += 32) {
+    __m256i s = _mm256_loadu_si256((const __m256i*)(scanline + i));
+    __m256i b = _mm256_loadu_si256((const __m256i*)(precon + i));
+    _mm256_storeu_si256((__m256i*)(recon + i), _mm256_add_epi8(s, b));
+  }
+  for(; i != length; ++i) recon[i] = scanline[i] + precon[i];
+}
+
+static void unfilterUpSSE2(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon, size_t length) {
+  size_t i = 0;
+  for(; i + 16 <= length; i += 16) {
+    __m128i s = _mm_loadu_si128((const __m128i*)(scanline + i));
+    __m128i b = _mm_loadu_si128((const __m128i*)(precon + i));
+    _mm_storeu_si128((__m128i*)(recon + i), _mm_add_epi8(s, b));
+  }
+  for(; i != length; ++i) recon[i] = scanline[i] + precon[i];
+}
+
+/*Sub as a prefix sum: the previous pixel is added to the first pixel of the vector, then each
+pixel is added to the ones after it with log2(pixels per vector) shifted adds. For bytewidth 3 and 6,
+a vector holds 12 bytes, which are stored as 8 + 4 so that no byte after them is touched.*/
+static LODEPNG_SIMD_INLINE void unfilterSubSSE2_(unsigned char* recon, const unsigned char* scanline,
+                                            size_t bytewidth, size_t length) {
+  size_t i = 0, j;
+  __m128i a = _mm_setzero_si128();
+  if(bytewidth == 4 || bytewidth == 8) {
+    for(; i + 16 <= length; i += 16) {
+      __m128i x = _mm_add_epi8(_mm_loadu_si128((const __m128i*)(scanline + i)), a);
+      x = _mm_add_epi8(x, _mm_slli_si128(x, 8));
+      if(bytewidth == 4) {
+        x = _mm_add_epi8(x, _mm_slli_si128(x, 4));
+        a = _mm_srli_si128(x, 12);
+      } else {
+        a = _mm_srli_si128(x, 8);
+      }
+      _mm_storeu_si128((__m128i*)(recon + i), x);
+    }
+  } else {
+    const __m128i mask = bytewidth == 3 ? _mm_set_epi32(0, 0, 0, 0xffffff) : _mm_set_epi32(0, 0, 0xffff, -1);
+    for(; i + 16 <= length; i += 12) {
+      __m128i x = _mm_add_epi8(_mm_loadu_si128((const __m128i*)(scanline + i)), a);
+      int last;
+      if(bytewidth == 3) {
+        x = _mm_add_epi8(x, _mm_slli_si128(x, 3));
+        x = _mm_add_epi8(x, _mm_slli_si128(x, 6));
+        a = _mm_and_si128(_mm_srli_si128(x, 9), mask);
+      } else {
+        x = _mm_add_epi8(x, _mm_slli_si128(x, 6));
+        a = _mm_and_si128(_mm_srli_si128(x, 6), mask);
+      }
+      last = _mm_cvtsi128_si32(_mm_srli_si128(x, 8));
+      _mm_storel_epi64((__m128i*)(recon + i), x);
+      memcpy(recon + i + 8, &last, 4);
+    }
+  }
+  if(i == 0) {
+    for(; i != bytewidth; ++i) recon[i] = scanline[i];
+  }
+  for(j = i - bytewidth; i != length; ++i, ++j) recon[i] = scanline[i] + recon[j];
+}
+
+/*Average per pixel: _mm_avg_epu8 rounds up, so the lowest bit of a ^ b is subtracted to round down.
+The first pixel uses a = 0, which gives precon >> 1 as required.*/
+static LODEPNG_SIMD_INLINE void unfilterAvgSSE2_(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                                            size_t bytewidth, size_t length) {
+  size_t i;
+  const __m128i one = _mm_set1_epi8(1);
+  __m128i a = _mm_setzero_si128();
+  for(i = 0; i + bytewidth <= length; i += bytewidth) {
+    __m128i s = loadPixelSSE2(scanline + i, bytewidth);
+    __m128i b = loadPixelSSE2(precon + i, bytewidth);
+    __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b), _mm_and_si128(_mm_xor_si128(a, b), one));
+    a = _mm_add_epi8(s, avg);
+    storePixelSSE2(recon + i, a, bytewidth);
+  }
+}
+
+/*Paeth per pixel in 16-bit lanes, choosing between a, b and c with the same priority as paethPredictor:
+a unless pb < pa, then the winner unless pc is smaller still.*/
+LODEPNG_TARGET("ssse3")
+static LODEPNG_SIMD_INLINE void unfilterPaethSSSE3_(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                                               size_t bytewidth, size_t length) {
+  size_t i;
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i low = _mm_set1_epi16(255);
+  __m128i a = zero, c = zero;
+  for(i = 0; i + bytewidth <= length; i += bytewidth) {
+    __m128i b = _mm_unpacklo_epi8(loadPixelSSE2(precon + i, bytewidth), zero);
+    __m128i s = _mm_unpacklo_epi8(loadPixelSSE2(scanline + i, bytewidth), zero);
+    __m128i pa = _mm_sub_epi16(b, c);
+    __m128i pb = _mm_sub_epi16(a, c);
+    __m128i pc = _mm_abs_epi16(_mm_add_epi16(pa, pb));
+    __m128i smaller, pred;
+    pa = _mm_abs_epi16(pa);
+    pb = _mm_abs_epi16(pb);
+    smaller = _mm_cmplt_epi16(pb, pa);
+    pred = _mm_or_si128(_mm_and_si128(smaller, b), _mm_andnot_si128(smaller, a));
+    pa = _mm_min_epi16(pa, pb);
+    smaller = _mm_cmplt_epi16(pc, pa);
+    pred = _mm_or_si128(_mm_and_si128(smaller, c), _mm_andnot_si128(smaller, pred));
+    /*the sum stays in 16-bit lanes for the next pixel, only the store packs it*/
+    a = _mm_and_si128(_mm_add_epi16(s, pred), low);
+    storePixelSSE2(recon + i, _mm_packus_epi16(a, a), bytewidth);
+    c = b;
+  }
+}
+
+/*the kernels are instantiated for each supported bytewidth, so that the pixel size is a constant*/
+static void unfilterSubSSE2(unsigned char* recon, const unsigned char* scanline, size_t bytewidth, size_t length) {
+  switch(bytewidth) {
+    case 3: unfilterSubSSE2_(recon, scanline, 3, length); break;
+    case 4: unfilterSubSSE2_(recon, scanline, 4, length); break;
+    case 6: unfilterSubSSE2_(recon, scanline, 6, length); break;
+    default: unfilterSubSSE2_(recon, scanline, 8, length); break;
+  }
+}
+
+static void unfilterAvgSSE2(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                            size_t bytewidth, size_t length) {
+  switch(bytewidth) {
+    case 3: unfilterAvgSSE2_(recon, scanline, precon, 3, length); break;
+    case 4: unfilterAvgSSE2_(recon, scanline, precon, 4, length); break;
+    case 6: unfilterAvgSSE2_(recon, scanline, precon, 6, length); break;
+    default: unfilterAvgSSE2_(recon, scanline, precon, 8, length); break;
+  }
+}
+
+LODEPNG_TARGET("ssse3")
+static void unfilterPaethSSSE3(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                               size_t bytewidth, size_t length) {
+  switch(bytewidth) {
+    case 3: unfilterPaethSSSE3_(recon, scanline, precon, 3, length); break;
+    case 4: unfilterPaethSSSE3_(recon, scanline, precon, 4, length); break;
+    case 6: unfilterPaethSSSE3_(recon, scanline, precon, 6, length); break;
+    default: unfilterPaethSSSE3_(recon, scanline, precon, 8, length); break;
+  }
+}
+
+/*Unfilters the scanline with a SIMD kernel if there is one for the filter type, bytewidth and CPU.
+Returns 0 if the scanline must be unfiltered by the portable code instead.*/
+static int unfilterScanlineSIMD(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
+                                size_t bytewidth, unsigned char filterType, size_t length) {
+  int features = lodepng_get_simd_features();
+  switch(filterType) {
+    case 1:
+      if(bytewidth != 3 && bytewidth != 4 && bytewidth != 6 && bytewidth != 8) return 0;
+      unfilterSubSSE2(recon, scanline, bytewidth, length);
+      return 1;
+    case 2:
+      if(!precon) return 0;
+      if(features & LODEPNG_SIMD_AVX2) unfilterUpAVX2(recon, scanline, precon, length);
+      else unfilterUpSSE2(recon, scanline, precon, length);
+      return 1;
+    case 3:
+      if(!precon || (bytewidth != 3 && bytewidth != 4 && bytewidth != 6 && bytewidth != 8)) return 0;
+      unfilterAvgSSE2(recon, scanline, precon, bytewidth, length);
+      return 1;
+    case 4:
+      if(!precon || !(features & LODEPNG_SIMD_SSSE3)) return 0;
+      if(bytewidth != 3 && bytewidth != 4 && bytewidth != 6 && bytewidth != 8) return 0;
+      unfilterPaethSSSE3(recon, scanline, precon, bytewidth, length);
+      return 1;
+    default: return 0;
+  }
+}
+#endif /*LODEPNG_SIMD_X86*/
+
 static unsigned unfilterScanline(unsigned char* recon, const unsigned char* scanline, const unsigned char* precon,
                                  size_t bytewidth, unsigned char filterType, size_t length) {
   /*
@@ -4447,6 +5756,9 @@ static unsigned unfilterScanline(unsigned char* recon, const unsigned char* scan
   */
 
   size_t i;
+#ifdef LODEPNG_SIMD_X86
+  if(unfilterScanlineSIMD(recon, scanline, precon, bytewidth, filterType, length)) return 0;
+#endif /*LODEPNG_SIMD_X86*/
   switch(filterType) {
     case 0:
       for(i = 0; i != length; ++i) recon[i] = scanline[i];
@@ -4626,12 +5938,14 @@ static unsigned unfilterScanline(unsigned char* recon, const unsigned char* scan
   return 0;
 }
 
-static unsigned unfilter(unsigned char* out, const unsigned char* in, unsigned w, unsigned h, unsigned bpp) {
+static unsigned unfilter(unsigned char* out, size_t outstride, const unsigned char* in,
+                         unsigned w, unsigned h, unsigned bpp) {
   /*
   For PNG filter method 0
   this function unfilters a single image (e.g. without interlacing this is called once, with Adam7 seven times)
   out must have enough bytes allocated already, in must have the scanlines + 1 filtertype byte per scanline
   w and h are image dimensions or dimensions of reduced image, bpp is bits per pixel
+  outstride is the amount of bytes between the starts of rows in out, at least the width of a scanline
   in and out are allowed to be the same memory address (but aren't the same size since in has the extra filter bytes)
   */
 
@@ -4644,7 +5958,7 @@ static unsigned unfilter(unsigned char* out, const unsigned char* in, unsigned w
   size_t linebytes = lodepng_get_raw_size_idat(w, 1, bpp) - 1u;
 
   for(y = 0; y < h; ++y) {
-    size_t outindex = linebytes * y;
+    size_t outindex = outstride * y;
     size_t inindex = (1 + linebytes) * y; /*the extra filterbyte added to each row*/
     unsigned char filterType = in[inindex];
 
@@ -4660,14 +5974,16 @@ static unsigned unfilter(unsigned char* out, const unsigned char* in, unsigned w
 in: Adam7 interlaced image, with no padding bits between scanlines, but between
  reduced images so that each reduced image starts at a byte.
 out: the same pixels, but re-ordered so that they're now a non-interlaced image with size w*h
+olinebits: bits between the starts of rows of out, w * bpp for no padding bits, a multiple of 8 if bpp >= 8
 bpp: bits per pixel
-out has the following size in bits: w * h * bpp.
+out has the following size in bits: olinebits * (h - 1) + w * bpp.
 in is possibly bigger due to padding bits between reduced images.
 out must be big enough AND must be 0 everywhere if bpp < 8 in the current implementation
 (because that's likely a little bit faster)
 NOTE: comments about padding bits are only relevant if bpp < 8
 */
-static void Adam7_deinterlace(unsigned char* out, const unsigned char* in, unsigned w, unsigned h, unsigned bpp) {
+static void Adam7_deinterlace(unsigned char* out, size_t olinebits, const unsigned char* in,
+                              unsigned w, unsigned h, unsigned bpp) {
   unsigned passw[7], passh[7];
   size_t filter_passstart[8], padded_passstart[8], passstart[8];
   unsigned i;
@@ -4681,8 +5997,8 @@ static void Adam7_deinterlace(unsigned char* out, const unsigned char* in, unsig
       for(y = 0; y < passh[i]; ++y)
       for(x = 0; x < passw[i]; ++x) {
         size_t pixelinstart = passstart[i] + (y * passw[i] + x) * bytewidth;
-        size_t pixeloutstart = ((ADAM7_IY[i] + (size_t)y * ADAM7_DY[i]) * (size_t)w
-                             + ADAM7_IX[i] + (size_t)x * ADAM7_DX[i]) * bytewidth;
+        size_t pixeloutstart = (ADAM7_IY[i] + (size_t)y * ADAM7_DY[i]) * (olinebits / 8u)
+                             + (ADAM7_IX[i] + (size_t)x * ADAM7_DX[i]) * bytewidth;
         for(b = 0; b < bytewidth; ++b) {
           out[pixeloutstart + b] = in[pixelinstart + b];
         }
@@ -4692,7 +6008,6 @@ static void Adam7_deinterlace(unsigned char* out, const unsigned char* in, unsig
     for(i = 0; i != 7; ++i) {
       unsigned x, y, b;
       unsigned ilinebits = bpp * passw[i];
-      unsigned olinebits = bpp * w;
       size_t obp, ibp; /*bit pointers (for out and in buffer)*/
       for(y = 0; y < passh[i]; ++y)
       for(x = 0; x < passw[i]; ++x) {
@@ -4734,25 +6049,35 @@ static void removePaddingBits(unsigned char* out, const unsigned char* in,
 /*out must be buffer big enough to contain full image, and in must contain the full decompressed data from
 the IDAT chunks (with filter index bytes and possible padding bits)
 return value is error*/
-static unsigned postProcessScanlines(unsigned char* out, unsigned char* in,
+static unsigned postProcessScanlines(unsigned char* out, size_t olinebits, unsigned char* in,
                                      unsigned w, unsigned h, const LodePNGInfo* info_png) {
   /*
   This function converts the filtered-padded-interlaced data into pure 2D image buffer with the PNG's colortype.
   Steps:
   *) if no Adam7: 1) unfilter 2) remove padding bits (= possible extra bits per scanline if bpp < 8)
   *) if adam7: 1) 7x unfilter 2) 7x remove padding bits 3) Adam7_deinterlace
+  olinebits is the amount of bits between the starts of rows in out: w * bpp for the image without padding bits
+  that lodepng_decode outputs, or else a multiple of 8 of at least w * bpp, then the unused bits of each row are 0.
   NOTE: the in buffer will be overwritten with intermediate data!
   */
   unsigned bpp = lodepng_get_bpp(&info_png->color);
+  size_t linebytes; /*bytes per row without filter type byte, including the padding bits*/
   if(bpp == 0) return 31; /*error: invalid colortype*/
+  linebytes = lodepng_get_raw_size_idat(w, 1, bpp) - 1u;
 
   if(info_png->interlace_method == 0) {
-    if(bpp < 8 && w * bpp != ((w * bpp + 7u) / 8u) * 8u) {
-      CERROR_TRY_RETURN(unfilter(in, in, w, h, bpp));
-      removePaddingBits(out, in, w * bpp, ((w * bpp + 7u) / 8u) * 8u, h);
+    if(olinebits == (size_t)w * bpp && olinebits != linebytes * 8u) {
+      CERROR_TRY_RETURN(unfilter(in, linebytes, in, w, h, bpp));
+      removePaddingBits(out, in, olinebits, linebytes * 8u, h);
     }
     /*we can immediately filter into the out buffer, no other steps needed*/
-    else CERROR_TRY_RETURN(unfilter(out, in, w, h, bpp));
+    else CERROR_TRY_RETURN(unfilter(out, olinebits / 8u, in, w, h, bpp));
+    if(olinebits != (size_t)w * bpp && ((size_t)w * bpp) % 8u != 0) {
+      /*clear the padding bits that unfilter kept*/
+      unsigned char mask = (unsigned char)(0xff00u >> (((size_t)w * bpp) % 8u));
+      unsigned y;
+      for(y = 0; y != h; ++y) out[(olinebits / 8u) * y + linebytes - 1u] &= mask;
+    }
   } else /*interlace_method is 1 (Adam7)*/ {
     unsigned passw[7], passh[7]; size_t filter_passstart[8], padded_passstart[8], passstart[8];
     unsigned i;
@@ -4760,7 +6085,9 @@ static unsigned postProcessScanlines(unsigned char* out, unsigned char* in,
     Adam7_getpassvalues(passw, passh, filter_passstart, padded_passstart, passstart, w, h, bpp);
 
     for(i = 0; i != 7; ++i) {
-      CERROR_TRY_RETURN(unfilter(&in[padded_passstart[i]], &in[filter_passstart[i]], passw[i], passh[i], bpp));
+      size_t passbytes = lodepng_get_raw_size_idat(passw[i], 1, bpp) - 1u;
+      CERROR_TRY_RETURN(unfilter(&in[padded_passstart[i]], passbytes, &in[filter_passstart[i]],
+                                 passw[i], passh[i], bpp));
       /*TODO: possible efficiency improvement: if in this reduced image the bits fit nicely in 1 scanline,
       move bytes instead of bits or move not at all*/
       if(bpp < 8) {
@@ -4771,7 +6098,12 @@ static unsigned postProcessScanlines(unsigned char* out, unsigned char* in,
       }
     }
 
-    Adam7_deinterlace(out, in, w, h, bpp);
+    if(olinebits != (size_t)w * bpp && ((size_t)w * bpp) % 8u != 0) {
+      /*Adam7_deinterlace only sets the bits of pixels*/
+      unsigned y;
+      for(y = 0; y != h; ++y) out[(olinebits / 8u) * y + linebytes - 1u] = 0;
+    }
+    Adam7_deinterlace(out, olinebits, in, w, h, bpp);
   }
 
   return 0;
@@ -5282,46 +6614,404 @@ unsigned lodepng_inspect_chunk(LodePNGState* state, size_t pos,
 }
 
 /*read a PNG, the result will be in the same color type as the PNG (hence "generic")*/
-static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
-                          LodePNGState* state,
-                          const unsigned char* in, size_t insize) {
-  unsigned char IEND = 0;
-  const unsigned char* chunk; /*points to beginning of next chunk*/
-  unsigned char* idat; /*the data from idat chunks, zlib compressed*/
-  size_t idatsize = 0;
-  unsigned char* scanlines = 0;
-  size_t scanlines_size = 0, expected_size = 0;
-  size_t outsize = 0;
+/*returns 1 if the decoder must convert the image from info_png to info_raw*/
+static unsigned needsColorConvert(const LodePNGState* state) {
+  return state->decoder.color_convert && !lodepng_color_mode_equal(&state->info_raw, &state->info_png.color);
+}
+
+/*returns 1 if the decoder can convert to this color mode*/
+static unsigned colorConvertSupported(const LodePNGColorMode* mode_raw) {
+  /*TODO: check if this works according to the statement in the documentation: "The converter can convert
+  from grayscale input color type, to 8-bit grayscale or grayscale with alpha"*/
+  return mode_raw->colortype == LCT_RGB || mode_raw->colortype == LCT_RGBA || mode_raw->bitdepth == 8;
+}
+
+/*
+lodepng_convert of h rows of w pixels, with the given amount of bytes between the starts of rows of out and in.
+Rows that are not whole bytes start at a byte and end with padding bits.
+*/
+static unsigned convertRows(unsigned char* out, size_t outstride, const unsigned char* in, size_t instride,
+                            const LodePNGColorMode* mode_out, const LodePNGColorMode* mode_in,
+                            unsigned w, unsigned h) {
+  size_t outbits = (size_t)w * lodepng_get_bpp(mode_out), inbits = (size_t)w * lodepng_get_bpp(mode_in);
+  unsigned y;
+  if(h <= 1 || (outbits == outstride * 8u && inbits == instride * 8u)) {
+    return lodepng_convert(out, in, mode_out, mode_in, w, h);
+  }
+  for(y = 0; y != h; ++y) {
+    unsigned error = lodepng_convert(&out[outstride * y], &in[instride * y], mode_out, mode_in, w, 1);
+    if(error) return error;
+  }
+  return 0;
+}
+
+/*
+The error of zlib_decompress in decodeGeneric for IDAT data that inflates to more than expected_size. Inflate into a
+buffer of expected_size stops there with error 109, while decodeGeneric goes on and reports an error further in the
+zlib stream, a wrong Adler-32, or else the size mismatch 91. This inflates the data again without the limit to find
+which. It is only for corrupt images, so the extra work does not matter.
+*/
+static unsigned zlibOversizeError(const unsigned char* idat, size_t idatsize,
+                                  const LodePNGDecompressSettings* settings) {
+  unsigned char* data = 0;
+  size_t size = 0;
+  unsigned error = zlib_decompress(&data, &size, 0, idat, idatsize, settings);
+  lodepng_free(data);
+  return error ? error : 91; /*decompressed size doesn't match prediction*/
+}
+
+#ifdef LODEPNG_THREADS
+/*
+Pipelined decoding of large non-interlaced images with whole bytes per scanline. The calling thread inflates the IDAT
+data and publishes through LodePNGInflateProgress how much of it is final. A second thread unfilters every complete
+row into the image, and computes the Adler-32 of the rows on the way. If the image needs color conversion, the other
+threads, and the calling thread once inflate is done, convert batches of unfiltered rows with lodepng_convert.
+The inflate output is allocated at its final size plus the slack of inflateHuffmanBlock, and max_output_size makes
+inflate fail rather than grow it, so it never moves while the other threads read it.
+*/
+
+/*smallest inflated size worth starting threads for*/
+#define LODEPNG_PIPELINE_MIN_SIZE 1048576u
+/*how often inflate reports progress, in bytes*/
+#define LODEPNG_PIPELINE_STEP 65536u
+
+struct LodePNGPipeline {
+  std::mutex mutex;
+  std::condition_variable cond;
+  const unsigned char* scanlines; /*inflate output, one filter type byte before each row*/
+  unsigned char* image; /*unfiltered image in the PNG color type*/
+  unsigned char* converted; /*image in the requested color type, or NULL if no conversion is needed*/
+  size_t imagestride, convertedstride; /*bytes between the starts of rows of image and converted*/
+  const LodePNGColorMode* mode_png;
+  const LodePNGColorMode* mode_raw;
+  unsigned w, h;
+  size_t linebytes; /*bytes per row of the scanlines, without filter type byte*/
+  unsigned batch; /*rows per color conversion batch*/
+  /*the following are guarded by mutex*/
+  size_t inflated; /*bytes of scanlines that are final*/
+  int inflate_done;
+  unsigned unfiltered; /*rows unfiltered*/
+  int unfilter_done;
+  unsigned unfilter_error;
+  unsigned adler; /*Adler-32 of the scanlines of the unfiltered rows*/
+  unsigned claimed; /*rows taken by color conversion*/
+  unsigned convert_error;
+};
+
+static void pipelineInflateProgress(void* context, size_t size) {
+  LodePNGPipeline* p = (LodePNGPipeline*)context;
+  std::lock_guard<std::mutex> lock(p->mutex);
+  p->inflated = size;
+  p->cond.notify_all();
+}
+
+static void pipelineUnfilter(LodePNGPipeline* p) {
+  size_t bytewidth = (lodepng_get_bpp(p->mode_png) + 7u) / 8u;
+  size_t stride = p->linebytes + 1u;
+  /*rows per step, also keeps the Adler-32 length within unsigned*/
+  unsigned maxrows = (unsigned)LODEPNG_MAX((size_t)1u, (size_t)16777216u / stride);
+  unsigned char* prevline = 0;
+  unsigned y = 0, error = 0, adler = 1u;
+
+  while(y < p->h && !error) {
+    unsigned start = y, end;
+    {
+      std::unique_lock<std::mutex> lock(p->mutex);
+      while(p->inflated / stride <= y && !p->inflate_done) p->cond.wait(lock);
+      end = (unsigned)LODEPNG_MIN(p->inflated / stride, (size_t)p->h);
+    }
+    if(end <= y) break; /*inflate stopped early, decodePipelined reports the error*/
+    if(end - y > maxrows) end = y + maxrows;
+    for(; y < end; ++y) {
+      const unsigned char* scanline = &p->scanlines[stride * y];
+      unsigned char* recon = &p->image[p->imagestride * y];
+      error = unfilterScanline(recon, scanline + 1, prevline, bytewidth, scanline[0], p->linebytes);
+      if(error) break;
+      prevline = recon;
+    }
+    adler = update_adler32(adler, &p->scanlines[stride * start], (unsigned)(stride * (y - start)));
+    {
+      std::lock_guard<std::mutex> lock(p->mutex);
+      p->unfiltered = y;
+      p->cond.notify_all();
+    }
+  }
+
+  std::lock_guard<std::mutex> lock(p->mutex);
+  p->unfilter_done = 1;
+  p->unfilter_error = error;
+  p->adler = adler;
+  p->cond.notify_all();
+}
+
+/*converts batches of rows until all rows that the unfilter thread produces are taken*/
+static void pipelineConvert(LodePNGPipeline* p) {
+  for(;;) {
+    unsigned y0, y1, error;
+    {
+      std::unique_lock<std::mutex> lock(p->mutex);
+      while(p->claimed >= p->unfiltered && !p->unfilter_done && !p->convert_error) p->cond.wait(lock);
+      if(p->claimed >= p->unfiltered || p->convert_error) return;
+      y0 = p->claimed;
+      y1 = LODEPNG_MIN(p->unfiltered, y0 + p->batch);
+      p->claimed = y1;
+    }
+    error = convertRows(&p->converted[p->convertedstride * y0], p->convertedstride,
+                        &p->image[p->imagestride * y0], p->imagestride, p->mode_raw, p->mode_png, p->w, y1 - y0);
+    if(error) {
+      std::lock_guard<std::mutex> lock(p->mutex);
+      if(!p->convert_error) p->convert_error = error;
+      p->cond.notify_all();
+    }
+  }
+}
+
+/*amount of threads to decode with, 1 if the image is not suitable for decodePipelined*/
+static unsigned pipelineThreads(const LodePNGState* state, unsigned w, size_t expected_size) {
+  const LodePNGDecompressSettings* zlib = &state->decoder.zlibsettings;
+  unsigned threads = state->decoder.num_threads;
+  if(expected_size < LODEPNG_PIPELINE_MIN_SIZE || state->info_png.interlace_method != 0) return 1;
+  if(((size_t)w * lodepng_get_bpp(&state->info_png.color)) % 8u != 0) return 1; /*rows with padding bits*/
+  if(zlib->custom_zlib || zlib->custom_inflate) return 1;
+  if(threads == 0) threads = std::thread::hardware_concurrency();
+  return threads == 0 ? 1 : threads;
+}
+
+/*
+Does the zlib decompression of idat into scanlines and the postProcessScanlines of decodeGeneric, with the rows of
+image imagestride bytes apart, and if converted is not NULL also the color conversion to info_raw, with the rows of
+converted convertedstride bytes apart. scanlines must have room for expected_size + 270 bytes.
+Returns the same errors as doing these steps one after the other.
+*/
+static unsigned pipelineDecode(LodePNGState* state, unsigned w, unsigned h,
+                               const unsigned char* idat, size_t idatsize, size_t expected_size, unsigned threads,
+                               unsigned char* scanlines, unsigned char* image, size_t imagestride,
+                               unsigned char* converted, size_t convertedstride) {
+  LodePNGPipeline p;
+  LodePNGDecompressSettings settings = state->decoder.zlibsettings;
+  LodePNGInflateProgress progress;
+  size_t user_max = state->decoder.zlibsettings.max_output_size;
+  std::thread unfilter_thread;
+  std::vector<std::thread> convert_threads;
+  int unfilter_started;
+  unsigned error, i;
+  ucvector v;
+
+  p.scanlines = scanlines;
+  p.image = image;
+  p.converted = converted;
+  p.imagestride = imagestride;
+  p.convertedstride = convertedstride;
+  p.mode_png = &state->info_png.color;
+  p.mode_raw = &state->info_raw;
+  p.w = w;
+  p.h = h;
+  p.linebytes = lodepng_get_raw_size_idat(w, 1, lodepng_get_bpp(p.mode_png)) - 1u;
+  p.batch = (unsigned)LODEPNG_MAX((size_t)1u, (size_t)LODEPNG_PIPELINE_STEP / p.linebytes);
+  p.inflated = 0;
+  p.inflate_done = 0;
+  p.unfiltered = 0;
+  p.unfilter_done = 0;
+  p.unfilter_error = 0;
+  p.adler = 1u;
+  p.claimed = 0;
+  p.convert_error = 0;
+
+  /*the Adler-32 is computed by the unfilter thread instead*/
+  settings.ignore_adler32 = 1;
+  settings.max_output_size = (user_max && user_max < expected_size) ? user_max : expected_size;
+  progress.func = pipelineInflateProgress;
+  progress.context = &p;
+  progress.step = LODEPNG_PIPELINE_STEP;
+  progress.next = LODEPNG_PIPELINE_STEP;
+  v = ucvector_init(scanlines, expected_size + 270u);
+  v.size = 0;
+
+  /*without threads the steps below still work, just one after the other*/
+  unfilter_started = lodepng_start_thread(unfilter_thread, pipelineUnfilter, &p);
+  if(converted) {
+    for(i = 2; i < threads; ++i) {
+      std::thread thread;
+      if(!lodepng_start_thread(thread, pipelineConvert, &p)) break;
+      convert_threads.push_back(std::move(thread));
+    }
+  }
+
+  error = lodepng_zlib_decompressv(&v, idat, idatsize, &settings, &progress);
+  {
+    std::lock_guard<std::mutex> lock(p.mutex);
+    p.inflated = v.size;
+    p.inflate_done = 1;
+    p.cond.notify_all();
+  }
+  if(!unfilter_started) pipelineUnfilter(&p);
+  if(converted) pipelineConvert(&p);
+  if(unfilter_started) unfilter_thread.join();
+  for(i = 0; i != convert_threads.size(); ++i) convert_threads[i].join();
+
+  /*109 from the limit set above rather than from the one of the user means the data is larger than the image*/
+  if(error == 109 && settings.max_output_size != user_max) {
+    error = zlibOversizeError(idat, idatsize, &state->decoder.zlibsettings);
+  }
+  if(!error && !state->decoder.zlibsettings.ignore_adler32) {
+    unsigned ADLER32 = lodepng_read32bitInt(&idat[idatsize - 4]);
+    /*the unfilter thread stops at a row with an invalid filter type, and decodeGeneric only reports that after
+    checking the Adler-32 of all the data*/
+    unsigned checksum = (v.size == expected_size && !p.unfilter_error) ? p.adler : adler32(v.data, (unsigned)v.size);
+    if(checksum != ADLER32) error = 58; /*error, adler checksum not correct, data must be corrupted*/
+  }
+  if(!error && v.size != expected_size) error = 91; /*decompressed size doesn't match prediction*/
+  if(!error) error = p.unfilter_error;
+  if(!error) error = p.convert_error;
+  return error;
+}
+
+/*
+pipelineDecode into newly allocated buffers for decodeGeneric. Also does the color conversion of lodepng_decode, and
+sets *converted to 1, if the image needs a conversion that lodepng_convert supports row by row.
+*/
+static unsigned decodePipelined(unsigned char** out, unsigned* converted, LodePNGState* state, unsigned w, unsigned h,
+                                const unsigned char* idat, size_t idatsize, size_t expected_size, unsigned threads) {
+  const LodePNGColorMode* mode_raw = &state->info_raw;
+  size_t imagestride = lodepng_get_raw_size(w, 1, &state->info_png.color);
+  size_t convertedstride = lodepng_get_raw_size(w, 1, mode_raw);
+  unsigned char* scanlines;
+  unsigned char* image;
+  unsigned char* image_raw = 0;
+  unsigned error;
+
+  *out = 0;
+  *converted = 0;
+  /*the same condition as in lodepng_decode, plus whole bytes per row in the output*/
+  if(needsColorConvert(state) && colorConvertSupported(mode_raw) && ((size_t)w * lodepng_get_bpp(mode_raw)) % 8u == 0) {
+    *converted = 1;
+  }
+
+  /*270 is reserved_size of inflateHuffmanBlock*/
+  scanlines = (unsigned char*)lodepng_malloc(expected_size + 270u);
+  image = (unsigned char*)lodepng_malloc(lodepng_get_raw_size(w, h, &state->info_png.color));
+  if(*converted) image_raw = (unsigned char*)lodepng_malloc(lodepng_get_raw_size(w, h, mode_raw));
+  if(!scanlines || !image || (*converted && !image_raw)) {
+    error = 83; /*alloc fail*/
+  } else {
+    error = pipelineDecode(state, w, h, idat, idatsize, expected_size, threads, scanlines, image, imagestride,
+                           image_raw, convertedstride);
+  }
 
-  /*for unknown chunk order*/
+  lodepng_free(scanlines);
+  if(*converted) {
+    lodepng_free(image);
+    image = image_raw;
+  }
+  if(error) lodepng_free(image);
+  else *out = image;
+  return error;
+}
+#endif /*LODEPNG_THREADS*/
+
+/*
+Reads the chunks after the header, which lodepng_inspect read, into state, and copies the data of the IDAT chunks to
+idat, which must have room for insize bytes. Returns the error, which is also stored in state->error.
+*/
+/*
+Reads a chunk other than IHDR, IDAT and IEND into state->info_png, the whole chunk must be given including its CRC.
+critical_pos tells after which critical chunk unknown chunks are: 1 = after IHDR, 2 = after PLTE, 3 = after IDAT.
+Returns error code.
+*/
+static unsigned readChunk(LodePNGState* state, const unsigned char* chunk, unsigned* critical_pos) {
+  /*length of the data of the chunk, excluding the 12 bytes for length, chunk type and CRC*/
+  unsigned chunkLength = lodepng_chunk_length(chunk);
+  const unsigned char* data = lodepng_chunk_data_const(chunk); /*the data in the chunk*/
   unsigned unknown = 0;
+  unsigned error = 0;
+
+  if(lodepng_chunk_type_equals(chunk, "PLTE")) {
+    /*palette chunk (PLTE)*/
+    error = readChunk_PLTE(&state->info_png.color, data, chunkLength);
+    *critical_pos = 2;
+  } else if(lodepng_chunk_type_equals(chunk, "tRNS")) {
+    /*palette transparency chunk (tRNS). Even though this one is an ancillary chunk , it is still compiled
+    in without 'LODEPNG_COMPILE_ANCILLARY_CHUNKS' because it contains essential color information that
+    affects the alpha channel of pixels. */
+    error = readChunk_tRNS(&state->info_png.color, data, chunkLength);
 #ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
-  unsigned critical_pos = 1; /*1 = after IHDR, 2 = after PLTE, 3 = after IDAT*/
+    /*background color chunk (bKGD)*/
+  } else if(lodepng_chunk_type_equals(chunk, "bKGD")) {
+    error = readChunk_bKGD(&state->info_png, data, chunkLength);
+  } else if(lodepng_chunk_type_equals(chunk, "tEXt")) {
+    /*text chunk (tEXt)*/
+    if(state->decoder.read_text_chunks) {
+      error = readChunk_tEXt(&state->info_png, data, chunkLength);
+    }
+  } else if(lodepng_chunk_type_equals(chunk, "zTXt")) {
+    /*compressed text chunk (zTXt)*/
+    if(state->decoder.read_text_chunks) {
+      error = readChunk_zTXt(&state->info_png, &state->decoder, data, chunkLength);
+    }
+  } else if(lodepng_chunk_type_equals(chunk, "iTXt")) {
+    /*international text chunk (iTXt)*/
+    if(state->decoder.read_text_chunks) {
+      error = readChunk_iTXt(&state->info_png, &state->decoder, data, chunkLength);
+    }
+  } else if(lodepng_chunk_type_equals(chunk, "tIME")) {
+    error = readChunk_tIME(&state->info_png, data, chunkLength);
+  } else if(lodepng_chunk_type_equals(chunk, "pHYs")) {
+    error = readChunk_pHYs(&state->info_png, data, chunkLength);
+  } else if(lodepng_chunk_type_equals(chunk, "gAMA")) {
+    error = readChunk_gAMA(&state->info_png, data, chunkLength);
+  } else if(lodepng_chunk_type_equals(chunk, "cHRM")) {
+    error = readChunk_cHRM(&state->info_png, data, chunkLength);
+  } else if(lodepng_chunk_type_equals(chunk, "sRGB")) {
+    error = readChunk_sRGB(&state->info_png, data, chunkLength);
+  } else if(lodepng_chunk_type_equals(chunk, "iCCP")) {
+    error = readChunk_iCCP(&state->info_png, &state->decoder, data, chunkLength);
+  } else if(lodepng_chunk_type_equals(chunk, "cICP")) {
+    error = readChunk_cICP(&state->info_png, data, chunkLength);
+  } else if(lodepng_chunk_type_equals(chunk, "mDCV")) {
+    error = readChunk_mDCV(&state->info_png, data, chunkLength);
+  } else if(lodepng_chunk_type_equals(chunk, "cLLI")) {
+    error = readChunk_cLLI(&state->info_png, data, chunkLength);
+  } else if(lodepng_chunk_type_equals(chunk, "eXIf")) {
+    error = readChunk_eXIf(&state->info_png, data, chunkLength);
+  } else if(lodepng_chunk_type_equals(chunk, "sBIT")) {
+    error = readChunk_sBIT(&state->info_png, data, chunkLength);
 #endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
+  } else /*it's not an implemented chunk type, so ignore it: skip over the data*/ {
+    if(!lodepng_chunk_type_name_valid(chunk)) return 121; /* invalid chunk type name */
+    if(lodepng_chunk_reserved(chunk)) return 122; /* invalid third lowercase character */
 
+    /*error: unknown critical chunk (5th bit of first byte of chunk type is 0)*/
+    if(!state->decoder.ignore_critical && !lodepng_chunk_ancillary(chunk)) return 69;
 
-  /* safe output values in case error happens */
-  *out = 0;
-  *w = *h = 0;
-
-  state->error = lodepng_inspect(w, h, state, in, insize); /*reads header and resets other parameters in state->info_png*/
-  if(state->error) return;
+    unknown = 1;
+#ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
+    if(state->decoder.remember_unknown_chunks) {
+      error = lodepng_chunk_append(&state->info_png.unknown_chunks_data[*critical_pos - 1],
+                                   &state->info_png.unknown_chunks_size[*critical_pos - 1], chunk);
+    }
+#endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
+  }
+  if(error) return error;
 
-  if(lodepng_pixel_overflow(*w, *h, &state->info_png.color, &state->info_raw)) {
-    CERROR_RETURN(state->error, 92); /*overflow possible due to amount of pixels*/
+  if(!state->decoder.ignore_crc && !unknown) /*check CRC if wanted, only on known chunk types*/ {
+    if(lodepng_chunk_check_crc(chunk)) return 57; /*invalid CRC*/
   }
+  return 0;
+}
 
-  /*the input filesize is a safe upper bound for the sum of idat chunks size*/
-  idat = (unsigned char*)lodepng_malloc(insize);
-  if(!idat) CERROR_RETURN(state->error, 83); /*alloc fail*/
+static unsigned readChunks(LodePNGState* state, const unsigned char* in, size_t insize,
+                           unsigned char* idat, size_t* idatsize) {
+  unsigned char IEND = 0;
+  const unsigned char* chunk; /*points to beginning of next chunk*/
+  unsigned critical_pos = 1; /*for unknown chunk order, see readChunk*/
 
+  *idatsize = 0;
   chunk = &in[33]; /*first byte of the first chunk after the header*/
 
   /*loop through the chunks, ignoring unknown chunks and stopping at IEND chunk.
   IDAT data is put at the start of the in buffer*/
   while(!IEND && !state->error) {
     unsigned chunkLength;
-    const unsigned char* data; /*the data in the chunk*/
     size_t pos = (size_t)(chunk - in);
 
     /*error: next chunk out of bounds of the in buffer*/
@@ -5342,146 +7032,94 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
       CERROR_BREAK(state->error, 64); /*error: size of the in buffer too small to contain next chunk (or int overflow)*/
     }
 
-    data = lodepng_chunk_data_const(chunk);
-
-    unknown = 0;
-
-    /*IDAT chunk, containing compressed image data*/
     if(lodepng_chunk_type_equals(chunk, "IDAT")) {
+      /*IDAT chunk, containing compressed image data*/
       size_t newsize;
-      if(lodepng_addofl(idatsize, chunkLength, &newsize)) CERROR_BREAK(state->error, 95);
+      if(lodepng_addofl(*idatsize, chunkLength, &newsize)) CERROR_BREAK(state->error, 95);
       if(newsize > insize) CERROR_BREAK(state->error, 95);
-      lodepng_memcpy(idat + idatsize, data, chunkLength);
-      idatsize += chunkLength;
-#ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
+      lodepng_memcpy(idat + *idatsize, lodepng_chunk_data_const(chunk), chunkLength);
+      *idatsize += chunkLength;
       critical_pos = 3;
-#endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
     } else if(lodepng_chunk_type_equals(chunk, "IEND")) {
       /*IEND chunk*/
       IEND = 1;
-    } else if(lodepng_chunk_type_equals(chunk, "PLTE")) {
-      /*palette chunk (PLTE)*/
-      state->error = readChunk_PLTE(&state->info_png.color, data, chunkLength);
-      if(state->error) break;
-#ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
-      critical_pos = 2;
-#endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
-    } else if(lodepng_chunk_type_equals(chunk, "tRNS")) {
-      /*palette transparency chunk (tRNS). Even though this one is an ancillary chunk , it is still compiled
-      in without 'LODEPNG_COMPILE_ANCILLARY_CHUNKS' because it contains essential color information that
-      affects the alpha channel of pixels. */
-      state->error = readChunk_tRNS(&state->info_png.color, data, chunkLength);
-      if(state->error) break;
-#ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
-      /*background color chunk (bKGD)*/
-    } else if(lodepng_chunk_type_equals(chunk, "bKGD")) {
-      state->error = readChunk_bKGD(&state->info_png, data, chunkLength);
-      if(state->error) break;
-    } else if(lodepng_chunk_type_equals(chunk, "tEXt")) {
-      /*text chunk (tEXt)*/
-      if(state->decoder.read_text_chunks) {
-        state->error = readChunk_tEXt(&state->info_png, data, chunkLength);
-        if(state->error) break;
-      }
-    } else if(lodepng_chunk_type_equals(chunk, "zTXt")) {
-      /*compressed text chunk (zTXt)*/
-      if(state->decoder.read_text_chunks) {
-        state->error = readChunk_zTXt(&state->info_png, &state->decoder, data, chunkLength);
-        if(state->error) break;
-      }
-    } else if(lodepng_chunk_type_equals(chunk, "iTXt")) {
-      /*international text chunk (iTXt)*/
-      if(state->decoder.read_text_chunks) {
-        state->error = readChunk_iTXt(&state->info_png, &state->decoder, data, chunkLength);
-        if(state->error) break;
-      }
-    } else if(lodepng_chunk_type_equals(chunk, "tIME")) {
-      state->error = readChunk_tIME(&state->info_png, data, chunkLength);
-      if(state->error) break;
-    } else if(lodepng_chunk_type_equals(chunk, "pHYs")) {
-      state->error = readChunk_pHYs(&state->info_png, data, chunkLength);
-      if(state->error) break;
-    } else if(lodepng_chunk_type_equals(chunk, "gAMA")) {
-      state->error = readChunk_gAMA(&state->info_png, data, chunkLength);
-      if(state->error) break;
-    } else if(lodepng_chunk_type_equals(chunk, "cHRM")) {
-      state->error = readChunk_cHRM(&state->info_png, data, chunkLength);
-      if(state->error) break;
-    } else if(lodepng_chunk_type_equals(chunk, "sRGB")) {
-      state->error = readChunk_sRGB(&state->info_png, data, chunkLength);
-      if(state->error) break;
-    } else if(lodepng_chunk_type_equals(chunk, "iCCP")) {
-      state->error = readChunk_iCCP(&state->info_png, &state->decoder, data, chunkLength);
-      if(state->error) break;
-    } else if(lodepng_chunk_type_equals(chunk, "cICP")) {
-      state->error = readChunk_cICP(&state->info_png, data, chunkLength);
-      if(state->error) break;
-    } else if(lodepng_chunk_type_equals(chunk, "mDCV")) {
-      state->error = readChunk_mDCV(&state->info_png, data, chunkLength);
-      if(state->error) break;
-    } else if(lodepng_chunk_type_equals(chunk, "cLLI")) {
-      state->error = readChunk_cLLI(&state->info_png, data, chunkLength);
-      if(state->error) break;
-    } else if(lodepng_chunk_type_equals(chunk, "eXIf")) {
-      state->error = readChunk_eXIf(&state->info_png, data, chunkLength);
-      if(state->error) break;
-    } else if(lodepng_chunk_type_equals(chunk, "sBIT")) {
-      state->error = readChunk_sBIT(&state->info_png, data, chunkLength);
+    } else {
+      state->error = readChunk(state, chunk, &critical_pos);
       if(state->error) break;
-#endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
-    } else /*it's not an implemented chunk type, so ignore it: skip over the data*/ {
-      if(!lodepng_chunk_type_name_valid(chunk)) {
-        CERROR_BREAK(state->error, 121); /* invalid chunk type name */
-      }
-      if(lodepng_chunk_reserved(chunk)) {
-        CERROR_BREAK(state->error, 122); /* invalid third lowercase character */
-      }
-
-      /*error: unknown critical chunk (5th bit of first byte of chunk type is 0)*/
-      if(!state->decoder.ignore_critical && !lodepng_chunk_ancillary(chunk)) {
-        CERROR_BREAK(state->error, 69);
-      }
-
-      unknown = 1;
-#ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
-      if(state->decoder.remember_unknown_chunks) {
-        state->error = lodepng_chunk_append(&state->info_png.unknown_chunks_data[critical_pos - 1],
-                                            &state->info_png.unknown_chunks_size[critical_pos - 1], chunk);
-        if(state->error) break;
-      }
-#endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
     }
 
-    if(!state->decoder.ignore_crc && !unknown) /*check CRC if wanted, only on known chunk types*/ {
+    /*check CRC if wanted, readChunk already did for the chunks it read*/
+    if(!state->decoder.ignore_crc && (IEND || lodepng_chunk_type_equals(chunk, "IDAT"))) {
       if(lodepng_chunk_check_crc(chunk)) CERROR_BREAK(state->error, 57); /*invalid CRC*/
     }
 
     if(!IEND) chunk = lodepng_chunk_next_const(chunk, in + insize);
   }
 
+
   if(!state->error && state->info_png.color.colortype == LCT_PALETTE && !state->info_png.color.palette) {
     state->error = 106; /* error: PNG file must have PLTE chunk if color type is palette */
   }
 
-  if(!state->error) {
+  return state->error;
+}
+
+/*size of the inflated IDAT data: the filtered scanlines, for interlaced images of all 7 passes*/
+static size_t idatExpectedSize(unsigned w, unsigned h, const LodePNGInfo* info_png) {
+  unsigned bpp = lodepng_get_bpp(&info_png->color);
+  size_t expected_size = 0;
+  if(info_png->interlace_method == 0) return lodepng_get_raw_size_idat(w, h, bpp);
+  /*Adam-7 interlaced: expected size is the sum of the 7 sub-images sizes*/
+  expected_size += lodepng_get_raw_size_idat((w + 7) >> 3, (h + 7) >> 3, bpp);
+  if(w > 4) expected_size += lodepng_get_raw_size_idat((w + 3) >> 3, (h + 7) >> 3, bpp);
+  expected_size += lodepng_get_raw_size_idat((w + 3) >> 2, (h + 3) >> 3, bpp);
+  if(w > 2) expected_size += lodepng_get_raw_size_idat((w + 1) >> 2, (h + 3) >> 2, bpp);
+  expected_size += lodepng_get_raw_size_idat((w + 1) >> 1, (h + 1) >> 2, bpp);
+  if(w > 1) expected_size += lodepng_get_raw_size_idat((w + 0) >> 1, (h + 1) >> 1, bpp);
+  expected_size += lodepng_get_raw_size_idat((w + 0), (h + 0) >> 1, bpp);
+  return expected_size;
+}
+
+/*converted is set to 1 if out is already color converted to info_raw, which only the pipelined decoder does*/
+static void decodeGeneric(unsigned char** out, unsigned* converted, unsigned* w, unsigned* h,
+                          LodePNGState* state,
+                          const unsigned char* in, size_t insize) {
+  unsigned char* idat; /*the data from idat chunks, zlib compressed*/
+  size_t idatsize = 0;
+  unsigned char* scanlines = 0;
+  size_t scanlines_size = 0, expected_size = 0;
+  size_t outsize = 0;
+
+  /* safe output values in case error happens */
+  *out = 0;
+  *converted = 0;
+  *w = *h = 0;
+
+  state->error = lodepng_inspect(w, h, state, in, insize); /*reads header and resets other parameters in state->info_png*/
+  if(state->error) return;
+
+  if(lodepng_pixel_overflow(*w, *h, &state->info_png.color, &state->info_raw)) {
+    CERROR_RETURN(state->error, 92); /*overflow possible due to amount of pixels*/
+  }
+
+  /*the input filesize is a safe upper bound for the sum of idat chunks size*/
+  idat = (unsigned char*)lodepng_malloc(insize);
+  if(!idat) CERROR_RETURN(state->error, 83); /*alloc fail*/
+
+  if(!readChunks(state, in, insize, idat, &idatsize)) {
     /*predict output size, to allocate exact size for output buffer to avoid more dynamic allocation.
     If the decompressed size does not match the prediction, the image must be corrupt.*/
-    if(state->info_png.interlace_method == 0) {
-      unsigned bpp = lodepng_get_bpp(&state->info_png.color);
-      expected_size = lodepng_get_raw_size_idat(*w, *h, bpp);
-    } else {
-      unsigned bpp = lodepng_get_bpp(&state->info_png.color);
-      /*Adam-7 interlaced: expected size is the sum of the 7 sub-images sizes*/
-      expected_size = 0;
-      expected_size += lodepng_get_raw_size_idat((*w + 7) >> 3, (*h + 7) >> 3, bpp);
-      if(*w > 4) expected_size += lodepng_get_raw_size_idat((*w + 3) >> 3, (*h + 7) >> 3, bpp);
-      expected_size += lodepng_get_raw_size_idat((*w + 3) >> 2, (*h + 3) >> 3, bpp);
-      if(*w > 2) expected_size += lodepng_get_raw_size_idat((*w + 1) >> 2, (*h + 3) >> 2, bpp);
-      expected_size += lodepng_get_raw_size_idat((*w + 1) >> 1, (*h + 1) >> 2, bpp);
-      if(*w > 1) expected_size += lodepng_get_raw_size_idat((*w + 0) >> 1, (*h + 1) >> 1, bpp);
-      expected_size += lodepng_get_raw_size_idat((*w + 0), (*h + 0) >> 1, bpp);
+    expected_size = idatExpectedSize(*w, *h, &state->info_png);
+#ifdef LODEPNG_THREADS
+    {
+      unsigned threads = pipelineThreads(state, *w, expected_size);
+      if(threads > 1) {
+        state->error = decodePipelined(out, converted, state, *w, *h, idat, idatsize, expected_size, threads);
+        lodepng_free(idat);
+        return;
+      }
     }
-
+#endif /*LODEPNG_THREADS*/
     state->error = zlib_decompress(&scanlines, &scanlines_size, expected_size, idat, idatsize, &state->decoder.zlibsettings);
   }
   if(!state->error && scanlines_size != expected_size) state->error = 91; /*decompressed size doesn't match prediction*/
@@ -5494,7 +7132,8 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
   }
   if(!state->error) {
     lodepng_memset(*out, 0, outsize);
-    state->error = postProcessScanlines(*out, scanlines, *w, *h, &state->info_png);
+    state->error = postProcessScanlines(*out, (size_t)*w * lodepng_get_bpp(&state->info_png.color), scanlines,
+                                        *w, *h, &state->info_png);
   }
   lodepng_free(scanlines);
 }
@@ -5502,10 +7141,13 @@ static void decodeGeneric(unsigned char** out, unsigned* w, unsigned* h,
 unsigned lodepng_decode(unsigned char** out, unsigned* w, unsigned* h,
                         LodePNGState* state,
                         const unsigned char* in, size_t insize) {
+  unsigned converted;
   *out = 0;
-  decodeGeneric(out, w, h, state, in, insize);
+  decodeGeneric(out, &converted, w, h, state, in, insize);
   if(state->error) return state->error;
-  if(!state->decoder.color_convert || lodepng_color_mode_equal(&state->info_raw, &state->info_png.color)) {
+  if(converted) {
+    /*the pipelined decoder already converted it to info_raw*/
+  } else if(!needsColorConvert(state)) {
     /*same color type, no copying or converting of data needed*/
     /*store the info_png color settings on the info_raw so that the info_raw still reflects what colortype
     the raw image has to the end user*/
@@ -5517,10 +7159,7 @@ unsigned lodepng_decode(unsigned char** out, unsigned* w, unsigned* h,
     unsigned char* data = *out;
     size_t outsize;
 
-    /*TODO: check if this works according to the statement in the documentation: "The converter can convert
-    from grayscale input color type, to 8-bit grayscale or grayscale with alpha"*/
-    if(!(state->info_raw.colortype == LCT_RGB || state->info_raw.colortype == LCT_RGBA)
-       && !(state->info_raw.bitdepth == 8)) {
+    if(!colorConvertSupported(&state->info_raw)) {
       return 56; /*unsupported color mode conversion*/
     }
 
@@ -5536,6 +7175,688 @@ unsigned lodepng_decode(unsigned char** out, unsigned* w, unsigned* h,
   return state->error;
 }
 
+void lodepng_arena_init(LodePNGArena* arena, unsigned char* buffer, size_t size) {
+  arena->data = buffer;
+  arena->size = buffer ? size : 0;
+  arena->owned = 0;
+}
+
+void lodepng_arena_cleanup(LodePNGArena* arena) {
+  if(arena->owned) lodepng_free(arena->data);
+  lodepng_arena_init(arena, 0, 0);
+}
+
+/*makes the arena at least size bytes, without keeping its contents. Returns 0 if out of memory.*/
+static unsigned lodepng_arena_reserve(LodePNGArena* arena, size_t size) {
+  unsigned char* data;
+  if(size <= arena->size) return 1;
+  data = (unsigned char*)lodepng_malloc(size);
+  if(!data) return 0;
+  lodepng_arena_cleanup(arena);
+  arena->data = data;
+  arena->size = size;
+  arena->owned = 1;
+  return 1;
+}
+
+/*size rounded up so that the next buffer in the arena starts at a cache line*/
+static size_t lodepng_arena_align(size_t size) {
+  return (size + 63u) & ~(size_t)63u;
+}
+
+unsigned lodepng_decode_into(unsigned char* out, size_t outsize, size_t stride, unsigned* w, unsigned* h,
+                             LodePNGState* state, const unsigned char* in, size_t insize, LodePNGArena* arena) {
+  LodePNGArena heap; /*used if arena is NULL*/
+  const LodePNGColorMode* mode_png = &state->info_png.color;
+  const LodePNGColorMode* mode_out = mode_png;
+  unsigned char* idat = 0;
+  unsigned char* scanlines = 0;
+  unsigned char* image = 0; /*the image in the PNG color type, before color conversion*/
+  unsigned char* heap_scanlines = 0;
+  unsigned char* heap_image = 0;
+  size_t idatsize = 0, scanlines_size = 0, expected_size, imagestride, imagesize, space, rowbytes = 0, required = 0;
+  unsigned convert = 0, unsupported = 0, done = 0;
+
+  *w = *h = 0;
+  state->error = lodepng_inspect(w, h, state, in, insize); /*reads header and resets other parameters in state->info_png*/
+  if(state->error) return state->error;
+  if(lodepng_pixel_overflow(*w, *h, &state->info_png.color, &state->info_raw)) {
+    CERROR_RETURN_ERROR(state->error, 92); /*overflow possible due to amount of pixels*/
+  }
+
+  if(!arena) {
+    lodepng_arena_init(&heap, 0, 0);
+    arena = &heap;
+  }
+
+  /*the arena holds the IDAT data, the inflated scanlines, and the image before conversion if the color type or bit
+  depth differs. A conversion because only the palette or color key differs uses a separate allocation.*/
+  expected_size = idatExpectedSize(*w, *h, &state->info_png);
+  imagestride = lodepng_get_raw_size_idat(*w, 1, lodepng_get_bpp(mode_png)) - 1u;
+  imagesize = imagestride * *h;
+  space = lodepng_arena_align(insize) + lodepng_arena_align(expected_size + 270u); /*270: see pipelineDecode*/
+  if(state->decoder.color_convert && (state->info_raw.colortype != mode_png->colortype ||
+                                      state->info_raw.bitdepth != mode_png->bitdepth)) {
+    space += imagesize;
+  }
+  if(!lodepng_arena_reserve(arena, space)) state->error = 83; /*alloc fail*/
+
+  if(!state->error) {
+    idat = arena->data;
+    scanlines = idat + lodepng_arena_align(insize);
+    readChunks(state, in, insize, idat, &idatsize);
+  }
+  if(!state->error) {
+    convert = needsColorConvert(state);
+    /*lodepng_decode reports this only for an image that decodes without error, so it is checked at the end*/
+    unsupported = convert && !colorConvertSupported(&state->info_raw);
+    if(!state->decoder.color_convert) {
+      /*as in lodepng_decode, info_raw reflects what colortype the output has*/
+      state->error = lodepng_color_mode_copy(&state->info_raw, mode_png);
+    }
+  }
+  if(!state->error) {
+    if(convert) mode_out = &state->info_raw;
+    rowbytes = lodepng_get_raw_size(*w, 1, mode_out);
+    if(stride == 0) {
+      required = lodepng_get_raw_size(*w, *h, mode_out);
+    } else if(stride < rowbytes) {
+      state->error = 123; /*stride smaller than a row*/
+    } else if(lodepng_mulofl(stride, *h - 1u, &required) || lodepng_addofl(required, rowbytes, &required)) {
+      state->error = 124; /*output buffer too small*/
+    }
+    if(!state->error && outsize < required) state->error = 124; /*output buffer too small*/
+  }
+  if(!state->error && convert) {
+    image = scanlines + lodepng_arena_align(expected_size + 270u);
+    if(space < (size_t)(image - idat) + imagesize) {
+      image = heap_image = (unsigned char*)lodepng_malloc(imagesize);
+      if(!image) state->error = 83; /*alloc fail*/
+    }
+  }
+
+#ifdef LODEPNG_THREADS
+  if(!state->error) {
+    unsigned threads = pipelineThreads(state, *w, expected_size);
+    /*the conversion of batches of rows needs rows that start at a byte*/
+    if(threads > 1 && (!convert || stride != 0 || ((size_t)*w * lodepng_get_bpp(mode_out)) % 8u == 0)) {
+      size_t outstride = stride ? stride : rowbytes;
+      state->error = pipelineDecode(state, *w, *h, idat, idatsize, expected_size, threads, scanlines,
+                                    convert ? image : out, convert ? imagestride : outstride,
+                                    (convert && !unsupported) ? out : 0, outstride);
+      if(!state->error && unsupported) state->error = 56; /*unsupported color mode conversion*/
+      done = 1;
+    }
+  }
+#endif /*LODEPNG_THREADS*/
+
+  if(!state->error && !done) {
+    const LodePNGDecompressSettings* zlibsettings = &state->decoder.zlibsettings;
+    if(zlibsettings->custom_zlib || zlibsettings->custom_inflate) {
+      /*these may reallocate the output, so it can't be in the arena*/
+      state->error = zlib_decompress(&heap_scanlines, &scanlines_size, expected_size, idat, idatsize, zlibsettings);
+      scanlines = heap_scanlines;
+    } else {
+      LodePNGDecompressSettings settings = *zlibsettings;
+      size_t user_max = zlibsettings->max_output_size;
+      ucvector v = ucvector_init(scanlines, expected_size + 270u);
+      v.size = 0;
+      /*inflate fails rather than grow the output out of the arena*/
+      settings.max_output_size = (user_max && user_max < expected_size) ? user_max : expected_size;
+      state->error = lodepng_zlib_decompressv(&v, idat, idatsize, &settings, 0);
+      /*109 from the limit set above rather than from the one of the user means the data is larger than the image*/
+      if(state->error == 109 && settings.max_output_size != user_max) {
+        state->error = zlibOversizeError(idat, idatsize, zlibsettings);
+      }
+      scanlines_size = v.size;
+    }
+    if(!state->error && scanlines_size != expected_size) state->error = 91; /*decompressed size doesn't match prediction*/
+  }
+  if(!state->error && !done) {
+    unsigned bpp_png = lodepng_get_bpp(mode_png);
+    if(!convert) {
+      /*the trailing bits of the image, as lodepng_decode gives them*/
+      if(stride == 0 && bpp_png < 8) out[required - 1u] = 0;
+      state->error = postProcessScanlines(out, stride ? stride * 8u : (size_t)*w * bpp_png, scanlines,
+                                          *w, *h, &state->info_png);
+    } else if(unsupported) {
+      state->error = postProcessScanlines(image, imagestride * 8u, scanlines, *w, *h, &state->info_png);
+      if(!state->error) state->error = 56; /*unsupported color mode conversion*/
+    } else if(stride == 0 && ((size_t)*w * lodepng_get_bpp(mode_out)) % 8u != 0) {
+      /*the output rows don't start at a byte, convert the image at once*/
+      state->error = postProcessScanlines(image, (size_t)*w * bpp_png, scanlines, *w, *h, &state->info_png);
+      if(!state->error) state->error = lodepng_convert(out, image, mode_out, mode_png, *w, *h);
+    } else {
+      state->error = postProcessScanlines(image, imagestride * 8u, scanlines, *w, *h, &state->info_png);
+      if(!state->error) {
+        state->error = convertRows(out, stride ? stride : rowbytes, image, imagestride, mode_out, mode_png, *w, *h);
+      }
+    }
+  }
+
+  lodepng_free(heap_scanlines);
+  lodepng_free(heap_image);
+  if(arena == &heap) lodepng_arena_cleanup(&heap);
+  return state->error;
+}
+
+/* ////////////////////////////////////////////////////////////////////////// */
+/* / Incremental decoding                                                   / */
+/* ////////////////////////////////////////////////////////////////////////// */
+
+/*
+The stream decoder parses the chunks as their bytes arrive, and inflates IDAT data as soon as it is given rather than
+after collecting all of it. Inflate runs in steps that end on a whole symbol: a symbol is only started with input for
+the longest one there, or once the input is final at IEND. The output goes after the last 32 KiB of earlier output,
+which back references need, and is unfiltered row by row as it comes, so the memory use is two rows and some 100 KiB
+whatever the size of the image. Interlaced images, and zlib settings with custom_zlib or custom_inflate, collect the
+IDAT data and are decoded at once at IEND instead.
+*/
+
+#define STREAM_WINDOW 32768u /*output kept for back references, the largest deflate distance*/
+#define STREAM_OUTPUT 32768u /*output a step makes after the window before the rows take it*/
+#define STREAM_INPUT 65536u /*IDAT bytes given to inflate at once*/
+#define STREAM_FAST_INPUT 1024u /*input per inflateHuffmanFast call, it only stops for the end of its input*/
+#define STREAM_SYMBOL_BITS 48u /*the longest length and distance with their extra bits, 15 + 5 + 15 + 13*/
+#define STREAM_HEADER_BYTES 600u /*the longest dynamic block header, 3 + 14 + 19 * 3 + 316 * (7 + 7) bits*/
+
+typedef enum LodePNGStreamStage {
+  STREAM_SIGNATURE, /*the signature and IHDR chunk, 33 bytes*/
+  STREAM_CHUNK_HEADER, /*length and type of the next chunk*/
+  STREAM_CHUNK, /*a whole chunk other than IDAT*/
+  STREAM_IDAT, /*the data of an IDAT chunk, which is not collected*/
+  STREAM_IDAT_CRC, /*the CRC at the end of an IDAT chunk*/
+  STREAM_END /*after IEND or an error*/
+} LodePNGStreamStage;
+
+typedef enum LodePNGZlibStage {
+  ZLIB_HEADER, ZLIB_BLOCK, ZLIB_STORED, ZLIB_HUFFMAN, ZLIB_ADLER32, ZLIB_DONE
+} LodePNGZlibStage;
+
+struct LodePNGStreamDecoder {
+  LodePNGState* state;
+  LodePNGRowCallback callback;
+  void* context;
+  unsigned w, h;
+  size_t expected_size; /*size of the inflated IDAT data*/
+  unsigned buffered; /*1 if the IDAT data is collected and decoded at IEND*/
+  unsigned started; /*1 once the rows are set up, at the first IDAT chunk*/
+  unsigned convert; /*1 if the rows are converted to info_raw*/
+
+  /*chunks*/
+  LodePNGStreamStage stage;
+  ucvector chunk; /*the bytes of the current stage*/
+  size_t need; /*amount of bytes the current stage takes into chunk*/
+  size_t remaining; /*data bytes of the current IDAT chunk still to come*/
+  unsigned crc; /*CRC of the current IDAT chunk so far*/
+  unsigned critical_pos; /*see readChunk*/
+
+  /*zlib*/
+  LodePNGZlibStage zstage;
+  ucvector in; /*IDAT data not inflated yet*/
+  size_t bp; /*bit position in in*/
+  unsigned bfinal; /*1 in the last deflate block*/
+  size_t stored; /*bytes of the current stored block still to copy*/
+  HuffmanTree tree_ll;
+  HuffmanTree tree_d;
+  unsigned* table_ll; /*fast lookup tables for inflateHuffmanFast*/
+  unsigned* table_d;
+  ucvector out; /*the window followed by the new output*/
+  size_t outpos; /*start of the output the rows didn't take yet*/
+  size_t total; /*amount of inflated bytes*/
+  unsigned adler;
+
+  /*rows*/
+  size_t linebytes; /*bytes per row of the PNG, without the filter type byte*/
+  size_t bytewidth;
+  unsigned char* rows; /*allocation of row, prev and converted*/
+  unsigned char* row; /*the filter type byte and the row being filled*/
+  unsigned char* prev; /*same for the previous row, unfiltered*/
+  unsigned char* converted; /*one row in the color type of info_raw*/
+  size_t rowfill; /*amount of bytes of row given*/
+  unsigned y; /*the next row to give to the callback*/
+};
+
+static void streamExpect(LodePNGStreamDecoder* decoder, LodePNGStreamStage stage, size_t need) {
+  decoder->stage = stage;
+  decoder->need = need;
+  decoder->chunk.size = 0;
+}
+
+/*gives an unfiltered row to the callback, converted if needed*/
+static unsigned streamEmitRow(LodePNGStreamDecoder* decoder, unsigned char* row) {
+  LodePNGState* state = decoder->state;
+  size_t bits = (size_t)decoder->w * lodepng_get_bpp(&state->info_png.color);
+  unsigned error = 0;
+  if(decoder->convert) {
+    error = lodepng_convert(decoder->converted, row, &state->info_raw, &state->info_png.color, decoder->w, 1);
+    if(!error) error = decoder->callback(decoder->context, decoder->converted, decoder->y, decoder->w, decoder->h);
+  } else if(bits % 8u != 0) {
+    /*clear the padding bits for the callback only, the next row unfilters with the bits as they are*/
+    unsigned char last = row[decoder->linebytes - 1u];
+    row[decoder->linebytes - 1u] &= (unsigned char)(0xff00u >> (bits % 8u));
+    error = decoder->callback(decoder->context, row, decoder->y, decoder->w, decoder->h);
+    row[decoder->linebytes - 1u] = last;
+  } else {
+    error = decoder->callback(decoder->context, row, decoder->y, decoder->w, decoder->h);
+  }
+  ++decoder->y;
+  return error;
+}
+
+/*unfilters and gives out the rows the new output completes, and then drops the output that is out of the window*/
+static unsigned streamRows(LodePNGStreamDecoder* decoder) {
+  const LodePNGDecompressSettings* settings = &decoder->state->decoder.zlibsettings;
+  const unsigned char* data = decoder->out.data + decoder->outpos;
+  size_t size = decoder->out.size - decoder->outpos;
+  size_t rowsize = decoder->linebytes + 1u;
+
+  decoder->total += size;
+  if(settings->max_output_size && decoder->total > settings->max_output_size) return 109; /*larger than max size*/
+  if(decoder->total > decoder->expected_size) return 91; /*decompressed size doesn't match prediction*/
+  if(!settings->ignore_adler32) decoder->adler = update_adler32(decoder->adler, data, (unsigned)size);
+
+  while(size != 0) {
+    size_t n = LODEPNG_MIN(rowsize - decoder->rowfill, size);
+    lodepng_memcpy(decoder->row + decoder->rowfill, data, n);
+    decoder->rowfill += n;
+    data += n;
+    size -= n;
+    if(decoder->rowfill == rowsize) {
+      unsigned char* temp = decoder->prev;
+      unsigned error = unfilterScanline(decoder->row + 1, decoder->row + 1, decoder->y ? decoder->prev + 1 : 0,
+                                        decoder->bytewidth, decoder->row[0], decoder->linebytes);
+      if(!error) error = streamEmitRow(decoder, decoder->row + 1);
+      if(error) return error;
+      decoder->prev = decoder->row;
+      decoder->row = temp;
+      decoder->rowfill = 0;
+    }
+  }
+
+  /*keep the window, it starts past its own size so it doesn't overlap where it goes. This also leaves the next step
+  room to make output*/
+  if(decoder->out.size >= STREAM_WINDOW + STREAM_OUTPUT) {
+    lodepng_memcpy(decoder->out.data, decoder->out.data + decoder->out.size - STREAM_WINDOW, STREAM_WINDOW);
+    decoder->out.size = STREAM_WINDOW;
+  }
+  decoder->outpos = decoder->out.size;
+  return 0;
+}
+
+/*
+One step of inflate on the IDAT data so far. final is 1 if all IDAT data is given, else the step waits rather than
+read past the input. Returns error code, and only changes the zlib stage or bit position if it made progress.
+*/
+static unsigned streamInflateStep(LodePNGStreamDecoder* decoder, unsigned final) {
+  const LodePNGDecompressSettings* settings = &decoder->state->decoder.zlibsettings;
+  const size_t limit = STREAM_WINDOW + STREAM_OUTPUT;
+  ucvector* out = &decoder->out;
+  LodePNGBitReader reader;
+  unsigned error = LodePNGBitReader_init(&reader, decoder->in.data, decoder->in.size);
+  if(error) return error;
+  reader.bp = decoder->bp;
+
+  if(decoder->zstage == ZLIB_HEADER) {
+    const unsigned char* in = decoder->in.data;
+    if(decoder->in.size < 2) return final ? 53 : 0; /*error, size of zlib data too small*/
+    /*see lodepng_zlib_decompressv*/
+    if((in[0] * 256 + in[1]) % 31 != 0) return 24;
+    if((in[0] & 15) != 8 || ((in[0] >> 4) & 15) > 7) return 25;
+    if(((in[1] >> 5) & 1) != 0) return 26;
+    reader.bp = 16;
+    decoder->zstage = ZLIB_BLOCK;
+  } else if(decoder->zstage == ZLIB_BLOCK) {
+    unsigned BTYPE;
+    if(!final && reader.bitsize - reader.bp < STREAM_HEADER_BYTES * 8u) return 0;
+    if(reader.bitsize - reader.bp < 3) return 52; /*error, bit pointer will jump past memory*/
+    ensureBits9(&reader, 3);
+    decoder->bfinal = readBits(&reader, 1);
+    BTYPE = readBits(&reader, 2);
+    if(BTYPE == 3) return 20; /*error: invalid BTYPE*/
+    if(BTYPE == 0) {
+      /*see inflateNoCompression*/
+      size_t bytepos = (reader.bp + 7u) >> 3u;
+      unsigned LEN, NLEN;
+      if(bytepos + 4 >= reader.size) return 52; /*error, bit pointer will jump past memory*/
+      LEN = (unsigned)reader.data[bytepos] + ((unsigned)reader.data[bytepos + 1] << 8u);
+      NLEN = (unsigned)reader.data[bytepos + 2] + ((unsigned)reader.data[bytepos + 3] << 8u);
+      if(!settings->ignore_nlen && LEN + NLEN != 65535) return 21; /*error: NLEN is not one's complement of LEN*/
+      decoder->stored = LEN;
+      reader.bp = (bytepos + 4u) << 3u;
+      decoder->zstage = ZLIB_STORED;
+    } else {
+      HuffmanTree_cleanup(&decoder->tree_ll);
+      HuffmanTree_cleanup(&decoder->tree_d);
+      HuffmanTree_init(&decoder->tree_ll);
+      HuffmanTree_init(&decoder->tree_d);
+      if(BTYPE == 1) error = getTreeInflateFixed(&decoder->tree_ll, &decoder->tree_d);
+      else error = getTreeInflateDynamic(&decoder->tree_ll, &decoder->tree_d, &reader);
+      if(!error && sizeof(size_t) >= 8) {
+        error = HuffmanTree_makeFastTable(&decoder->table_ll, &decoder->tree_ll, FAST_LL_BITS, 1);
+        if(!error) error = HuffmanTree_makeFastTable(&decoder->table_d, &decoder->tree_d, FAST_D_BITS, 0);
+      }
+      if(error) return error;
+      decoder->zstage = ZLIB_HUFFMAN;
+    }
+  } else if(decoder->zstage == ZLIB_STORED) {
+    size_t bytepos = reader.bp >> 3u;
+    size_t n = decoder->stored;
+    if(reader.size - bytepos < n) {
+      if(final) return 23; /*error: reading outside of in buffer*/
+      n = reader.size - bytepos;
+    }
+    n = LODEPNG_MIN(n, out->size < limit ? limit - out->size : 0);
+    if(!ucvector_reserve(out, out->size + n)) return 83; /*alloc fail*/
+    if(n) lodepng_memcpy(out->data + out->size, reader.data + bytepos, n);
+    out->size += n;
+    reader.bp += n << 3u;
+    decoder->stored -= n;
+    if(decoder->stored == 0) decoder->zstage = decoder->bfinal ? ZLIB_ADLER32 : ZLIB_BLOCK;
+  } else if(decoder->zstage == ZLIB_HUFFMAN) {
+    /*as inflateHuffmanBlock, one symbol at a time*/
+    int done = 0;
+    if(decoder->table_ll && out->size < limit) {
+      LodePNGBitReader fast = reader;
+      size_t end = (reader.bp >> 3u) + STREAM_FAST_INPUT + 16u;
+      if(end < fast.size) fast.size = end;
+      error = inflateHuffmanFast(out, &fast, decoder->table_ll, decoder->table_d, 270, 0, &done, 0);
+      if(error) return error;
+      reader.bp = fast.bp;
+    }
+    /*the rest of the symbols are for where inflateHuffmanFast stops, near the end of the input*/
+    while(!done && out->size < limit && (!decoder->table_ll || reader.size - (reader.bp >> 3u) < 32u)) {
+      unsigned code_ll;
+      if(!final && reader.bitsize - reader.bp < STREAM_SYMBOL_BITS) break;
+      if(out->allocsize - out->size < 270 && !ucvector_reserve(out, out->size + 270)) return 83; /*alloc fail*/
+      ensureBits25(&reader, 20); /*the literal or length code and its extra bits*/
+      code_ll = huffmanDecodeSymbol(&reader, &decoder->tree_ll);
+      if(code_ll <= 255) /*literal symbol*/ {
+        out->data[out->size++] = (unsigned char)code_ll;
+      } else if(code_ll >= FIRST_LENGTH_CODE_INDEX && code_ll <= LAST_LENGTH_CODE_INDEX) /*length code*/ {
+        unsigned code_d, distance, numextrabits_l, numextrabits_d;
+        size_t start, backward, length;
+        length = LENGTHBASE[code_ll - FIRST_LENGTH_CODE_INDEX];
+        numextrabits_l = LENGTHEXTRA[code_ll - FIRST_LENGTH_CODE_INDEX];
+        if(numextrabits_l != 0) length += readBits(&reader, numextrabits_l);
+        ensureBits32(&reader, 28); /* up to 15 for the huffman symbol, up to 13 for the extra bits */
+        code_d = huffmanDecodeSymbol(&reader, &decoder->tree_d);
+        if(code_d > 29) {
+          /*error: invalid distance code (30-31 are never used), or disallowed huffman symbol*/
+          return code_d <= 31 ? 18 : 16;
+        }
+        distance = DISTANCEBASE[code_d];
+        numextrabits_d = DISTANCEEXTRA[code_d];
+        if(numextrabits_d != 0) distance += readBits(&reader, numextrabits_d);
+        start = out->size;
+        if(distance > start) return 52; /*too long backward distance*/
+        backward = start - distance;
+        out->size += length;
+        if(distance < length) {
+          size_t forward;
+          lodepng_memcpy(out->data + start, out->data + backward, distance);
+          start += distance;
+          for(forward = distance; forward < length; ++forward) out->data[start++] = out->data[backward++];
+        } else {
+          lodepng_memcpy(out->data + start, out->data + backward, length);
+        }
+      } else if(code_ll == 256) {
+        done = 1; /*end code*/
+      } else /*if(code_ll == INVALIDSYMBOL)*/ {
+        return 16; /*error: tried to read disallowed huffman symbol*/
+      }
+      if(reader.bp > reader.bitsize) return 51; /*error, bit pointer jumps past memory*/
+    }
+    if(done) {
+      lodepng_free(decoder->table_ll);
+      lodepng_free(decoder->table_d);
+      decoder->table_ll = decoder->table_d = 0;
+      decoder->zstage = decoder->bfinal ? ZLIB_ADLER32 : ZLIB_BLOCK;
+    }
+  } else if(decoder->zstage == ZLIB_ADLER32) {
+    size_t bytepos = (reader.bp + 7u) >> 3u;
+    if(bytepos + 4u > reader.size) {
+      if(!final) return 0;
+      if(!settings->ignore_adler32) return 58; /*error, adler checksum not correct, data must be corrupted*/
+      bytepos = reader.size;
+    } else {
+      if(!settings->ignore_adler32 && lodepng_read32bitInt(&reader.data[bytepos]) != decoder->adler) return 58;
+      bytepos += 4u;
+    }
+    reader.bp = bytepos << 3u;
+    decoder->zstage = ZLIB_DONE;
+  }
+
+  decoder->bp = reader.bp;
+  return 0;
+}
+
+/*inflates and gives out rows while the IDAT data so far allows it*/
+static unsigned streamInflate(LodePNGStreamDecoder* decoder, unsigned final) {
+  unsigned error = 0;
+  size_t used;
+  while(!error && decoder->zstage != ZLIB_DONE) {
+    size_t bp = decoder->bp, total = decoder->total;
+    LodePNGZlibStage zstage = decoder->zstage;
+    error = streamInflateStep(decoder, final);
+    if(!error) error = streamRows(decoder);
+    if(decoder->bp == bp && decoder->total == total && decoder->zstage == zstage) break; /*needs more input*/
+  }
+  /*drop the used input once the rest fits in front of it*/
+  used = decoder->bp >> 3u;
+  if(!error && used != 0 && used >= decoder->in.size - used) {
+    lodepng_memcpy(decoder->in.data, decoder->in.data + used, decoder->in.size - used);
+    decoder->in.size -= used;
+    decoder->bp -= used << 3u;
+  }
+  return error;
+}
+
+/*sets up the rows once the chunks before the image data are read*/
+static unsigned streamStart(LodePNGStreamDecoder* decoder) {
+  LodePNGState* state = decoder->state;
+  unsigned bpp = lodepng_get_bpp(&state->info_png.color);
+  size_t convertedsize = 0;
+  decoder->started = 1;
+  if(state->info_png.color.colortype == LCT_PALETTE && !state->info_png.color.palette) {
+    return 106; /* error: PNG file must have PLTE chunk if color type is palette */
+  }
+  decoder->convert = needsColorConvert(state);
+  if(decoder->convert) {
+    if(!colorConvertSupported(&state->info_raw)) return 56; /*unsupported color mode conversion*/
+    convertedsize = lodepng_get_raw_size(decoder->w, 1, &state->info_raw);
+  } else if(!state->decoder.color_convert) {
+    /*as in lodepng_decode, info_raw reflects what colortype the rows have*/
+    unsigned error = lodepng_color_mode_copy(&state->info_raw, &state->info_png.color);
+    if(error) return error;
+  }
+  decoder->linebytes = lodepng_get_raw_size_idat(decoder->w, 1, bpp) - 1u;
+  decoder->bytewidth = (bpp + 7u) / 8u;
+  decoder->rows = (unsigned char*)lodepng_malloc((decoder->linebytes + 1u) * 2u + convertedsize);
+  if(!decoder->rows) return 83; /*alloc fail*/
+  decoder->row = decoder->rows;
+  decoder->prev = decoder->row + decoder->linebytes + 1u;
+  decoder->converted = decoder->prev + decoder->linebytes + 1u;
+  if(!decoder->buffered && !ucvector_reserve(&decoder->out, STREAM_WINDOW + STREAM_OUTPUT + 270u)) return 83;
+  return 0;
+}
+
+/*decodes the collected IDAT data of an interlaced image, or for a custom zlib*/
+static unsigned streamBuffered(LodePNGStreamDecoder* decoder) {
+  LodePNGState* state = decoder->state;
+  unsigned char* scanlines = 0;
+  unsigned char* image = 0;
+  size_t scanlines_size = 0;
+  unsigned y;
+  unsigned error = zlib_decompress(&scanlines, &scanlines_size, decoder->expected_size,
+                                   decoder->in.data, decoder->in.size, &state->decoder.zlibsettings);
+  if(!error && scanlines_size != decoder->expected_size) error = 91; /*decompressed size doesn't match prediction*/
+  if(!error) {
+    image = (unsigned char*)lodepng_malloc(decoder->linebytes * decoder->h);
+    if(!image) error = 83; /*alloc fail*/
+  }
+  if(!error) {
+    error = postProcessScanlines(image, decoder->linebytes * 8u, scanlines, decoder->w, decoder->h, &state->info_png);
+  }
+  for(y = 0; !error && y != decoder->h; ++y) error = streamEmitRow(decoder, &image[decoder->linebytes * y]);
+  lodepng_free(scanlines);
+  lodepng_free(image);
+  return error;
+}
+
+/*the end of the image data, at IEND*/
+static unsigned streamEnd(LodePNGStreamDecoder* decoder) {
+  unsigned error = 0;
+  decoder->stage = STREAM_END;
+  if(!decoder->started) error = streamStart(decoder);
+  if(error) return error;
+  if(decoder->buffered) return streamBuffered(decoder);
+  error = streamInflate(decoder, 1);
+  if(!error && decoder->total != decoder->expected_size) error = 91; /*decompressed size doesn't match prediction*/
+  return error;
+}
+
+/*handles the bytes of the current stage once they are all there*/
+static unsigned streamChunk(LodePNGStreamDecoder* decoder) {
+  LodePNGState* state = decoder->state;
+  const unsigned char* chunk = decoder->chunk.data;
+  unsigned error = 0;
+
+  if(decoder->stage == STREAM_SIGNATURE) {
+    const LodePNGDecompressSettings* zlibsettings = &state->decoder.zlibsettings;
+    error = lodepng_inspect(&decoder->w, &decoder->h, state, chunk, 33);
+    if(error) return error;
+    if(lodepng_pixel_overflow(decoder->w, decoder->h, &state->info_png.color, &state->info_raw)) {
+      return 92; /*overflow possible due to amount of pixels*/
+    }
+    decoder->expected_size = idatExpectedSize(decoder->w, decoder->h, &state->info_png);
+    decoder->buffered = state->info_png.interlace_method != 0 ||
+                        zlibsettings->custom_zlib || zlibsettings->custom_inflate;
+    streamExpect(decoder, STREAM_CHUNK_HEADER, 8);
+  } else if(decoder->stage == STREAM_CHUNK_HEADER) {
+    unsigned chunkLength = lodepng_chunk_length(chunk);
+    if(chunkLength > 2147483647) {
+      /*error: chunk length larger than the max PNG chunk size*/
+      return state->decoder.ignore_end ? streamEnd(decoder) : 63;
+    }
+    if(lodepng_chunk_type_equals(chunk, "IDAT")) {
+      if(!decoder->started) error = streamStart(decoder);
+      if(error) return error;
+      decoder->critical_pos = 3;
+      decoder->crc = lodepng_crc32(&chunk[4], 4);
+      decoder->remaining = chunkLength;
+      streamExpect(decoder, chunkLength ? STREAM_IDAT : STREAM_IDAT_CRC, chunkLength ? 0 : 4);
+    } else {
+      /*the chunk is read once it's all there, after the header that is already in chunk*/
+      decoder->stage = STREAM_CHUNK;
+      decoder->need = (size_t)chunkLength + 12u;
+    }
+  } else if(decoder->stage == STREAM_CHUNK) {
+    if(lodepng_chunk_type_equals(chunk, "IEND")) {
+      if(!state->decoder.ignore_crc && lodepng_chunk_check_crc(chunk)) return 57; /*invalid CRC*/
+      return streamEnd(decoder);
+    }
+    error = readChunk(state, chunk, &decoder->critical_pos);
+    if(error) return error;
+    streamExpect(decoder, STREAM_CHUNK_HEADER, 8);
+  } else if(decoder->stage == STREAM_IDAT_CRC) {
+    if(!state->decoder.ignore_crc && lodepng_read32bitInt(chunk) != decoder->crc) return 57; /*invalid CRC*/
+    streamExpect(decoder, STREAM_CHUNK_HEADER, 8);
+  }
+  return 0;
+}
+
+LodePNGStreamDecoder* lodepng_stream_decoder_new(LodePNGState* state, LodePNGRowCallback callback, void* context) {
+  LodePNGStreamDecoder* decoder = (LodePNGStreamDecoder*)lodepng_malloc(sizeof(LodePNGStreamDecoder));
+  if(!decoder) return 0;
+  decoder->state = state;
+  decoder->callback = callback;
+  decoder->context = context;
+  decoder->w = decoder->h = 0;
+  decoder->expected_size = 0;
+  decoder->buffered = decoder->started = decoder->convert = 0;
+  decoder->chunk = ucvector_init(0, 0);
+  streamExpect(decoder, STREAM_SIGNATURE, 33);
+  decoder->remaining = 0;
+  decoder->crc = 0;
+  decoder->critical_pos = 1;
+  decoder->zstage = ZLIB_HEADER;
+  decoder->in = ucvector_init(0, 0);
+  decoder->bp = 0;
+  decoder->bfinal = 0;
+  decoder->stored = 0;
+  HuffmanTree_init(&decoder->tree_ll);
+  HuffmanTree_init(&decoder->tree_d);
+  decoder->table_ll = decoder->table_d = 0;
+  decoder->out = ucvector_init(0, 0);
+  decoder->outpos = 0;
+  decoder->total = 0;
+  decoder->adler = 1u;
+  decoder->linebytes = decoder->bytewidth = 0;
+  decoder->rows = decoder->row = decoder->prev = decoder->converted = 0;
+  decoder->rowfill = 0;
+  decoder->y = 0;
+  state->error = 0;
+  return decoder;
+}
+
+void lodepng_stream_decoder_delete(LodePNGStreamDecoder* decoder) {
+  if(!decoder) return;
+  lodepng_free(decoder->chunk.data);
+  lodepng_free(decoder->in.data);
+  lodepng_free(decoder->out.data);
+  HuffmanTree_cleanup(&decoder->tree_ll);
+  HuffmanTree_cleanup(&decoder->tree_d);
+  lodepng_free(decoder->table_ll);
+  lodepng_free(decoder->table_d);
+  lodepng_free(decoder->rows);
+  lodepng_free(decoder);
+}
+
+unsigned lodepng_stream_decoder_feed(LodePNGStreamDecoder* decoder, const unsigned char* in, size_t insize) {
+  LodePNGState* state = decoder->state;
+  while(insize != 0 && !state->error && decoder->stage != STREAM_END) {
+    size_t n;
+    if(decoder->stage == STREAM_IDAT) {
+      /*IDAT data goes to inflate as it comes, only its CRC is known at the end of the chunk*/
+      n = LODEPNG_MIN(insize, decoder->remaining);
+      if(!decoder->buffered) n = LODEPNG_MIN(n, STREAM_INPUT);
+      if(!state->decoder.ignore_crc) decoder->crc = lodepng_crc32_combine(decoder->crc, lodepng_crc32(in, n), n);
+      if(!ucvector_reserve(&decoder->in, decoder->in.size + n)) CERROR_BREAK(state->error, 83); /*alloc fail*/
+      lodepng_memcpy(decoder->in.data + decoder->in.size, in, n);
+      decoder->in.size += n;
+      decoder->remaining -= n;
+      if(!decoder->buffered) state->error = streamInflate(decoder, 0);
+      if(decoder->remaining == 0) streamExpect(decoder, STREAM_IDAT_CRC, 4);
+    } else {
+      n = LODEPNG_MIN(insize, decoder->need - decoder->chunk.size);
+      if(!ucvector_reserve(&decoder->chunk, decoder->chunk.size + n)) CERROR_BREAK(state->error, 83); /*alloc fail*/
+      lodepng_memcpy(decoder->chunk.data + decoder->chunk.size, in, n);
+      decoder->chunk.size += n;
+      if(decoder->chunk.size == decoder->need) state->error = streamChunk(decoder);
+    }
+    in += n;
+    insize -= n;
+  }
+  return state->error;
+}
+
+unsigned lodepng_stream_decoder_finish(LodePNGStreamDecoder* decoder) {
+  LodePNGState* state = decoder->state;
+  if(state->error || decoder->stage == STREAM_END) return state->error;
+  if(decoder->stage == STREAM_SIGNATURE) {
+    /*error: the data is empty, or smaller than a PNG header*/
+    state->error = decoder->chunk.size == 0 ? 48 : 27;
+  } else if(decoder->stage == STREAM_CHUNK_HEADER || (decoder->stage == STREAM_CHUNK && decoder->chunk.size < 12)) {
+    /*error: the PNG ends before IEND*/
+    state->error = state->decoder.ignore_end ? streamEnd(decoder) : 30;
+  } else {
+    state->error = 64; /*error: the PNG ends within a chunk*/
+  }
+  decoder->stage = STREAM_END;
+  return state->error;
+}
+
 unsigned lodepng_decode_memory(unsigned char** out, unsigned* w, unsigned* h, const unsigned char* in,
                                size_t insize, LodePNGColorType colortype, unsigned bitdepth) {
   unsigned error;
@@ -5587,6 +7908,7 @@ unsigned lodepng_decode24_file(unsigned char** out, unsigned* w, unsigned* h, co
 
 void lodepng_decoder_settings_init(LodePNGDecoderSettings* settings) {
   settings->color_convert = 1;
+  settings->num_threads = 1;
 #ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
   settings->read_text_chunks = 1;
   settings->remember_unknown_chunks = 0;
@@ -6041,6 +8363,73 @@ static unsigned addChunk_sBIT(ucvector* out, const LodePNGInfo* info) {
 
 #endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
 
+#ifdef LODEPNG_SIMD_X86
+/*Paeth filter of 8 bytes at a time in 16-bit lanes. Unlike unfiltering, each predictor only depends on the input, so
+the pixel size doesn't matter. Returns the index of the first byte it did not filter.*/
+static size_t filterPaethSSE2(unsigned char* out, const unsigned char* scanline, const unsigned char* prevline,
+                              size_t length, size_t bytewidth) {
+  size_t i;
+  const __m128i zero = _mm_setzero_si128();
+  for(i = bytewidth; i + 8 <= length; i += 8) {
+    __m128i a = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(scanline + i - bytewidth)), zero);
+    __m128i b = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(prevline + i)), zero);
+    __m128i c = _mm_unpacklo_epi8(_mm_loadl_epi64((const __m128i*)(prevline + i - bytewidth)), zero);
+    __m128i x = _mm_loadl_epi64((const __m128i*)(scanline + i));
+    __m128i pa = _mm_sub_epi16(b, c);
+    __m128i pb = _mm_sub_epi16(a, c);
+    __m128i pc = _mm_add_epi16(pa, pb);
+    __m128i smaller, pred;
+    pa = _mm_max_epi16(pa, _mm_sub_epi16(zero, pa));
+    pb = _mm_max_epi16(pb, _mm_sub_epi16(zero, pb));
+    pc = _mm_max_epi16(pc, _mm_sub_epi16(zero, pc));
+    /*same priority as paethPredictor: a, unless pb < pa, then the winner unless pc is smaller still*/
+    smaller = _mm_cmplt_epi16(pb, pa);
+    pred = _mm_or_si128(_mm_and_si128(smaller, b), _mm_andnot_si128(smaller, a));
+    pa = _mm_min_epi16(pa, pb);
+    smaller = _mm_cmplt_epi16(pc, pa);
+    pred = _mm_or_si128(_mm_and_si128(smaller, c), _mm_andnot_si128(smaller, pred));
+    _mm_storel_epi64((__m128i*)(out + i), _mm_sub_epi8(x, _mm_packus_epi16(pred, pred)));
+  }
+  return i;
+}
+
+/*filterSum for 16 bytes at a time. For differences min(s, 255 - s) is the magnitude of s as signed char.*/
+static size_t filterSumSSE2(const unsigned char* data, size_t length, unsigned char filterType, size_t* sum) {
+  size_t i;
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i ones = _mm_set1_epi8(-1);
+  __m128i acc = zero;
+  for(i = 0; i + 16 <= length; i += 16) {
+    __m128i v = _mm_loadu_si128((const __m128i*)(data + i));
+    if(filterType != 0) v = _mm_min_epu8(v, _mm_xor_si128(v, ones));
+    acc = _mm_add_epi64(acc, _mm_sad_epu8(v, zero));
+  }
+  acc = _mm_add_epi64(acc, _mm_unpackhi_epi64(acc, acc));
+  *sum = (size_t)_mm_cvtsi128_si64(acc);
+  return i;
+}
+#endif /*LODEPNG_SIMD_X86*/
+
+/*the LFS_MINSUM cost of a filtered scanline*/
+static size_t filterSum(const unsigned char* data, size_t length, unsigned char filterType) {
+  size_t i = 0, sum = 0;
+#ifdef LODEPNG_SIMD_X86
+  i = filterSumSSE2(data, length, filterType, &sum);
+#endif /*LODEPNG_SIMD_X86*/
+  if(filterType == 0) {
+    for(; i != length; ++i) sum += data[i];
+  } else {
+    for(; i != length; ++i) {
+      /*For differences, each byte should be treated as signed, values above 127 are negative
+      (converted to signed char). Filtertype 0 isn't a difference though, so use unsigned there.
+      This means filtertype 0 is almost never chosen, but that is justified.*/
+      unsigned char s = data[i];
+      sum += s < 128 ? s : (255U - s);
+    }
+  }
+  return sum;
+}
+
 static void filterScanline(unsigned char* out, const unsigned char* scanline, const unsigned char* prevline,
                            size_t length, size_t bytewidth, unsigned char filterType) {
   size_t i;
@@ -6072,7 +8461,10 @@ static void filterScanline(unsigned char* out, const unsigned char* scanline, co
       if(prevline) {
         /*paethPredictor(0, prevline[i], 0) is always prevline[i]*/
         for(i = 0; i != bytewidth; ++i) out[i] = (scanline[i] - prevline[i]);
-        for(i = bytewidth; i < length; ++i) {
+#ifdef LODEPNG_SIMD_X86
+        i = filterPaethSSE2(out, scanline, prevline, length, bytewidth);
+#endif /*LODEPNG_SIMD_X86*/
+        for(; i < length; ++i) {
           out[i] = (scanline[i] - paethPredictor(scanline[i - bytewidth], prevline[i], prevline[i - bytewidth]));
         }
       } else {
@@ -6158,21 +8550,9 @@ static unsigned filter(unsigned char* out, const unsigned char* in, unsigned w,
       for(y = 0; y != h; ++y) {
         /*try the 5 filter types*/
         for(type = 0; type != 5; ++type) {
-          size_t sum = 0;
+          size_t sum;
           filterScanline(attempt[type], &in[y * linebytes], prevline, linebytes, bytewidth, type);
-
-          /*calculate the sum of the result*/
-          if(type == 0) {
-            for(x = 0; x != linebytes; ++x) sum += (unsigned char)(attempt[type][x]);
-          } else {
-            for(x = 0; x != linebytes; ++x) {
-              /*For differences, each byte should be treated as signed, values above 127 are negative
-              (converted to signed char). Filtertype 0 isn't a difference though, so use unsigned there.
-              This means filtertype 0 is almost never chosen, but that is justified.*/
-              unsigned char s = attempt[type][x];
-              sum += s < 128 ? s : (255U - s);
-            }
-          }
+          sum = filterSum(attempt[type], linebytes, type);
 
           /*check if this is smallest sum (or if type == 0 it's the first case so always store the values)*/
           if(type == 0 || sum < smallest) {
@@ -6185,7 +8565,7 @@ static unsigned filter(unsigned char* out, const unsigned char* in, unsigned w,
 
         /*now fill the out values*/
         out[y * (linebytes + 1)] = bestType; /*the first byte of a scanline will be the filter type*/
-        for(x = 0; x != linebytes; ++x) out[y * (linebytes + 1) + 1 + x] = attempt[bestType][x];
+        lodepng_memcpy(&out[y * (linebytes + 1) + 1], attempt[bestType], linebytes);
       }
     }
 
@@ -6874,6 +9254,15 @@ void lodepng_encoder_settings_init(LodePNGEncoderSettings* settings) {
 #endif /*LODEPNG_COMPILE_ANCILLARY_CHUNKS*/
 }
 
+
+void lodepng_encoder_settings_level(LodePNGEncoderSettings* settings, unsigned level) {
+  lodepng_compress_settings_level(&settings->zlibsettings, level);
+  /*filtering costs little next to level 0, and trying all filters on each row is slow next to levels 1 and 2*/
+  if(level == 0) settings->filter_strategy = LFS_ZERO;
+  else if(level <= 2) settings->filter_strategy = LFS_FOUR;
+  else settings->filter_strategy = LFS_MINSUM;
+}
+
 #endif /*LODEPNG_COMPILE_ENCODER*/
 #endif /*LODEPNG_COMPILE_PNG*/
 
@@ -7013,6 +9402,8 @@ const char* lodepng_error_text(unsigned code) {
     case 120: return "invalid cLLI chunk size";
     case 121: return "invalid chunk type name: may only contain [a-zA-Z]";
     case 122: return "invalid chunk type name: third character must be uppercase";
+    case 123: return "lodepng_decode_into: stride is smaller than a row of the image";
+    case 124: return "lodepng_decode_into: output buffer too small for the image";
   }
   return "unknown error code";
 }
@@ -7116,6 +9507,14 @@ State& State::operator=(const State& other) {
 
 #ifdef LODEPNG_COMPILE_DECODER
 
+Arena::Arena(unsigned char* buffer, size_t buffersize) {
+  lodepng_arena_init(this, buffer, buffersize);
+}
+
+Arena::~Arena() {
+  lodepng_arena_cleanup(this);
+}
+
 unsigned decode(std::vector<unsigned char>& out, unsigned& w, unsigned& h, const unsigned char* in,
                 size_t insize, LodePNGColorType colortype, unsigned bitdepth) {
   unsigned char* buffer = 0;
@@ -102,6 +102,21 @@ or comment out LODEPNG_COMPILE_CRC below*/
 #define LODEPNG_COMPILE_CRC
 #endif
 
+/*SSE2, SSSE3 and AVX2 versions of the PNG unfilter and Adler-32, and a PCLMUL CRC32, for x86-64, selected at
+runtime based on the CPU. Other platforms, and builds with this disabled, use the portable C code.*/
+#ifndef LODEPNG_NO_COMPILE_SIMD
+/*pass -DLODEPNG_NO_COMPILE_SIMD to the compiler to disable this, or comment out LODEPNG_COMPILE_SIMD below*/
+#define LODEPNG_COMPILE_SIMD
+#endif
+
+/*decode and compress large images with several threads, see num_threads in LodePNGDecoderSettings and
+LodePNGCompressSettings. This is only available when lodepng.cpp is compiled as C++11 or newer, C builds always run
+on the calling thread.*/
+#ifndef LODEPNG_NO_COMPILE_THREADS
+/*pass -DLODEPNG_NO_COMPILE_THREADS to the compiler to disable this, or comment out LODEPNG_COMPILE_THREADS below*/
+#define LODEPNG_COMPILE_THREADS
+#endif
+
 /*compile the C++ version (you can disable the C++ wrapper here even when compiling for C++)*/
 #ifdef __cplusplus
 #ifndef LODEPNG_NO_COMPILE_CPP
@@ -356,6 +371,17 @@ struct LodePNGCompressSettings /*deflate = compress*/ {
   unsigned minmatch; /*minimum lz77 length. 3 is normally best, 6 can be better for some PNGs. Default: 0*/
   unsigned nicematch; /*stop searching if >= this length found. Set to 258 for best compression. Default: 128*/
   unsigned lazymatching; /*use lazy matching: better compression but a bit slower. Default: true*/
+  /*use a greedy matcher with a 4 byte hash instead: several times faster, compresses a few percent worse. Ignores
+  lazymatching. Used by compression levels 1 to 6. Default: 0*/
+  unsigned fastmatching;
+  /*maximum amount of earlier positions tried for each match, lower is faster. 0 uses windowsize for windows of 8192
+  and more, windowsize / 8 for smaller ones. Default: 0*/
+  unsigned maxchainlength;
+  /*amount of threads that compress the dynamic blocks of large inputs, each ending in a sync flush. 0 uses
+  std::thread::hardware_concurrency, 1 compresses on the calling thread only, without the sync flushes. The output
+  is the same for every value other than 1, whatever the amount of cores, and a little larger than with 1. Ignored
+  without LODEPNG_COMPILE_THREADS. Default: 1*/
+  unsigned num_threads;
 
   /*use custom zlib encoder instead of built in one (default: null)*/
   unsigned (*custom_zlib)(unsigned char**, size_t*,
@@ -373,6 +399,12 @@ struct LodePNGCompressSettings /*deflate = compress*/ {
 
 extern const LodePNGCompressSettings lodepng_default_compress_settings;
 void lodepng_compress_settings_init(LodePNGCompressSettings* settings);
+/*Sets btype, use_lz77, windowsize, minmatch, nicematch, lazymatching, fastmatching and maxchainlength to a preset, like the levels
+of zlib: 0 stores without compression, 1 is the fastest that compresses, 9 gives the smallest output. Levels above 9
+are treated as 9. The other settings, such as num_threads and the custom functions, are left alone. The defaults of
+lodepng_compress_settings_init are not one of the levels, they are slower than level 3 and compress less on most
+images, but are kept as they are so the output of existing programs doesn't change.*/
+void lodepng_compress_settings_level(LodePNGCompressSettings* settings, unsigned level);
 #endif /*LODEPNG_COMPILE_ENCODER*/
 
 #ifdef LODEPNG_COMPILE_PNG
@@ -826,6 +858,13 @@ typedef struct LodePNGDecoderSettings {
 
   unsigned color_convert; /*whether to convert the PNG to the color type you want. Default: yes*/
 
+  /*amount of threads used for large non-interlaced images: inflate, unfilter and color conversion then overlap,
+  with the color conversion spread over the threads that are left. 0 uses std::thread::hardware_concurrency,
+  1 decodes on the calling thread only. The output and the error codes are the same for any amount. Leave it at 1
+  if the application already decodes several images in parallel. Ignored without LODEPNG_COMPILE_THREADS.
+  Default: 1*/
+  unsigned num_threads;
+
 #ifdef LODEPNG_COMPILE_ANCILLARY_CHUNKS
   unsigned read_text_chunks; /*if false but remember_unknown_chunks is true, they're stored in the unknown chunks*/
 
@@ -940,6 +979,10 @@ typedef struct LodePNGEncoderSettings {
 } LodePNGEncoderSettings;
 
 void lodepng_encoder_settings_init(LodePNGEncoderSettings* settings);
+/*Sets zlibsettings with lodepng_compress_settings_level, and filter_strategy to match the level: LFS_ZERO for level 0,
+Paeth on every row (LFS_FOUR) for levels 1 and 2, and LFS_MINSUM for the others. Level 1 is meant for real-time
+capture. auto_convert is left alone, turn it off as well when speed matters: it scans all pixels before encoding.*/
+void lodepng_encoder_settings_level(LodePNGEncoderSettings* settings, unsigned level);
 #endif /*LODEPNG_COMPILE_ENCODER*/
 
 
@@ -980,6 +1023,63 @@ information is placed in the info_png field of the LodePNGState.
 unsigned lodepng_inspect(unsigned* w, unsigned* h,
                          LodePNGState* state,
                          const unsigned char* in, size_t insize);
+
+/*
+Scratch memory for the compressed and inflated data of lodepng_decode_into. Reusing it for a series of images
+allocates only when an image needs more than the ones before. It can start out with a buffer of your own of the
+given size, which lodepng never frees, or with NULL and 0.
+*/
+typedef struct LodePNGArena {
+  unsigned char* data;
+  size_t size;
+  unsigned owned; /*1 if data was allocated by lodepng*/
+} LodePNGArena;
+
+void lodepng_arena_init(LodePNGArena* arena, unsigned char* buffer, size_t size);
+void lodepng_arena_cleanup(LodePNGArena* arena);
+
+/*
+Same as lodepng_decode, but writes the image to the outsize bytes at out instead of allocating it, for example
+straight into a mapped pixel buffer. Use lodepng_inspect first to get the size.
+stride: amount of bytes between the starts of rows in out, or 0 for the rows after each other as lodepng_decode
+gives them. With a stride, rows always start at a byte, and padding bits of rows with less than 8 bits per pixel
+are 0. out needs at least stride * (h - 1) + lodepng_get_raw_size(w, 1, &state->info_raw) bytes, where info_raw is
+the color type of the PNG if color_convert is 0.
+arena: holds the intermediate buffers between calls, or NULL to allocate them for this call only. The inflated data
+is allocated anyway if the zlibsettings have custom_zlib or custom_inflate.
+Returns the error code lodepng_decode returns for the same PNG and settings, with two exceptions: a stride or outsize
+that is too small (123, 124) is reported before the image data is read, so before errors in that data, and running
+out of memory (83) can be reported before other errors, since the scratch memory is reserved at the start.
+*/
+unsigned lodepng_decode_into(unsigned char* out, size_t outsize, size_t stride, unsigned* w, unsigned* h,
+                             LodePNGState* state, const unsigned char* in, size_t insize, LodePNGArena* arena);
+
+/*
+Receives row y of the w * h image from the stream decoder. The row is in the color type of info_raw, or of the PNG
+if color_convert is 0, and has lodepng_get_raw_size(w, 1, &state->info_raw) bytes, padding bits are 0. The pointer
+is only valid during the call. Return 0 to continue, anything else stops decoding and is returned as the error.
+*/
+typedef unsigned (*LodePNGRowCallback)(void* context, const unsigned char* row, unsigned y, unsigned w, unsigned h);
+
+/*
+Decodes a PNG given in pieces, for example while it is read from a file, and gives out each row as soon as it is
+decoded. Neither the file nor the image is ever in memory at once: a non-interlaced image needs two rows and about
+100 KiB. Interlaced images are decoded at IEND, from the collected IDAT data, and then use as much memory as
+lodepng_decode. The same applies for custom_zlib or custom_inflate in the zlibsettings.
+The state has the settings and gets the info_png of the chunks read so far, it must outlive the decoder.
+The CRC of an IDAT chunk is only known at its end, so rows of a chunk with a wrong CRC may already be given out when
+feed returns error 57.
+*/
+typedef struct LodePNGStreamDecoder LodePNGStreamDecoder;
+
+/*returns NULL if out of memory*/
+LodePNGStreamDecoder* lodepng_stream_decoder_new(LodePNGState* state, LodePNGRowCallback callback, void* context);
+void lodepng_stream_decoder_delete(LodePNGStreamDecoder* decoder);
+/*Gives the next insize bytes of the PNG, any amount at a time. Returns error code, after an error all further calls
+return it too. Bytes after IEND are ignored.*/
+unsigned lodepng_stream_decoder_feed(LodePNGStreamDecoder* decoder, const unsigned char* in, size_t insize);
+/*Call after the last bytes are given. Returns error code, with an error if the PNG ended before IEND.*/
+unsigned lodepng_stream_decoder_finish(LodePNGStreamDecoder* decoder);
 #endif /*LODEPNG_COMPILE_DECODER*/
 
 /*
@@ -1192,6 +1292,16 @@ class State : public LodePNGState {
 };
 
 #ifdef LODEPNG_COMPILE_DECODER
+/* LodePNGArena that frees its memory in the destructor. */
+class Arena : public LodePNGArena {
+  public:
+    Arena(unsigned char* buffer = 0, size_t buffersize = 0);
+    ~Arena();
+  private:
+    Arena(const Arena& other); /*not copyable*/
+    Arena& operator=(const Arena& other);
+};
+
 /* Same as other lodepng::decode, but using a State for more settings and information. */
 unsigned decode(std::vector<unsigned char>& out, unsigned& w, unsigned& h,
                 State& state,
@@ -1975,6 +2085,7 @@ state.encoder.zlibsettings.windowsize: tweak LZ77 windowsize
 state.encoder.zlibsettings.minmatch: tweak min LZ77 length to match
 state.encoder.zlibsettings.nicematch: tweak LZ77 match where to stop searching
 state.encoder.zlibsettings.lazymatching: try one more LZ77 matching
+state.encoder.zlibsettings.fastmatching: faster greedy LZ77 matching
 state.encoder.zlibsettings.custom_...: use custom deflate function
 state.encoder.auto_convert: choose optimal PNG color type, if 0 uses info_png
 state.encoder.filter_palette_zero: PNG filter strategy for palette
@@ -2003,6 +2114,19 @@ symbol.
 Not all changes are listed here, the commit history in github lists more:
 https://github.com/lvandeve/lodepng
 
+*) local change: lodepng_stream_decoder, to decode a PNG given in pieces row by row with bounded memory.
+*) local change: lodepng_decode_into, to decode into a given buffer with a stride and reusable scratch memory.
+*) local change: SSSE3/AVX2 color conversion to RGBA8 and RGB8, and lodepng_convert to other
+   types converts in chunks instead of one pixel at a time.
+*) local change: compression levels, see lodepng_encoder_settings_level, a greedy matcher with
+   fastmatching, maxchainlength, and SSE2 Paeth filtering and LFS_MINSUM sums.
+*) local change: multi-threaded deflate of large images, opt-in with num_threads in LodePNGCompressSettings.
+*) local change: multi-threaded decoding of large images, opt-in with num_threads.
+*) local change: PCLMUL CRC32 and SSSE3/AVX2 Adler-32 under LODEPNG_COMPILE_SIMD.
+*) local change: faster inflate on 64-bit platforms, with a word sized bit
+   buffer, lookup tables that decode two literals at once and word copies.
+*) local change: SIMD unfilter (SSE2, SSSE3 and AVX2) for x86-64, which can be
+   disabled with LODEPNG_NO_COMPILE_SIMD.
 *) 6 may 2025: renamed mDCv to mDCV and cLLi to cLLI as per the recent rename
    in the draft png third edition spec. Please note that while the third
    edition is not finalized, backwards-incompatible changes to its features are
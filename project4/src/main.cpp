@@ -5,9 +5,10 @@
 #include "cyTriMesh.h"
 #include "cyMatrix.h"
 #include "cyGL.h"
+#include "cyFrustum.h"
 #include <map>
 #include <tuple>
-#include "lodepng.h"
+#include "cyTextureLoader.h"
 #include <vector>
 struct Vertex {
     cy::Vec3f position;
@@ -28,9 +29,14 @@ private:
     std::vector<GLuint> m_vbos;
     std::vector<GLuint> m_ibos;
     std::vector<size_t> m_indices_sizes;
+    cy::Vec3fArray m_material_bound_min;
+    cy::Vec3fArray m_material_bound_max;
+    std::vector<uint32_t> m_material_visible;
+    cy::CullStats m_cull_stats;
+    std::string m_window_title;
     cy::GLSLProgram m_shader_program;
-    cy::Matrix4f m_model;
-    cy::Matrix4f m_view;
+    cy::Matrix34f m_model;
+    cy::Matrix34f m_view;
     cy::Matrix4f m_projection;
     cy::Matrix4f m_mvp;
     bool m_left_mouse_pressed = false;
@@ -42,6 +48,11 @@ private:
     std::vector<GLuint> m_textures_kd;
     std::vector<GLuint> m_textures_ks;
     std::vector<GLuint> m_textures_ka;
+    cy::GLTextureUploader m_texture_uploader;
+    cy::GLMipmapGenerator m_mipmap_generator;
+    cy::TextureBatchLoader m_texture_loader;
+    // Creates the material textures of the decoded images and queues their uploads and mipmap generation
+    cy::GLTextureReceiver m_texture_receiver{m_texture_uploader, &m_mipmap_generator};
     std::string m_model_obj_path;
     static void key_callback(GLFWwindow* window, int key, int scancode, int action, int mods) {
         if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
@@ -179,6 +190,10 @@ private:
 
             m_indices_sizes[i] = indices.size();
         }
+
+        // Object-space bounds of each material for frustum culling
+        m_mesh.ComputeMaterialBounds(m_material_bound_min, m_material_bound_max);
+        m_material_visible.resize((m_mesh.NM() + 31) / 32);
     }
     void init_glew() {
         if (glewInit() != GLEW_OK) {
@@ -188,30 +203,39 @@ private:
     }
 
     void init_gl_state() {
-        glEnable(GL_DEPTH_TEST);
-        glEnable(GL_CULL_FACE);
-        glCullFace(GL_BACK);
-        glFrontFace(GL_CCW);
+        cy::GLState::Enable(GL_DEPTH_TEST);
+        cy::GLState::Enable(GL_CULL_FACE);
+        cy::GLState::CullFace(GL_BACK);
+        cy::GLState::FrontFace(GL_CCW);
 
         m_light.position = cy::Vec3f(0.0f, 0.0f, -5.0f);
     }
     void render() {
+        // Create the textures decoded since the last frame and issue their uploads
+        m_texture_receiver.Receive();
+        m_texture_uploader.Process();
         m_shader_program.Bind();
         glfwGetFramebufferSize(m_window, &m_width, &m_height);
-        glViewport(0, 0, m_width, m_height);
+        cy::GLState::Viewport(0, 0, m_width, m_height);
         glClearColor(0.f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        m_view = cy::Matrix4f::Identity();
         float x = m_camera_distance * std::sin(m_camera_yaw) * std::cos(m_camera_pitch);
         float y = m_camera_distance * std::sin(m_camera_pitch);
         float z = m_camera_distance * std::cos(m_camera_yaw) * std::cos(m_camera_pitch);
         m_view.SetView(cy::Vec3f(x, y, z), cy::Vec3f(0.0f, 0.0f, 0.0f), cy::Vec3f(0.0f, 1.0f, 0.0f));
-        m_mvp = m_projection * m_view * m_model;
+        // Model-view stays affine; only the projection needs the full 4x4 product
+        cy::Matrix34f mv = m_view * m_model;
+        m_mvp = m_projection * mv;
         m_shader_program["mvp"] = m_mvp;
-        m_shader_program["mv_inv_transpose"] = (m_view * m_model).GetInverse().GetTranspose();
-        m_shader_program["mv"] = m_view * m_model;
+        m_shader_program["mv_inv_transpose"] = mv.GetInverse().GetTranspose();
+        m_shader_program["mv"] = cy::Matrix4f(mv);
         m_shader_program["light_position"] = m_view * m_light.position;
+        // The mvp includes the model transformation, so the frustum planes are in object space
+        cy::Frustumf frustum(m_mvp);
+        m_cull_stats.Reset();
+        m_cull_stats.Add(m_mesh.NM(), frustum.TestBoxes(m_material_bound_min, m_material_bound_max, m_material_visible.data()));
         for (unsigned int i = 0; i < m_mesh.NM(); i++) {
+            if (!cy::Frustumf::IsVisible(m_material_visible.data(), i)) continue;
             m_shader_program["material.kd"] = cy::Vec3f(m_mesh.M(i).Kd[0], m_mesh.M(i).Kd[1], m_mesh.M(i).Kd[2]);
             m_shader_program["material.ks"] = cy::Vec3f(m_mesh.M(i).Ks[0], m_mesh.M(i).Ks[1], m_mesh.M(i).Ks[2]);
             m_shader_program["material.ka"] = cy::Vec3f(m_mesh.M(i).Ka[0], m_mesh.M(i).Ka[1], m_mesh.M(i).Ka[2]);
@@ -220,17 +244,30 @@ private:
             bind_texture_if_available(m_textures_kd[i], m_mesh.M(i).map_Kd.data, 0, "has_texture_kd", "tex_kd");
             bind_texture_if_available(m_textures_ks[i], m_mesh.M(i).map_Ks.data, 1, "has_texture_ks", "tex_ks");
             bind_texture_if_available(m_textures_ka[i], m_mesh.M(i).map_Ka.data, 2, "has_texture_ka", "tex_ka");
-            glBindVertexArray(m_vaos[i]);
+            cy::GLState::BindVertexArray(m_vaos[i]);
             glDrawElements(GL_TRIANGLES, m_indices_sizes[i], GL_UNSIGNED_INT, 0);
         }
+        show_frame_stats();
+    }
+
+    // Shows the number of drawn and tested materials and the redundant uniform and state calls skipped in this frame in the window title
+    void show_frame_stats() {
+        std::string title = m_title + " [drawn " + std::to_string(m_cull_stats.NumVisible()) + "/" + std::to_string(m_cull_stats.NumTested())
+                          + ", skipped uniforms " + std::to_string(cy::GLSLProgram::GetElidedUniformCount())
+                          + ", skipped state " + std::to_string(cy::GLState::GetElidedCount()) + "]";
+        cy::GLSLProgram::ResetElidedUniformCount();
+        cy::GLState::ResetCounts();
+        if (title != m_window_title) {
+            m_window_title = title;
+            glfwSetWindowTitle(m_window, m_window_title.c_str());
+        }
     }
 
     // Helper function to bind texture and set shader uniforms
     void bind_texture_if_available(GLuint texture_id, const char* texture_data, int texture_unit, 
                                    const char* has_texture_uniform, const char* texture_uniform) {
         if (texture_data != nullptr && texture_id != 0) {
-            glActiveTexture(GL_TEXTURE0 + texture_unit);
-            glBindTexture(GL_TEXTURE_2D, texture_id);
+            cy::GLState::BindTexture(texture_unit, GL_TEXTURE_2D, texture_id);
             m_shader_program[has_texture_uniform] = 1;
             m_shader_program[texture_uniform] = texture_unit;
         } else {
@@ -238,29 +275,7 @@ private:
         }
     }
 
-    // Helper function to load a single texture
-    GLuint load_single_texture(const std::string& texture_path, const std::string& texture_type) {
-        std::vector<unsigned char> data;
-        unsigned width, height;
-        unsigned error = lodepng::decode(data, width, height, texture_path.c_str());
-        if (error) {
-            std::cerr << "Failed to load " << texture_type << " texture: " << texture_path << std::endl;
-            return 0;
-        }
-        
-        std::cout << "Loaded " << texture_type << " texture: " << texture_path << std::endl;
-        
-        GLuint texture_id;
-        glGenTextures(1, &texture_id);
-        glBindTexture(GL_TEXTURE_2D, texture_id);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data.data());
-        glGenerateMipmap(GL_TEXTURE_2D);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        
-        return texture_id;
-    }
-
+    // Queues the material textures for decoding on the loader threads, so the first frames render without them
     void load_texture() {
         std::string model_directory = m_model_obj_path.substr(0, m_model_obj_path.find_last_of('/'));
         std::cout << "Model directory: " << model_directory << std::endl;
@@ -271,26 +286,18 @@ private:
         m_textures_ka.resize(m_mesh.NM(), 0);
         
         std::cout << "Number of materials: " << m_mesh.NM() << std::endl;
-        
+
+        // The images are decoded straight into the staging buffer of the uploader
+        m_texture_uploader.Initialize(64 << 20);
+        m_texture_loader.SetAllocator(m_texture_receiver.GetAllocator());
         for (unsigned int i = 0; i < m_mesh.NM(); i++) {
             std::cout << "Processing material: " << m_mesh.M(i).name.data << std::endl;
-            
-            // Load diffuse texture (Kd)
-            if (m_mesh.M(i).map_Kd.data != nullptr) {
-                std::string texture_path = model_directory + "/" + std::string(m_mesh.M(i).map_Kd.data);
-                m_textures_kd[i] = load_single_texture(texture_path, "diffuse");
-            }
-            
-            // Load specular texture (Ks)
-            if (m_mesh.M(i).map_Ks.data != nullptr) {
-                std::string texture_path = model_directory + "/" + std::string(m_mesh.M(i).map_Ks.data);
-                m_textures_ks[i] = load_single_texture(texture_path, "specular");
-            }
-            
-            // Load ambient texture (Ka)
-            if (m_mesh.M(i).map_Ka.data != nullptr) {
-                std::string texture_path = model_directory + "/" + std::string(m_mesh.M(i).map_Ka.data);
-                m_textures_ka[i] = load_single_texture(texture_path, "ambient");
+            const char* maps[3] = {m_mesh.M(i).map_Kd.data, m_mesh.M(i).map_Ks.data, m_mesh.M(i).map_Ka.data};
+            GLuint* texture_ids[3] = {&m_textures_kd[i], &m_textures_ks[i], &m_textures_ka[i]};
+            const char* types[3] = {"diffuse", "specular", "ambient"};
+            for (int j = 0; j < 3; j++) {
+                if (maps[j] == nullptr) continue;
+                m_texture_receiver.Add(m_texture_loader.Load(model_directory + "/" + std::string(maps[j])), texture_ids[j], types[j]);
             }
         }
     }
@@ -303,26 +310,32 @@ public:
         cy::Vec3f center = m_mesh.GetBoundMin() + (m_mesh.GetBoundMax() - m_mesh.GetBoundMin()) / 2.0f;
         cy::Vec3f size = m_mesh.GetBoundMax() - m_mesh.GetBoundMin();
         float max_size = std::max(size.x, std::max(size.y, size.z));
-        cy::Matrix4f translation;
+        cy::Matrix34f translation;
         translation.SetTranslation(-center);
-        cy::Matrix4f scale;
+        cy::Matrix34f scale;
         if (max_size > 0.0f) {
             scale.SetScale(1.0f / max_size);
         } else {
             scale.SetScale(1.0f);
         }
-        cy::Matrix4f rotation;
+        cy::Matrix34f rotation;
         rotation.SetRotation(cy::Vec3f(1.0f, 0.0f, 0.0f), -45.0f);
         m_model = rotation * scale * translation;
         m_shader_program.BuildFiles("shaders/shader.vs", "shaders/shader.fs");
         init_vao();
         init_gl_state();
-        m_view = cy::Matrix4f::Identity();
+        m_view = cy::Matrix34f::Identity();
         m_projection = cy::Matrix4f::Identity();
         m_projection.SetPerspective(45.0f, (float)m_width / (float)m_height, 0.01f, 100.0f);
         load_texture();
     }
-    ~GlApp() {}
+    ~GlApp() {
+        // Wake the loader threads that wait for staging memory, then release the buffer once they have stopped
+        m_texture_uploader.Close();
+        m_texture_loader.Close();
+        m_texture_uploader.Delete();
+        m_mipmap_generator.Delete();
+    }
     void run() {
         while (!glfwWindowShouldClose(m_window)) {
             render();
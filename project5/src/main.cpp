@@ -5,9 +5,10 @@
 #include "cyTriMesh.h"
 #include "cyMatrix.h"
 #include "cyGL.h"
+#include "cyFrustum.h"
 #include <map>
 #include <tuple>
-#include "lodepng.h"
+#include "cyTextureLoader.h"
 #include <vector>
 struct Vertex {
     cy::Vec3f position;
@@ -24,9 +25,14 @@ private:
     std::vector<GLuint> m_mesh_vbos;
     std::vector<GLuint> m_mesh_ibos;
     std::vector<size_t> m_mesh_indices_sizes;
+    cy::Vec3fArray m_mesh_material_bound_min;
+    cy::Vec3fArray m_mesh_material_bound_max;
+    std::vector<uint32_t> m_mesh_material_visible;
+    cy::CullStats m_cull_stats;
+    std::string m_window_title;
     cy::GLSLProgram m_mesh_shader_program;
-    cy::Matrix4f m_mesh_model;
-    cy::Matrix4f m_mesh_view;
+    cy::Matrix34f m_mesh_model;
+    cy::Matrix34f m_mesh_view;
     cy::Matrix4f m_mesh_projection;
     cy::Matrix4f m_mesh_mvp;
     bool m_left_mouse_pressed = false;
@@ -36,6 +42,11 @@ private:
     float m_mesh_camera_pitch = 0.0f;
 
     std::vector<GLuint> m_mesh_textures_kd;
+    cy::GLTextureUploader m_texture_uploader;
+    cy::GLMipmapGenerator m_mipmap_generator;
+    cy::TextureBatchLoader m_texture_loader;
+    // Creates the material textures of the decoded images and queues their uploads and mipmap generation
+    cy::GLTextureReceiver m_texture_receiver{m_texture_uploader, &m_mipmap_generator};
     std::string m_model_obj_path;
 
     GLuint m_fbo;
@@ -50,7 +61,7 @@ private:
     GLuint m_square_vbo;
     GLuint m_square_ibo;
     cy::GLSLProgram m_square_shader_program;
-    cy::Matrix4f m_square_view;
+    cy::Matrix34f m_square_view;
     cy::Matrix4f m_projection;
     bool m_left_alt_pressed = false;
     bool m_right_alt_pressed = false;
@@ -131,8 +142,9 @@ private:
         glCreateFramebuffers(1, &m_fbo);
         glCreateRenderbuffers(1, &m_rbo_depth);
         glCreateTextures(GL_TEXTURE_2D, 1, &m_texture_color);
-        glTextureStorage2D(m_texture_color, 1, GL_RGBA8, 800, 600);
-        glTexParameterf(GL_TEXTURE_2D, GL_TEXTURE_MAX_ANISOTROPY, max_anisotropy);
+        // The square samples the texture with mipmaps, so the storage needs the full mipmap chain
+        glTextureStorage2D(m_texture_color, cy::GLTexture2D::NumMipmapLevels(800, 600), GL_RGBA8, 800, 600);
+        glTextureParameterf(m_texture_color, GL_TEXTURE_MAX_ANISOTROPY, max_anisotropy);
         glTextureParameteri(m_texture_color, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
         glNamedFramebufferTexture(m_fbo, GL_COLOR_ATTACHMENT0, m_texture_color, 0);
         glNamedRenderbufferStorage(m_rbo_depth, GL_DEPTH_COMPONENT, 800, 600);
@@ -269,6 +281,10 @@ private:
 
             m_mesh_indices_sizes[i] = indices.size();
         }
+
+        // Object-space bounds of each material for frustum culling
+        m_mesh.ComputeMaterialBounds(m_mesh_material_bound_min, m_mesh_material_bound_max);
+        m_mesh_material_visible.resize((m_mesh.NM() + 31) / 32);
     }
     void init_glew() {
         if (glewInit() != GLEW_OK) {
@@ -278,29 +294,32 @@ private:
     }
 
     void init_gl_state() {
-        glEnable(GL_DEPTH_TEST);
-        glDepthFunc(GL_LESS);
-        glEnable(GL_CULL_FACE);
-        glCullFace(GL_BACK);
-        glFrontFace(GL_CCW);
+        cy::GLState::Enable(GL_DEPTH_TEST);
+        cy::GLState::DepthFunc(GL_LESS);
+        cy::GLState::Enable(GL_CULL_FACE);
+        cy::GLState::CullFace(GL_BACK);
+        cy::GLState::FrontFace(GL_CCW);
     }
 
     void render() {
-        glBindFramebuffer(GL_FRAMEBUFFER, m_fbo);
+        // Create the textures decoded since the last frame and issue their uploads
+        m_texture_receiver.Receive();
+        m_texture_uploader.Process();
+        cy::GLState::BindFramebuffer(GL_FRAMEBUFFER, m_fbo);
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glViewport(0, 0, 800, 600);
+        cy::GLState::Viewport(0, 0, 800, 600);
         render_mesh();
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        cy::GLState::BindFramebuffer(GL_FRAMEBUFFER, 0);
+        m_mipmap_generator.Generate(m_texture_color);
 
         glfwGetFramebufferSize(m_window, &m_width, &m_height);
-        glViewport(0, 0, m_width, m_height);
+        cy::GLState::Viewport(0, 0, m_width, m_height);
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         render_square();
     }
     void render_square() {
-        m_square_view = cy::Matrix4f::Identity();
         float x = m_camera_distance * std::sin(m_camera_yaw) * std::cos(m_camera_pitch);
         float y = m_camera_distance * std::sin(m_camera_pitch);
         float z = m_camera_distance * std::cos(m_camera_yaw) * std::cos(m_camera_pitch);
@@ -308,38 +327,54 @@ private:
         m_square_shader_program.Bind();
         m_square_shader_program["mvp"] = m_projection * m_square_view;
         m_square_shader_program["texture_color"] = 0;
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, m_texture_color);
+        cy::GLState::BindTexture(0, GL_TEXTURE_2D, m_texture_color);
         CY_GL_ERROR;
-        glBindVertexArray(m_square_vao);
+        cy::GLState::BindVertexArray(m_square_vao);
         CY_GL_ERROR;
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
         CY_GL_ERROR;
     }
     void render_mesh() {
         m_mesh_shader_program.Bind();
-        m_mesh_view = cy::Matrix4f::Identity();
         float x = m_mesh_camera_distance * std::sin(m_mesh_camera_yaw) * std::cos(m_mesh_camera_pitch);
         float y = m_mesh_camera_distance * std::sin(m_mesh_camera_pitch);
         float z = m_mesh_camera_distance * std::cos(m_mesh_camera_yaw) * std::cos(m_mesh_camera_pitch);
         m_mesh_view.SetView(cy::Vec3f(x, y, z), cy::Vec3f(0.0f, 0.0f, 0.0f), cy::Vec3f(0.0f, 1.0f, 0.0f));
-        m_mesh_mvp = m_mesh_projection * m_mesh_view * m_mesh_model;
+        m_mesh_mvp = m_mesh_projection * (m_mesh_view * m_mesh_model);
         m_mesh_shader_program["mvp"] = m_mesh_mvp;
+        // The mvp includes the model transformation, so the frustum planes are in object space
+        cy::Frustumf frustum(m_mesh_mvp);
+        m_cull_stats.Reset();
+        m_cull_stats.Add(m_mesh.NM(), frustum.TestBoxes(m_mesh_material_bound_min, m_mesh_material_bound_max, m_mesh_material_visible.data()));
         for (unsigned int i = 0; i < m_mesh.NM(); i++) {
+            if (!cy::Frustumf::IsVisible(m_mesh_material_visible.data(), i)) continue;
             m_mesh_shader_program["material.kd"] = cy::Vec3f(m_mesh.M(i).Kd[0], m_mesh.M(i).Kd[1], m_mesh.M(i).Kd[2]);
 
             // Bind textures using helper function
             bind_texture_if_available(m_mesh_textures_kd[i], m_mesh.M(i).map_Kd.data, 0, "has_texture_kd", "tex_kd");
-            glBindVertexArray(m_mesh_vaos[i]);
+            cy::GLState::BindVertexArray(m_mesh_vaos[i]);
             glDrawElements(GL_TRIANGLES, m_mesh_indices_sizes[i], GL_UNSIGNED_INT, 0);
         }
+        show_frame_stats();
+    }
+
+    // Shows the number of drawn and tested materials and the redundant uniform and state calls skipped in the last frame in the window title
+    void show_frame_stats() {
+        std::string title = m_title + " [drawn " + std::to_string(m_cull_stats.NumVisible()) + "/" + std::to_string(m_cull_stats.NumTested())
+                          + ", skipped uniforms " + std::to_string(cy::GLSLProgram::GetElidedUniformCount())
+                          + ", skipped state " + std::to_string(cy::GLState::GetElidedCount()) + "]";
+        cy::GLSLProgram::ResetElidedUniformCount();
+        cy::GLState::ResetCounts();
+        if (title != m_window_title) {
+            m_window_title = title;
+            glfwSetWindowTitle(m_window, m_window_title.c_str());
+        }
     }
     // Helper function to bind texture and set shader uniforms
     void bind_texture_if_available(GLuint texture_id, const char* texture_data, int texture_unit, 
                                    const char* has_texture_uniform, const char* texture_uniform) {
         if (texture_data != nullptr && texture_id != 0) {
-            glActiveTexture(GL_TEXTURE0 + texture_unit);
-            glBindTexture(GL_TEXTURE_2D, texture_id);
+            cy::GLState::BindTexture(texture_unit, GL_TEXTURE_2D, texture_id);
             m_mesh_shader_program[has_texture_uniform] = 1;
             m_mesh_shader_program[texture_uniform] = texture_unit;
         } else {
@@ -347,29 +382,7 @@ private:
         }
     }
 
-    // Helper function to load a single texture
-    GLuint load_single_texture(const std::string& texture_path, const std::string& texture_type) {
-        std::vector<unsigned char> data;
-        unsigned width, height;
-        unsigned error = lodepng::decode(data, width, height, texture_path.c_str());
-        if (error) {
-            std::cerr << "Failed to load " << texture_type << " texture: " << texture_path << std::endl;
-            return 0;
-        }
-        
-        std::cout << "Loaded " << texture_type << " texture: " << texture_path << std::endl;
-        
-        GLuint texture_id;
-        glGenTextures(1, &texture_id);
-        glBindTexture(GL_TEXTURE_2D, texture_id);
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data.data());
-        glGenerateMipmap(GL_TEXTURE_2D);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
-        
-        return texture_id;
-    }
-
+    // Queues the diffuse maps of the materials for decoding on the loader threads
     void load_mesh_textures() {
         std::string model_directory = m_model_obj_path.substr(0, m_model_obj_path.find_last_of('/'));
         std::cout << "Model directory: " << model_directory << std::endl;
@@ -378,14 +391,15 @@ private:
         m_mesh_textures_kd.resize(m_mesh.NM(), 0);
         
         std::cout << "Number of materials: " << m_mesh.NM() << std::endl;
-        
+
+        // The workers decode the images straight into the staging buffer
+        m_texture_uploader.Initialize(64 << 20);
+        m_texture_loader.SetAllocator(m_texture_receiver.GetAllocator());
         for (unsigned int i = 0; i < m_mesh.NM(); i++) {
             std::cout << "Processing material: " << m_mesh.M(i).name.data << std::endl;
-            
-            // Load diffuse texture (Kd)
             if (m_mesh.M(i).map_Kd.data != nullptr) {
-                std::string texture_path = model_directory + "/" + std::string(m_mesh.M(i).map_Kd.data);
-                m_mesh_textures_kd[i] = load_single_texture(texture_path, "diffuse");
+                std::string path = model_directory + "/" + std::string(m_mesh.M(i).map_Kd.data);
+                m_texture_receiver.Add(m_texture_loader.Load(path), &m_mesh_textures_kd[i], "diffuse");
             }
         }
     }
@@ -395,20 +409,20 @@ private:
         cy::Vec3f center = m_mesh.GetBoundMin() + (m_mesh.GetBoundMax() - m_mesh.GetBoundMin()) / 2.0f;
         cy::Vec3f size = m_mesh.GetBoundMax() - m_mesh.GetBoundMin();
         float max_size = std::max(size.x, std::max(size.y, size.z));
-        cy::Matrix4f translation;
+        cy::Matrix34f translation;
         translation.SetTranslation(-center);
-        cy::Matrix4f scale;
+        cy::Matrix34f scale;
         if (max_size > 0.0f) {
             scale.SetScale(1.0f / max_size);
         } else {
             scale.SetScale(1.0f);
         }
-        cy::Matrix4f rotation;
+        cy::Matrix34f rotation;
         rotation.SetRotation(cy::Vec3f(1.0f, 0.0f, 0.0f), -45.0f);
         m_mesh_model = rotation * scale * translation;
         m_mesh_shader_program.BuildFiles("shaders/mesh_shader.vs", "shaders/mesh_shader.fs");
         init_mesh_vao();
-        m_mesh_view = cy::Matrix4f::Identity();
+        m_mesh_view = cy::Matrix34f::Identity();
         m_mesh_projection = cy::Matrix4f::Identity();
         m_mesh_projection.SetPerspective(45.0f, (float)m_width / (float)m_height, z_near, z_far);
         load_mesh_textures();
@@ -422,7 +436,13 @@ public:
         init_square();
         init_fbo();
     }
-    ~GlApp() {}
+    ~GlApp() {
+        // Wake the decoding threads that wait for staging memory, and stop them before the buffer is released
+        m_texture_uploader.Close();
+        m_texture_loader.Close();
+        m_texture_uploader.Delete();
+        m_mipmap_generator.Delete();
+    }
     void run() {
         while (!glfwWindowShouldClose(m_window)) {
             render();
@@ -5,7 +5,8 @@
 #include "cyTriMesh.h"
 #include "cyMatrix.h"
 #include "cyGL.h"
-#include "lodepng.h"
+#include "cyFrustum.h"
+#include "cyTextureLoader.h"
 #include <vector>
 
 struct Vertex {
@@ -19,6 +20,13 @@ private:
     int m_width, m_height;
     std::string m_title;
     GLuint m_cubemap_texture;
+    GLsizei m_cubemap_face_size = 0;
+    int m_cubemap_faces_loaded = 0;
+    cy::GLTextureUploader m_texture_uploader;
+    cy::GLMipmapGenerator m_mipmap_generator;
+    cy::TextureBatchLoader m_texture_loader;
+    // The faces still being decoded, with the cube map faces that receive them
+    std::vector<std::pair<cy::TextureBatchLoader::Future, GLenum>> m_pending_faces;
     cyTriMesh m_cubemap_mesh;
     GLuint m_cubemap_vao;
     GLuint m_cubemap_vbo;
@@ -34,15 +42,19 @@ private:
     cyTriMesh m_model_mesh;
     cy::GLSLProgram m_model_shader_program;
     cy::Matrix4f m_model_matrix_reflection;
-    cy::Matrix4f m_model_matrix;
-    cy::Matrix4f m_view;
+    cy::Matrix34f m_model_matrix;
+    cy::Matrix34f m_view;
     cy::Matrix4f m_projection;
     cy::Matrix4f m_mvp;
     float m_camera_distance = 2.0f;
     float m_camera_yaw = 0.0f;
     float m_camera_pitch = 0.0f;
     cy::Vec3f m_camera_pos;
+    cy::CullStats m_cull_stats;
+    std::string m_window_title;
     bool m_left_mouse_pressed = false;
+    cy::GLProfiler m_profiler;
+    bool m_tracing = false;
     public:
     GlApp(int width, int height, std::string title) : m_width(width), m_height(height), m_title(title) {
         init_glfw(m_width, m_height, m_title);
@@ -51,7 +63,7 @@ private:
         init_cubemap_texture();
         init_cubemap_mesh();
         init_rectangle();
-        m_view = cy::Matrix4f::Identity();
+        m_view = cy::Matrix34f::Identity();
         m_projection = cy::Matrix4f::Identity();
         m_projection.SetPerspective(45.0f, (float)m_width / (float)m_height, 0.1f, 100.0f);
         m_cubemap_shader_program.BuildFiles("shaders/cubemap.vs", "shaders/cubemap.fs");
@@ -59,8 +71,16 @@ private:
         init_model_mesh();
         m_model_shader_program.BuildFiles("shaders/model.vs", "shaders/model.fs");
         m_rectangle_shader_program.BuildFiles("shaders/rectangle.vs", "shaders/rectangle.fs");
+        m_profiler.Initialize(3, 64, true);
+    }
+    ~GlApp() {
+        // Wake the loader threads if they wait for staging memory, then release the buffer once they have stopped
+        m_texture_uploader.Close();
+        m_texture_loader.Close();
+        m_texture_uploader.Delete();
+        m_mipmap_generator.Delete();
+        m_profiler.Delete();
     }
-    ~GlApp() {}
 
     void init_rectangle() {
         std::vector<Vertex> vertices = {
@@ -86,14 +106,13 @@ private:
     }
     void render_rectangle() {
         m_rectangle_shader_program.Bind();
-        m_rectangle_shader_program["view"] = m_view;
+        m_rectangle_shader_program["view"] = cy::Matrix4f(m_view);
         m_rectangle_shader_program["projection"] = m_projection;
         m_rectangle_shader_program["cubemap"] = 0;
         m_rectangle_shader_program["cameraPos"] = m_camera_pos;
         m_rectangle_shader_program["model"] = cy::Matrix4f::Translation(cy::Vec3f(0.0f, -0.244793, 0.0f));
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, m_cubemap_texture);
-        glBindVertexArray(m_rectangle_vao);
+        cy::GLState::BindTexture(0, GL_TEXTURE_CUBE_MAP, m_cubemap_texture);
+        cy::GLState::BindVertexArray(m_rectangle_vao);
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
     }
     static void mouse_button_callback(GLFWwindow* window, int button, int action, int mods) {
@@ -125,53 +144,98 @@ private:
         }
     }
     void render() {
+        // Queue and issue the uploads of the cube map faces decoded since the last frame
+        receive_cubemap_faces();
+        m_texture_uploader.Process();
+        m_profiler.BeginFrame();
         float x = m_camera_distance * std::sin(m_camera_yaw) * std::cos(m_camera_pitch);
         float y = m_camera_distance * std::sin(m_camera_pitch);
         float z = m_camera_distance * std::cos(m_camera_yaw) * std::cos(m_camera_pitch);
         m_camera_pos = cy::Vec3f(x, y, z);
         m_view.SetView(cy::Vec3f(x, y, z), cy::Vec3f(0.0f, 0.0f, 0.0f), cy::Vec3f(0.0f, 1.0f, 0.0f));
-        m_mvp = m_projection * cy::Matrix4f(cy::Matrix3f(m_view));
+        m_mvp = m_projection * cy::Matrix3f(m_view);
         glfwGetFramebufferSize(m_window, &m_width, &m_height);
-        glViewport(0, 0, m_width, m_height);
+        cy::GLState::Viewport(0, 0, m_width, m_height);
         glClearColor(1.0f, 0.0f, 0.0f, 1.0f);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
-        glDepthMask(GL_FALSE);
-        //glDepthFunc(GL_LEQUAL);
+        m_profiler.BeginZone("skybox");
+        cy::GLState::DepthMask(false);
+        //cy::GLState::DepthFunc(GL_LEQUAL);
         m_cubemap_shader_program.Bind();
         m_cubemap_shader_program["mvp"] = m_mvp;
         m_cubemap_shader_program["cubemap"] = 0;
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, m_cubemap_texture);
-        glBindVertexArray(m_cubemap_vao);
+        cy::GLState::BindTexture(0, GL_TEXTURE_CUBE_MAP, m_cubemap_texture);
+        cy::GLState::BindVertexArray(m_cubemap_vao);
         glDrawElements(GL_TRIANGLES, m_cubemap_mesh.NF() * 3, GL_UNSIGNED_INT, 0);
-        glDepthMask(GL_TRUE);
+        cy::GLState::DepthMask(true);
+        m_profiler.EndZone();
         m_model_shader_program.Bind();  
+        m_cull_stats.Reset();
+        m_profiler.BeginZone("model");
         render_model();
+        m_profiler.EndZone();
+        m_profiler.BeginZone("reflection");
         render_model_reflection();
+        m_profiler.EndZone();
+        m_profiler.BeginZone("floor");
         render_rectangle();
+        m_profiler.EndZone();
+        m_profiler.EndFrame();
+        show_frame_stats();
+    }
+
+    // Starts recording the GPU passes, or stops recording and writes them as a Chrome trace
+    void toggle_gpu_trace() {
+        if (!m_tracing) {
+            m_profiler.StartTrace();
+            std::cout << "Recording GPU trace" << std::endl;
+        } else {
+            m_profiler.StopTrace();
+            if (m_profiler.WriteTrace("gpu_trace.json")) std::cout << "GPU trace written to gpu_trace.json" << std::endl;
+        }
+        m_tracing = !m_tracing;
+    }
+    // Tests the object-space bounding box of the model against the frustum of the given view
+    bool is_model_visible(cy::Matrix34f const& view) {
+        cy::Frustumf frustum(m_projection * (view * m_model_matrix));
+        bool visible = frustum.IsVisible(m_model_mesh.GetBoundMin(), m_model_mesh.GetBoundMax());
+        m_cull_stats.Add(visible);
+        return visible;
+    }
+    // Shows the number of drawn and tested models, the redundant uniform and state calls skipped in this frame,
+    // and the average GPU frame time in the window title
+    void show_frame_stats() {
+        char gpu_time[32];
+        snprintf(gpu_time, sizeof(gpu_time), "%.2f", m_profiler.GetFrame().averageTime);
+        std::string title = m_title + " [drawn " + std::to_string(m_cull_stats.NumVisible()) + "/" + std::to_string(m_cull_stats.NumTested())
+                          + ", skipped uniforms " + std::to_string(cy::GLSLProgram::GetElidedUniformCount())
+                          + ", skipped state " + std::to_string(cy::GLState::GetElidedCount()) + ", gpu " + gpu_time + " ms]";
+        cy::GLSLProgram::ResetElidedUniformCount();
+        cy::GLState::ResetCounts();
+        if (title != m_window_title) {
+            m_window_title = title;
+            glfwSetWindowTitle(m_window, m_window_title.c_str());
+        }
     }
     void render_model() {
-        m_model_shader_program["model"] = m_model_matrix;
-        m_model_shader_program["view"] = m_view;
-        m_model_shader_program["projection"] = m_projection;
-        m_model_shader_program["cameraPos"] = m_camera_pos;
-        m_model_shader_program["skybox"] = 0;
-        m_model_shader_program["light_position"] = cy::Vec3f(1.0f, 1.0f, 10.0f);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, m_cubemap_texture);
-        glBindVertexArray(m_model_vao);
-        glDrawElements(GL_TRIANGLES, m_model_mesh.NF() * 3, GL_UNSIGNED_INT, 0);
+        draw_model(m_view);
     }
     void render_model_reflection() {
-        m_model_shader_program["model"] = m_model_matrix;
-        m_model_shader_program["view"] = m_view * cy::Matrix4f::Scale(1.0f, -1.0f, 1.0f) * cy::Matrix4f::Translation(cy::Vec3f(0.0f, 2 * 0.244793f, 0.0f));
+        cy::Matrix34f reflection_view = m_view * cy::Matrix34f::Scale(1.0f, -1.0f, 1.0f) * cy::Matrix34f::Translation(cy::Vec3f(0.0f, 2 * 0.244793f, 0.0f));
+        draw_model(reflection_view);
+    }
+    // Draws the model seen from the given view. When the model and its reflection are both drawn,
+    // only the view reaches OpenGL for the second one; the other uniforms and binds are skipped by the caches.
+    void draw_model(cy::Matrix34f const& view) {
+        if (!is_model_visible(view)) return;
+        m_model_shader_program["model"] = cy::Matrix4f(m_model_matrix);
+        m_model_shader_program["view"] = cy::Matrix4f(view);
         m_model_shader_program["projection"] = m_projection;
         m_model_shader_program["cameraPos"] = m_camera_pos;
         m_model_shader_program["skybox"] = 0;
         m_model_shader_program["light_position"] = cy::Vec3f(1.0f, 1.0f, 10.0f);
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, m_cubemap_texture);
-        glBindVertexArray(m_model_vao);
+        cy::GLState::BindTexture(0, GL_TEXTURE_CUBE_MAP, m_cubemap_texture);
+        cy::GLState::BindVertexArray(m_model_vao);
         glDrawElements(GL_TRIANGLES, m_model_mesh.NF() * 3, GL_UNSIGNED_INT, 0);
     }
 
@@ -183,9 +247,17 @@ private:
         m_window = glfwCreateWindow(width, height, title.c_str(), NULL, NULL);
         glfwMakeContextCurrent(m_window);
         glfwSetKeyCallback(m_window, [](GLFWwindow* window, int key, int scancode, int action, int mods) {
+            GlApp* app = (GlApp*)glfwGetWindowUserPointer(window);
             if (key == GLFW_KEY_ESCAPE && action == GLFW_PRESS) {
                 glfwSetWindowShouldClose(window, GLFW_TRUE);
             }
+            // P prints the GPU time of each pass, T starts and stops recording a trace of the passes
+            if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+                app->m_profiler.PrintStatistics();
+            }
+            if (key == GLFW_KEY_T && action == GLFW_PRESS) {
+                app->toggle_gpu_trace();
+            }
         });
         glfwSetWindowUserPointer(m_window, this);
         glfwSetMouseButtonCallback(m_window, mouse_button_callback);
@@ -195,32 +267,69 @@ private:
         glewInit();
     }
     void init_gl_state() {
-        glEnable(GL_DEPTH_TEST);
+        cy::GLState::Enable(GL_DEPTH_TEST);
     }
-    void load_cubemap_face(const std::string& face_path, GLenum face) {
-        std::vector<unsigned char> data;
-        unsigned width, height;
-        unsigned error = lodepng::decode(data, width, height, face_path.c_str());
-        if (error) {
-            std::cerr << "Failed to load cubemap face: " << face_path << std::endl;
+    // Runs on the main thread for each decoded face and submits its upload from the staging buffer.
+    // The storage of the cube map is allocated by the first valid face that arrives, the others must match its size.
+    void receive_cubemap_face(const cy::TextureBatchLoader::Image& image, GLenum face) {
+        if (image.error) {
+            std::cerr << "Failed to load cubemap face: " << image.path << std::endl;
+            if (image.pixels != nullptr) m_texture_uploader.Submit(image.ticket, [](const void*) {});
+            return;
+        }
+        GLsizei width = image.width, height = image.height;
+        if (width != height || width <= 0) {
+            std::cerr << "Cubemap face is not square: " << image.path << std::endl;
+            m_texture_uploader.Submit(image.ticket, [](const void*) {});
             return;
         }
-        glTexImage2D(face, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, data.data());
+        if (m_cubemap_face_size == 0) {
+            m_cubemap_face_size = width;
+            glTextureStorage2D(m_cubemap_texture, cy::GLTextureCubeMap::NumMipmapLevels(width), GL_RGBA8, width, height);
+        } else if (width != m_cubemap_face_size) {
+            std::cerr << "Cubemap face size does not match: " << image.path << std::endl;
+            m_texture_uploader.Submit(image.ticket, [](const void*) {});
+            return;
+        }
+        GLint layer = face - GL_TEXTURE_CUBE_MAP_POSITIVE_X;
+        m_texture_uploader.Submit(image.ticket, [this, layer, width, height](const void* offset) {
+            glTextureSubImage3D(m_cubemap_texture, 0, 0, 0, layer, width, height, 1, GL_RGBA, GL_UNSIGNED_BYTE, offset);
+            if (++m_cubemap_faces_loaded == 6) m_mipmap_generator.Generate(m_cubemap_texture);
+        });
+    }
+    void receive_cubemap_faces() {
+        for (size_t i = 0; i < m_pending_faces.size();) {
+            if (!cy::TextureBatchLoader::IsReady(m_pending_faces[i].first)) {
+                i++;
+                continue;
+            }
+            receive_cubemap_face(*m_pending_faces[i].first.get(), m_pending_faces[i].second);
+            m_pending_faces.erase(m_pending_faces.begin() + i);
+        }
     }
     void init_cubemap_texture() {
-        glGenTextures(1, &m_cubemap_texture);
-        glBindTexture(GL_TEXTURE_CUBE_MAP, m_cubemap_texture);
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_CUBE_MAP, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
-        load_cubemap_face("cubemap/cubemap_posx.png", GL_TEXTURE_CUBE_MAP_POSITIVE_X);
-        load_cubemap_face("cubemap/cubemap_negx.png", GL_TEXTURE_CUBE_MAP_NEGATIVE_X);
-        load_cubemap_face("cubemap/cubemap_posy.png", GL_TEXTURE_CUBE_MAP_POSITIVE_Y);
-        load_cubemap_face("cubemap/cubemap_negy.png", GL_TEXTURE_CUBE_MAP_NEGATIVE_Y);
-        load_cubemap_face("cubemap/cubemap_posz.png", GL_TEXTURE_CUBE_MAP_POSITIVE_Z);
-        load_cubemap_face("cubemap/cubemap_negz.png", GL_TEXTURE_CUBE_MAP_NEGATIVE_Z);
+        glCreateTextures(GL_TEXTURE_CUBE_MAP, 1, &m_cubemap_texture);
+        glTextureParameteri(m_cubemap_texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR_MIPMAP_LINEAR);
+        glTextureParameteri(m_cubemap_texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTextureParameteri(m_cubemap_texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(m_cubemap_texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(m_cubemap_texture, GL_TEXTURE_WRAP_R, GL_CLAMP_TO_EDGE);
+        // The faces are decoded concurrently into the staging buffer and uploaded by render() as they become ready
+        m_texture_uploader.Initialize(64 << 20);
+        m_texture_loader.SetAllocator([this](size_t size, uint64_t& ticket) {
+            return m_texture_uploader.Allocate(size, ticket);
+        });
+        const GLenum faces[6] = {
+            GL_TEXTURE_CUBE_MAP_POSITIVE_X, GL_TEXTURE_CUBE_MAP_NEGATIVE_X,
+            GL_TEXTURE_CUBE_MAP_POSITIVE_Y, GL_TEXTURE_CUBE_MAP_NEGATIVE_Y,
+            GL_TEXTURE_CUBE_MAP_POSITIVE_Z, GL_TEXTURE_CUBE_MAP_NEGATIVE_Z
+        };
+        std::vector<cy::TextureBatchLoader::Future> images = m_texture_loader.Load({
+            "cubemap/cubemap_posx.png", "cubemap/cubemap_negx.png",
+            "cubemap/cubemap_posy.png", "cubemap/cubemap_negy.png",
+            "cubemap/cubemap_posz.png", "cubemap/cubemap_negz.png"
+        });
+        for (int i = 0; i < 6; i++) m_pending_faces.emplace_back(images[i], faces[i]);
     }
     void load_mesh(const std::string& obj_path, float scale_factor, 
                    cyTriMesh& mesh, GLuint& vao, GLuint& vbo, GLuint& ibo) {
@@ -284,7 +393,7 @@ private:
 
     void init_model_mesh() {
         load_mesh_with_normals("models/teapot.obj", m_model_mesh, m_model_vao, m_model_vbo, m_model_ibo);
-        m_model_matrix = cy::Matrix4f::Identity();
+        m_model_matrix = cy::Matrix34f::Identity();
         m_model_mesh.ComputeBoundingBox();
         cy::Vec3f center = m_model_mesh.GetBoundMin() + (m_model_mesh.GetBoundMax() - m_model_mesh.GetBoundMin()) / 2.0f;
         cy::Vec3f size = m_model_mesh.GetBoundMax() - m_model_mesh.GetBoundMin();
@@ -292,9 +401,9 @@ private:
         std::cout << "m_model_mesh.GetBoundMax(): " << m_model_mesh.GetBoundMax().x << ", " << m_model_mesh.GetBoundMax().y << ", " << m_model_mesh.GetBoundMax().z << std::endl;
         float max_size = std::max(size.x, std::max(size.y, size.z));
         std::cout << "max_size: " << max_size << std::endl;
-        cy::Matrix4f translation;
+        cy::Matrix34f translation;
         translation.SetTranslation(-center);
-        cy::Matrix4f scale;
+        cy::Matrix34f scale;
         if (max_size > 0.0f) {
             //std::cout << "scale factor: " << 1.0f / max_size << std::endl;
             //scale.SetScale(0.205f / max_size);
@@ -302,7 +411,7 @@ private:
         } else {
             scale.SetScale(1.0f);
         }
-        m_model_matrix = cy::Matrix4f::RotationX(-M_PI / 2.0f) * scale * translation;
+        m_model_matrix = cy::Matrix34f::RotationX(-M_PI / 2.0f) * scale * translation;
         std::cout << "m_model_matrix: " << (m_model_matrix* cy::Vec4f(m_model_mesh.GetBoundMin(), 1.0f)).x << ", " << (m_model_matrix* cy::Vec4f(m_model_mesh.GetBoundMin(), 1.0f)).y << ", " << (m_model_matrix* cy::Vec4f(m_model_mesh.GetBoundMin(), 1.0f)).z << std::endl;
         std::cout << "m_model_matrix: " << (m_model_matrix* cy::Vec4f(m_model_mesh.GetBoundMax(), 1.0f)).x << ", " << (m_model_matrix* cy::Vec4f(m_model_mesh.GetBoundMax(), 1.0f)).y << ", " << (m_model_matrix* cy::Vec4f(m_model_mesh.GetBoundMax(), 1.0f)).z << std::endl;
     }
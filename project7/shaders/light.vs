@@ -4,7 +4,11 @@ layout(location = 0) in vec3 position;
 layout(location = 1) in vec3 normal;
 layout(location = 2) in vec3 color;
 
-uniform mat4 mvp;
+layout(std140, binding = 1) uniform ObjectBlock {
+    mat4 mvp;
+    mat4 mv;
+    mat4 mshadow;
+};
 
 out vec3 fragColor;
 
@@ -12,7 +12,9 @@ struct Light {
     vec3 material_diffuse_color;
     vec3 material_specular_color;
 };
-uniform Light light;
+layout(std140, binding = 0) uniform FrameBlock {
+    Light light;
+};
 void main() {
     vec3 n = normalize(fragNormalView);
     vec3 light_dir = normalize(light.position_view - fragPositionView);
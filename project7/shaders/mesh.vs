@@ -2,9 +2,11 @@
 
 layout(location = 0) in vec3 vpos;
 layout(location = 1) in vec3 vnormal;
-uniform mat4 mvp;
-uniform mat4 mv;
-uniform mat4 mshadow;
+layout(std140, binding = 1) uniform ObjectBlock {
+    mat4 mvp;
+    mat4 mv;
+    mat4 mshadow;
+};
 out vec3 fragNormalView;
 out vec3 fragPositionView;
 out vec4 fragPositionLightView;
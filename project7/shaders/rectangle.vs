@@ -2,13 +2,16 @@
 
 layout(location = 0) in vec3 position;
 
-uniform mat4 mvp;
-uniform mat4 shadowMVP;
+layout(std140, binding = 1) uniform ObjectBlock {
+    mat4 mvp;
+    mat4 mv;
+    mat4 mshadow;
+};
 
 out vec4 fragPositionLightView;
 
 void main() {
     gl_Position = mvp * vec4(position, 1.0f);
-    fragPositionLightView = shadowMVP * vec4(position, 1.0f);
+    fragPositionLightView = mshadow * vec4(position, 1.0f);
 }
 
@@ -1,8 +1,12 @@
 #version 460 core
 
-uniform mat4 shadowMVP;
+layout(std140, binding = 1) uniform ObjectBlock {
+    mat4 mvp;
+    mat4 mv;
+    mat4 mshadow;
+};
 layout(location = 0) in vec3 position;
 
 void main() {
-    gl_Position = shadowMVP * vec4(position, 1.0);
+    gl_Position = mvp * vec4(position, 1.0);
 }
\ No newline at end of file
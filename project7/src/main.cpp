@@ -3,6 +3,7 @@
 #include <cyMatrix.h>
 #include <cyGL.h>
 #include <cyTriMesh.h>
+#include <cyFrustum.h>
 #include <iostream>
 #include <vector>
 #include <tuple>
@@ -27,6 +28,14 @@ struct Light {
     cy::Vec3f material_specular_color;
 };
 
+// Uniform blocks in std140 layout, matching the declarations in the shaders.
+// The frame block holds the light and is bound once per frame for all programs.
+// The object blocks hold the transformations of each draw call and are bound by their offsets.
+enum { FRAME_BLOCK_BINDING = 0, OBJECT_BLOCK_BINDING = 1 };
+typedef cy::GLBlockLayout<cy::STD140, cy::Vec3f, cy::Vec3f, cy::Vec3f, cy::Vec3f, cy::Vec3f> FrameLayout;  // Light
+typedef cy::GLBlockLayout<cy::STD140, cy::Matrix4f, cy::Matrix4f, cy::Matrix4f> ObjectLayout;          // mvp, mv, mshadow
+enum Object { OBJECT_RECTANGLE, OBJECT_TEAPOT, OBJECT_TEAPOT_SHADOW, OBJECT_LIGHT_MESH, OBJECT_COUNT };
+
 struct MeshData {
     cyTriMesh mesh;
     std::vector<Vertex> vertices;
@@ -34,7 +43,7 @@ struct MeshData {
     GLuint vao = 0;
     GLuint vbo = 0;
     GLuint ibo = 0;
-    cy::Matrix4f model;
+    cy::Matrix34f model;
 };
 
 struct ColoredMeshData {
@@ -44,7 +53,7 @@ struct ColoredMeshData {
     GLuint vao = 0;
     GLuint vbo = 0;
     GLuint ibo = 0;
-    cy::Matrix4f model;
+    cy::Matrix34f model;
 };
 
 class GlApp {
@@ -61,11 +70,11 @@ private:
 
     int m_shadow_map_width = 4096;
     int m_shadow_map_height = 4096;
-    cy::Matrix4f m_rectangle_model;
-    cy::Matrix4f m_view;
+    cy::Matrix34f m_rectangle_model;
+    cy::Matrix34f m_view;
     cy::Matrix4f m_projection;
     cy::Matrix4f m_mvp;
-    cy::Matrix4f m_shadow_view;
+    cy::Matrix34f m_shadow_view;
     cy::Matrix4f m_shadow_projection;
     cy::Matrix4f m_shadow_mvp_texture_rectangle;
     bool m_left_mouse_pressed = false;
@@ -77,10 +86,20 @@ private:
     ColoredMeshData m_light_mesh;
     float m_floor_y_position = 0.0f;
     std::string m_teapot_obj_path;
+    cy::CullStats m_cull_stats;
+    std::string m_window_title;
+    cy::GLProfiler m_profiler;
+    bool m_tracing = false;
     std::string m_light_obj_path;
     cy::GLSLProgram m_mesh_shader_program;
     cy::GLSLProgram m_light_shader_program;
+    double m_shader_build_start_time = 0.0;
     Light m_light;
+    cy::GLUniformBlockBuffer m_frame_block;
+    cy::GLStreamBuffer m_object_stream;              // Object blocks, rewritten every frame in place
+    GLint m_object_alignment = 256;
+    GLintptr m_object_offsets[OBJECT_COUNT] = {};     // Offsets of this frame's object blocks in the stream
+    cy::Matrix4f m_object_mvp[OBJECT_COUNT];          // CPU copies of the mvps for culling; the stream is write-only
     GLuint m_shadow_map_fbo;
     GLuint m_shadow_map_texture;
     bool m_ctrl_pressed = false;
@@ -95,9 +114,12 @@ public:
         init_gl_state();
         init_shadow_map();
         init_shaders();
+        init_uniform_blocks();
         init_rectangle();
         init_projection_matrices();
         init_meshes();
+        finish_shaders();
+        m_profiler.Initialize(3, 64, true);
     }
 
     ~GlApp() {
@@ -110,8 +132,13 @@ public:
         glDeleteVertexArrays(1, &m_light_mesh.vao);
         glDeleteBuffers(1, &m_light_mesh.vbo);
         glDeleteBuffers(1, &m_light_mesh.ibo);
+        cy::GLState::DeleteFramebuffer(m_shadow_map_fbo);
         glDeleteFramebuffers(1, &m_shadow_map_fbo);
+        cy::GLState::DeleteTexture(m_shadow_map_texture);
         glDeleteTextures(1, &m_shadow_map_texture);
+        m_frame_block.Delete();
+        m_object_stream.Delete();
+        m_profiler.Delete();
         glfwDestroyWindow(m_window);
         glfwTerminate();
     }
@@ -157,6 +184,13 @@ private:
             if (key == GLFW_KEY_LEFT_CONTROL && action == GLFW_RELEASE) {
                 app->m_ctrl_pressed = false;
             }
+            // P prints the GPU time of each pass, T starts and stops recording a trace of the passes
+            if (key == GLFW_KEY_P && action == GLFW_PRESS) {
+                app->m_profiler.PrintStatistics();
+            }
+            if (key == GLFW_KEY_T && action == GLFW_PRESS) {
+                app->toggle_gpu_trace();
+            }
         });
 
         glfwSetMouseButtonCallback(m_window, [](GLFWwindow* window, int button, int action, int mods) {
@@ -201,7 +235,7 @@ private:
             app->m_width = width;
             app->m_height = height;
             app->m_projection.SetPerspective(45.0f, (float)width / (float)height, 0.1f, 100.0f);
-            glViewport(0, 0, width, height);
+            cy::GLState::Viewport(0, 0, width, height);
         });
     }
 
@@ -216,27 +250,50 @@ private:
 
     void init_gl_state() {
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glEnable(GL_DEPTH_TEST);
-        glDepthFunc(GL_LESS);
-        glEnable(GL_CULL_FACE);
-        glCullFace(GL_BACK);
-        glFrontFace(GL_CCW);
+        cy::GLState::Enable(GL_DEPTH_TEST);
+        cy::GLState::DepthFunc(GL_LESS);
+        cy::GLState::Enable(GL_CULL_FACE);
+        cy::GLState::CullFace(GL_BACK);
+        cy::GLState::FrontFace(GL_CCW);
     }
 
+    // Submits all shader builds without waiting for them; the driver compiles them while the meshes are loaded
     void init_shaders() {
-        m_shader_program.BuildFiles("shaders/rectangle.vs", "shaders/rectangle.fs");
-        m_mesh_shader_program.BuildFiles("shaders/mesh.vs", "shaders/mesh.fs");
-        m_light_shader_program.BuildFiles("shaders/light.vs", "shaders/light.fs");
+        // Linked programs are cached in the working directory, so only the first launch (or a shader or driver change) compiles them
+        m_shader_build_start_time = glfwGetTime();
+        cy::GLSLProgram::SetBinaryCacheDirectory("shader_cache");
+        m_shader_program.BuildFilesAsync("shaders/rectangle.vs", "shaders/rectangle.fs");
+        m_mesh_shader_program.BuildFilesAsync("shaders/mesh.vs", "shaders/mesh.fs");
+        m_light_shader_program.BuildFilesAsync("shaders/light.vs", "shaders/light.fs");
+        m_shadow_shader_program.BuildFilesAsync("shaders/shadow.vs", "shaders/shadow.fs");
         m_light.position = cy::Vec3f(0.0f, m_light_pos_distance, m_light_pos_distance);
         m_light.intensity_ambient = cy::Vec3f(0.1f, 0.1f, 0.1f);
         m_light.intensity_diffuse = cy::Vec3f(1.0f, 1.0f, 1.0f);
         m_light.material_diffuse_color = cy::Vec3f(1.0f, 0.0f, 0.0f);
         m_light.material_specular_color = cy::Vec3f(1.0f, 1.0f, 1.0f);
-        m_mesh_shader_program["light.intensity_ambient"] = m_light.intensity_ambient;
-        m_mesh_shader_program["light.intensity_diffuse"] = m_light.intensity_diffuse;
-        m_mesh_shader_program["light.material_diffuse_color"] = m_light.material_diffuse_color;
-        m_mesh_shader_program["light.material_specular_color"] = m_light.material_specular_color;
-        m_shadow_shader_program.BuildFiles("shaders/shadow.vs", "shaders/shadow.fs");
+    }
+
+    void finish_shaders() {
+        double wait_start_time = glfwGetTime();
+        if (!cy::GLSLProgram::FinishAll()) {
+            std::cerr << "Failed to build shaders" << std::endl;
+        }
+        double end_time = glfwGetTime();
+        std::cout << "Shaders built in " << (end_time - m_shader_build_start_time) * 1000.0 << " ms, waited "
+                  << (end_time - wait_start_time) * 1000.0 << " ms after loading"
+                  << (m_shadow_shader_program.IsFromBinaryCache() ? " (from binary cache)" : "") << std::endl;
+    }
+
+    void init_uniform_blocks() {
+        m_frame_block.Initialize(FrameLayout::Size());
+        m_object_alignment = cy::GLUniformBuffer::GetOffsetAlignment();
+        m_object_stream.Initialize(OBJECT_COUNT * cy::GLBlockRoundUp(ObjectLayout::Size(), m_object_alignment));
+        // The light parameters other than the position do not change, so they are written to the CPU copy only once
+        void* frame = m_frame_block.GetBlock(0);
+        FrameLayout::Write<1>(frame, m_light.intensity_ambient);
+        FrameLayout::Write<2>(frame, m_light.intensity_diffuse);
+        FrameLayout::Write<3>(frame, m_light.material_diffuse_color);
+        FrameLayout::Write<4>(frame, m_light.material_specular_color);
     }
 
     MeshData load_mesh(const std::string& path, bool compute_transform) {
@@ -274,20 +331,20 @@ private:
         glVertexArrayAttribBinding(mesh_data.vao, 1, 0);
         glEnableVertexArrayAttrib(mesh_data.vao, 1);
 
+        mesh_data.mesh.ComputeBoundingBox();
         if (compute_transform) {
-            mesh_data.mesh.ComputeBoundingBox();
             cy::Vec3f center = mesh_data.mesh.GetBoundMin() + (mesh_data.mesh.GetBoundMax() - mesh_data.mesh.GetBoundMin()) / 2.0f;
             cy::Vec3f size = mesh_data.mesh.GetBoundMax() - mesh_data.mesh.GetBoundMin();
             float max_size = std::max(size.x, std::max(size.y, size.z));
-            cy::Matrix4f translation;
+            cy::Matrix34f translation;
             translation.SetTranslation(-center);
-            cy::Matrix4f scale;
+            cy::Matrix34f scale;
             if (max_size > 1.0f) {
                 scale.SetScale(1.0f / max_size);
             } else {
                 scale.SetScale(1.0f);
             }
-            cy::Matrix4f rotationX;
+            cy::Matrix34f rotationX;
             rotationX.SetRotationX(-M_PI / 2.0f);
             mesh_data.model = rotationX * scale * translation;
         } else {
@@ -302,6 +359,7 @@ private:
 
         std::cout << "Loading light mesh from " << path << std::endl;
         mesh_data.mesh.LoadFromFileObj(path.c_str(), true);  // Load with materials
+        mesh_data.mesh.ComputeBoundingBox();
 
         // Material colors from light.mtl
         cy::Vec3f frame_color(0.588f, 0.588f, 0.588f);  // Gray frame
@@ -372,7 +430,7 @@ private:
         m_teapot = load_mesh(m_teapot_obj_path, true);
 
         // Compute floor position based on teapot
-        cy::Vec4f min_point = m_teapot.model * cy::Vec4f(m_teapot.mesh.GetBoundMin(), 1.0f);
+        cy::Vec3f min_point = m_teapot.model * m_teapot.mesh.GetBoundMin();
         m_floor_y_position = min_point.y;
         m_rectangle_model.SetTranslation(cy::Vec3f(0.0f, m_floor_y_position, 0.0f));
 
@@ -419,63 +477,89 @@ private:
         m_shadow_projection.SetPerspective(45.0f, (float)m_shadow_map_width / (float)m_shadow_map_height, 0.1f, 100.0f);
     }
 
+    // Tests the object-space bounding box of the mesh against the frustum of the mvp of the given object
+    bool is_visible(cyTriMesh const& mesh, Object object) {
+        bool visible = cy::Frustumf(m_object_mvp[object]).IsVisible(mesh.GetBoundMin(), mesh.GetBoundMax());
+        m_cull_stats.Add(visible);
+        return visible;
+    }
+
+    // Shows the number of drawn and tested meshes (in both passes), the redundant uniform and state calls skipped in this frame,
+    // the total number of frames that waited for the GPU to release an object block region, and the average GPU frame time
+    // in the window title
+    void show_frame_stats() {
+        char gpu_time[32];
+        snprintf(gpu_time, sizeof(gpu_time), "%.2f", m_profiler.GetFrame().averageTime);
+        std::string title = m_title + " [drawn " + std::to_string(m_cull_stats.NumVisible()) + "/" + std::to_string(m_cull_stats.NumTested())
+                          + ", skipped uniforms " + std::to_string(cy::GLSLProgram::GetElidedUniformCount())
+                          + ", skipped state " + std::to_string(cy::GLState::GetElidedCount())
+                          + ", stream stalls " + std::to_string(m_object_stream.GetStallCount()) + ", gpu " + gpu_time + " ms]";
+        cy::GLSLProgram::ResetElidedUniformCount();
+        cy::GLState::ResetCounts();
+        if (title != m_window_title) {
+            m_window_title = title;
+            glfwSetWindowTitle(m_window, m_window_title.c_str());
+        }
+    }
+
     void render() {
+        m_profiler.BeginFrame();
+        m_cull_stats.Reset();
         update_light();
         update_camera();
+        update_uniform_blocks();
         render_shadow_map();
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         glfwGetFramebufferSize(m_window, &m_width, &m_height);
-        glViewport(0, 0, m_width, m_height);
+        cy::GLState::Viewport(0, 0, m_width, m_height);
 
         // Draw rectangle (floor) with shadow
+        // The shadow map stays bound to unit 0 for the teapot and the next frame; the shadow pass does not sample it
+        m_profiler.BeginZone("floor");
         m_shader_program.Bind();
-        m_shader_program["mvp"] = m_mvp;
-        glBindVertexArray(m_rectangle_vao);
-        m_shader_program["shadowMVP"] = m_shadow_mvp_texture_rectangle;
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, m_shadow_map_texture);
+        bind_object_block(OBJECT_RECTANGLE);
+        cy::GLState::BindVertexArray(m_rectangle_vao);
+        cy::GLState::BindTexture(0, GL_TEXTURE_2D, m_shadow_map_texture);
         m_shader_program["shadowMap"] = 0;
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-        glBindTexture(GL_TEXTURE_2D, 0);
         CY_GL_ERROR;
+        m_profiler.EndZone();
 
         // Draw teapot with lighting and shadow
-        cy::Matrix4f teapot_mvp = m_projection * m_view * m_teapot.model;
-        cy::Matrix4f teapot_mv = m_view * m_teapot.model;
-        cy::Matrix4f scale_texture;
-        scale_texture.SetScale(0.5f);
-        cy::Matrix4f translation_texture;
-        float bias = 0.01f;
-        translation_texture.SetTranslation(cy::Vec3f(0.5f, 0.5f, 0.5f - bias));
-        cy::Matrix4f teapot_shadow_mvp_texture = translation_texture * scale_texture * m_shadow_projection * m_shadow_view * m_teapot.model;
-
-        m_mesh_shader_program.Bind();
-        m_mesh_shader_program["mvp"] = teapot_mvp;
-        m_mesh_shader_program["mv"] = teapot_mv;
-        m_mesh_shader_program["mshadow"] = teapot_shadow_mvp_texture;
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, m_shadow_map_texture);
-        m_mesh_shader_program["shadowMap"] = 0;
-        CY_GL_ERROR;
-        // Set light struct members individually (cy::GLSLProgram doesn't support custom structs)
-        cy::Vec4f light_pos_view = m_view * cy::Vec4f(m_light.position, 1.0f);
-        m_mesh_shader_program["light.position_view"] = cy::Vec3f(light_pos_view.x, light_pos_view.y, light_pos_view.z);
-        glBindVertexArray(m_teapot.vao);
-        glDrawElements(GL_TRIANGLES, m_teapot.indices.size(), GL_UNSIGNED_INT, 0);
+        if (is_visible(m_teapot.mesh, OBJECT_TEAPOT)) {
+            cy::GLProfiler::Zone zone(m_profiler, "teapot");
+            m_mesh_shader_program.Bind();
+            bind_object_block(OBJECT_TEAPOT);
+            cy::GLState::BindTexture(0, GL_TEXTURE_2D, m_shadow_map_texture);
+            m_mesh_shader_program["shadowMap"] = 0;
+            CY_GL_ERROR;
+            cy::GLState::BindVertexArray(m_teapot.vao);
+            glDrawElements(GL_TRIANGLES, m_teapot.indices.size(), GL_UNSIGNED_INT, 0);
+        }
 
         // Draw light mesh at light position with material colors
-        cy::Matrix4f scale_light;
-        scale_light.SetScale(0.1f);  // Smaller scale
-        cy::Matrix4f rotation_light;
-        rotation_light.SetRotationX(-M_PI / 2.0f);  // Rotate to point downward
-        cy::Matrix4f translation_light;
-        translation_light.SetTranslation(m_light.position);
-        m_light_mesh.model = translation_light * rotation_light * scale_light;
-        cy::Matrix4f light_mesh_mvp = m_projection * m_view * m_light_mesh.model;
-        m_light_shader_program.Bind();
-        m_light_shader_program["mvp"] = light_mesh_mvp;
-        glBindVertexArray(m_light_mesh.vao);
-        glDrawElements(GL_TRIANGLES, m_light_mesh.indices.size(), GL_UNSIGNED_INT, 0);
+        if (is_visible(m_light_mesh.mesh, OBJECT_LIGHT_MESH)) {
+            cy::GLProfiler::Zone zone(m_profiler, "light");
+            m_light_shader_program.Bind();
+            bind_object_block(OBJECT_LIGHT_MESH);
+            cy::GLState::BindVertexArray(m_light_mesh.vao);
+            glDrawElements(GL_TRIANGLES, m_light_mesh.indices.size(), GL_UNSIGNED_INT, 0);
+        }
+        m_object_stream.EndFrame();  // Fences the object blocks after the last draw that reads them
+        m_profiler.EndFrame();
+        show_frame_stats();
+    }
+
+    // Starts recording the GPU passes, or stops recording and writes them as a Chrome trace
+    void toggle_gpu_trace() {
+        if (!m_tracing) {
+            m_profiler.StartTrace();
+            std::cout << "Recording GPU trace" << std::endl;
+        } else {
+            m_profiler.StopTrace();
+            if (m_profiler.WriteTrace("gpu_trace.json")) std::cout << "GPU trace written to gpu_trace.json" << std::endl;
+        }
+        m_tracing = !m_tracing;
     }
 
     void update_light() {
@@ -490,14 +574,56 @@ private:
         float y = m_camera_distance * std::sin(m_camera_pitch);
         float z = m_camera_distance * std::cos(m_camera_yaw) * std::cos(m_camera_pitch);
         m_view.SetView(cy::Vec3f(x, y, z), cy::Vec3f(0.0f, 0.0f, 0.0f), cy::Vec3f(0.0f, 1.0f, 0.0f));
-        m_mvp = m_projection * m_view * m_rectangle_model;
+        m_mvp = m_projection * (m_view * m_rectangle_model);
         m_shadow_view.SetView(m_light.position, cy::Vec3f(0.0f, 0.0f, 0.0f), cy::Vec3f(0.0f, 1.0f, 0.0f));
-        cy::Matrix4f scale_texture;
+        cy::Matrix34f scale_texture;
         scale_texture.SetScale(0.5f);
-        cy::Matrix4f translation_texture;
+        cy::Matrix34f translation_texture;
         float bias = 0.0001f;
         translation_texture.SetTranslation(cy::Vec3f(0.5f, 0.5f, 0.5f - bias));
-        m_shadow_mvp_texture_rectangle = translation_texture * scale_texture * m_shadow_projection * m_shadow_view * m_rectangle_model;
+        m_shadow_mvp_texture_rectangle = (translation_texture * scale_texture) * m_shadow_projection * (m_shadow_view * m_rectangle_model);
+    }
+
+    // Allocates the block of the given object in this frame's region of the stream and writes its mvp,
+    // which is also kept for culling. The members the shaders of the object do not read are left unwritten.
+    void* write_object_block(Object object, cy::Matrix4f const& mvp) {
+        void* block = m_object_stream.Allocate(ObjectLayout::Size(), m_object_alignment, m_object_offsets[object]);
+        m_object_mvp[object] = mvp;
+        ObjectLayout::Write<0>(block, mvp);
+        return block;
+    }
+
+    void bind_object_block(Object object) {
+        m_object_stream.Bind(GL_UNIFORM_BUFFER, OBJECT_BLOCK_BINDING, m_object_offsets[object], ObjectLayout::Size());
+    }
+
+    // Writes the light and the transformations of all draw calls in this frame. The light block is uploaded with one
+    // call, the object blocks are written directly into the persistently mapped stream.
+    void update_uniform_blocks() {
+        FrameLayout::Write<0>(m_frame_block.GetBlock(0), m_view * m_light.position);
+        m_frame_block.Upload();
+        m_frame_block.Bind(FRAME_BLOCK_BINDING);
+
+        m_object_stream.BeginFrame();
+        void* rectangle = write_object_block(OBJECT_RECTANGLE, m_mvp);
+        ObjectLayout::Write<2>(rectangle, m_shadow_mvp_texture_rectangle);
+
+        // Model-view stays affine; only the projections need full 4x4 products
+        cy::Matrix34f teapot_mv = m_view * m_teapot.model;
+        cy::Matrix34f scale_texture;
+        scale_texture.SetScale(0.5f);
+        cy::Matrix34f translation_texture;
+        float bias = 0.01f;
+        translation_texture.SetTranslation(cy::Vec3f(0.5f, 0.5f, 0.5f - bias));
+        cy::Matrix4f teapot_shadow_mvp = m_shadow_projection * (m_shadow_view * m_teapot.model);
+        void* teapot = write_object_block(OBJECT_TEAPOT, m_projection * teapot_mv);
+        ObjectLayout::Write<1>(teapot, cy::Matrix4f(teapot_mv));
+        ObjectLayout::Write<2>(teapot, (translation_texture * scale_texture) * teapot_shadow_mvp);
+        write_object_block(OBJECT_TEAPOT_SHADOW, teapot_shadow_mvp);
+
+        m_light_mesh.model = cy::Matrix34f::RotationX(-M_PI / 2.0f) * cy::Matrix34f::Scale(0.1f);  // Point downward, smaller scale
+        m_light_mesh.model.SetTranslationComponent(m_light.position);
+        write_object_block(OBJECT_LIGHT_MESH, m_projection * (m_view * m_light_mesh.model));
     }
 
     void init_shadow_map() {
@@ -519,16 +645,18 @@ private:
     }
 
     void render_shadow_map() {
-        glBindFramebuffer(GL_FRAMEBUFFER, m_shadow_map_fbo);
+        cy::GLProfiler::Zone zone(m_profiler, "shadow map");
+        cy::GLState::BindFramebuffer(GL_FRAMEBUFFER, m_shadow_map_fbo);
         glClear(GL_DEPTH_BUFFER_BIT);
-        glViewport(0, 0, m_shadow_map_width, m_shadow_map_height);
+        cy::GLState::Viewport(0, 0, m_shadow_map_width, m_shadow_map_height);
         m_shadow_shader_program.Bind();
         // Only render teapot to shadow map (teapot casts shadows, light mesh does not)
-        cy::Matrix4f teapot_shadow_mvp = m_shadow_projection * m_shadow_view * m_teapot.model;
-        m_shadow_shader_program["shadowMVP"] = teapot_shadow_mvp;
-        glBindVertexArray(m_teapot.vao);
-        glDrawElements(GL_TRIANGLES, m_teapot.indices.size(), GL_UNSIGNED_INT, 0);
-        glBindFramebuffer(GL_FRAMEBUFFER, 0);
+        if (is_visible(m_teapot.mesh, OBJECT_TEAPOT_SHADOW)) {
+            bind_object_block(OBJECT_TEAPOT_SHADOW);
+            cy::GLState::BindVertexArray(m_teapot.vao);
+            glDrawElements(GL_TRIANGLES, m_teapot.indices.size(), GL_UNSIGNED_INT, 0);
+        }
+        cy::GLState::BindFramebuffer(GL_FRAMEBUFFER, 0);
     }
 };
 
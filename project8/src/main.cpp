@@ -3,8 +3,12 @@
 #include <cyMatrix.h>
 #include <cyVector.h>
 #include <cyGL.h>
+#include <algorithm>
+#include <cstring>
+#include <fstream>
 #include <iostream>
 #include <lodepng.h>
+#include <thread>
 
 struct Vertex {
     cy::Vec3f position;
@@ -19,17 +23,19 @@ class GlApp {
         init_gl_state();
         init_quad_mesh();
         init_shaders();
-        init_texture(normal_map_image_path, m_normal_map_texture);
-        if (!displacement_map_image_path.empty()) {
-            init_texture(displacement_map_image_path, m_displacement_map_texture);
-        }
+        init_textures();
         init_projection_matrix();
         init_view_matrix();
         init_model_matrix();
-        m_mvp = m_projection * m_view * m_model;
-        m_mv_matrix = m_view * m_model;
+        cy::Matrix34f mv = m_view * m_model;
+        m_mvp = m_projection * mv;
+        m_mv_matrix = cy::Matrix4f(mv);
     }
     ~GlApp() {
+        // Wake the loader if it waits for staging memory, then release the buffer once it has stopped
+        m_texture_uploader.Close();
+        if (m_texture_loader.joinable()) m_texture_loader.join();
+        m_texture_uploader.Delete();
         glDeleteTextures(1, &m_normal_map_texture);
         if (!m_displacement_map_image_path.empty()) {
             glDeleteTextures(1, &m_displacement_map_texture);
@@ -85,42 +91,53 @@ class GlApp {
     }
     void init_gl_state() {
         glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
-        glEnable(GL_DEPTH_TEST);
-        glDepthFunc(GL_LESS);
-        glEnable(GL_CULL_FACE);
-        glCullFace(GL_BACK);
-        glFrontFace(GL_CW);
+        cy::GLState::Enable(GL_DEPTH_TEST);
+        cy::GLState::DepthFunc(GL_LESS);
+        cy::GLState::Enable(GL_CULL_FACE);
+        cy::GLState::CullFace(GL_BACK);
+        cy::GLState::FrontFace(GL_CW);
         CY_GL_ERROR;
     }
     void render() {
+        // Issue the uploads of the maps decoded since the last frame
+        m_texture_uploader.Process();
         glfwGetFramebufferSize(m_window, &m_width, &m_height);
-        glViewport(0, 0, m_width, m_height);
+        cy::GLState::Viewport(0, 0, m_width, m_height);
         glClear(GL_COLOR_BUFFER_BIT | GL_DEPTH_BUFFER_BIT);
         render_quad();
         if (m_render_wireframe) {
             render_quad_gs();
         }
         CY_GL_ERROR;
+        show_frame_stats();
+    }
+    // Shows the redundant uniform and state calls skipped in this frame in the window title
+    void show_frame_stats() {
+        std::string title = m_title + " [skipped uniforms " + std::to_string(cy::GLSLProgram::GetElidedUniformCount())
+                          + ", skipped state " + std::to_string(cy::GLState::GetElidedCount()) + "]";
+        cy::GLSLProgram::ResetElidedUniformCount();
+        cy::GLState::ResetCounts();
+        if (title != m_window_title) {
+            m_window_title = title;
+            glfwSetWindowTitle(m_window, m_window_title.c_str());
+        }
     }
     void render_quad() {
         m_shader_program.Bind();
         m_shader_program["mvp"] = m_mvp;
-        m_light_position_view = cy::Vec3f(m_view * cy::Vec4f(2.0f, 2.0f, 2.0f, 1.0f));
+        m_light_position_view = m_view * cy::Vec3f(2.0f, 2.0f, 2.0f);
         m_shader_program["light_position_view"] = m_light_position_view;
         m_shader_program["mv_matrix"] = m_mv_matrix;
-        glActiveTexture(GL_TEXTURE0);
-        glBindTexture(GL_TEXTURE_2D, m_normal_map_texture);
+        cy::GLState::BindTexture(0, GL_TEXTURE_2D, m_normal_map_texture);
         m_shader_program.SetUniform("normalMap", 0);
-        glBindVertexArray(m_quad_vao);
+        cy::GLState::BindVertexArray(m_quad_vao);
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
     }
     void render_quad_gs() {
         m_shader_program_gs.Bind();
         m_shader_program_gs["mvp"] = m_mvp;
-        glBindVertexArray(m_quad_vao);
+        cy::GLState::BindVertexArray(m_quad_vao);
         glDrawElements(GL_TRIANGLES, 6, GL_UNSIGNED_INT, 0);
-        glBindVertexArray(0);
     }
     void init_quad_mesh() {
         std::vector<Vertex> vertices = {
@@ -150,23 +167,94 @@ class GlApp {
         m_shader_program_gs.BuildFiles("shaders/geometry.vs", "shaders/geometry.fs", "shaders/geometry.gs");
         CY_GL_ERROR;
     }
-    void init_texture(std::string image_path, GLuint& texture) {
-        glGenTextures(1, &texture);
-        glBindTexture(GL_TEXTURE_2D, texture);
-        std::vector<unsigned char> image;
-        unsigned width, height;
-        unsigned error = lodepng::decode(image, width, height, image_path.c_str());
-        if (error) {
-            std::cerr << "Failed to load normal map texture: " << image_path << std::endl;
-            return;
+    // Creates the map textures and decodes their images on a separate thread; render() uploads them when they are ready
+    void init_textures() {
+        init_texture(m_normal_map_texture);
+        if (!m_displacement_map_image_path.empty()) {
+            init_texture(m_displacement_map_texture);
         }
-        glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, image.data());
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
-        glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+        m_texture_uploader.Initialize(64 << 20);
+        m_texture_loader = std::thread([this] {
+            load_texture(m_normal_map_image_path, m_normal_map_texture);
+            if (!m_displacement_map_image_path.empty()) {
+                load_texture(m_displacement_map_image_path, m_displacement_map_texture);
+            }
+        });
+    }
+    void init_texture(GLuint& texture) {
+        glCreateTextures(GL_TEXTURE_2D, 1, &texture);
+        glTextureParameteri(texture, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+        glTextureParameteri(texture, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+        glTextureParameteri(texture, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
         CY_GL_ERROR;
     }
+    // Decoding state of load_texture: the rows are gathered in staging memory and uploaded in bands
+    struct TextureStream {
+        GlApp* app;
+        GLuint texture;
+        cy::GLTextureUploader::Ticket ticket = 0;
+        unsigned char* band = nullptr;  // staging memory of the band being filled, null between bands
+        unsigned band_y = 0, band_rows = 0;
+        bool closed = false;  // the uploader stopped handing out memory
+        size_t wide_row = 0;  // the size of a row that does not fit in the staging buffer, zero if all rows fit
+    };
+    // Called by the decoder for each row: allocates the staging memory at the first row of a band and submits the
+    // upload of the band at its last row. Bands are at most 4 MB and never larger than the staging buffer, so an
+    // allocation only fails if the uploader is closed or a single row is larger than the whole buffer.
+    static unsigned receive_row(void* context, const unsigned char* row, unsigned y, unsigned width, unsigned height) {
+        TextureStream& stream = *static_cast<TextureStream*>(context);
+        size_t row_size = size_t(width) * 4;
+        if (stream.band == nullptr) {
+            stream.band_y = y;
+            size_t band_size = std::min(size_t(4) << 20, size_t(stream.app->m_texture_uploader.GetSize()));
+            stream.band_rows = unsigned(std::min(band_size / row_size, size_t(height - y)));
+            if (stream.band_rows == 0) {
+                stream.wide_row = row_size;
+                return 1;
+            }
+            stream.band = (unsigned char*)stream.app->m_texture_uploader.Allocate(row_size * stream.band_rows, stream.ticket);
+            if (stream.band == nullptr) {
+                stream.closed = true;
+                return 1;
+            }
+        }
+        std::memcpy(stream.band + (y - stream.band_y) * row_size, row, row_size);
+        if (y + 1 == stream.band_y + stream.band_rows) {
+            GLuint texture = stream.texture;
+            unsigned band_y = stream.band_y, band_rows = stream.band_rows;
+            stream.app->m_texture_uploader.Submit(stream.ticket, [texture, width, height, band_y, band_rows](const void* offset) {
+                if (band_y == 0) glTextureStorage2D(texture, 1, GL_RGBA8, width, height);
+                glTextureSubImage2D(texture, 0, 0, band_y, width, band_rows, GL_RGBA, GL_UNSIGNED_BYTE, offset);
+            });
+            stream.band = nullptr;
+        }
+        return 0;
+    }
+    // Runs on the loader thread: feeds the file to the decoder in pieces, so neither the file nor the whole image is
+    // in memory, and large maps don't need to fit in the staging buffer at once
+    void load_texture(const std::string& image_path, GLuint texture) {
+        std::ifstream file(image_path, std::ios::binary);
+        lodepng::State state;
+        TextureStream stream{this, texture};
+        LodePNGStreamDecoder* decoder = lodepng_stream_decoder_new(&state, receive_row, &stream);
+        unsigned error = decoder == nullptr ? 83 : !file ? 78 : 0;
+        std::vector<char> buffer(1 << 16);
+        while (!error && file) {
+            file.read(buffer.data(), buffer.size());
+            error = lodepng_stream_decoder_feed(decoder, (const unsigned char*)buffer.data(), (size_t)file.gcount());
+        }
+        if (!error) error = lodepng_stream_decoder_finish(decoder);
+        lodepng_stream_decoder_delete(decoder);
+        // A band that the decoder stopped in still has to give its staging memory back
+        if (stream.band != nullptr) m_texture_uploader.Submit(stream.ticket, [](const void*) {});
+        if (stream.wide_row != 0) {
+            std::cerr << "Failed to load texture: " << image_path << ": a row of " << stream.wide_row
+                      << " bytes does not fit in the " << m_texture_uploader.GetSize() << " byte staging buffer" << std::endl;
+        } else if (error && !stream.closed) {
+            std::cerr << "Failed to load normal map texture: " << image_path << std::endl;
+        }
+    }
     void init_projection_matrix() {
         m_projection.SetPerspective(45.0f, (float)m_width / (float)m_height, 0.01f, 100.0f);
     }
@@ -180,6 +268,7 @@ class GlApp {
     GLFWwindow* m_window;
     int m_width, m_height;
     std::string m_title;
+    std::string m_window_title;
     GLuint m_quad_vao;
     GLuint m_quad_vbo;
     GLuint m_quad_ibo;
@@ -190,12 +279,14 @@ class GlApp {
     std::string m_displacement_map_image_path;
     GLuint m_displacement_map_texture;
     cy::Matrix4f m_projection;
-    cy::Matrix4f m_view;
-    cy::Matrix4f m_model;
+    cy::Matrix34f m_view;
+    cy::Matrix34f m_model;
     cy::Matrix4f m_mvp;
     cy::Matrix4f m_mv_matrix;
     cy::Vec3f m_light_position_view;
     bool m_render_wireframe = false;
+    cy::GLTextureUploader m_texture_uploader;
+    std::thread m_texture_loader;
 };
 
 int main(int argc, char** argv) {